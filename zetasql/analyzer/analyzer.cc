@@ -30,11 +30,13 @@
 #include "zetasql/parser/parse_tree.h"
 #include "zetasql/parser/parse_tree_errors.h"
 #include "zetasql/parser/parser.h"
+#include "zetasql/public/analyzer_runtime_info.h"
 #include "zetasql/public/parse_helpers.h"
 #include "zetasql/public/parse_resume_location.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_visitor.h"
 #include "zetasql/resolved_ast/validator.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
@@ -46,6 +48,10 @@
 ABSL_FLAG(bool, zetasql_validate_resolved_ast, true,
           "Run validator on resolved AST before returning it.");
 
+ABSL_FLAG(int32_t, zetasql_validator_num_threads, 1,
+          "Maximum number of threads used to validate one resolved statement. "
+          "See ValidatorOptions::num_threads.");
+
 // This provides a way to extract and look at the zetasql resolved AST
 // from within some other test or tool.  It prints to cout rather than logging
 // because the output is often too big to log without truncating.
@@ -131,6 +137,188 @@ const AnalyzerOptions& GetOptionsWithArenas(
   return **copy;
 }
 
+// A Catalog that forwards all lookups to another Catalog, adding the time
+// spent and the number of lookups to the kCatalogLookup phase. This is only
+// interposed when collecting runtime info, so that lookups pay no extra
+// indirection otherwise.
+class RuntimeInfoCatalog : public Catalog {
+ public:
+  RuntimeInfoCatalog(Catalog* catalog, AnalyzerRuntimeInfo* runtime_info)
+      : catalog_(catalog),
+        timing_(runtime_info->mutable_phase(
+            AnalyzerRuntimeInfo::kCatalogLookup)) {}
+  RuntimeInfoCatalog(const RuntimeInfoCatalog&) = delete;
+  RuntimeInfoCatalog& operator=(const RuntimeInfoCatalog&) = delete;
+
+  std::string FullName() const override { return catalog_->FullName(); }
+
+  absl::Status FindTable(const absl::Span<const std::string>& path,
+                         const Table** table,
+                         const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindTable(path, table, options);
+  }
+  absl::Status FindModel(const absl::Span<const std::string>& path,
+                         const Model** model,
+                         const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindModel(path, model, options);
+  }
+  absl::Status FindConnection(const absl::Span<const std::string>& path,
+                              const Connection** connection,
+                              const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindConnection(path, connection, options);
+  }
+  absl::Status FindFunction(const absl::Span<const std::string>& path,
+                            const Function** function,
+                            const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindFunction(path, function, options);
+  }
+  absl::Status FindTableValuedFunction(
+      const absl::Span<const std::string>& path,
+      const TableValuedFunction** function,
+      const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindTableValuedFunction(path, function, options);
+  }
+  absl::Status FindProcedure(const absl::Span<const std::string>& path,
+                             const Procedure** procedure,
+                             const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindProcedure(path, procedure, options);
+  }
+  absl::Status FindType(const absl::Span<const std::string>& path,
+                        const Type** type,
+                        const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindType(path, type, options);
+  }
+  absl::Status FindConversion(const Type* from_type, const Type* to_type,
+                              const FindConversionOptions& options,
+                              Conversion* conversion) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindConversion(from_type, to_type, options, conversion);
+  }
+  absl::Status FindConstantWithPathPrefix(
+      const absl::Span<const std::string> path, int* num_names_consumed,
+      const Constant** constant, const FindOptions& options) override {
+    ScopedPhaseTimer timer(timing_);
+    return catalog_->FindConstantWithPathPrefix(path, num_names_consumed,
+                                                constant, options);
+  }
+
+  std::string SuggestTable(
+      const absl::Span<const std::string>& mistyped_path) override {
+    return catalog_->SuggestTable(mistyped_path);
+  }
+  std::string SuggestModel(
+      const absl::Span<const std::string>& mistyped_path) override {
+    return catalog_->SuggestModel(mistyped_path);
+  }
+  std::string SuggestFunction(
+      const absl::Span<const std::string>& mistyped_path) override {
+    return catalog_->SuggestFunction(mistyped_path);
+  }
+  std::string SuggestTableValuedFunction(
+      const absl::Span<const std::string>& mistyped_path) override {
+    return catalog_->SuggestTableValuedFunction(mistyped_path);
+  }
+  std::string SuggestConstant(
+      const absl::Span<const std::string>& mistyped_path) override {
+    return catalog_->SuggestConstant(mistyped_path);
+  }
+
+ private:
+  Catalog* catalog_;  // Not owned.
+  AnalyzerRuntimeInfo::PhaseTiming* timing_;  // Not owned.
+};
+
+// Counts the nodes of a resolved AST.
+class ResolvedNodeCounter : public ResolvedASTVisitor {
+ public:
+  int64_t num_nodes() const { return num_nodes_; }
+
+  absl::Status DefaultVisit(const ResolvedNode* node) override {
+    ++num_nodes_;
+    return node->ChildrenAccept(this);
+  }
+
+ private:
+  int64_t num_nodes_ = 0;
+};
+
+// Collects the AnalyzerRuntimeInfo for one Analyze*() call, if
+// <options.collect_runtime_info()> is set. Otherwise, all methods are no-ops
+// and all timers get NULL PhaseTimings. The kTotal phase covers the lifetime
+// of this object up to Finish().
+class RuntimeInfoCollector {
+ public:
+  RuntimeInfoCollector(const AnalyzerOptions& options, Catalog* catalog)
+      : catalog_(catalog) {
+    if (options.collect_runtime_info()) {
+      runtime_info_ = absl::make_unique<AnalyzerRuntimeInfo>();
+      total_timer_ = absl::make_unique<ScopedPhaseTimer>(
+          runtime_info_->mutable_phase(AnalyzerRuntimeInfo::kTotal));
+      runtime_info_catalog_ =
+          absl::make_unique<RuntimeInfoCatalog>(catalog, runtime_info_.get());
+      catalog_ = runtime_info_catalog_.get();
+      set_arena(options.arena().get());
+    }
+  }
+  RuntimeInfoCollector(const RuntimeInfoCollector&) = delete;
+  RuntimeInfoCollector& operator=(const RuntimeInfoCollector&) = delete;
+
+  // The Catalog that resolution should use.
+  Catalog* catalog() const { return catalog_; }
+
+  // NULL if runtime info is not being collected.
+  AnalyzerRuntimeInfo* runtime_info() const { return runtime_info_.get(); }
+
+  AnalyzerRuntimeInfo::PhaseTiming* phase(AnalyzerRuntimeInfo::Phase phase) {
+    return runtime_info_ == nullptr ? nullptr
+                                    : runtime_info_->mutable_phase(phase);
+  }
+
+  // Sets the arena whose allocations are counted, if it was not known at
+  // construction. That only happens when analyzing a given ParserOutput
+  // without an arena in AnalyzerOptions, after parsing is already done.
+  void set_arena(zetasql_base::UnsafeArena* arena) {
+    if (runtime_info_ != nullptr && arena_ == nullptr && arena != nullptr) {
+      arena_ = arena;
+      start_arena_bytes_ = arena->status().bytes_allocated();
+    }
+  }
+
+  // Stops the kTotal timer, computes the counters and stores the result in
+  // <output>.
+  void Finish(AnalyzerOutput* output) {
+    if (runtime_info_ == nullptr) return;
+    total_timer_.reset();
+    ResolvedNodeCounter counter;
+    const ResolvedNode* root = output->resolved_statement();
+    if (root == nullptr) root = output->resolved_expr();
+    if (root != nullptr) {
+      ZETASQL_CHECK_OK(root->Accept(&counter));
+    }
+    runtime_info_->set_num_resolved_nodes(counter.num_nodes());
+    if (arena_ != nullptr) {
+      runtime_info_->set_arena_bytes_allocated(
+          arena_->status().bytes_allocated() - start_arena_bytes_);
+    }
+    output->set_runtime_info(*runtime_info_);
+  }
+
+ private:
+  Catalog* catalog_;
+  std::unique_ptr<AnalyzerRuntimeInfo> runtime_info_;
+  std::unique_ptr<ScopedPhaseTimer> total_timer_;
+  std::unique_ptr<RuntimeInfoCatalog> runtime_info_catalog_;
+  zetasql_base::UnsafeArena* arena_ = nullptr;  // Not owned.
+  int64_t start_arena_bytes_ = 0;
+};
+
 }  // namespace
 
 void AllowedHintsAndOptions::AddOption(const std::string& name,
@@ -690,17 +878,26 @@ AnalyzerOutput::~AnalyzerOutput() {
 static absl::Status FinishAnalyzeStatementImpl(
     absl::string_view sql, const ParserOutput& parser_output,
     Resolver* resolver, const AnalyzerOptions& options, Catalog* catalog,
-    TypeFactory* type_factory,
+    TypeFactory* type_factory, RuntimeInfoCollector* runtime_info_collector,
     std::unique_ptr<const ResolvedStatement>* resolved_statement) {
   VLOG(5) << "Parsed AST:\n" << parser_output.statement()->DebugString();
 
-  ZETASQL_RETURN_IF_ERROR(resolver->ResolveStatement(sql, parser_output.statement(),
-                                             resolved_statement));
+  {
+    ScopedPhaseTimer timer(
+        runtime_info_collector->phase(AnalyzerRuntimeInfo::kResolver));
+    ZETASQL_RETURN_IF_ERROR(resolver->ResolveStatement(
+        sql, parser_output.statement(), resolved_statement));
+  }
 
   VLOG(3) << "Resolved AST:\n" << (*resolved_statement)->DebugString();
 
   if (absl::GetFlag(FLAGS_zetasql_validate_resolved_ast)) {
-    Validator validator(options.language_options());
+    ScopedPhaseTimer timer(
+        runtime_info_collector->phase(AnalyzerRuntimeInfo::kValidator));
+    ValidatorOptions validator_options;
+    validator_options.num_threads =
+        absl::GetFlag(FLAGS_zetasql_validator_num_threads);
+    Validator validator(options.language_options(), validator_options);
     ZETASQL_RETURN_IF_ERROR(
         validator.ValidateResolvedStatement(resolved_statement->get()));
   }
@@ -738,6 +935,13 @@ static absl::Status UnsupportedStatementErrorOrStatus(
   return status;
 }
 
+static absl::Status AnalyzeStatementFromParserOutputImpl(
+    std::unique_ptr<ParserOutput>* statement_parser_output,
+    bool take_ownership_on_success, const AnalyzerOptions& options,
+    absl::string_view sql, TypeFactory* type_factory,
+    RuntimeInfoCollector* runtime_info_collector,
+    std::unique_ptr<const AnalyzerOutput>* output);
+
 static absl::Status AnalyzeStatementImpl(
     absl::string_view sql, const AnalyzerOptions& options, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
@@ -745,17 +949,23 @@ static absl::Status AnalyzeStatementImpl(
 
   ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options));
 
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   VLOG(1) << "Parsing statement:\n" << sql;
   std::unique_ptr<ParserOutput> parser_output;
-  const absl::Status status = ParseStatement(
-      sql, options.GetParserOptions(), &parser_output);
+  absl::Status status;
+  {
+    ScopedPhaseTimer timer(
+        runtime_info_collector.phase(AnalyzerRuntimeInfo::kParser));
+    status = ParseStatement(sql, options.GetParserOptions(), &parser_output);
+  }
   if (!status.ok()) {
     return UnsupportedStatementErrorOrStatus(
         status, ParseResumeLocation::FromStringView(sql), options);
   }
 
-  return AnalyzeStatementFromParserOutputOwnedOnSuccess(
-      &parser_output, options, sql, catalog, type_factory, output);
+  return AnalyzeStatementFromParserOutputImpl(
+      &parser_output, /*take_ownership_on_success=*/true, options, sql,
+      type_factory, &runtime_info_collector, output);
 }
 
 absl::Status AnalyzeStatement(absl::string_view sql,
@@ -788,18 +998,23 @@ static absl::Status AnalyzeNextStatementImpl(
             << resume_location->byte_position();
   }
 
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   std::unique_ptr<ParserOutput> parser_output;
-  const absl::Status status = ParseNextStatement(
-      resume_location, options.GetParserOptions(), &parser_output,
-      at_end_of_input);
+  absl::Status status;
+  {
+    ScopedPhaseTimer timer(
+        runtime_info_collector.phase(AnalyzerRuntimeInfo::kParser));
+    status = ParseNextStatement(resume_location, options.GetParserOptions(),
+                                &parser_output, at_end_of_input);
+  }
   if (!status.ok()) {
     return UnsupportedStatementErrorOrStatus(status, *resume_location, options);
   }
   ZETASQL_RET_CHECK(parser_output != nullptr);
 
-  return AnalyzeStatementFromParserOutputOwnedOnSuccess(
-      &parser_output, options, resume_location->input(), catalog,
-      type_factory, output);
+  return AnalyzeStatementFromParserOutputImpl(
+      &parser_output, /*take_ownership_on_success=*/true, options,
+      resume_location->input(), type_factory, &runtime_info_collector, output);
 }
 
 absl::Status AnalyzeNextStatement(
@@ -818,10 +1033,12 @@ absl::Status AnalyzeNextStatement(
       options.error_message_mode(), resume_location->input(), status);
 }
 
+// <runtime_info_collector> also provides the Catalog to resolve against.
 static absl::Status AnalyzeStatementFromParserOutputImpl(
     std::unique_ptr<ParserOutput>* statement_parser_output,
     bool take_ownership_on_success, const AnalyzerOptions& options,
-    absl::string_view sql, Catalog* catalog, TypeFactory* type_factory,
+    absl::string_view sql, TypeFactory* type_factory,
+    RuntimeInfoCollector* runtime_info_collector,
     std::unique_ptr<const AnalyzerOutput>* output) {
   AnalyzerOptions local_options = options;
 
@@ -837,20 +1054,22 @@ static absl::Status AnalyzeStatementFromParserOutputImpl(
         (*statement_parser_output)->id_string_pool());
   }
   output->reset();
+  runtime_info_collector->set_arena(local_options.arena().get());
 
+  Catalog* catalog = runtime_info_collector->catalog();
   std::unique_ptr<const ResolvedStatement> resolved_statement;
   Resolver resolver(catalog, type_factory, &local_options);
-  const absl::Status status =
-      FinishAnalyzeStatementImpl(
-          sql, *(statement_parser_output->get()), &resolver, local_options,
-          catalog, type_factory, &resolved_statement);
+  resolver.set_runtime_info(runtime_info_collector->runtime_info());
+  const absl::Status status = FinishAnalyzeStatementImpl(
+      sql, *(statement_parser_output->get()), &resolver, local_options,
+      catalog, type_factory, runtime_info_collector, &resolved_statement);
   if (!status.ok()) {
     return ConvertInternalErrorLocationAndAdjustErrorString(
         local_options.error_message_mode(), sql, status);
   }
   std::unique_ptr<ParserOutput> owned_parser_output(
       take_ownership_on_success ? statement_parser_output->release() : nullptr);
-  *output = absl::make_unique<AnalyzerOutput>(
+  auto analyzer_output = absl::make_unique<AnalyzerOutput>(
       local_options.id_string_pool(), local_options.arena(),
       std::move(resolved_statement),
       AnalyzerOutputProperties(),
@@ -860,6 +1079,8 @@ static absl::Status AnalyzeStatementFromParserOutputImpl(
           resolver.deprecation_warnings()),
       resolver.undeclared_parameters(),
       resolver.undeclared_positional_parameters());
+  runtime_info_collector->Finish(analyzer_output.get());
+  *output = std::move(analyzer_output);
   return absl::OkStatus();
 }
 
@@ -867,18 +1088,20 @@ absl::Status AnalyzeStatementFromParserOutputOwnedOnSuccess(
     std::unique_ptr<ParserOutput>* statement_parser_output,
     const AnalyzerOptions& options, absl::string_view sql, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   return AnalyzeStatementFromParserOutputImpl(
       statement_parser_output, /*take_ownership_on_success=*/true, options,
-      sql, catalog, type_factory, output);
+      sql, type_factory, &runtime_info_collector, output);
 }
 
 absl::Status AnalyzeStatementFromParserOutputUnowned(
     std::unique_ptr<ParserOutput>* statement_parser_output,
     const AnalyzerOptions& options, absl::string_view sql, Catalog* catalog,
     TypeFactory* type_factory, std::unique_ptr<const AnalyzerOutput>* output) {
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   return AnalyzeStatementFromParserOutputImpl(
       statement_parser_output, /*take_ownership_on_success=*/false, options,
-      sql, catalog, type_factory, output);
+      sql, type_factory, &runtime_info_collector, output);
 }
 
 // Coerces <resolved_expr> to <target_type>, using assignment semantics
@@ -900,24 +1123,36 @@ static absl::Status ConvertExprToTargetType(
       sql);
 }
 
+// <runtime_info_collector> also provides the Catalog to resolve against.
 static absl::Status AnalyzeExpressionFromParserASTImpl(
     const ASTExpression& ast_expression,
     std::unique_ptr<ParserOutput> parser_output, absl::string_view sql,
-    const AnalyzerOptions& options, Catalog* catalog, TypeFactory* type_factory,
-    const Type* target_type, std::unique_ptr<const AnalyzerOutput>* output) {
+    const AnalyzerOptions& options, TypeFactory* type_factory,
+    const Type* target_type, RuntimeInfoCollector* runtime_info_collector,
+    std::unique_ptr<const AnalyzerOutput>* output) {
+  Catalog* catalog = runtime_info_collector->catalog();
   std::unique_ptr<const ResolvedExpr> resolved_expr;
   Resolver resolver(catalog, type_factory, &options);
-  ZETASQL_RETURN_IF_ERROR(resolver.ResolveStandaloneExpr(
-      sql, &ast_expression, &resolved_expr));
+  resolver.set_runtime_info(runtime_info_collector->runtime_info());
+  {
+    ScopedPhaseTimer timer(
+        runtime_info_collector->phase(AnalyzerRuntimeInfo::kResolver));
+    ZETASQL_RETURN_IF_ERROR(resolver.ResolveStandaloneExpr(
+        sql, &ast_expression, &resolved_expr));
+  }
   VLOG(3) << "Resolved AST:\n" << resolved_expr->DebugString();
 
   if (target_type != nullptr) {
+    ScopedPhaseTimer timer(
+        runtime_info_collector->phase(AnalyzerRuntimeInfo::kResolver));
     ZETASQL_RETURN_IF_ERROR(ConvertExprToTargetType(ast_expression, sql, options,
                                             catalog, type_factory, target_type,
                                             &resolved_expr));
   }
 
   if (absl::GetFlag(FLAGS_zetasql_validate_resolved_ast)) {
+    ScopedPhaseTimer timer(
+        runtime_info_collector->phase(AnalyzerRuntimeInfo::kValidator));
     Validator validator(options.language_options());
     ZETASQL_RETURN_IF_ERROR(
         validator.ValidateStandaloneResolvedExpr(resolved_expr.get()));
@@ -938,7 +1173,7 @@ static absl::Status AnalyzeExpressionFromParserASTImpl(
   // Make sure we're starting from a clean state for CheckFieldsAccessed.
   resolved_expr->ClearFieldsAccessed();
 
-  *output = absl::make_unique<AnalyzerOutput>(
+  auto analyzer_output = absl::make_unique<AnalyzerOutput>(
       options.id_string_pool(), options.arena(), std::move(resolved_expr),
       AnalyzerOutputProperties(),
       std::move(parser_output),
@@ -946,6 +1181,8 @@ static absl::Status AnalyzeExpressionFromParserASTImpl(
           options.error_message_mode(), sql, resolver.deprecation_warnings()),
       resolver.undeclared_parameters(),
       resolver.undeclared_positional_parameters());
+  runtime_info_collector->Finish(analyzer_output.get());
+  *output = std::move(analyzer_output);
   return absl::OkStatus();
 }
 
@@ -960,15 +1197,20 @@ static absl::Status AnalyzeExpressionImpl(
   const AnalyzerOptions& options = GetOptionsWithArenas(&options_in, &copy);
   ZETASQL_RETURN_IF_ERROR(ValidateAnalyzerOptions(options));
 
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   std::unique_ptr<ParserOutput> parser_output;
   ParserOptions parser_options = options.GetParserOptions();
-  ZETASQL_RETURN_IF_ERROR(ParseExpression(sql, parser_options, &parser_output));
+  {
+    ScopedPhaseTimer timer(
+        runtime_info_collector.phase(AnalyzerRuntimeInfo::kParser));
+    ZETASQL_RETURN_IF_ERROR(ParseExpression(sql, parser_options, &parser_output));
+  }
   const ASTExpression* expression = parser_output->expression();
   VLOG(5) << "Parsed AST:\n" << expression->DebugString();
 
   return AnalyzeExpressionFromParserASTImpl(
-      *expression, std::move(parser_output), sql, options, catalog,
-      type_factory, target_type, output);
+      *expression, std::move(parser_output), sql, options, type_factory,
+      target_type, &runtime_info_collector, output);
 }
 
 absl::Status AnalyzeExpression(absl::string_view sql,
@@ -1006,9 +1248,10 @@ absl::Status AnalyzeExpressionFromParserASTForAssignmentToType(
     const Type* target_type, std::unique_ptr<const AnalyzerOutput>* output) {
   std::unique_ptr<AnalyzerOptions> copy;
   const AnalyzerOptions& options = GetOptionsWithArenas(&options_in, &copy);
+  RuntimeInfoCollector runtime_info_collector(options, catalog);
   const absl::Status status = AnalyzeExpressionFromParserASTImpl(
-      ast_expression, /*parser_output=*/nullptr, sql, options, catalog,
-      type_factory, target_type, output);
+      ast_expression, /*parser_output=*/nullptr, sql, options, type_factory,
+      target_type, &runtime_info_collector, output);
   return ConvertInternalErrorLocationAndAdjustErrorString(
       options.error_message_mode(), sql, status);
 }
@@ -1379,6 +1379,137 @@ TEST(AnalyzerTest, LanguageOptions) {
             analyzer_options2.error_message_mode());
 }
 
+TEST(AnalyzerTest, FrozenSimpleCatalog) {
+  TypeFactory type_factory;
+  auto catalog = std::make_shared<SimpleCatalog>("root", &type_factory);
+  catalog->AddZetaSQLFunctions();
+  SimpleCatalog* nested = catalog->MakeOwnedSimpleCatalog("Outer")
+                              ->MakeOwnedSimpleCatalog("Inner");
+  nested->AddOwnedTable(
+      new SimpleTable("T", {{"key", type_factory.get_int64()}}));
+  nested->AddOwnedFunction(new Function(
+      std::vector<std::string>{"Outer", "Inner", "Fn"}, "test_group",
+      Function::SCALAR,
+      {{type_factory.get_int64(), {type_factory.get_int64()}, nullptr}}));
+
+  FrozenSimpleCatalogHolder holder;
+  EXPECT_EQ(nullptr, holder.Get());
+  holder.Publish(catalog);
+  EXPECT_TRUE(catalog->is_frozen());
+  EXPECT_TRUE(nested->is_frozen());
+
+  const std::shared_ptr<SimpleCatalog> snapshot = holder.Get();
+  const Table* table;
+  ZETASQL_EXPECT_OK(snapshot->FindTable({"OUTER", "inner", "t"}, &table));
+  EXPECT_EQ("T", table->Name());
+  EXPECT_FALSE(snapshot->FindTable({"outer", "t"}, &table).ok());
+
+  AnalyzerOptions options;
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_EXPECT_OK(AnalyzeStatement(
+      "SELECT outer.inner.fn(key), abs(key) FROM outer.inner.t", options,
+      snapshot.get(), &type_factory, &output));
+
+  // Publishing a new version leaves existing readers untouched.
+  auto next = std::make_shared<SimpleCatalog>("root", &type_factory);
+  holder.Publish(next);
+  EXPECT_EQ(next, holder.Get());
+  ZETASQL_EXPECT_OK(snapshot->FindTable({"outer", "inner", "t"}, &table));
+}
+
+TEST(AnalyzerTest, FunctionSignatureMatchCache) {
+  AnalyzerOptions options;
+  SampleCatalog sample_catalog(options.language());
+  auto cache = std::make_shared<FunctionSignatureMatchCache>();
+  options.set_function_signature_match_cache(cache);
+
+  TypeFactory type_factory;
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(AnalyzeStatement(
+      "SELECT key + 1, key + 2, key + 3, CONCAT(value, 'a'), "
+      "CONCAT(value, 'b') FROM KeyValue",
+      options, sample_catalog.catalog(), &type_factory, &output));
+  EXPECT_EQ(2, cache->num_misses());
+  EXPECT_EQ(3, cache->num_hits());
+  EXPECT_EQ(2, cache->num_entries());
+
+  // A literal NULL and a non-literal have different keys.
+  ZETASQL_ASSERT_OK(AnalyzeStatement("SELECT key + NULL, key + key FROM KeyValue",
+                             options, sample_catalog.catalog(), &type_factory,
+                             &output));
+  EXPECT_EQ(4, cache->num_misses());
+  EXPECT_EQ(3, cache->num_hits());
+
+  // Cached results produce the same resolved AST as uncached ones.
+  const std::string sql = "SELECT key + 1.5, CONCAT(value, NULL) FROM KeyValue";
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options, sample_catalog.catalog(),
+                             &type_factory, &output));
+  const std::string first_debug_string =
+      output->resolved_statement()->DebugString();
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options, sample_catalog.catalog(),
+                             &type_factory, &output));
+  EXPECT_EQ(first_debug_string, output->resolved_statement()->DebugString());
+  EXPECT_EQ(5, cache->num_hits());
+
+  // Mismatches are cached too, and still produce the usual error.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_THAT(AnalyzeStatement("SELECT key + value FROM KeyValue", options,
+                                 sample_catalog.catalog(), &type_factory,
+                                 &output),
+                StatusIs(_, HasSubstr("No matching signature")));
+  }
+  EXPECT_EQ(6, cache->num_hits());
+}
+
+TEST(AnalyzerTest, RuntimeInfo) {
+  AnalyzerOptions options;
+  SampleCatalog sample_catalog(options.language());
+  TypeFactory type_factory;
+  std::unique_ptr<const AnalyzerOutput> output;
+  const std::string sql = "SELECT key + 1, CONCAT(value, 'a') FROM KeyValue";
+
+  // Nothing is collected by default.
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options, sample_catalog.catalog(),
+                             &type_factory, &output));
+  EXPECT_EQ(0, output->runtime_info().phase(AnalyzerRuntimeInfo::kTotal).count);
+  EXPECT_EQ(0, output->runtime_info().num_resolved_nodes());
+
+  options.set_collect_runtime_info(true);
+  ZETASQL_ASSERT_OK(AnalyzeStatement(sql, options, sample_catalog.catalog(),
+                             &type_factory, &output));
+  const AnalyzerRuntimeInfo& info = output->runtime_info();
+  EXPECT_EQ(1, info.phase(AnalyzerRuntimeInfo::kTotal).count);
+  EXPECT_EQ(1, info.phase(AnalyzerRuntimeInfo::kParser).count);
+  EXPECT_EQ(1, info.phase(AnalyzerRuntimeInfo::kResolver).count);
+  // One table and two functions.
+  EXPECT_GE(info.phase(AnalyzerRuntimeInfo::kCatalogLookup).count, 3);
+  EXPECT_GE(info.phase(AnalyzerRuntimeInfo::kFunctionSignatureMatching).count,
+            2);
+  EXPECT_GE(info.phase(AnalyzerRuntimeInfo::kTotal).wall_time,
+            info.phase(AnalyzerRuntimeInfo::kResolver).wall_time);
+  EXPECT_GE(info.phase(AnalyzerRuntimeInfo::kResolver).wall_time,
+            info.phase(AnalyzerRuntimeInfo::kCatalogLookup).wall_time);
+  EXPECT_GT(info.num_resolved_nodes(), 10);
+  EXPECT_GT(info.arena_bytes_allocated(), 0);
+  EXPECT_THAT(info.DebugString(), HasSubstr("catalog_lookup: "));
+
+  // The Catalog used for collection forwards errors and suggestions.
+  EXPECT_THAT(AnalyzeStatement("SELECT * FROM KeyValu", options,
+                               sample_catalog.catalog(), &type_factory,
+                               &output),
+              StatusIs(_, HasSubstr("Did you mean KeyValue?")));
+
+  ZETASQL_ASSERT_OK(AnalyzeExpression("1 + 2", options, sample_catalog.catalog(),
+                              &type_factory, &output));
+  EXPECT_EQ(1, output->runtime_info().phase(AnalyzerRuntimeInfo::kParser).count);
+  EXPECT_GE(output->runtime_info()
+                .phase(AnalyzerRuntimeInfo::kFunctionSignatureMatching)
+                .count,
+            1);
+  // The function call and its two arguments.
+  EXPECT_EQ(3, output->runtime_info().num_resolved_nodes());
+}
+
 TEST(SQLBuilderTest, Int32ParameterForLimit) {
   auto cast_limit = MakeResolvedCast(types::Int64Type(),
                                      MakeResolvedLiteral(values::Int32(2)),
@@ -35,11 +35,13 @@
 #include "zetasql/parser/parse_tree_errors.h"
 #include "zetasql/parser/parser.h"
 #include "zetasql/public/analyzer.h"
+#include "zetasql/public/analyzer_runtime_info.h"
 #include "zetasql/public/cast.h"
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/coercer.h"
 #include "zetasql/public/cycle_detector.h"
 #include "zetasql/public/function.h"
+#include "zetasql/public/function_signature_match_cache.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/numeric_value.h"
 #include "zetasql/public/options.pb.h"
@@ -1307,6 +1309,27 @@ FunctionResolver::FindMatchingSignature(
     const std::vector<const ASTNode*>& arg_locations_in,
     const std::vector<std::pair<const ASTNamedArgument*, int>>& named_arguments)
     const {
+  ScopedPhaseTimer timer(
+      resolver_->runtime_info_ == nullptr
+          ? nullptr
+          : resolver_->runtime_info_->mutable_phase(
+                AnalyzerRuntimeInfo::kFunctionSignatureMatching));
+  FunctionSignatureMatchCache* cache =
+      resolver_->analyzer_options().function_signature_match_cache().get();
+  std::string cache_key;
+  // Named arguments are matched against each signature using their names, so
+  // calls with named arguments are not cached.
+  const bool use_cache = cache != nullptr && named_arguments.empty() &&
+                         FunctionSignatureMatchCache::MakeKey(
+                             function, LanguageOptionsCacheKey(),
+                             input_arguments_in, &cache_key);
+  if (use_cache) {
+    std::unique_ptr<FunctionSignature> cached_signature;
+    if (cache->Lookup(cache_key, &cached_signature)) {
+      return cached_signature.release();
+    }
+  }
+
   std::unique_ptr<FunctionSignature> best_result_signature;
   SignatureMatchResult best_result;
 
@@ -1369,9 +1392,22 @@ FunctionResolver::FindMatchingSignature(
       }
     }
   }
+  if (use_cache && FunctionSignatureMatchCache::IsCacheableSignature(
+                       best_result_signature.get())) {
+    cache->Insert(cache_key, best_result_signature.get());
+  }
   return best_result_signature.release();
 }
 
+const std::string& FunctionResolver::LanguageOptionsCacheKey() const {
+  if (language_options_cache_key_.empty()) {
+    LanguageOptionsProto proto;
+    resolver_->language().Serialize(&proto);
+    language_options_cache_key_ = proto.SerializeAsString();
+  }
+  return language_options_cache_key_;
+}
+
 static void ConvertMakeStructToLiteralIfAllExplicitLiteralFields(
     std::unique_ptr<const ResolvedExpr>* argument) {
   if (!(*argument)->type()->IsStruct() ||
@@ -216,10 +216,16 @@ class FunctionResolver {
       std::vector<ResolvedTVFArg>* tvf_arg_types) const;
 
  private:
+  // Returns the key identifying the LanguageOptions of this analysis in
+  // FunctionSignatureMatchCache. Computed on first use.
+  const std::string& LanguageOptionsCacheKey() const;
+
   Catalog* catalog_;           // Not owned.
   TypeFactory* type_factory_;  // Not owned.
   Resolver* resolver_;         // Not owned.
 
+  mutable std::string language_options_cache_key_;
+
   // Represents the argument types corresponding to a SignatureArgumentKind.
   // There are three possibilities:
   // 1) The object represents an untyped NULL.
@@ -322,6 +328,9 @@ class FunctionResolver {
   // object that the parser produced for this named argument reference and also
   // an integer identifying the corresponding argument type by indexing into
   // <input_arguments>.
+  //
+  // If the AnalyzerOptions have a FunctionSignatureMatchCache, the result is
+  // looked up there first and stored there when possible.
   zetasql_base::StatusOr<const FunctionSignature*> FindMatchingSignature(
       const Function* function,
       const std::vector<InputArgumentType>& input_arguments,
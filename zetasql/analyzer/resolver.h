@@ -34,6 +34,7 @@
 #include "zetasql/parser/parse_tree.h"
 #include "zetasql/parser/parse_tree_decls.h"
 #include "zetasql/public/analyzer.h"
+#include "zetasql/public/analyzer_runtime_info.h"
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/coercer.h"
 #include "zetasql/public/deprecation_warning.pb.h"
@@ -235,6 +236,12 @@ class Resolver {
   // is contained in <sql>.
   void Reset(absl::string_view sql);
 
+  // If <runtime_info> is non-NULL, timings for phases inside the resolver
+  // are added to it. It must outlive this Resolver.
+  void set_runtime_info(AnalyzerRuntimeInfo* runtime_info) {
+    runtime_info_ = runtime_info;
+  }
+
  private:
   // Case-insensitive map of a column name to its position in a list of columns.
   typedef std::map<IdString, int, IdStringCaseLess> ColumnIndexMap;
@@ -300,6 +307,9 @@ class Resolver {
   // Pool where IdStrings are allocated.  Copied from AnalyzerOptions.
   IdStringPool* const id_string_pool_;
 
+  // Where to record timings, if collecting runtime info. Not owned.
+  AnalyzerRuntimeInfo* runtime_info_ = nullptr;
+
   // Next unique column_id to allocate.  Pointer may come from AnalyzerOptions.
   zetasql_base::SequenceNumber* next_column_id_sequence_ = nullptr;  // Not owned.
   std::unique_ptr<zetasql_base::SequenceNumber> owned_column_id_sequence_;
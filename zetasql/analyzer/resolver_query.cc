@@ -1357,12 +1357,8 @@ absl::Status Resolver::ResolveModelTransformSelectList(
       ZETASQL_RET_CHECK(select_column_state->resolved_computed_column != nullptr)
           << "resolved_computed_column cannot be nullptr in "
              "ResolveModelTransformSelectList when resolved_expr is nullptr";
-      zetasql::ResolvedASTDeepCopyVisitor deep_copy_visitor;
-      ZETASQL_RETURN_IF_ERROR(
-          select_column_state->resolved_computed_column->expr()->Accept(
-              &deep_copy_visitor));
-      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ResolvedExpr> resolved_expr_copy,
-                       deep_copy_visitor.ConsumeRootNode<ResolvedExpr>());
+      std::unique_ptr<ResolvedExpr> resolved_expr_copy = CopyResolvedAST(
+          select_column_state->resolved_computed_column->expr());
       transform_list->push_back(MakeResolvedComputedColumn(
           select_column_state->resolved_computed_column->column(),
           std::move(resolved_expr_copy)));
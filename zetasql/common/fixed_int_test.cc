@@ -2187,5 +2187,28 @@ TEST(FixedIntTest, MinMax) {
   EXPECT_EQ((FixedInt<64, 2>::min()), (FixedInt<64, 2>(kint128min)));
   EXPECT_EQ((FixedInt<64, 2>::max()), (FixedInt<64, 2>(kint128max)));
 }
+
+TEST(FixedIntSumAccumulatorTest, MatchesRepeatedAdd) {
+  FixedIntSumAccumulator<2> accumulator;
+  FixedInt<64, 3> expected;
+  EXPECT_EQ(accumulator.GetSum<3>(), expected);
+  for (int128 input : GetTestInputs()) {
+    accumulator.Add(FixedInt<64, 2>(input));
+    expected += FixedInt<64, 3>(input);
+    EXPECT_EQ(accumulator.GetSum<3>(), expected);
+  }
+}
+
+TEST(FixedIntSumAccumulatorTest, ExtremeValues) {
+  FixedIntSumAccumulator<4> accumulator;
+  FixedInt<64, 5> expected;
+  for (int i = 0; i < 1000; ++i) {
+    const FixedInt<64, 4>& x =
+        i % 3 == 0 ? FixedInt<64, 4>::min() : FixedInt<64, 4>::max();
+    accumulator.Add(x);
+    expected += FixedInt<64, 5>(x);
+  }
+  EXPECT_EQ(accumulator.GetSum<5>(), expected);
+}
 }  // namespace
 }  // namespace zetasql
@@ -17,6 +17,7 @@
 #include "zetasql/local_service/local_service.h"
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
@@ -31,9 +32,11 @@
 #include "zetasql/proto/simple_catalog.pb.h"
 #include "zetasql/public/builtin_function.h"
 #include "zetasql/public/evaluator.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/function.h"
 #include "zetasql/public/id_string.h"
 #include "zetasql/public/language_options.h"
+#include "zetasql/public/operator_stats.pb.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/sql_formatter.h"
 #include "zetasql/public/table_from_proto.h"
@@ -47,6 +50,7 @@
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
 #include "zetasql/base/status_macros.h"
 #include "zetasql/base/statusor.h"
 
@@ -57,6 +61,9 @@ using google::protobuf::RepeatedPtrField;
 
 namespace {
 
+// Used for EvaluateQueryRequest::max_rows_per_batch if it is not positive.
+constexpr int kDefaultMaxRowsPerBatch = 1000;
+
 zetasql_base::StatusOr<Value> DeserializeValue(
     const ValueProto& value_proto, const TypeProto& type_proto,
     const std::vector<const google::protobuf::DescriptorPool*>& pools,
@@ -238,6 +245,41 @@ class PreparedExpressionState : public BaseSavedState {
 class PreparedExpressionPool : public SharedStatePool<PreparedExpressionState> {
 };
 
+// Holds a query for the duration of one EvaluateQueryStream() call.
+class PreparedQueryState : public BaseSavedState {
+ public:
+  PreparedQueryState() : BaseSavedState() {}
+  PreparedQueryState(const PreparedQueryState&) = delete;
+  PreparedQueryState& operator=(const PreparedQueryState&) = delete;
+
+  absl::Status InitAndDeserializeOptions(
+      const std::string& sql,
+      const RepeatedPtrField<google::protobuf::FileDescriptorSet>& fdsets,
+      const AnalyzerOptionsProto& proto, AnalyzerOptions* options) {
+    ZETASQL_RETURN_IF_ERROR(BaseSavedState::Init(fdsets));
+
+    absl::MutexLock lock(&mutex_);
+    ZETASQL_RETURN_IF_ERROR(AnalyzerOptions::Deserialize(
+        proto, const_pools_, &factory_, options));
+    zetasql::EvaluatorOptions evaluator_options;
+    evaluator_options.type_factory = &factory_;
+    evaluator_options.default_time_zone = options->default_time_zone();
+    query_ = absl::make_unique<PreparedQuery>(sql, evaluator_options);
+    initialized_ = true;
+    return absl::OkStatus();
+  }
+
+  PreparedQuery* GetPreparedQuery() {
+    absl::MutexLock lock(&mutex_);
+    CHECK(initialized_);
+
+    return query_.get();
+  }
+
+ private:
+  std::unique_ptr<PreparedQuery> query_ ABSL_GUARDED_BY(mutex_);
+};
+
 class RegisteredCatalogState : public BaseSavedState {
  public:
   RegisteredCatalogState() : BaseSavedState() {}
@@ -430,6 +472,98 @@ absl::Status ZetaSqlLocalServiceImpl::EvaluateImpl(
   return absl::OkStatus();
 }
 
+absl::Status ZetaSqlLocalServiceImpl::EvaluateQueryStream(
+    const EvaluateQueryRequest& request,
+    const std::function<bool(const EvaluateQueryResponse&)>& write_response) {
+  PreparedQueryState state;
+  AnalyzerOptions options;
+  ZETASQL_RETURN_IF_ERROR(state.InitAndDeserializeOptions(
+      request.sql(), request.file_descriptor_set(), request.options(),
+      &options));
+
+  RegisteredCatalogState* catalog_state = nullptr;
+  // Keeps a registered catalog alive while the query runs.
+  std::shared_ptr<RegisteredCatalogState> shared_catalog_state;
+  std::unique_ptr<RegisteredCatalogState> new_catalog_state;
+
+  if (request.has_registered_catalog_id()) {
+    int64_t id = request.registered_catalog_id();
+    shared_catalog_state = registered_catalogs_->Get(id);
+    catalog_state = shared_catalog_state.get();
+    if (catalog_state == nullptr) {
+      return MakeSqlError() << "Registered catalog " << id << " unknown.";
+    }
+  } else if (request.has_simple_catalog()) {
+    new_catalog_state = absl::make_unique<RegisteredCatalogState>();
+    catalog_state = new_catalog_state.get();
+    ZETASQL_RETURN_IF_ERROR(catalog_state->Init(request.simple_catalog(),
+                                        request.file_descriptor_set()));
+  }
+
+  const auto& const_pools = state.GetDescriptorPools();
+  ParameterValueMap params;
+  ZETASQL_RETURN_IF_ERROR(RepeatedParametersToMap(
+      request.params(), const_pools, state.GetTypeFactory(), &params));
+  // As in PreparedQuery::Execute() without Prepare(), undeclared parameters
+  // take the types of their values.
+  if (options.query_parameters().empty()) {
+    for (const auto& param : params) {
+      ZETASQL_RETURN_IF_ERROR(
+          options.AddQueryParameter(param.first, param.second.type()));
+    }
+  }
+
+  PreparedQuery* query = state.GetPreparedQuery();
+  ZETASQL_RETURN_IF_ERROR(query->Prepare(options, catalog_state != nullptr
+                                              ? catalog_state->GetCatalog()
+                                              : nullptr));
+
+  QueryExecutionStatsProto execution_stats;
+  PreparedQuery::QueryOptions query_options;
+  query_options.parameters = std::move(params);
+  query_options.execution_stats = &execution_stats;
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   query->ExecuteAfterPrepare(query_options));
+
+  EvaluateQueryResponse response;
+  for (int i = 0; i < iter->NumColumns(); ++i) {
+    EvaluateQueryResponse::Column* column = response.add_column();
+    column->set_name(iter->GetColumnName(i));
+    ZETASQL_RETURN_IF_ERROR(SerializeTypeUsingExistingPools(
+        iter->GetColumnType(i), const_pools, column->mutable_type()));
+  }
+
+  // Only one batch is held at a time, and the next one is not pulled from
+  // the iterator until <write_response> has accepted the previous one.
+  const int max_rows_per_batch = request.max_rows_per_batch() > 0
+                                     ? request.max_rows_per_batch()
+                                     : kDefaultMaxRowsPerBatch;
+  std::vector<std::vector<Value>> rows;
+  while (iter->NextRowBatch(max_rows_per_batch, &rows)) {
+    for (const std::vector<Value>& row : rows) {
+      EvaluateQueryResponse::Row* row_proto = response.add_row();
+      for (const Value& value : row) {
+        ZETASQL_RETURN_IF_ERROR(value.Serialize(row_proto->add_value()));
+      }
+    }
+    if (!write_response(response)) {
+      return ::zetasql_base::CancelledErrorBuilder()
+             << "Query output stream was closed";
+    }
+    response.Clear();
+  }
+  ZETASQL_RETURN_IF_ERROR(iter->Status());
+
+  // Destroying the iterator writes <execution_stats>.
+  iter.reset();
+  *response.mutable_execution_stats() = execution_stats;
+  if (!write_response(response)) {
+    return ::zetasql_base::CancelledErrorBuilder()
+           << "Query output stream was closed";
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ZetaSqlLocalServiceImpl::GetTableFromProto(
     const TableFromProtoRequest& request, SimpleTableProto* response) {
   TypeFactory factory;
@@ -18,6 +18,7 @@
 #define ZETASQL_LOCAL_SERVICE_LOCAL_SERVICE_H_
 
 #include <stddef.h>
+#include <functional>
 #include <memory>
 
 #include "zetasql/local_service/local_service.pb.h"
@@ -59,6 +60,13 @@ class ZetaSqlLocalServiceImpl {
                             PreparedExpressionState* state,
                             EvaluateResponse* response);
 
+  // Evaluates the query in <request> and passes its rows to <write_response>
+  // in batches, as they are produced. Returns a CANCELLED error without
+  // evaluating the rest of the query if <write_response> returns false.
+  absl::Status EvaluateQueryStream(
+      const EvaluateQueryRequest& request,
+      const std::function<bool(const EvaluateQueryResponse&)>& write_response);
+
   absl::Status GetTableFromProto(const TableFromProtoRequest& request,
                                  SimpleTableProto* response);
 
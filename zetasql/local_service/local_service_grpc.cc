@@ -100,6 +100,17 @@ grpc::Status ZetaSqlLocalServiceGrpcImpl::Evaluate(
   return ToGrpcStatus(service_.Evaluate(*req, resp));
 }
 
+grpc::Status ZetaSqlLocalServiceGrpcImpl::EvaluateQueryStream(
+    grpc::ServerContext* context, const EvaluateQueryRequest* req,
+    grpc::ServerWriter<EvaluateQueryResponse>* writer) {
+  // Write() blocks while the client is not reading, which keeps the service
+  // from evaluating further ahead than one batch.
+  return ToGrpcStatus(service_.EvaluateQueryStream(
+      *req, [writer](const EvaluateQueryResponse& response) {
+        return writer->Write(response);
+      }));
+}
+
 grpc::Status ZetaSqlLocalServiceGrpcImpl::GetTableFromProto(
     grpc::ServerContext* context, const TableFromProtoRequest* req,
     SimpleTableProto* resp) {
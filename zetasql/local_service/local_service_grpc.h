@@ -42,6 +42,10 @@ class ZetaSqlLocalServiceGrpcImpl
                         const EvaluateRequest* req,
                         EvaluateResponse* resp) override;
 
+  grpc::Status EvaluateQueryStream(
+      grpc::ServerContext* context, const EvaluateQueryRequest* req,
+      grpc::ServerWriter<EvaluateQueryResponse>* writer) override;
+
   grpc::Status GetTableFromProto(grpc::ServerContext* context,
                                  const TableFromProtoRequest* req,
                                  SimpleTableProto* resp) override;
@@ -16,8 +16,10 @@
 
 #include "zetasql/local_service/local_service.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/base/path.h"
@@ -86,6 +88,22 @@ class ZetaSqlLocalServiceImplTest : public ::testing::Test {
     return service_.Evaluate(request, response);
   }
 
+  // Collects the responses of EvaluateQueryStream(). If <max_responses> is
+  // not negative, the stream is closed after that many responses.
+  absl::Status EvaluateQueryStream(
+      const EvaluateQueryRequest& request,
+      std::vector<EvaluateQueryResponse>* responses, int max_responses = -1) {
+    return service_.EvaluateQueryStream(
+        request, [responses, max_responses](
+                     const EvaluateQueryResponse& response) {
+          if (static_cast<int>(responses->size()) == max_responses) {
+            return false;
+          }
+          responses->push_back(response);
+          return true;
+        });
+  }
+
   absl::Status Analyze(const AnalyzeRequest& request,
                        AnalyzeResponse* response) {
     return service_.Analyze(request, response);
@@ -405,6 +423,68 @@ TEST_F(ZetaSqlLocalServiceImplTest, EvaluateFailuresNoRegister) {
   EXPECT_EQ(0, NumSavedPreparedExpression());
 }
 
+TEST_F(ZetaSqlLocalServiceImplTest, EvaluateQueryStream) {
+  EvaluateQueryRequest request;
+  request.set_sql("SELECT x, x * 10 AS y FROM UNNEST(GENERATE_ARRAY(1, @n)) x");
+  request.set_max_rows_per_batch(2);
+  auto* param = request.add_params();
+  param->set_name("n");
+  param->mutable_type()->set_type_kind(TYPE_INT64);
+  param->mutable_value()->set_int64_value(5);
+
+  std::vector<EvaluateQueryResponse> responses;
+  ZETASQL_ASSERT_OK(EvaluateQueryStream(request, &responses));
+
+  // Three batches of rows, then the statistics.
+  ASSERT_EQ(4, responses.size());
+  ASSERT_EQ(2, responses[0].column_size());
+  EXPECT_EQ("x", responses[0].column(0).name());
+  EXPECT_EQ(TYPE_INT64, responses[0].column(0).type().type_kind());
+  EXPECT_EQ("y", responses[0].column(1).name());
+  EXPECT_EQ(0, responses[1].column_size());
+
+  std::vector<int64_t> values;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(i < 2 ? 2 : 1, responses[i].row_size());
+    EXPECT_FALSE(responses[i].has_execution_stats());
+    for (const auto& row : responses[i].row()) {
+      ASSERT_EQ(2, row.value_size());
+      EXPECT_EQ(row.value(0).int64_value() * 10, row.value(1).int64_value());
+      values.push_back(row.value(0).int64_value());
+    }
+  }
+  EXPECT_THAT(values, ::testing::UnorderedElementsAre(1, 2, 3, 4, 5));
+
+  EXPECT_EQ(0, responses[3].row_size());
+  EXPECT_EQ(5, responses[3].execution_stats().num_rows());
+  EXPECT_TRUE(responses[3].execution_stats().has_time_to_first_row_micros());
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, EvaluateQueryStreamClosedByClient) {
+  EvaluateQueryRequest request;
+  request.set_sql("SELECT x FROM UNNEST(GENERATE_ARRAY(1, 100)) x");
+  request.set_max_rows_per_batch(10);
+
+  std::vector<EvaluateQueryResponse> responses;
+  EXPECT_THAT(EvaluateQueryStream(request, &responses, /*max_responses=*/1),
+              ::zetasql_base::testing::StatusIs(absl::StatusCode::kCancelled));
+  ASSERT_EQ(1, responses.size());
+  EXPECT_EQ(10, responses[0].row_size());
+}
+
+TEST_F(ZetaSqlLocalServiceImplTest, EvaluateQueryStreamFailures) {
+  EvaluateQueryRequest request;
+  std::vector<EvaluateQueryResponse> responses;
+
+  request.set_sql("SELECT foo");
+  EXPECT_FALSE(EvaluateQueryStream(request, &responses).ok());
+
+  request.set_sql("SELECT 1");
+  request.set_registered_catalog_id(10086);
+  EXPECT_FALSE(EvaluateQueryStream(request, &responses).ok());
+  EXPECT_TRUE(responses.empty());
+}
+
 TEST_F(ZetaSqlLocalServiceImplTest, UnprepareUnknownId) {
   ASSERT_FALSE(Unprepare(10086).ok());
 }
@@ -28,6 +28,7 @@
 #include "zetasql/proto/internal_error_location.pb.h"
 #include "zetasql/public/error_location.pb.h"
 #include "zetasql/public/parse_location.h"
+#include "zetasql/public/parse_resume_location.h"
 #include "zetasql/testdata/test_schema.pb.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -233,6 +234,136 @@ TEST(ParseTreeTest, NodeKindCategories_QueryStatement) {
   EXPECT_FALSE(statement->IsTableExpression());
 }
 
+TEST(ParserSessionTest, RecyclesArenaOnlyWhenOutputIsReleased) {
+  ParserSession session;
+  std::unique_ptr<ParserOutput> first;
+  ZETASQL_ASSERT_OK(session.ParseStatement("SELECT a FROM t", &first));
+  const std::string first_debug_string = first->statement()->DebugString();
+  EXPECT_EQ(session.arena_reuse_count(), 0);
+
+  // <first> is still alive, so its arena must not be reused.
+  std::unique_ptr<ParserOutput> second;
+  ZETASQL_ASSERT_OK(session.ParseStatement("SELECT b FROM u", &second));
+  EXPECT_EQ(session.arena_reuse_count(), 0);
+  EXPECT_NE(first->arena(), second->arena());
+
+  // Parsing into <second> releases it, so its arena is recycled.
+  ZETASQL_ASSERT_OK(session.ParseStatement("SELECT c FROM v", &second));
+  EXPECT_EQ(session.arena_reuse_count(), 1);
+  EXPECT_THAT(second->statement()->DebugString(),
+              ::testing::HasSubstr("Identifier(c)"));
+  EXPECT_EQ(first->statement()->DebugString(), first_debug_string);
+}
+
+TEST(ParserSessionTest, ParseNextStatement) {
+  ParserSession session;
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView("SELECT 1; SELECT 2; SELECT 3");
+  std::unique_ptr<ParserOutput> output;
+  std::vector<std::string> debug_strings;
+  bool at_end_of_input = false;
+  while (!at_end_of_input) {
+    ZETASQL_ASSERT_OK(session.ParseNextStatement(&resume_location, &output,
+                                         &at_end_of_input));
+    debug_strings.push_back(output->statement()->DebugString());
+  }
+  EXPECT_THAT(debug_strings,
+              ::testing::ElementsAre(::testing::HasSubstr("IntLiteral(1)"),
+                                     ::testing::HasSubstr("IntLiteral(2)"),
+                                     ::testing::HasSubstr("IntLiteral(3)")));
+  EXPECT_EQ(session.arena_reuse_count(), 2);
+}
+
+// Verifies that <parser> has the same statements as a parser that parses
+// <text> from scratch.
+void ExpectSameAsFullParse(const IncrementalStatementParser& parser,
+                           absl::string_view text, bool script_statements) {
+  IncrementalStatementParser full_parser(ParserOptions(), script_statements);
+  ZETASQL_ASSERT_OK(full_parser.Parse(text));
+  ASSERT_EQ(parser.statements().size(), full_parser.statements().size());
+  for (int i = 0; i < parser.statements().size(); ++i) {
+    const IncrementalStatementParser::Statement& actual =
+        parser.statements()[i];
+    const IncrementalStatementParser::Statement& expected =
+        full_parser.statements()[i];
+    EXPECT_EQ(actual.start_byte_offset, expected.start_byte_offset);
+    EXPECT_EQ(actual.end_byte_offset, expected.end_byte_offset);
+    EXPECT_EQ(actual.parser_output->statement()->DebugString(),
+              expected.parser_output->statement()->DebugString());
+  }
+}
+
+TEST(IncrementalStatementParserTest, ReparsesOnlyEditedStatements) {
+  IncrementalStatementParser parser(ParserOptions(),
+                                    /*script_statements=*/false);
+  std::string text = "SELECT 1; SELECT 2; SELECT 3; SELECT 4";
+  ZETASQL_ASSERT_OK(parser.Parse(text));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 4);
+
+  // Replace "2" with "22". Only the second statement is reparsed, and the
+  // locations of the following statements are shifted.
+  int edit_start = text.find('2');
+  text.replace(edit_start, 1, "22");
+  ZETASQL_ASSERT_OK(parser.Update(text, edit_start, /*old_length=*/1,
+                          /*new_length=*/2));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 1);
+  ExpectSameAsFullParse(parser, text, /*script_statements=*/false);
+
+  // Shrink the third statement.
+  edit_start = text.find("SELECT 3");
+  text.replace(edit_start, 8, "SELECT x");
+  ZETASQL_ASSERT_OK(parser.Update(text, edit_start, /*old_length=*/8,
+                          /*new_length=*/8));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 1);
+  ExpectSameAsFullParse(parser, text, /*script_statements=*/false);
+
+  // Append to the last statement, which has no terminating semicolon.
+  edit_start = text.size();
+  text.append(" + 5; SELECT 6");
+  ZETASQL_ASSERT_OK(parser.Update(text, edit_start, /*old_length=*/0,
+                          /*new_length=*/14));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 2);
+  ExpectSameAsFullParse(parser, text, /*script_statements=*/false);
+}
+
+TEST(IncrementalStatementParserTest, ErrorForcesFullReparse) {
+  IncrementalStatementParser parser(ParserOptions(),
+                                    /*script_statements=*/false);
+  std::string text = "SELECT 1; SELECT 2; SELECT 3";
+  ZETASQL_ASSERT_OK(parser.Parse(text));
+
+  // Deleting the first semicolon merges two statements into an invalid one.
+  text.erase(8, 1);
+  EXPECT_FALSE(parser.Update(text, 8, /*old_length=*/1, /*new_length=*/0)
+                   .ok());
+  EXPECT_TRUE(parser.statements().empty());
+
+  // Re-inserting it parses everything from scratch.
+  text.insert(8, ";");
+  ZETASQL_ASSERT_OK(parser.Update(text, 8, /*old_length=*/0, /*new_length=*/1));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 3);
+  ExpectSameAsFullParse(parser, text, /*script_statements=*/false);
+}
+
+TEST(IncrementalStatementParserTest, ScriptStatements) {
+  IncrementalStatementParser parser(ParserOptions(),
+                                    /*script_statements=*/true);
+  std::string text =
+      "DECLARE x INT64;\n"
+      "BEGIN\n  SELECT 1;\n  SELECT 2;\nEND;\n"
+      "SET x = 3;";
+  ZETASQL_ASSERT_OK(parser.Parse(text));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 3);
+
+  // Edit inside the block. The whole block is reparsed.
+  const int edit_start = text.find("SELECT 2");
+  text.replace(edit_start, 8, "SELECT 2 + 2");
+  ZETASQL_ASSERT_OK(parser.Update(text, edit_start, /*old_length=*/8,
+                          /*new_length=*/12));
+  EXPECT_EQ(parser.last_parsed_statement_count(), 1);
+  ExpectSameAsFullParse(parser, text, /*script_statements=*/true);
+}
+
 TEST(ParseTreeTest, NodeKindCategories_LiteralExpression) {
   const std::string sql = "5";
 
@@ -16,7 +16,10 @@
 
 #include "zetasql/parser/parser.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/common/errors.h"
@@ -79,6 +82,202 @@ ParserOutput::ParserOutput(
 
 ParserOutput::~ParserOutput() {}
 
+ParserSession::ParserSession(const LanguageOptions* language_options,
+                             int arena_block_size)
+    : language_options_(language_options),
+      arena_block_size_(arena_block_size) {}
+
+ParserSession::~ParserSession() {}
+
+ParserOptions ParserSession::PrepareParserOptions() {
+  // The arena is referenced by this session, by <id_string_pool_>, and by every
+  // ParserOutput of a previous parse that is still alive. The same holds for
+  // <id_string_pool_>, minus the reference from itself.
+  if (arena_ != nullptr && arena_.use_count() == 2 &&
+      id_string_pool_.use_count() == 1) {
+    // The IdStringPool must be destroyed before resetting the arena that
+    // holds its strings.
+    id_string_pool_.reset();
+    arena_->Reset();
+    ++arena_reuse_count_;
+  } else {
+    arena_ = std::make_shared<zetasql_base::UnsafeArena>(arena_block_size_);
+  }
+  id_string_pool_ = std::make_shared<IdStringPool>(arena_);
+  return ParserOptions(id_string_pool_, arena_, language_options_);
+}
+
+absl::Status ParserSession::ParseStatement(
+    absl::string_view statement_string, std::unique_ptr<ParserOutput>* output) {
+  // Release the previous output first, so that its arena can be recycled.
+  output->reset();
+  return zetasql::ParseStatement(statement_string, PrepareParserOptions(),
+                                   output);
+}
+
+absl::Status ParserSession::ParseNextStatement(
+    ParseResumeLocation* resume_location,
+    std::unique_ptr<ParserOutput>* output, bool* at_end_of_input) {
+  // Release the previous output first, so that its arena can be recycled.
+  output->reset();
+  return zetasql::ParseNextStatement(resume_location, PrepareParserOptions(),
+                                       output, at_end_of_input);
+}
+
+namespace {
+// Shifts the parse locations of <root> and all its descendants by <delta>
+// bytes.
+void ShiftParseLocations(ASTNode* root, int delta) {
+  std::vector<ASTNode*> stack = {root};
+  while (!stack.empty()) {
+    ASTNode* node = stack.back();
+    stack.pop_back();
+    node->MoveStartLocation(delta);
+    node->MoveEndLocationBack(-delta);
+    for (int i = 0; i < node->num_children(); ++i) {
+      stack.push_back(node->mutable_child(i));
+    }
+  }
+}
+}  // namespace
+
+IncrementalStatementParser::IncrementalStatementParser(
+    const ParserOptions& parser_options, bool script_statements)
+    : parser_options_(parser_options), script_statements_(script_statements) {}
+
+IncrementalStatementParser::~IncrementalStatementParser() {}
+
+absl::Status IncrementalStatementParser::Parse(absl::string_view text) {
+  statements_.clear();
+  text_size_ = -1;
+  last_parsed_statement_count_ = 0;
+  int stop_offset;
+  ZETASQL_RETURN_IF_ERROR(ParseStatementsFrom(
+      text, /*byte_offset=*/0, [](int end_offset) { return false; },
+      &statements_, &stop_offset));
+  last_parsed_statement_count_ = statements_.size();
+  text_size_ = text.size();
+  return absl::OkStatus();
+}
+
+absl::Status IncrementalStatementParser::Update(absl::string_view new_text,
+                                                int edit_start, int old_length,
+                                                int new_length) {
+  if (text_size_ < 0) {
+    return Parse(new_text);
+  }
+  ZETASQL_RET_CHECK_GE(edit_start, 0);
+  ZETASQL_RET_CHECK_GE(old_length, 0);
+  ZETASQL_RET_CHECK_GE(new_length, 0);
+  ZETASQL_RET_CHECK_LE(edit_start + old_length, text_size_);
+  ZETASQL_RET_CHECK_EQ(new_text.size(), text_size_ - old_length + new_length);
+  const int delta = new_length - old_length;
+  const int new_edit_end = edit_start + new_length;
+
+  // Statements that end before the edit are not affected by it. A statement
+  // that ends exactly at the edit is reparsed, since it may be the last
+  // statement without a terminating semicolon.
+  int first_affected = 0;
+  while (first_affected < statements_.size() &&
+         statements_[first_affected].end_byte_offset < edit_start) {
+    ++first_affected;
+  }
+  const int reparse_start = first_affected < statements_.size()
+                                ? statements_[first_affected].start_byte_offset
+                                : 0;
+
+  // Returns the index of the old statement that starts at <old_offset>, or -1.
+  auto find_old_statement = [this, first_affected](int old_offset) {
+    auto it = std::lower_bound(
+        statements_.begin() + first_affected, statements_.end(), old_offset,
+        [](const Statement& statement, int offset) {
+          return statement.start_byte_offset < offset;
+        });
+    return it != statements_.end() && it->start_byte_offset == old_offset
+               ? static_cast<int>(it - statements_.begin())
+               : -1;
+  };
+  // Reparsing can stop at a statement boundary past the edit if an old
+  // statement started at the same (unshifted) position, because the text from
+  // there on is unchanged.
+  auto can_resync = [&](int end_offset) {
+    return end_offset >= new_edit_end &&
+           find_old_statement(end_offset - delta) >= 0;
+  };
+
+  std::vector<Statement> reparsed;
+  int stop_offset;
+  const absl::Status status = ParseStatementsFrom(
+      new_text, reparse_start, can_resync, &reparsed, &stop_offset);
+  if (!status.ok()) {
+    statements_.clear();
+    text_size_ = -1;
+    last_parsed_statement_count_ = 0;
+    return status;
+  }
+  last_parsed_statement_count_ = reparsed.size();
+
+  std::vector<Statement> updated;
+  updated.reserve(statements_.size());
+  for (int i = 0; i < first_affected; ++i) {
+    updated.push_back(std::move(statements_[i]));
+  }
+  for (Statement& statement : reparsed) {
+    updated.push_back(std::move(statement));
+  }
+  if (stop_offset >= 0) {
+    for (int i = find_old_statement(stop_offset - delta);
+         i < statements_.size(); ++i) {
+      Statement& statement = statements_[i];
+      statement.start_byte_offset += delta;
+      statement.end_byte_offset += delta;
+      if (delta != 0) {
+        // We own the parse tree, so it is safe to modify it.
+        ShiftParseLocations(
+            const_cast<ASTStatement*>(statement.parser_output->statement()),
+            delta);
+      }
+      updated.push_back(std::move(statement));
+    }
+  }
+  statements_ = std::move(updated);
+  text_size_ = new_text.size();
+  return absl::OkStatus();
+}
+
+absl::Status IncrementalStatementParser::ParseStatementsFrom(
+    absl::string_view text, int byte_offset,
+    const std::function<bool(int)>& stop_at_end_offset,
+    std::vector<Statement>* statements, int* stop_offset) {
+  *stop_offset = -1;
+  ParseResumeLocation resume_location =
+      ParseResumeLocation::FromStringView(text);
+  resume_location.set_byte_position(byte_offset);
+  bool at_end_of_input = byte_offset >= text.size();
+  while (!at_end_of_input) {
+    Statement statement;
+    statement.start_byte_offset = resume_location.byte_position();
+    if (script_statements_) {
+      ZETASQL_RETURN_IF_ERROR(ParseNextScriptStatement(&resume_location,
+                                               parser_options_,
+                                               &statement.parser_output,
+                                               &at_end_of_input));
+    } else {
+      ZETASQL_RETURN_IF_ERROR(ParseNextStatement(&resume_location, parser_options_,
+                                         &statement.parser_output,
+                                         &at_end_of_input));
+    }
+    const int end_offset = resume_location.byte_position();
+    statement.end_byte_offset = end_offset;
+    statements->push_back(std::move(statement));
+    if (!at_end_of_input && stop_at_end_offset(end_offset)) {
+      *stop_offset = end_offset;
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ParseStatement(absl::string_view statement_string,
                             const ParserOptions& parser_options_in,
                             std::unique_ptr<ParserOutput>* output) {
@@ -17,6 +17,8 @@
 #ifndef ZETASQL_PARSER_PARSER_H_
 #define ZETASQL_PARSER_PARSER_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -153,6 +155,128 @@ class ParserOutput {
       node_;
 };
 
+// Parses a sequence of independent statements, recycling the parser's arena
+// and IdStringPool between them instead of allocating new ones for every
+// statement. This is intended for callers that parse a high volume of
+// statements, e.g. a query frontend.
+//
+// The arena of a previous parse is reused only if no ParserOutput returned by
+// this session still references it; otherwise a new arena is allocated and the
+// old one stays alive with its outputs. Callers get the most benefit by
+// destroying each ParserOutput before parsing the next statement.
+//
+// A ParserSession is not thread-safe.
+class ParserSession {
+ public:
+  // <language_options> may be NULL. If not, it must outlive this object.
+  // The first block of the arena, which is the part that is recycled, has
+  // <arena_block_size> bytes.
+  explicit ParserSession(const LanguageOptions* language_options = nullptr,
+                         int arena_block_size = 64 * 1024);
+  ParserSession(const ParserSession&) = delete;
+  ParserSession& operator=(const ParserSession&) = delete;
+  ~ParserSession();
+
+  // Same as the ParseStatement() and ParseNextStatement() functions below,
+  // using this session's memory pools.
+  absl::Status ParseStatement(absl::string_view statement_string,
+                              std::unique_ptr<ParserOutput>* output);
+  absl::Status ParseNextStatement(ParseResumeLocation* resume_location,
+                                  std::unique_ptr<ParserOutput>* output,
+                                  bool* at_end_of_input);
+
+  // Returns the number of parses that reused the arena of a previous parse.
+  int64_t arena_reuse_count() const { return arena_reuse_count_; }
+
+ private:
+  // Returns ParserOptions for the next parse, resetting the arena if it is no
+  // longer referenced by any ParserOutput.
+  ParserOptions PrepareParserOptions();
+
+  const LanguageOptions* language_options_;
+  const int arena_block_size_;
+  std::shared_ptr<zetasql_base::UnsafeArena> arena_;
+  std::shared_ptr<IdStringPool> id_string_pool_;
+  int64_t arena_reuse_count_ = 0;
+};
+
+// Keeps the parse trees of the top-level statements in a string, and updates
+// them incrementally after an edit to the string. This is intended for
+// editors and linters that reparse a large script after every keystroke.
+//
+// Each top-level statement is parsed separately with ParseNextStatement() or
+// ParseNextScriptStatement() (a compound script statement like BEGIN...END is
+// a single top-level statement). After an edit, statements that end before
+// the edit are kept as is, and reparsing starts at the first statement that
+// touches the edit. Reparsing stops as soon as a reparsed statement ends
+// past the edit, at an offset where an old statement started. The remaining
+// old statements are reused with their parse locations shifted by the size
+// change of the edit.
+//
+// Every statement has its own ParserOutput. If <parser_options> has arenas
+// set, they are shared by all statements and are never freed, so callers
+// should usually leave them unset.
+class IncrementalStatementParser {
+ public:
+  // A top-level statement and its byte range in the current string. The
+  // range includes the statement's terminating semicolon and the whitespace
+  // and comments that precede the statement. The ranges of all statements are
+  // contiguous and cover the whole string.
+  struct Statement {
+    int start_byte_offset;
+    int end_byte_offset;
+    std::unique_ptr<ParserOutput> parser_output;
+  };
+
+  // If <script_statements> is true, statements are parsed with
+  // ParseNextScriptStatement(), otherwise with ParseNextStatement().
+  IncrementalStatementParser(const ParserOptions& parser_options,
+                             bool script_statements);
+  IncrementalStatementParser(const IncrementalStatementParser&) = delete;
+  IncrementalStatementParser& operator=(const IncrementalStatementParser&) =
+      delete;
+  ~IncrementalStatementParser();
+
+  // Parses all statements in <text> from scratch.
+  //
+  // <text> is not copied; the parse trees do not reference it.
+  absl::Status Parse(absl::string_view text);
+
+  // Updates the statements after the bytes [edit_start, edit_start +
+  // old_length) of the previously parsed string were replaced by <new_length>
+  // bytes, producing <new_text>.
+  //
+  // If this returns an error, the statements are cleared and the next call to
+  // Update() parses the new string from scratch.
+  absl::Status Update(absl::string_view new_text, int edit_start,
+                      int old_length, int new_length);
+
+  const std::vector<Statement>& statements() const { return statements_; }
+
+  // Returns the number of statements that were parsed by the last call to
+  // Parse() or Update().
+  int last_parsed_statement_count() const {
+    return last_parsed_statement_count_;
+  }
+
+ private:
+  // Parses statements of <text> starting at <byte_offset> and appends them to
+  // <statements>. Stops at the end of the input, or after the first statement
+  // that ends at an offset for which <stop_at_end_offset> returns true.
+  // Returns that offset in <*stop_offset>, or -1 if the end was reached.
+  absl::Status ParseStatementsFrom(
+      absl::string_view text, int byte_offset,
+      const std::function<bool(int)>& stop_at_end_offset,
+      std::vector<Statement>* statements, int* stop_offset);
+
+  const ParserOptions parser_options_;
+  const bool script_statements_;
+  std::vector<Statement> statements_;
+  // Size of the string that <statements_> cover, or -1 after a failure.
+  int text_size_ = -1;
+  int last_parsed_statement_count_ = 0;
+};
+
 // Parses <statement_string> and returns the parser output in <output> upon
 // success. The AST can be retrieved from output->statement().
 //
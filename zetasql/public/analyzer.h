@@ -29,7 +29,9 @@
 #include "zetasql/base/atomic_sequence_num.h"
 #include "google/protobuf/descriptor.h"
 #include "zetasql/proto/options.pb.h"
+#include "zetasql/public/analyzer_runtime_info.h"
 #include "zetasql/public/catalog.h"
+#include "zetasql/public/function_signature_match_cache.h"
 #include "zetasql/public/id_string.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
@@ -411,6 +413,28 @@ class AnalyzerOptions {
   }
   std::shared_ptr<zetasql_base::UnsafeArena> arena() const { return arena_; }
 
+  // Sets a cache of function signature matching results. If it is set, calls
+  // of the same function with the same kinds of arguments are only matched
+  // against the function signatures once. The cache may be shared by
+  // concurrent analyses against the same Catalog. See
+  // function_signature_match_cache.h for which calls are cached and the
+  // restrictions on Catalog lifetime.
+  void set_function_signature_match_cache(
+      std::shared_ptr<FunctionSignatureMatchCache> cache) {
+    function_signature_match_cache_ = std::move(cache);
+  }
+  const std::shared_ptr<FunctionSignatureMatchCache>&
+  function_signature_match_cache() const {
+    return function_signature_match_cache_;
+  }
+
+  // If true, per-phase timings and counters are collected during analysis
+  // and returned in AnalyzerOutput::runtime_info(). This adds clock reads
+  // around each catalog lookup and function signature match, so it is off by
+  // default.
+  void set_collect_runtime_info(bool value) { collect_runtime_info_ = value; }
+  bool collect_runtime_info() const { return collect_runtime_info_; }
+
   // Creates default-sized id_string_pool() and arena().
   // WARNING: After calling this, calling Analyze functions concurrently with
   // the same AnalyzerOptions is no longer allowed.
@@ -601,6 +625,11 @@ class AnalyzerOptions {
   // The pool will also be referenced in AnalyzerOutput to keep it alive.
   std::shared_ptr<IdStringPool> id_string_pool_;
 
+  // If set, function signature matching results are cached here.
+  std::shared_ptr<FunctionSignatureMatchCache> function_signature_match_cache_;
+
+  bool collect_runtime_info_ = false;
+
   ErrorMessageMode error_message_mode_ = ERROR_MESSAGE_ONE_LINE;
 
   // Some timestamp-related functions take an optional timezone argument, and
@@ -760,6 +789,13 @@ class AnalyzerOutput {
     return analyzer_output_properties_;
   }
 
+  // Timings and counters for this analysis. All zero unless
+  // AnalyzerOptions::collect_runtime_info() was set.
+  const AnalyzerRuntimeInfo& runtime_info() const { return runtime_info_; }
+  void set_runtime_info(const AnalyzerRuntimeInfo& runtime_info) {
+    runtime_info_ = runtime_info;
+  }
+
  private:
   // This IdStringPool and arena must be kept alive for the Resolved trees below
   // to be valid.
@@ -781,6 +817,8 @@ class AnalyzerOutput {
 
   QueryParametersMap undeclared_parameters_;
   std::vector<const Type*> undeclared_positional_parameters_;
+
+  AnalyzerRuntimeInfo runtime_info_;
 };
 
 // Analyze a ZetaSQL statement.
@@ -0,0 +1,98 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/analyzer_runtime_info.h"
+
+#include <time.h>
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+
+namespace zetasql {
+
+namespace {
+
+absl::Duration ThreadCpuTime() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return absl::ZeroDuration();
+  }
+  return absl::DurationFromTimespec(ts);
+}
+
+}  // namespace
+
+const char* AnalyzerRuntimeInfo::PhaseName(Phase phase) {
+  switch (phase) {
+    case kTotal:
+      return "total";
+    case kParser:
+      return "parser";
+    case kResolver:
+      return "resolver";
+    case kCatalogLookup:
+      return "catalog_lookup";
+    case kFunctionSignatureMatching:
+      return "function_signature_matching";
+    case kValidator:
+      return "validator";
+    case kNumPhases:
+      break;
+  }
+  return "unknown";
+}
+
+void AnalyzerRuntimeInfo::Accumulate(const AnalyzerRuntimeInfo& other) {
+  for (int i = 0; i < kNumPhases; ++i) {
+    phases_[i].Accumulate(other.phases_[i]);
+  }
+  num_resolved_nodes_ += other.num_resolved_nodes_;
+  arena_bytes_allocated_ += other.arena_bytes_allocated_;
+}
+
+std::string AnalyzerRuntimeInfo::DebugString() const {
+  std::string out;
+  for (int i = 0; i < kNumPhases; ++i) {
+    const PhaseTiming& timing = phases_[i];
+    absl::StrAppend(&out, PhaseName(static_cast<Phase>(i)),
+                    ": wall=", absl::FormatDuration(timing.wall_time),
+                    " cpu=", absl::FormatDuration(timing.cpu_time),
+                    " count=", timing.count, "\n");
+  }
+  absl::StrAppend(&out, "num_resolved_nodes: ", num_resolved_nodes_, "\n",
+                  "arena_bytes_allocated: ", arena_bytes_allocated_, "\n");
+  return out;
+}
+
+ScopedPhaseTimer::ScopedPhaseTimer(AnalyzerRuntimeInfo::PhaseTiming* timing)
+    : timing_(timing) {
+  if (timing_ != nullptr) {
+    start_wall_time_ = absl::Now();
+    start_cpu_time_ = ThreadCpuTime();
+  }
+}
+
+ScopedPhaseTimer::~ScopedPhaseTimer() {
+  if (timing_ != nullptr) {
+    timing_->wall_time += absl::Now() - start_wall_time_;
+    timing_->cpu_time += ThreadCpuTime() - start_cpu_time_;
+    ++timing_->count;
+  }
+}
+
+}  // namespace zetasql
@@ -0,0 +1,130 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_ANALYZER_RUNTIME_INFO_H_
+#define ZETASQL_PUBLIC_ANALYZER_RUNTIME_INFO_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/time/time.h"
+
+namespace zetasql {
+
+// Timings and counters collected while analyzing one statement or
+// expression. This is only populated when
+// AnalyzerOptions::set_collect_runtime_info(true) is set, and is returned in
+// AnalyzerOutput::runtime_info().
+//
+// Phases nest: kTotal includes all the others, and kCatalogLookup and
+// kFunctionSignatureMatching are included in kResolver. A resolver-bound
+// analysis has most of its kResolver time outside those two phases, while a
+// catalog-bound analysis spends most of it in kCatalogLookup.
+class AnalyzerRuntimeInfo {
+ public:
+  enum Phase {
+    // The entire Analyze*() call.
+    kTotal = 0,
+    // Parsing. Not recorded when analyzing a caller-provided parse tree.
+    kParser,
+    // Resolving the parse tree into a resolved AST.
+    kResolver,
+    // Catalog Find*() calls made during resolution. The count is the number
+    // of lookups.
+    kCatalogLookup,
+    // Matching function calls against function signatures. The count is the
+    // number of function calls matched.
+    kFunctionSignatureMatching,
+    // Running the resolved AST validator.
+    kValidator,
+    kNumPhases,
+  };
+
+  // Accumulated time spent in one phase, and the number of times the phase
+  // was entered.
+  struct PhaseTiming {
+    absl::Duration wall_time;
+    absl::Duration cpu_time;
+    int64_t count = 0;
+
+    void Accumulate(const PhaseTiming& other) {
+      wall_time += other.wall_time;
+      cpu_time += other.cpu_time;
+      count += other.count;
+    }
+  };
+
+  AnalyzerRuntimeInfo() {}
+  AnalyzerRuntimeInfo(const AnalyzerRuntimeInfo&) = default;
+  AnalyzerRuntimeInfo& operator=(const AnalyzerRuntimeInfo&) = default;
+
+  static const char* PhaseName(Phase phase);
+
+  const PhaseTiming& phase(Phase phase) const { return phases_[phase]; }
+  PhaseTiming* mutable_phase(Phase phase) { return &phases_[phase]; }
+
+  // Number of nodes in the resolved AST.
+  int64_t num_resolved_nodes() const { return num_resolved_nodes_; }
+  void set_num_resolved_nodes(int64_t value) { num_resolved_nodes_ = value; }
+
+  // Number of bytes allocated from the analyzer arena during the analysis.
+  // For calls that parse the SQL, this covers both the parse tree and the
+  // resolved AST. For the *FromParserOutput* and *FromParserAST* calls, which
+  // are given an already parsed tree, this covers only resolution. If
+  // AnalyzerOptions has no arena, the *FromParserOutput* calls count the
+  // allocations on the arena of the given ParserOutput.
+  int64_t arena_bytes_allocated() const { return arena_bytes_allocated_; }
+  void set_arena_bytes_allocated(int64_t value) {
+    arena_bytes_allocated_ = value;
+  }
+
+  // Adds all timings and counters from <other> to this. This can be used to
+  // aggregate over many analyses.
+  void Accumulate(const AnalyzerRuntimeInfo& other);
+
+  // Returns a multi-line description of all timings and counters.
+  std::string DebugString() const;
+
+ private:
+  PhaseTiming phases_[kNumPhases];
+  int64_t num_resolved_nodes_ = 0;
+  int64_t arena_bytes_allocated_ = 0;
+
+  // Copyable
+};
+
+// Adds the wall and CPU time between construction and destruction to
+// <timing>, and increments its count. If <timing> is NULL, this does nothing
+// and does not read any clocks, so timers can be left in hot paths when
+// collection is disabled.
+//
+// CPU time is the CPU time of the calling thread.
+class ScopedPhaseTimer {
+ public:
+  explicit ScopedPhaseTimer(AnalyzerRuntimeInfo::PhaseTiming* timing);
+  ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+  ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+  ~ScopedPhaseTimer();
+
+ private:
+  AnalyzerRuntimeInfo::PhaseTiming* timing_;
+  absl::Time start_wall_time_;
+  absl::Duration start_cpu_time_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_ANALYZER_RUNTIME_INFO_H_
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <memory>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -39,6 +40,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -125,6 +127,50 @@ void GetZetaSQLFunctions(TypeFactory* type_factory,
   }
 }
 
+ZetaSQLBuiltinFunctionSet::ZetaSQLBuiltinFunctionSet(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  GetZetaSQLFunctions(&type_factory_, options, &functions_);
+}
+
+// Returns a canonical encoding of <options>; equivalent options produce the
+// same key regardless of the iteration order of the id sets.
+static std::string BuiltinFunctionOptionsKey(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  ZetaSQLBuiltinFunctionOptionsProto proto;
+  options.language_options.Serialize(proto.mutable_language_options());
+  std::vector<FunctionSignatureId> include_ids(
+      options.include_function_ids.begin(), options.include_function_ids.end());
+  std::sort(include_ids.begin(), include_ids.end());
+  for (FunctionSignatureId id : include_ids) {
+    proto.add_include_function_ids(id);
+  }
+  std::vector<FunctionSignatureId> exclude_ids(
+      options.exclude_function_ids.begin(), options.exclude_function_ids.end());
+  std::sort(exclude_ids.begin(), exclude_ids.end());
+  for (FunctionSignatureId id : exclude_ids) {
+    proto.add_exclude_function_ids(id);
+  }
+  return proto.SerializeAsString();
+}
+
+std::shared_ptr<const ZetaSQLBuiltinFunctionSet>
+ZetaSQLBuiltinFunctionSet::GetShared(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  static absl::Mutex* mutex = new absl::Mutex;
+  static auto* sets = new absl::flat_hash_map<
+      std::string, std::shared_ptr<const ZetaSQLBuiltinFunctionSet>>;
+
+  const std::string key = BuiltinFunctionOptionsKey(options);
+  // The lock is held while building so that concurrent first requests for
+  // the same options build the set only once.
+  absl::MutexLock lock(mutex);
+  std::shared_ptr<const ZetaSQLBuiltinFunctionSet>& set = (*sets)[key];
+  if (set == nullptr) {
+    set = std::make_shared<const ZetaSQLBuiltinFunctionSet>(options);
+  }
+  return set;
+}
+
 bool FunctionMayHaveUnintendedArgumentCoercion(const Function* function) {
   if (function->NumSignatures() == 0 ||
       !function->ArgumentsAreCoercible()) {
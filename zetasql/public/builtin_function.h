@@ -20,6 +20,7 @@
 #include <stddef.h>
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "zetasql/proto/options.pb.h"
@@ -48,6 +49,41 @@ void GetZetaSQLFunctions(
     TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
     std::map<std::string, std::unique_ptr<Function>>* functions);
 
+// An immutable set of built-in ZetaSQL functions for one
+// ZetaSQLBuiltinFunctionOptions, along with the TypeFactory that owns the
+// Types they reference.
+//
+// Building the built-in functions creates thousands of Function and
+// FunctionSignature objects, so processes that create many catalogs should
+// share one set per distinct options value rather than calling
+// GetZetaSQLFunctions() for each catalog. SimpleCatalog::AddZetaSQLFunctions()
+// does this automatically.
+class ZetaSQLBuiltinFunctionSet {
+ public:
+  using FunctionMap = std::map<std::string, std::unique_ptr<Function>>;
+
+  explicit ZetaSQLBuiltinFunctionSet(
+      const ZetaSQLBuiltinFunctionOptions& options);
+  ZetaSQLBuiltinFunctionSet(const ZetaSQLBuiltinFunctionSet&) = delete;
+  ZetaSQLBuiltinFunctionSet& operator=(const ZetaSQLBuiltinFunctionSet&) =
+      delete;
+
+  // Returns the process-wide set for <options>, building it on the first
+  // request for an equivalent <options>. Sets are cached for the lifetime of
+  // the process, keyed by the canonical serialized form of <options>.
+  // Thread-safe.
+  static std::shared_ptr<const ZetaSQLBuiltinFunctionSet> GetShared(
+      const ZetaSQLBuiltinFunctionOptions& options);
+
+  // Map from function name (as in GetZetaSQLFunctions) to Function.
+  const FunctionMap& functions() const { return functions_; }
+
+ private:
+  // Must outlive <functions_>, so it is declared first.
+  TypeFactory type_factory_;
+  FunctionMap functions_;
+};
+
 // If the function allows argument coercion, then checks the function
 // signatures to see if they are defined for floating point and
 // only one of signed/unsigned integer arguments (but not both integer
@@ -272,6 +272,44 @@ TEST(SimpleBuiltinFunctionTests, ExcludedBuiltinFunctionTests) {
             (*function)->GetSignature(1)->DebugString());
 }
 
+TEST(SimpleBuiltinFunctionTests, SharedFunctionSet) {
+  ZetaSQLBuiltinFunctionOptions options;
+  options.exclude_function_ids.insert(FN_CONCAT_STRING);
+  options.exclude_function_ids.insert(FN_CONCAT_BYTES);
+  std::shared_ptr<const ZetaSQLBuiltinFunctionSet> set =
+      ZetaSQLBuiltinFunctionSet::GetShared(options);
+  ASSERT_THAT(set, NotNull());
+
+  // Equivalent options, built independently, share the same set.
+  ZetaSQLBuiltinFunctionOptions same_options;
+  same_options.exclude_function_ids.insert(FN_CONCAT_BYTES);
+  same_options.exclude_function_ids.insert(FN_CONCAT_STRING);
+  EXPECT_EQ(set.get(),
+            ZetaSQLBuiltinFunctionSet::GetShared(same_options).get());
+
+  // Different options get a different set.
+  std::shared_ptr<const ZetaSQLBuiltinFunctionSet> default_set =
+      ZetaSQLBuiltinFunctionSet::GetShared(ZetaSQLBuiltinFunctionOptions());
+  EXPECT_NE(set.get(), default_set.get());
+
+  // The shared set has the same functions as GetZetaSQLFunctions.
+  TypeFactory type_factory;
+  NameToFunctionMap functions;
+  GetZetaSQLFunctions(&type_factory, options, &functions);
+  ASSERT_EQ(functions.size(), set->functions().size());
+  for (const auto& entry : functions) {
+    const std::unique_ptr<Function>* shared_function =
+        zetasql_base::FindOrNull(set->functions(), entry.first);
+    ASSERT_THAT(shared_function, NotNull()) << entry.first;
+    EXPECT_EQ(entry.second->NumSignatures(),
+              (*shared_function)->NumSignatures())
+        << entry.first;
+  }
+  const std::string concat = FunctionSignatureIdToName(FN_CONCAT_STRING);
+  EXPECT_FALSE(zetasql_base::ContainsKey(set->functions(), concat));
+  EXPECT_TRUE(zetasql_base::ContainsKey(default_set->functions(), concat));
+}
+
 TEST(SimpleBuiltinFunctionTests, IncludedBuiltinFunctionTests) {
   TypeFactory type_factory;
   NameToFunctionMap functions;
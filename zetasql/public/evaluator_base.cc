@@ -16,6 +16,7 @@
 
 #include "zetasql/public/evaluator_base.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <unordered_map>
@@ -34,6 +35,7 @@
 #include "zetasql/reference_impl/algebrizer.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/operator_stats.h"
 #include "zetasql/reference_impl/parameters.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/reference_impl/variable_id.h"
@@ -47,6 +49,7 @@
 #include "zetasql/base/case.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "zetasql/base/map_util.h"
@@ -184,6 +187,13 @@ class Evaluator {
   Evaluator(const Evaluator&) = delete;
   Evaluator& operator=(const Evaluator&) = delete;
 
+  // Where to write the statistics requested through
+  // PreparedQueryBase::QueryOptions. Ignored when evaluating an expression.
+  struct QueryStats {
+    OperatorStatsProto* operator_stats = nullptr;
+    QueryExecutionStatsProto* execution_stats = nullptr;
+  };
+
   ~Evaluator() {
     CHECK_EQ(num_live_iterators_, 0)
         << "An iterator returned by PreparedQuery::Execute() cannot outlive "
@@ -197,28 +207,32 @@ class Evaluator {
   }
 
   // For expressions, populates 'expression_output_value'. For queries,
-  // populates 'query_output_iterator'.
+  // populates 'query_output_iterator', which fills in 'query_stats' as it
+  // runs.
   absl::Status Execute(
       const ExpressionOptions& options, Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator)
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      const QueryStats& query_stats)
       ABSL_LOCKS_EXCLUDED(mutex_);
 
   absl::Status ExecuteAfterPrepare(
       const ExpressionOptions& options, Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      const QueryStats& query_stats) const
       ABSL_LOCKS_EXCLUDED(mutex_) {
     absl::ReaderMutexLock l(&mutex_);
     return ExecuteAfterPrepareLocked(options, expression_output_value,
-                                     query_output_iterator);
+                                     query_output_iterator, query_stats);
   }
 
   absl::Status ExecuteAfterPrepareWithOrderedParams(
       const ExpressionOptions& options, Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      const QueryStats& query_stats) const
       ABSL_LOCKS_EXCLUDED(mutex_) {
     absl::ReaderMutexLock l(&mutex_);
     return ExecuteAfterPrepareWithOrderedParamsLocked(
-        options, expression_output_value, query_output_iterator);
+        options, expression_output_value, query_output_iterator, query_stats);
   }
 
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const
@@ -308,14 +322,16 @@ class Evaluator {
   // with a write lock).
   absl::Status ExecuteAfterPrepareLocked(
       const ExpressionOptions& options, Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      const QueryStats& query_stats) const
       ABSL_SHARED_LOCKS_REQUIRED(mutex_);
 
   // Same as ExecuteAfterPrepareWithOrderedParams(), but with the mutex already
   // locked.
   absl::Status ExecuteAfterPrepareWithOrderedParamsLocked(
       const ExpressionOptions& options, Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      const QueryStats& query_stats) const
       ABSL_SHARED_LOCKS_REQUIRED(mutex_);
 
   // Checks if 'parameters_map' specifies valid values for all variables from
@@ -346,8 +362,8 @@ class Evaluator {
            compiled_relational_op_ != nullptr;
   }
 
-  std::unique_ptr<EvaluationContext> CreateEvaluationContext() const
-      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+  std::unique_ptr<EvaluationContext> CreateEvaluationContext(
+      bool collect_operator_stats) const ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
     // Construct the EvaluationOptions for the internal evaluation API from the
     // user-provided EvaluatorOptions. These are two different struct types with
     // unfortunately similar names.
@@ -360,7 +376,13 @@ class Evaluator {
         evaluator_options_.max_value_byte_size;
     evaluation_options.max_intermediate_byte_size =
         evaluator_options_.max_intermediate_byte_size;
+    evaluation_options.max_subquery_cache_byte_size =
+        evaluator_options_.max_subquery_cache_byte_size;
     evaluation_options.return_all_rows_for_dml = false;
+    evaluation_options.use_primary_key_lookups_for_dml = true;
+    evaluation_options.analytic_num_threads =
+        evaluator_options_.analytic_num_threads;
+    evaluation_options.collect_operator_stats = collect_operator_stats;
 
     auto context = absl::make_unique<EvaluationContext>(evaluation_options);
 
@@ -484,7 +506,13 @@ absl::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
   algebrizer_options.allow_hash_join = true;
   algebrizer_options.allow_order_by_limit_operator = true;
   algebrizer_options.push_down_filters = true;
+  algebrizer_options.push_down_dml_filters = true;
   algebrizer_options.inline_with_entries = true;
+  algebrizer_options.push_down_proto_field_paths = true;
+  algebrizer_options.cache_subquery_results = true;
+  algebrizer_options.spool_with_tables = true;
+  algebrizer_options.allow_hash_partitioning_for_analytic = true;
+  algebrizer_options.limit_analytic_partitions_for_rank_filters = true;
 
   if (!is_expr_) {
     if (statement_ == nullptr) {
@@ -673,7 +701,8 @@ absl::Status Evaluator::TranslateParameterValueMapToList(
 
 absl::Status Evaluator::Execute(
     const ExpressionOptions& options, Value* expression_output_value,
-    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) {
+    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+    const QueryStats& query_stats) {
   {
     const ParameterValues parameters =
         options.parameters.has_value()
@@ -726,12 +755,13 @@ absl::Status Evaluator::Execute(
 
   absl::ReaderMutexLock l(&mutex_);
   return ExecuteAfterPrepareLocked(options, expression_output_value,
-                                   query_output_iterator);
+                                   query_output_iterator, query_stats);
 }
 
 absl::Status Evaluator::ExecuteAfterPrepareLocked(
     const ExpressionOptions& options, Value* expression_output_value,
-    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const {
+    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+    const QueryStats& query_stats) const {
   if (!has_prepare_succeeded()) {
     // Previous Prepare() failed with an analysis error or Prepare was never
     // called. Returns an error for consistency.
@@ -762,7 +792,8 @@ absl::Status Evaluator::ExecuteAfterPrepareLocked(
   new_options.ordered_parameters = parameters_list;
 
   return ExecuteAfterPrepareWithOrderedParamsLocked(
-      new_options, expression_output_value, query_output_iterator);
+      new_options, expression_output_value, query_output_iterator,
+      query_stats);
 }
 
 zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableModifyIterator>>
@@ -805,22 +836,50 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   using NameAndType = PreparedQueryBase::NameAndType;
 
   // 'tuple_indexes[i]' is in the index in a TupleData returned by 'iter' of the
-  // value for 'columns[i]'.
+  // value for 'columns[i]'. If 'operator_stats' is non-NULL, the statistics
+  // collected in 'context' for the plan rooted at 'root_op' are written to it
+  // on destruction. If 'execution_stats' is non-NULL, the timings of the rows
+  // returned since 'start_time' are written to it on destruction.
   TupleIteratorAdaptor(const std::vector<NameAndType>& columns,
                        const std::vector<int>& tuple_indexes,
                        const std::function<void()>& deletion_cb,
                        std::unique_ptr<EvaluationContext> context,
-                       std::unique_ptr<TupleIterator> iter)
+                       std::unique_ptr<TupleIterator> iter,
+                       const RelationalOp* root_op,
+                       OperatorStatsProto* operator_stats,
+                       absl::Time start_time,
+                       QueryExecutionStatsProto* execution_stats)
       : columns_(columns),
         tuple_indexes_(tuple_indexes),
         deletion_cb_(deletion_cb),
+        root_op_(root_op),
+        operator_stats_(operator_stats),
+        start_time_(start_time),
+        execution_stats_(execution_stats),
         context_(std::move(context)),
         iter_(std::move(iter)) {}
 
   TupleIteratorAdaptor(const TupleIteratorAdaptor&) = delete;
   TupleIteratorAdaptor& operator=(const TupleIteratorAdaptor&) = delete;
 
-  ~TupleIteratorAdaptor() override { deletion_cb_(); }
+  ~TupleIteratorAdaptor() override {
+    if (operator_stats_ != nullptr &&
+        context_->operator_stats() != nullptr) {
+      context_->operator_stats()->ToProto(*root_op_, operator_stats_);
+    }
+    if (execution_stats_ != nullptr) {
+      absl::MutexLock l(&mutex_);
+      execution_stats_->Clear();
+      if (first_row_time_.has_value()) {
+        execution_stats_->set_time_to_first_row_micros(
+            absl::ToInt64Microseconds(first_row_time_.value() - start_time_));
+      }
+      execution_stats_->set_time_micros(absl::ToInt64Microseconds(
+          end_time_.value_or(absl::Now()) - start_time_));
+      execution_stats_->set_num_rows(num_rows_);
+    }
+    deletion_cb_();
+  }
 
   int NumColumns() const override { return columns_.size(); }
 
@@ -830,9 +889,24 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
 
   bool NextRow() override {
     absl::MutexLock l(&mutex_);
-    current_ = iter_->Next();
-    called_next_ = true;
-    return current_ != nullptr;
+    return NextRowLocked();
+  }
+
+  // Pulls the whole batch under one lock.
+  bool NextRowBatch(int max_rows,
+                    std::vector<std::vector<Value>>* rows) override {
+    absl::MutexLock l(&mutex_);
+    rows->clear();
+    for (int num_rows = 0; num_rows < max_rows && NextRowLocked();
+         ++num_rows) {
+      rows->emplace_back();
+      std::vector<Value>& row = rows->back();
+      row.reserve(tuple_indexes_.size());
+      for (int tuple_index : tuple_indexes_) {
+        row.push_back(current_->slot(tuple_index).value());
+      }
+    }
+    return !rows->empty();
   }
 
   const Value& GetValue(int i) const override {
@@ -856,9 +930,27 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   }
 
  private:
+  bool NextRowLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    current_ = iter_->Next();
+    called_next_ = true;
+    if (execution_stats_ != nullptr && !end_time_.has_value()) {
+      if (current_ == nullptr) {
+        end_time_ = absl::Now();
+      } else {
+        if (num_rows_ == 0) first_row_time_ = absl::Now();
+        ++num_rows_;
+      }
+    }
+    return current_ != nullptr;
+  }
+
   const std::vector<NameAndType> columns_;
   const std::vector<int> tuple_indexes_;
   const std::function<void()> deletion_cb_;
+  const RelationalOp* root_op_;
+  OperatorStatsProto* operator_stats_;
+  const absl::Time start_time_;
+  QueryExecutionStatsProto* execution_stats_;
   mutable absl::Mutex mutex_;
   std::unique_ptr<EvaluationContext> context_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
@@ -868,12 +960,17 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   const TupleData* current_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_) = nullptr;
   absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  // Only maintained if 'execution_stats_' is non-NULL.
+  int64_t num_rows_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::optional<absl::Time> first_row_time_ ABSL_GUARDED_BY(mutex_);
+  absl::optional<absl::Time> end_time_ ABSL_GUARDED_BY(mutex_);
 };
 }  // namespace
 
 absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
     const ExpressionOptions& options, Value* expression_output_value,
-    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const {
+    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+    const QueryStats& query_stats) const {
   if (!has_prepare_succeeded()) {
     // Previous Prepare() failed with an analysis error or Prepare was never
     // called. Returns an error for consistency.
@@ -888,7 +985,9 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters));
   ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
 
-  std::unique_ptr<EvaluationContext> context = CreateEvaluationContext();
+  std::unique_ptr<EvaluationContext> context = CreateEvaluationContext(
+      /*collect_operator_stats=*/compiled_relational_op_ != nullptr &&
+      query_stats.operator_stats != nullptr);
   context->SetStatementEvaluationDeadline(options.deadline);
 
   ParameterValueList params;
@@ -901,6 +1000,9 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   const TupleData params_data = CreateTupleDataFromValues(params);
 
   if (compiled_relational_op_ != nullptr) {
+    // Operators like SortOp do their work when the iterator is created, so
+    // that is included in the time to the first row.
+    const absl::Time start_time = absl::Now();
     ZETASQL_ASSIGN_OR_RETURN(
         std::unique_ptr<TupleIterator> tuple_iter,
         compiled_relational_op_->Eval({&params_data},
@@ -919,7 +1021,8 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
     };
     *query_output_iterator = absl::make_unique<TupleIteratorAdaptor>(
         output_columns_, tuple_indexes, deletion_cb, std::move(context),
-        std::move(tuple_iter));
+        std::move(tuple_iter), compiled_relational_op_.get(),
+        query_stats.operator_stats, start_time, query_stats.execution_stats);
   } else {
     ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr);
 
@@ -1172,6 +1275,14 @@ ExpressionOptions QueryOptionsToExpressionOptions(
   return expr_options;
 }
 
+internal::Evaluator::QueryStats QueryOptionsToQueryStats(
+    const QueryOptions& query_options) {
+  internal::Evaluator::QueryStats query_stats;
+  query_stats.operator_stats = query_options.operator_stats;
+  query_stats.execution_stats = query_options.execution_stats;
+  return query_stats;
+}
+
 // If both the named and positional columns are empty, insert an empty named
 // columns map into the options struct. Does the same for the parameters.
 void GiveDefaultParameters(ExpressionOptions* options) {
@@ -1194,7 +1305,8 @@ zetasql_base::StatusOr<Value> PreparedExpressionBase::Execute(
          "ExecuteAfterPrepare()?";
   Value output;
   ZETASQL_RETURN_IF_ERROR(evaluator_->Execute(options, &output,
-                                      /*query_output_iterator=*/nullptr));
+                                      /*query_output_iterator=*/nullptr,
+                                      /*query_stats=*/{}));
   return output;
 }
 
@@ -1228,12 +1340,14 @@ zetasql_base::StatusOr<Value> PreparedExpressionBase::ExecuteAfterPrepare(
   // is non-positional.
   if (options.columns.has_value()) {
     ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepare(
-        options, &output, /*query_output_iterator=*/nullptr));
+        options, &output, /*query_output_iterator=*/nullptr,
+        /*query_stats=*/{}));
   } else {
     ZETASQL_RET_CHECK(options.ordered_parameters.has_value())
         << "Expected positional parameters since the columns are positional";
     ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareWithOrderedParams(
-        options, &output, /*query_output_iterator=*/nullptr));
+        options, &output, /*query_output_iterator=*/nullptr,
+        /*query_stats=*/{}));
   }
   return output;
 }
@@ -1320,7 +1434,8 @@ PreparedQueryBase::Execute(const QueryOptions& options) {
   ZETASQL_RETURN_IF_ERROR(ValidateExpressionOptions(expr_options));
   ZETASQL_RETURN_IF_ERROR(evaluator_->Execute(expr_options,
                                       /*expression_output_value=*/nullptr,
-                                      &output));
+                                      &output,
+                                      QueryOptionsToQueryStats(options)));
   return output;
 }
 
@@ -1352,14 +1467,16 @@ PreparedQueryBase::ExecuteAfterPrepare(const QueryOptions& options) const {
     ZETASQL_RETURN_IF_ERROR(ValidateExpressionOptions(expr_options));
     ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepare(
         expr_options,
-        /*expression_output_value=*/nullptr, &output));
+        /*expression_output_value=*/nullptr, &output,
+        QueryOptionsToQueryStats(options)));
   } else {
     expr_options.columns.reset();
     expr_options.ordered_columns = ParameterValueList();
     ZETASQL_RETURN_IF_ERROR(ValidateExpressionOptions(expr_options));
     ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareWithOrderedParams(
         expr_options,
-        /*expression_output_value=*/nullptr, &output));
+        /*expression_output_value=*/nullptr, &output,
+        QueryOptionsToQueryStats(options)));
   }
   return output;
 }
@@ -1378,6 +1495,11 @@ zetasql_base::StatusOr<std::string> PreparedQueryBase::ExplainAfterPrepare() con
   return evaluator_->ExplainAfterPrepare();
 }
 
+std::string PreparedQueryBase::ExplainAnalyze(
+    const OperatorStatsProto& operator_stats) {
+  return OperatorStatsProtoToString(operator_stats);
+}
+
 int PreparedQueryBase::num_columns() const {
   return evaluator_->query_output_columns().size();
 }
@@ -1441,8 +1563,9 @@ PreparedModifyBase::Execute(const ParameterValueMap& parameters,
   options.parameters = parameters;
   options.system_variables = system_variables;
   Value value;
-  ZETASQL_RETURN_IF_ERROR(
-      evaluator_->Execute(options, &value, /*query_output_iterator=*/nullptr));
+  ZETASQL_RETURN_IF_ERROR(evaluator_->Execute(options, &value,
+                                      /*query_output_iterator=*/nullptr,
+                                      /*query_stats=*/{}));
   return evaluator_->MakeUpdateIterator(value, resolved_statement());
 }
 
@@ -1455,8 +1578,9 @@ PreparedModifyBase::ExecuteWithPositionalParams(
   options.ordered_parameters = positional_parameters;
   options.system_variables = system_variables;
   Value value;
-  ZETASQL_RETURN_IF_ERROR(
-      evaluator_->Execute(options, &value, /*query_output_iterator=*/nullptr));
+  ZETASQL_RETURN_IF_ERROR(evaluator_->Execute(options, &value,
+                                      /*query_output_iterator=*/nullptr,
+                                      /*query_stats=*/{}));
   return evaluator_->MakeUpdateIterator(value, resolved_statement());
 }
 
@@ -1470,7 +1594,7 @@ PreparedModifyBase::ExecuteAfterPrepareWithOrderedParams(
   options.system_variables = system_variables;
   Value value;
   ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareWithOrderedParams(
-      options, &value, /*query_output_iterator=*/nullptr));
+      options, &value, /*query_output_iterator=*/nullptr, /*query_stats=*/{}));
   return evaluator_->MakeUpdateIterator(value, resolved_statement());
 }
 
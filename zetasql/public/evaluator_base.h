@@ -172,6 +172,7 @@
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/evaluator_table_iterator.h"
+#include "zetasql/public/operator_stats.pb.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
@@ -244,6 +245,23 @@ struct EvaluatorOptions {
   // accounting charges each of them individually. In some cases, it is
   // necessary to set this option to a very large value.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
+
+  // Limit on the number of in-memory bytes used to cache the results of
+  // subqueries for repeated values of their correlated columns. This memory is
+  // not counted towards 'max_intermediate_byte_size'. Once the limit is
+  // reached, further results are recomputed instead of cached; exceeding it is
+  // never an error. Setting it to 0 disables the cache.
+  int64_t max_subquery_cache_byte_size = 32 * 1024 * 1024;
+
+  // Maximum number of threads used to evaluate the analytic functions of a
+  // window with PARTITION BY, including the calling thread. With more than one
+  // thread, batches of partitions are evaluated concurrently, each thread with
+  // an even share of the memory remaining under 'max_intermediate_byte_size'.
+  // The results do not depend on this option. If it is greater than 1,
+  // 'clock' must be thread-safe. Windows whose analytic function arguments
+  // use subqueries or functions that are not known to be thread-safe (such as
+  // REGEXP_CONTAINS) are always evaluated on one thread.
+  int analytic_num_threads = 1;
 };
 
 class PreparedExpressionBase {
@@ -516,6 +534,7 @@ class PreparedQueryBase {
   // Options struct for Execute() and ExecuteAfterPrepareWithOrderedParams()
   // function calls.
   struct QueryOptions {
+    QueryOptions() {}
     // Parameters for the expression. Represented as a map or unordered list.
     // At most one of these can be specified.
     absl::optional<ParameterValueMap> parameters;
@@ -525,6 +544,20 @@ class PreparedQueryBase {
 
     // Optional system variables for all variants of Execute.
     SystemVariableValuesMap system_variables;
+
+    // If non-NULL, runtime statistics are collected for every operator in the
+    // query plan, and written to <operator_stats> when the returned iterator
+    // is destroyed. <operator_stats> must outlive the returned iterator.
+    // Collecting statistics slows down evaluation, so this is intended for
+    // diagnosing slow queries. See ExplainAnalyze().
+    OperatorStatsProto* operator_stats = nullptr;
+
+    // If non-NULL, the time to the first row, the total time and the number
+    // of rows seen by the reader of the returned iterator are written to
+    // <execution_stats> when the iterator is destroyed. <execution_stats>
+    // must outlive the returned iterator. Unlike <operator_stats>, this does
+    // not slow down evaluation.
+    QueryExecutionStatsProto* execution_stats = nullptr;
   };
 
   // Execute the query. This object must outlive the return value.
@@ -573,6 +606,12 @@ class PreparedQueryBase {
   // called.
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const;
 
+  // Returns a human-readable representation of the plan in <operator_stats>,
+  // as filled in by an execution with QueryOptions::operator_stats set, with
+  // the runtime statistics of each operator. Like ExplainAfterPrepare(), the
+  // format can change at any time.
+  static std::string ExplainAnalyze(const OperatorStatsProto& operator_stats);
+
   // Get the schema of the output table of this query. Anonymous column names
   // are empty. (There may be more than one column with the same name.)
   //
@@ -19,7 +19,11 @@
 #ifndef ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 #define ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
 #include "zetasql/base/canonical_errors.h"
 #include "zetasql/base/status.h"
 
@@ -27,6 +31,10 @@ namespace zetasql {
 
 struct ColumnFilter;
 
+// A path of proto fields starting at the proto type of a column. For example,
+// 'proto_col.a.b' is represented as {<descriptor for a>, <descriptor for b>}.
+using ProtoFieldPath = std::vector<const google::protobuf::FieldDescriptor*>;
+
 // Iterator interface for a user-supplied table in a PreparedQuery.
 //
 // Example:
@@ -129,6 +137,35 @@ class EvaluatorTableIterator {
     return absl::OkStatus();
   }
 
+  // This method is called just before the first call to NextRow() to indicate
+  // that the query reads some PROTO columns only through a known set of field
+  // paths. For example, for
+  //
+  //   SELECT p.a.b, p.c FROM Table
+  //
+  // the entry for 'p' is {{a, b}, {c}}. Columns whose whole value is needed
+  // (for example, because they are returned by the query, compared, or passed
+  // to a function) never appear in 'field_path_map'.
+  //
+  // For each column in 'field_path_map', the iterator may return a proto Value
+  // that only contains the fields on the given paths, including every subfield
+  // of the last field of each path. Field presence along each path must be
+  // preserved, since the query may check it with has_<field>. This allows
+  // iterators over wide stored protos to skip copying and carrying around
+  // fields that the query never decodes. Like SetColumnFilterMap(), honoring
+  // this is optional, and returning the full proto is always correct.
+  //
+  // This method should return quickly. All non-trivial processing should be
+  // done by NextRow().
+  //
+  // 'field_path_map' is keyed on the index of a column in the scan (not the
+  // Table). Paths are deduplicated, and no path is a prefix of another path
+  // for the same column.
+  virtual absl::Status SetColumnProtoFieldPathMap(
+      absl::flat_hash_map<int, std::vector<ProtoFieldPath>> field_path_map) {
+    return absl::OkStatus();
+  }
+
   // Indicates that the iterator should read from a snapshot of the table at the
   // given moment in time, rather than the current table content. This function
   // must be called prior to the first call to NextRow().
@@ -151,6 +188,30 @@ class EvaluatorTableIterator {
   // returned true.
   virtual const Value& GetValue(int i) const = 0;
 
+  // Replaces the contents of 'rows' with the next rows of this iterator, at
+  // most 'max_rows' of them, each with 'NumColumns()' values. Returns false
+  // if there is no next row, like NextRow(), in which case 'rows' is empty and
+  // the caller must check 'Status()'. 'max_rows' must be positive.
+  //
+  // This lets a reader pull rows in bounded batches without calling NextRow()
+  // and GetValue() for every row and column. Rows are only produced when
+  // they are pulled, so a slow reader holds back evaluation instead of
+  // letting output accumulate. GetValue() must not be called after
+  // NextRowBatch().
+  virtual bool NextRowBatch(int max_rows,
+                            std::vector<std::vector<Value>>* rows) {
+    rows->clear();
+    for (int num_rows = 0; num_rows < max_rows && NextRow(); ++num_rows) {
+      rows->emplace_back();
+      std::vector<Value>& row = rows->back();
+      row.reserve(NumColumns());
+      for (int i = 0; i < NumColumns(); ++i) {
+        row.push_back(GetValue(i));
+      }
+    }
+    return !rows->empty();
+  }
+
   // Returns OK unless the last call to NextRow() returned false because of an
   // error (including cancellation).
   virtual absl::Status Status() const = 0;
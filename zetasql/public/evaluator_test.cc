@@ -28,6 +28,7 @@
 #include "google/protobuf/text_format.h"
 #include "zetasql/common/evaluator_test_table.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/common/testing/proto_matchers.h"
 #include "zetasql/common/testing/testing_proto_util.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/civil_time.h"
@@ -53,6 +54,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <cstdint>
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/cord.h"
@@ -70,6 +72,7 @@ extern absl::Flag<int64_t>
 namespace zetasql {
 namespace {
 
+using ::zetasql::testing::EqualsProto;
 using ::testing::_;
 using ::testing::AllOf;
 using ::testing::ElementsAre;
@@ -2003,6 +2006,135 @@ TEST(PreparedQuery, FromTable) {
   ZETASQL_EXPECT_OK(iter->Status());
 }
 
+// Returns the first operator named <name> in a pre-order walk of <stats>, or
+// NULL if there is none.
+static const OperatorStatsProto* FindOperatorStats(
+    const OperatorStatsProto& stats, const std::string& name) {
+  if (stats.name() == name) return &stats;
+  for (const OperatorStatsProto& input : stats.input()) {
+    const OperatorStatsProto* found = FindOperatorStats(input, name);
+    if (found != nullptr) return found;
+  }
+  return nullptr;
+}
+
+TEST(PreparedQuery, OperatorStats) {
+  SimpleTable test_table("TestTable", {{"a", types::Int64Type()}});
+  test_table.SetContents({{Int64(10)}, {Int64(20)}, {Int64(10)}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query("select a, count(*) from TestTable group by a",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+
+  OperatorStatsProto stats;
+  PreparedQuery::QueryOptions options;
+  options.parameters = ParameterValueMap();
+  options.operator_stats = &stats;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepare(options));
+  int num_rows = 0;
+  while (iter->NextRow()) ++num_rows;
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_EQ(2, num_rows);
+
+  // The statistics are only written when the iterator is destroyed.
+  EXPECT_FALSE(stats.has_name());
+  iter.reset();
+
+  EXPECT_EQ(1, stats.num_evaluations());
+  EXPECT_EQ(2, stats.num_rows());
+
+  const OperatorStatsProto* aggregate = FindOperatorStats(stats, "AggregateOp");
+  ASSERT_NE(nullptr, aggregate);
+  EXPECT_EQ(1, aggregate->num_evaluations());
+  EXPECT_EQ(2, aggregate->num_rows());
+  ASSERT_EQ(1, aggregate->counter_size());
+  EXPECT_EQ("num_groups", aggregate->counter(0).name());
+  EXPECT_EQ(2, aggregate->counter(0).value());
+  EXPECT_LE(aggregate->self_time_micros(), aggregate->time_micros());
+
+  const OperatorStatsProto* scan =
+      FindOperatorStats(stats, "EvaluatorTableScanOp");
+  ASSERT_NE(nullptr, scan);
+  EXPECT_EQ(3, scan->num_rows());
+
+  const std::string explain = PreparedQuery::ExplainAnalyze(stats);
+  EXPECT_THAT(explain, HasSubstr("AggregateOp [evaluations=1 rows=2 "));
+  EXPECT_THAT(explain, HasSubstr("num_groups=2]"));
+  EXPECT_THAT(explain,
+              HasSubstr("+-EvaluatorTableScanOp [evaluations=1 rows=3 "));
+
+  // Without operator_stats, the statistics of the previous execution are
+  // left alone.
+  const OperatorStatsProto previous_stats = stats;
+  options.operator_stats = nullptr;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, query.ExecuteAfterPrepare(options));
+  while (iter->NextRow()) {}
+  ZETASQL_EXPECT_OK(iter->Status());
+  iter.reset();
+  EXPECT_THAT(stats, EqualsProto(previous_stats));
+}
+
+TEST(PreparedQuery, NextRowBatchAndExecutionStats) {
+  SimpleTable test_table("TestTable", {{"a", types::Int64Type()}});
+  test_table.SetContents(
+      {{Int64(1)}, {Int64(2)}, {Int64(3)}, {Int64(4)}, {Int64(5)}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+  catalog.AddZetaSQLFunctions();
+
+  PreparedQuery query("select a, a * 10 as b from TestTable",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+
+  QueryExecutionStatsProto stats;
+  PreparedQuery::QueryOptions options;
+  options.parameters = ParameterValueMap();
+  options.execution_stats = &stats;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepare(options));
+
+  std::vector<int> batch_sizes;
+  std::vector<int64_t> values;
+  std::vector<std::vector<Value>> rows;
+  while (iter->NextRowBatch(/*max_rows=*/2, &rows)) {
+    batch_sizes.push_back(rows.size());
+    for (const std::vector<Value>& row : rows) {
+      ASSERT_EQ(2, row.size());
+      EXPECT_EQ(row[0].int64_value() * 10, row[1].int64_value());
+      values.push_back(row[0].int64_value());
+    }
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_TRUE(rows.empty());
+  EXPECT_THAT(batch_sizes, ElementsAre(2, 2, 1));
+  EXPECT_THAT(values, UnorderedElementsAre(1, 2, 3, 4, 5));
+
+  // The statistics are only written when the iterator is destroyed.
+  EXPECT_FALSE(stats.has_num_rows());
+  iter.reset();
+
+  EXPECT_EQ(5, stats.num_rows());
+  ASSERT_TRUE(stats.has_time_to_first_row_micros());
+  EXPECT_LE(stats.time_to_first_row_micros(), stats.time_micros());
+
+  // Queries without rows have no time to the first row.
+  PreparedQuery empty_query("select a from TestTable where a > 5",
+                            EvaluatorOptions());
+  ZETASQL_ASSERT_OK(empty_query.Prepare(AnalyzerOptions(), &catalog));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, empty_query.ExecuteAfterPrepare(options));
+  EXPECT_FALSE(iter->NextRowBatch(/*max_rows=*/10, &rows));
+  ZETASQL_EXPECT_OK(iter->Status());
+  iter.reset();
+  EXPECT_EQ(0, stats.num_rows());
+  EXPECT_FALSE(stats.has_time_to_first_row_micros());
+}
+
 class PreparedModifyTest : public ::testing::Test {
  public:
   void SetUp() override {
@@ -3746,5 +3878,98 @@ TEST_F(PreparedQueryProtoTest, ArbitraryProtoValuedExpression) {
   EXPECT_EQ(GetNumProtoDeserializations(), 2);
 }
 
+// EvaluatorTableIterator that records the argument of
+// SetColumnProtoFieldPathMap() as strings, and otherwise delegates to an
+// underlying iterator.
+class ProtoFieldPathRecordingIterator : public EvaluatorTableIterator {
+ public:
+  ProtoFieldPathRecordingIterator(
+      std::unique_ptr<EvaluatorTableIterator> iterator,
+      std::vector<std::string>* recorded_paths)
+      : iterator_(std::move(iterator)), recorded_paths_(recorded_paths) {}
+
+  int NumColumns() const override { return iterator_->NumColumns(); }
+  std::string GetColumnName(int i) const override {
+    return iterator_->GetColumnName(i);
+  }
+  const Type* GetColumnType(int i) const override {
+    return iterator_->GetColumnType(i);
+  }
+  absl::Status SetColumnProtoFieldPathMap(
+      absl::flat_hash_map<int, std::vector<ProtoFieldPath>> field_path_map)
+      override {
+    for (const auto& entry : field_path_map) {
+      for (const ProtoFieldPath& path : entry.second) {
+        recorded_paths_->push_back(absl::StrCat(
+            entry.first, ":",
+            absl::StrJoin(path, ".",
+                          [](std::string* out,
+                             const google::protobuf::FieldDescriptor* field) {
+                            absl::StrAppend(out, field->name());
+                          })));
+      }
+    }
+    return absl::OkStatus();
+  }
+  bool NextRow() override { return iterator_->NextRow(); }
+  const Value& GetValue(int i) const override { return iterator_->GetValue(i); }
+  absl::Status Status() const override { return iterator_->Status(); }
+  absl::Status Cancel() override { return iterator_->Cancel(); }
+
+ private:
+  std::unique_ptr<EvaluatorTableIterator> iterator_;
+  std::vector<std::string>* recorded_paths_;
+};
+
+TEST_F(PreparedQueryProtoTest, ProtoFieldPathsPushedDownToTableScan) {
+  std::vector<std::string> recorded_paths;
+  SimpleTable projected_table("ProjectedTable", {{"col", proto_type_}});
+  projected_table.SetEvaluatorTableIteratorFactory(
+      [this, &recorded_paths](absl::Span<const int> column_idxs)
+          -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
+        ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         table_->CreateEvaluatorTableIterator(column_idxs));
+        return absl::make_unique<ProtoFieldPathRecordingIterator>(
+            std::move(iter), &recorded_paths);
+      });
+  catalog_->AddTable(projected_table.Name(), &projected_table);
+
+  {
+    // Paths are sorted by field number, and subfields of a field that is read
+    // as a whole are dropped.
+    PreparedQuery query(
+        "select col.nested_value.nested_int64, col.int64_key_1, "
+        "       col.nested_value, col.int64_key_1 "
+        "from ProjectedTable",
+        EvaluatorOptions());
+    ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), catalog_.get()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.ExecuteAfterPrepare());
+    ASSERT_TRUE(iter->NextRow());
+    EXPECT_EQ(iter->GetValue(1), Int64(1));
+    ASSERT_FALSE(iter->NextRow());
+    ZETASQL_EXPECT_OK(iter->Status());
+    EXPECT_THAT(recorded_paths, ElementsAre("0:int64_key_1", "0:nested_value"));
+  }
+
+  // Queries that need the whole proto value do not push down any paths.
+  for (const std::string& sql :
+       {"select col from ProjectedTable",
+        "select col.int64_key_1 from ProjectedTable where col is not null",
+        "select (select col.int64_key_1) from ProjectedTable",
+        "select x.int64_key_1 from (select col as x from ProjectedTable)"}) {
+    SCOPED_TRACE(sql);
+    recorded_paths.clear();
+    PreparedQuery query(sql, EvaluatorOptions());
+    ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), catalog_.get()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                         query.ExecuteAfterPrepare());
+    ASSERT_TRUE(iter->NextRow());
+    ASSERT_FALSE(iter->NextRow());
+    ZETASQL_EXPECT_OK(iter->Status());
+    EXPECT_THAT(recorded_paths, IsEmpty());
+  }
+}
+
 }  // namespace
 }  // namespace zetasql
@@ -0,0 +1,132 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/function_signature_match_cache.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "absl/memory/memory.h"
+
+namespace zetasql {
+
+namespace {
+
+// Argument properties, other than the Type, that affect signature matching.
+enum ArgumentKeyBits : char {
+  kLiteral = 1 << 0,
+  kNull = 1 << 1,
+  kQueryParameter = 1 << 2,
+  kUntyped = 1 << 3,
+};
+
+void AppendPointer(const void* ptr, std::string* key) {
+  const uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool IsCacheableType(const Type* type) {
+  return type != nullptr && type->IsSimpleType();
+}
+
+}  // namespace
+
+bool FunctionSignatureMatchCache::MakeKey(
+    const Function* function, absl::string_view language_options_key,
+    const std::vector<InputArgumentType>& arguments, std::string* key) {
+  key->clear();
+  key->reserve(sizeof(uintptr_t) * (arguments.size() + 1) + arguments.size() +
+               language_options_key.size());
+  AppendPointer(function, key);
+  for (const InputArgumentType& argument : arguments) {
+    if (argument.is_relation() || argument.is_model() ||
+        argument.is_connection() || argument.is_descriptor() ||
+        !IsCacheableType(argument.type())) {
+      return false;
+    }
+    char bits = 0;
+    if (argument.is_literal()) bits |= kLiteral;
+    if (argument.is_null()) bits |= kNull;
+    if (argument.is_query_parameter()) bits |= kQueryParameter;
+    if (argument.is_untyped()) bits |= kUntyped;
+    key->push_back(bits);
+    AppendPointer(argument.type(), key);
+  }
+  // The language key goes last so that its length does not need encoding.
+  key->append(language_options_key.data(), language_options_key.size());
+  return true;
+}
+
+bool FunctionSignatureMatchCache::IsCacheableSignature(
+    const FunctionSignature* signature) {
+  if (signature == nullptr) {
+    return true;
+  }
+  if (!IsCacheableType(signature->result_type().type())) {
+    return false;
+  }
+  for (const FunctionArgumentType& argument : signature->arguments()) {
+    if (!IsCacheableType(argument.type())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FunctionSignatureMatchCache::Lookup(
+    const std::string& key,
+    std::unique_ptr<FunctionSignature>* signature) const {
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      signature->reset(it->second == nullptr
+                           ? nullptr
+                           : new FunctionSignature(*it->second));
+      num_hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  num_misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void FunctionSignatureMatchCache::Insert(const std::string& key,
+                                         const FunctionSignature* signature) {
+  std::unique_ptr<const FunctionSignature> entry;
+  if (signature != nullptr) {
+    entry = absl::make_unique<FunctionSignature>(*signature);
+  }
+  absl::MutexLock l(&mutex_);
+  // Concurrent analyses may race to insert the same key. Both computed the
+  // same result, so the first one wins.
+  entries_.emplace(key, std::move(entry));
+}
+
+void FunctionSignatureMatchCache::Clear() {
+  absl::MutexLock l(&mutex_);
+  entries_.clear();
+}
+
+int64_t FunctionSignatureMatchCache::num_entries() const {
+  absl::ReaderMutexLock l(&mutex_);
+  return entries_.size();
+}
+
+}  // namespace zetasql
@@ -0,0 +1,110 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_FUNCTION_SIGNATURE_MATCH_CACHE_H_
+#define ZETASQL_PUBLIC_FUNCTION_SIGNATURE_MATCH_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/function.h"
+#include "zetasql/public/function_signature.h"
+#include "zetasql/public/input_argument_type.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace zetasql {
+
+// Remembers the outcome of function signature matching, so that repeated calls
+// of the same Function with the same kinds of arguments (as in generated
+// queries with thousands of calls like `col_i + 1`) skip the full matching
+// and coercion checks after the first one.
+//
+// An entry is keyed by the Function, the LanguageOptions in effect, and for
+// each argument its Type and whether it is a literal, a NULL literal, a query
+// parameter or untyped. Literal values are not part of the key, so
+// FunctionSignatureOptions constraint callbacks must depend only on those
+// properties of the arguments (as all builtin constraints do). The cached
+// value is the concrete result signature (or the fact that there was none),
+// which determines the coercions applied to the arguments.
+//
+// Only calls where all argument and result types are simple types are
+// cached, since other types may be owned by a TypeFactory that does not
+// outlive the analysis. Calls with named arguments are never cached.
+//
+// A cache is enabled with AnalyzerOptions::set_function_signature_match_cache
+// and may be shared by concurrent analyses. Entries refer to Functions by
+// pointer, so a cache must not be used across catalogs that destroy and
+// re-create their Functions; use one cache per catalog (e.g. per frozen
+// SimpleCatalog version) and drop it along with the catalog.
+class FunctionSignatureMatchCache {
+ public:
+  FunctionSignatureMatchCache() {}
+  FunctionSignatureMatchCache(const FunctionSignatureMatchCache&) = delete;
+  FunctionSignatureMatchCache& operator=(const FunctionSignatureMatchCache&) =
+      delete;
+
+  // Returns true if a call with <arguments> can be cached, and if so sets
+  // <key> to the cache key for calling <function> with them.
+  // <language_options_key> identifies the LanguageOptions of the analysis.
+  static bool MakeKey(const Function* function,
+                      absl::string_view language_options_key,
+                      const std::vector<InputArgumentType>& arguments,
+                      std::string* key);
+
+  // Returns true if <signature> can be stored in the cache.
+  static bool IsCacheableSignature(const FunctionSignature* signature);
+
+  // Looks up <key>. On a hit, returns true and sets <signature> to a copy of
+  // the cached result signature, or to NULL if no signature matched.
+  bool Lookup(const std::string& key,
+              std::unique_ptr<FunctionSignature>* signature) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stores a copy of <signature> under <key>, or records that no signature
+  // matched if <signature> is NULL.
+  void Insert(const std::string& key, const FunctionSignature* signature)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Removes all entries. Does not reset the counters.
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t num_entries() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of Lookup() calls that found, or did not find, an entry.
+  int64_t num_hits() const { return num_hits_.load(std::memory_order_relaxed); }
+  int64_t num_misses() const {
+    return num_misses_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  // A NULL value records that no signature matched.
+  absl::flat_hash_map<std::string, std::unique_ptr<const FunctionSignature>>
+      entries_ ABSL_GUARDED_BY(mutex_);
+
+  mutable std::atomic<int64_t> num_hits_{0};
+  mutable std::atomic<int64_t> num_misses_{0};
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_FUNCTION_SIGNATURE_MATCH_CACHE_H_
@@ -16,8 +16,12 @@
 
 #include "zetasql/public/id_string.h"
 
+#include <utility>
+
 #include "zetasql/base/logging.h"
 #include "zetasql/base/case.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 
@@ -62,6 +66,11 @@ IdStringPool::IdStringPool(const std::shared_ptr<zetasql_base::UnsafeArena>& are
 #endif
 }
 
+IdStringPool::IdStringPool(std::shared_ptr<const SharedIdStringPool> shared_pool)
+    : IdStringPool() {
+  shared_pool_ = std::move(shared_pool);
+}
+
 IdStringPool::~IdStringPool() {
 #ifndef NDEBUG
   VLOG(1) << "Deleting IdStringPool " << pool_id_;
@@ -90,4 +99,114 @@ IdString IdString::ToLower(IdStringPool* pool) const {
   return pool->Make(absl::AsciiStrToLower(ToStringView()));
 }
 
+struct SharedIdStringPool::Table {
+  explicit Table(int64_t capacity)
+      : mask(capacity - 1),
+        slots(new std::atomic<const IdString::Shared*>[capacity]) {
+    DCHECK_EQ(capacity & mask, 0) << "capacity must be a power of 2";
+    for (int64_t i = 0; i < capacity; ++i) {
+      slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  int64_t capacity() const { return mask + 1; }
+
+  const int64_t mask;
+  const std::unique_ptr<std::atomic<const IdString::Shared*>[]> slots;
+};
+
+SharedIdStringPool::SharedIdStringPool()
+    : table_(nullptr),
+      pool_(absl::make_unique<IdStringPool>()),
+      pool_id_(pool_->pool_id_) {
+  tables_.push_back(absl::make_unique<Table>(/*capacity=*/64));
+  table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+SharedIdStringPool::~SharedIdStringPool() {}
+
+// static
+const IdString::Shared* SharedIdStringPool::FindInTable(const Table& table,
+                                                        absl::string_view str) {
+  for (int64_t i = absl::Hash<absl::string_view>()(str) & table.mask;;
+       i = (i + 1) & table.mask) {
+    // Pairs with the release store in InsertIntoTable(), so the contents of
+    // <shared> are visible here.
+    const IdString::Shared* shared =
+        table.slots[i].load(std::memory_order_acquire);
+    if (shared == nullptr) return nullptr;
+    if (shared->str == str) return shared;
+  }
+}
+
+// static
+void SharedIdStringPool::InsertIntoTable(Table* table,
+                                         const IdString::Shared* shared) {
+  for (int64_t i = absl::Hash<absl::string_view>()(shared->str) & table->mask;;
+       i = (i + 1) & table->mask) {
+    if (table->slots[i].load(std::memory_order_relaxed) == nullptr) {
+      table->slots[i].store(shared, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+IdString SharedIdStringPool::ToIdString(const IdString::Shared* shared) const {
+#ifndef NDEBUG
+  return IdString(shared, pool_id_);
+#else
+  return IdString(shared);
+#endif
+}
+
+bool SharedIdStringPool::Find(absl::string_view str,
+                              IdString* id_string) const {
+  const IdString::Shared* shared =
+      FindInTable(*table_.load(std::memory_order_acquire), str);
+  if (shared == nullptr) return false;
+  *id_string = ToIdString(shared);
+  return true;
+}
+
+IdString SharedIdStringPool::Make(absl::string_view str) {
+  // This must not construct an IdString before the lookup, because
+  // IdString::kEmptyString itself is made here.
+  const IdString::Shared* shared =
+      FindInTable(*table_.load(std::memory_order_acquire), str);
+  if (shared != nullptr) return ToIdString(shared);
+
+  absl::MutexLock lock(&mutex_);
+  // Only this thread can replace or add to the table while holding the lock.
+  Table* table = table_.load(std::memory_order_relaxed);
+  shared = FindInTable(*table, str);
+  if (shared != nullptr) return ToIdString(shared);
+
+  // Keep the table at most half full, so probe sequences stay short.
+  if (2 * (num_strings_ + 1) > table->capacity()) {
+    tables_.push_back(absl::make_unique<Table>(2 * table->capacity()));
+    Table* new_table = tables_.back().get();
+    for (int64_t i = 0; i < table->capacity(); ++i) {
+      const IdString::Shared* old_shared =
+          table->slots[i].load(std::memory_order_relaxed);
+      if (old_shared != nullptr) InsertIntoTable(new_table, old_shared);
+    }
+    table_.store(new_table, std::memory_order_release);
+    table = new_table;
+  }
+
+  shared = pool_->MakeShared(str);
+  // Compute both hashes before publishing, so that readers never race to
+  // memoize them.
+  shared->Hash();
+  shared->HashCase();
+  InsertIntoTable(table, shared);
+  ++num_strings_;
+  return ToIdString(shared);
+}
+
+int64_t SharedIdStringPool::num_strings() const {
+  absl::MutexLock lock(&mutex_);
+  return num_strings_;
+}
+
 }  // namespace zetasql
@@ -20,6 +20,8 @@
 #include <stddef.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <new>
@@ -41,6 +43,7 @@
 namespace zetasql {
 
 class IdStringPool;
+class SharedIdStringPool;
 
 // An IdString is an immutable string that supports cheap copying and
 // assignment.  It is intended primarily to store identifiers. Like
@@ -283,6 +286,7 @@ class IdString {
 #endif
 
   friend class IdStringPool;
+  friend class SharedIdStringPool;
   // Copyable.
 };
 
@@ -389,26 +393,27 @@ using IdStringHashMapCase =
 // IdStringPool is not thread-safe.  The returned IdStrings are thread-safe to
 // read and copy.
 //
-// TODO Consider variants, like an interning IdStringPool.
+// An IdStringPool can be backed by a SharedIdStringPool. Make() then returns
+// the interned IdString from the SharedIdStringPool for strings that were
+// interned there, and only allocates the other strings in this pool. See
+// SharedIdStringPool.
 class IdStringPool {
  public:
   // Pass 'arena' to use an existing arena.
   IdStringPool();
   explicit IdStringPool(const std::shared_ptr<zetasql_base::UnsafeArena>& arena);
+  // Looks up strings in <shared_pool> before allocating them in this pool.
+  // <shared_pool> is kept alive as long as this pool.
+  explicit IdStringPool(std::shared_ptr<const SharedIdStringPool> shared_pool);
 #ifndef SWIG
   IdStringPool(const IdStringPool&) = delete;
   IdStringPool& operator=(const IdStringPool&) = delete;
 #endif  // SWIG
   ~IdStringPool();
 
-  // Make an IdString with contents allocated in this pool.
-  IdString Make(absl::string_view str) {
-#ifndef NDEBUG
-    return IdString(MakeShared(str), pool_id_);
-#else
-    return IdString(MakeShared(str));
-#endif
-  }
+  // Make an IdString with contents allocated in this pool, or return the
+  // interned IdString from the SharedIdStringPool backing this pool.
+  IdString Make(absl::string_view str);
 
   // Create an IdString in the global IdStringPool.  Memory will never be freed.
   // This function is thread safe.
@@ -459,6 +464,9 @@ class IdStringPool {
 
   std::shared_ptr<zetasql_base::UnsafeArena> arena_;
 
+  // If non-NULL, Make() looks up strings here first.
+  std::shared_ptr<const SharedIdStringPool> shared_pool_;
+
 #ifndef NDEBUG
   static absl::Mutex global_mutex_;
 
@@ -480,12 +488,95 @@ class IdStringPool {
 #endif
 
   friend IdString;
+  friend SharedIdStringPool;
+};
+
+// A thread-safe, append-only IdStringPool that interns its strings, i.e.
+// Make() returns IdStrings with the same underlying value for equal strings.
+// Strings are never freed before the SharedIdStringPool is destroyed.
+//
+// This is meant for long-lived identifiers, like the table and column names
+// of a catalog, that are used by many analyses. Intern them once with Make(),
+// and back the IdStringPool of each analysis by this pool:
+//
+//   auto shared_pool = std::make_shared<SharedIdStringPool>();
+//   shared_pool->Make("KeyValue");
+//   ...
+//   options.set_id_string_pool(std::make_shared<IdStringPool>(shared_pool));
+//
+// Those analyses then reuse the interned IdStrings instead of allocating and
+// lower-casing their own copies, and comparisons between IdStrings for the
+// same identifier find equal pointers without comparing contents. Both hashes
+// of an interned IdString are computed in Make(), so Hash() and HashCase()
+// never compute them again.
+//
+// Find() is lock-free. Make() takes a lock only if <str> was not interned yet.
+class SharedIdStringPool {
+ public:
+  SharedIdStringPool();
+  SharedIdStringPool(const SharedIdStringPool&) = delete;
+  SharedIdStringPool& operator=(const SharedIdStringPool&) = delete;
+  ~SharedIdStringPool();
+
+  // Returns the interned IdString for <str>, adding it if necessary.
+  IdString Make(absl::string_view str) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns true and sets <*id_string> to the interned IdString for <str> if
+  // <str> has been interned. Otherwise returns false.
+  bool Find(absl::string_view str, IdString* id_string) const;
+
+  // Returns the number of interned strings.
+  int64_t num_strings() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // An open-addressing hash table with linear probing. Slots are only ever
+  // filled, never cleared, so readers can probe without locking.
+  struct Table;
+
+  // Returns the interned value for <str> in <table>, or NULL.
+  static const IdString::Shared* FindInTable(const Table& table,
+                                             absl::string_view str);
+
+  // Adds <shared> to <table>, which must have a free slot.
+  static void InsertIntoTable(Table* table, const IdString::Shared* shared);
+
+  IdString ToIdString(const IdString::Shared* shared) const;
+
+  // The current table. Replaced by a larger copy when it gets half full.
+  std::atomic<Table*> table_;
+
+  mutable absl::Mutex mutex_;
+
+  // Allocates the interned values.
+  const std::unique_ptr<IdStringPool> pool_ ABSL_PT_GUARDED_BY(mutex_);
+
+  // The id of <pool_>, for the IdStrings returned by the lock-free lookups,
+  // which must not read <pool_>.
+  const int64_t pool_id_;
+
+  // All tables ever used, including <table_>. Replaced tables are kept alive
+  // because concurrent Find() calls may still be reading them.
+  std::vector<std::unique_ptr<Table>> tables_ ABSL_GUARDED_BY(mutex_);
+
+  int64_t num_strings_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
+inline IdString IdStringPool::Make(absl::string_view str) {
+  if (shared_pool_ != nullptr) {
+    IdString interned;
+    if (shared_pool_->Find(str, &interned)) {
+      return interned;
+    }
+  }
+#ifndef NDEBUG
+  return IdString(MakeShared(str), pool_id_);
+#else
+  return IdString(MakeShared(str));
+#endif
+}
+
 inline IdString IdStringPool::MakeGlobal(absl::string_view str) {
-  static IdStringPool* global_pool = new IdStringPool;
-  static absl::Mutex global_pool_mutex;
-  absl::MutexLock lock(&global_pool_mutex);
+  static SharedIdStringPool* global_pool = new SharedIdStringPool;
   return global_pool->Make(str);
 }
 
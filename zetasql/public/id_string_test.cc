@@ -16,13 +16,18 @@
 
 #include "zetasql/public/id_string.h"
 
+#include <memory>
 #include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <unordered_set>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/node_hash_set.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_join.h"
 #include "zetasql/base/map_util.h"
@@ -431,5 +436,79 @@ TEST(IdString, Static) {
   EXPECT_EQ("inside", kStaticInside.ToStringView());
 }
 
+TEST(SharedIdStringPool, Interns) {
+  SharedIdStringPool shared_pool;
+  IdString s1 = shared_pool.Make("abc");
+  IdString s2 = shared_pool.Make(std::string("abc"));
+  EXPECT_EQ("abc", s1.ToStringView());
+  // Interned strings share the same data.
+  EXPECT_EQ(s1.data(), s2.data());
+  EXPECT_NE(s1.data(), shared_pool.Make("ABC").data());
+  EXPECT_EQ(2, shared_pool.num_strings());
+
+  IdString found;
+  EXPECT_TRUE(shared_pool.Find("abc", &found));
+  EXPECT_EQ(s1.data(), found.data());
+  EXPECT_FALSE(shared_pool.Find("abcd", &found));
+  EXPECT_FALSE(shared_pool.Find("", &found));
+  EXPECT_EQ(s1.data(), found.data());
+
+  // Enough strings to grow the table several times.
+  std::vector<IdString> strings;
+  for (int i = 0; i < 1000; ++i) {
+    strings.push_back(shared_pool.Make(absl::StrCat("s", i)));
+  }
+  EXPECT_EQ(1002, shared_pool.num_strings());
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(shared_pool.Find(absl::StrCat("s", i), &found));
+    EXPECT_EQ(strings[i].data(), found.data());
+    EXPECT_EQ(found.HashCase(), ID(absl::StrCat("S", i)).HashCase());
+  }
+}
+
+TEST(SharedIdStringPool, BacksIdStringPool) {
+  auto shared_pool = std::make_shared<SharedIdStringPool>();
+  IdString interned = shared_pool->Make("KeyValue");
+
+  IdString local;
+  {
+    IdStringPool pool(shared_pool);
+    shared_pool.reset();
+    EXPECT_EQ(interned.data(), pool.Make("KeyValue").data());
+    local = pool.Make("Key");
+    EXPECT_EQ("Key", local.ToStringView());
+    EXPECT_NE(interned.data(), pool.Make("keyvalue").data());
+  }
+  // The shared pool was kept alive by <pool> until now.
+#ifndef NDEBUG
+  EXPECT_DEATH(interned.CheckAlive(), kPoolIsDeadMsg);
+  EXPECT_DEATH(local.CheckAlive(), kPoolIsDeadMsg);
+#endif
+}
+
+TEST(SharedIdStringPool, ConcurrentMake) {
+  SharedIdStringPool shared_pool;
+  constexpr int kNumThreads = 8;
+  constexpr int kNumStrings = 500;
+  std::vector<std::vector<IdString>> results(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&shared_pool, &results, t]() {
+      for (int i = 0; i < kNumStrings; ++i) {
+        results[t].push_back(shared_pool.Make(absl::StrCat("id", i)));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kNumStrings, shared_pool.num_strings());
+  for (int t = 1; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumStrings; ++i) {
+      EXPECT_EQ(results[0][i].data(), results[t][i].data());
+    }
+  }
+}
+
 }  // namespace
 }  // namespace zetasql
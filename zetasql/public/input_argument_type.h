@@ -124,6 +124,7 @@ class InputArgumentType {
   bool is_relation() const { return category_ == kRelation; }
   bool is_model() const { return category_ == kModel; }
   bool is_connection() const { return category_ == kConnection; }
+  bool is_descriptor() const { return category_ == kDescriptor; }
 
   // Argument type name to be used in user facing text (i.e. error messages).
   std::string UserFacingName(ProductMode product_mode) const;
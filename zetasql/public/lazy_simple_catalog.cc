@@ -0,0 +1,392 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/lazy_simple_catalog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "zetasql/proto/simple_catalog.pb.h"
+#include "zetasql/public/simple_table.pb.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+namespace {
+
+// Protocol buffer wire types. Groups are not used by any of the messages
+// scanned here.
+constexpr int kWireTypeVarint = 0;
+constexpr int kWireTypeFixed64 = 1;
+constexpr int kWireTypeLengthDelimited = 2;
+constexpr int kWireTypeFixed32 = 5;
+
+absl::Status MalformedError(absl::string_view what) {
+  return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+         << "Malformed serialized " << what;
+}
+
+bool ReadVarint(absl::string_view* data, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (data->empty()) return false;
+    const uint8_t byte = static_cast<uint8_t>((*data)[0]);
+    data->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+// Calls <callback> for each field of the serialized message in <data>, with
+// the field number, the complete encoded field (tag included) and, for
+// length-delimited fields, the payload. Only the bytes of the top-level
+// fields are examined, so nested messages are not parsed. <what> names the
+// message in errors.
+absl::Status ForEachField(
+    absl::string_view data, absl::string_view what,
+    const std::function<absl::Status(int field_number, absl::string_view field,
+                                     absl::string_view payload)>& callback) {
+  while (!data.empty()) {
+    const char* const field_start = data.data();
+    uint64_t tag;
+    if (!ReadVarint(&data, &tag)) return MalformedError(what);
+    const uint64_t field_number = tag >> 3;
+    if (field_number == 0 ||
+        field_number > std::numeric_limits<int32_t>::max()) {
+      return MalformedError(what);
+    }
+    absl::string_view payload;
+    switch (tag & 7) {
+      case kWireTypeVarint: {
+        uint64_t unused;
+        if (!ReadVarint(&data, &unused)) return MalformedError(what);
+        break;
+      }
+      case kWireTypeFixed64:
+      case kWireTypeFixed32: {
+        const size_t size = (tag & 7) == kWireTypeFixed64 ? 8 : 4;
+        if (data.size() < size) return MalformedError(what);
+        data.remove_prefix(size);
+        break;
+      }
+      case kWireTypeLengthDelimited: {
+        uint64_t size;
+        if (!ReadVarint(&data, &size) || size > data.size()) {
+          return MalformedError(what);
+        }
+        payload = data.substr(0, size);
+        data.remove_prefix(size);
+        break;
+      }
+      default:
+        return MalformedError(what);
+    }
+    ZETASQL_RETURN_IF_ERROR(callback(
+        static_cast<int>(field_number),
+        absl::string_view(field_start, data.data() - field_start), payload));
+  }
+  return absl::OkStatus();
+}
+
+// Returns the last value of the string field <field_number> in the serialized
+// message <data>, or an empty string if it is not present.
+zetasql_base::StatusOr<absl::string_view> FindStringField(absl::string_view data,
+                                                  int field_number,
+                                                  absl::string_view what) {
+  absl::string_view value;
+  ZETASQL_RETURN_IF_ERROR(ForEachField(
+      data, what,
+      [field_number, &value](int number, absl::string_view field,
+                             absl::string_view payload) {
+        if (number == field_number) value = payload;
+        return absl::OkStatus();
+      }));
+  return value;
+}
+
+// Memory-maps the file at <path> read-only. The mapping is released when the
+// last copy of <data> is destroyed.
+absl::Status MapFile(const std::string& path, std::shared_ptr<const char>* data,
+                     absl::string_view* contents) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Failed to open " << path << ": " << strerror(errno);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const int fstat_errno = errno;
+    close(fd);
+    return ::zetasql_base::InternalErrorBuilder(ZETASQL_LOC)
+           << "Failed to stat " << path << ": " << strerror(fstat_errno);
+  }
+  const size_t size = file_stat.st_size;
+  if (size == 0) {
+    // mmap() rejects empty mappings. An empty file is a valid serialization
+    // of an empty message.
+    close(fd);
+    *data = nullptr;
+    *contents = absl::string_view();
+    return absl::OkStatus();
+  }
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  const int mmap_errno = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return ::zetasql_base::InternalErrorBuilder(ZETASQL_LOC)
+           << "Failed to mmap " << path << ": " << strerror(mmap_errno);
+  }
+  data->reset(static_cast<const char*>(addr), [size](const char* mapped) {
+    munmap(const_cast<char*>(mapped), size);
+  });
+  *contents = absl::string_view(data->get(), size);
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+LazySimpleCatalog::LazySimpleCatalog(
+    const std::string& name, TypeFactory* type_factory,
+    const std::vector<const google::protobuf::DescriptorPool*>& pools,
+    std::shared_ptr<const char> mapped_data)
+    : SimpleCatalog(name, type_factory),
+      pools_(pools),
+      mapped_data_(std::move(mapped_data)) {}
+
+absl::Status LazySimpleCatalog::Create(
+    absl::string_view serialized_catalog,
+    const std::vector<const google::protobuf::DescriptorPool*>& pools,
+    std::unique_ptr<LazySimpleCatalog>* result) {
+  ZETASQL_ASSIGN_OR_RETURN(
+      const absl::string_view name,
+      FindStringField(serialized_catalog, SimpleCatalogProto::kNameFieldNumber,
+                      "SimpleCatalogProto"));
+  // Create a top level catalog that owns the TypeFactory.
+  std::unique_ptr<LazySimpleCatalog> catalog(new LazySimpleCatalog(
+      std::string(name), /*type_factory=*/nullptr, pools,
+      /*mapped_data=*/nullptr));
+  ZETASQL_RETURN_IF_ERROR(catalog->Index(serialized_catalog));
+  *result = std::move(catalog);
+  return absl::OkStatus();
+}
+
+absl::Status LazySimpleCatalog::CreateFromFile(
+    const std::string& path,
+    const std::vector<const google::protobuf::DescriptorPool*>& pools,
+    std::unique_ptr<LazySimpleCatalog>* result) {
+  std::shared_ptr<const char> mapped_data;
+  absl::string_view contents;
+  ZETASQL_RETURN_IF_ERROR(MapFile(path, &mapped_data, &contents));
+  ZETASQL_ASSIGN_OR_RETURN(
+      const absl::string_view name,
+      FindStringField(contents, SimpleCatalogProto::kNameFieldNumber,
+                      "SimpleCatalogProto"));
+  std::unique_ptr<LazySimpleCatalog> catalog(
+      new LazySimpleCatalog(std::string(name), /*type_factory=*/nullptr, pools,
+                            std::move(mapped_data)));
+  ZETASQL_RETURN_IF_ERROR(catalog->Index(contents));
+  *result = std::move(catalog);
+  return absl::OkStatus();
+}
+
+absl::Status LazySimpleCatalog::Index(absl::string_view serialized_catalog) {
+  // Everything except tables and sub-catalogs is collected here and
+  // deserialized eagerly.
+  std::string eager_fields;
+  ZETASQL_RETURN_IF_ERROR(ForEachField(
+      serialized_catalog, "SimpleCatalogProto",
+      [this, &eager_fields](int field_number, absl::string_view field,
+                            absl::string_view payload) -> absl::Status {
+        switch (field_number) {
+          case SimpleCatalogProto::kTableFieldNumber: {
+            ZETASQL_ASSIGN_OR_RETURN(
+                absl::string_view name,
+                FindStringField(payload,
+                                SimpleTableProto::kNameInCatalogFieldNumber,
+                                "SimpleTableProto"));
+            if (name.empty()) {
+              ZETASQL_ASSIGN_OR_RETURN(
+                  name, FindStringField(payload,
+                                        SimpleTableProto::kNameFieldNumber,
+                                        "SimpleTableProto"));
+            }
+            absl::MutexLock l(&lazy_mutex_);
+            if (!pending_tables_
+                     .emplace(absl::AsciiStrToLower(name),
+                              PendingTable{std::string(name), payload})
+                     .second) {
+              return ::zetasql_base::InvalidArgumentErrorBuilder()
+                     << "Duplicate table '" << name
+                     << "' in serialized catalog";
+            }
+            return absl::OkStatus();
+          }
+          case SimpleCatalogProto::kCatalogFieldNumber: {
+            ZETASQL_ASSIGN_OR_RETURN(
+                const absl::string_view name,
+                FindStringField(payload, SimpleCatalogProto::kNameFieldNumber,
+                                "SimpleCatalogProto"));
+            std::unique_ptr<LazySimpleCatalog> sub_catalog(
+                new LazySimpleCatalog(std::string(name), type_factory(),
+                                      pools_, mapped_data_));
+            ZETASQL_RETURN_IF_ERROR(sub_catalog->Index(payload));
+            if (!AddOwnedCatalogIfNotPresent(std::string(name),
+                                             std::move(sub_catalog))) {
+              return ::zetasql_base::InvalidArgumentErrorBuilder()
+                     << "Duplicate catalog '" << name
+                     << "' in serialized catalog";
+            }
+            return absl::OkStatus();
+          }
+          default:
+            eager_fields.append(field.data(), field.size());
+            return absl::OkStatus();
+        }
+      }));
+
+  SimpleCatalogProto proto;
+  if (!proto.ParseFromString(eager_fields)) {
+    return MalformedError("SimpleCatalogProto");
+  }
+  return DeserializeImpl(proto, pools_, this);
+}
+
+absl::Status LazySimpleCatalog::DeserializeTable(
+    const PendingTable& pending, std::unique_ptr<SimpleTable>* table) {
+  SimpleTableProto table_proto;
+  if (!table_proto.ParseFromArray(pending.serialized_table.data(),
+                                  pending.serialized_table.size())) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Malformed serialized table '" << pending.name << "'";
+  }
+  return SimpleTable::Deserialize(table_proto, pools_, type_factory(), table);
+}
+
+absl::Status LazySimpleCatalog::MaterializeTableLocked(
+    absl::flat_hash_map<std::string, PendingTable>::iterator it) {
+  std::unique_ptr<SimpleTable> table;
+  ZETASQL_RETURN_IF_ERROR(DeserializeTable(it->second, &table));
+  // Freeze() only leaves tables that fail to deserialize.
+  ZETASQL_RET_CHECK(!is_frozen()) << "Table '" << it->second.name
+                          << "' was not deserialized by Freeze()";
+  AddOwnedTable(it->second.name, std::move(table));
+  pending_tables_.erase(it);
+  return absl::OkStatus();
+}
+
+absl::Status LazySimpleCatalog::GetTable(const std::string& name,
+                                         const Table** table,
+                                         const FindOptions& options) {
+  {
+    absl::MutexLock l(&lazy_mutex_);
+    auto it = pending_tables_.find(absl::AsciiStrToLower(name));
+    if (it != pending_tables_.end()) {
+      ZETASQL_RETURN_IF_ERROR(MaterializeTableLocked(it));
+    }
+  }
+  return SimpleCatalog::GetTable(name, table, options);
+}
+
+void LazySimpleCatalog::Freeze() {
+  // Holding <lazy_mutex_> keeps GetTable() from adding a table while the
+  // catalog is being frozen.
+  absl::MutexLock l(&lazy_mutex_);
+  for (auto it = pending_tables_.begin(); it != pending_tables_.end();) {
+    // MaterializeTableLocked() erases <current> on success.
+    auto current = it++;
+    const absl::Status status = MaterializeTableLocked(current);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to deserialize table '" << current->second.name
+                   << "' of catalog " << FullName()
+                   << " before freezing it: " << status;
+    }
+  }
+  SimpleCatalog::Freeze();
+}
+
+absl::Status LazySimpleCatalog::MaterializeAllTables() {
+  absl::MutexLock l(&lazy_mutex_);
+  while (!pending_tables_.empty()) {
+    ZETASQL_RETURN_IF_ERROR(MaterializeTableLocked(pending_tables_.begin()));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status LazySimpleCatalog::GetTables(
+    absl::flat_hash_set<const Table*>* output) const {
+  // Materializing tables does not change the logical contents of the catalog.
+  ZETASQL_RETURN_IF_ERROR(
+      const_cast<LazySimpleCatalog*>(this)->MaterializeAllTables());
+  return SimpleCatalog::GetTables(output);
+}
+
+int LazySimpleCatalog::num_unmaterialized_tables() const {
+  absl::MutexLock l(&lazy_mutex_);
+  return static_cast<int>(pending_tables_.size());
+}
+
+absl::Status LazyDescriptorPool::Create(
+    absl::string_view file_descriptor_set,
+    std::unique_ptr<LazyDescriptorPool>* result) {
+  std::unique_ptr<LazyDescriptorPool> pool(new LazyDescriptorPool());
+  ZETASQL_RETURN_IF_ERROR(ForEachField(
+      file_descriptor_set, "FileDescriptorSet",
+      [&pool](int field_number, absl::string_view field,
+              absl::string_view payload) -> absl::Status {
+        if (field_number != google::protobuf::FileDescriptorSet::kFileFieldNumber) {
+          return absl::OkStatus();
+        }
+        // EncodedDescriptorDatabase only indexes the file here; the
+        // descriptors are built by the DescriptorPool on first use.
+        if (!pool->database_.Add(payload.data(),
+                                 static_cast<int>(payload.size()))) {
+          return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+                 << "Invalid or duplicate file in serialized "
+                    "FileDescriptorSet";
+        }
+        return absl::OkStatus();
+      }));
+  *result = std::move(pool);
+  return absl::OkStatus();
+}
+
+absl::Status LazyDescriptorPool::CreateFromFile(
+    const std::string& path, std::unique_ptr<LazyDescriptorPool>* result) {
+  std::shared_ptr<const char> mapped_data;
+  absl::string_view contents;
+  ZETASQL_RETURN_IF_ERROR(MapFile(path, &mapped_data, &contents));
+  ZETASQL_RETURN_IF_ERROR(Create(contents, result));
+  (*result)->mapped_data_ = std::move(mapped_data);
+  return absl::OkStatus();
+}
+
+}  // namespace zetasql
@@ -0,0 +1,162 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_LAZY_SIMPLE_CATALOG_H_
+#define ZETASQL_PUBLIC_LAZY_SIMPLE_CATALOG_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor_database.h"
+#include "zetasql/public/simple_catalog.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// A SimpleCatalog loaded from a serialized SimpleCatalogProto that only
+// deserializes a table the first time it is looked up.
+//
+// Loading scans the serialized bytes once to index table names and to build
+// the sub-catalog structure, but does not parse the tables themselves.
+// GetTable() (and so FindTable()) deserializes the SimpleTable, its columns
+// and their types on first use. GetTables() deserializes all remaining tables
+// of this catalog. All other objects (types, functions, procedures, TVFs,
+// constants) are deserialized up front, as in SimpleCatalog::Deserialize().
+//
+// The serialized bytes are referenced rather than copied. CreateFromFile()
+// memory-maps the file read-only, so processes forked after loading share
+// the pages, and pages of tables that are never used need not be read.
+//
+// tables() and table_names() only return tables that have been deserialized;
+// call MaterializeAllTables() first to list all of them. SuggestTable() looks
+// tables up through GetTable(), so it also sees tables that have not been
+// deserialized yet.
+//
+// Freeze() deserializes all remaining tables of this catalog first, since
+// tables can no longer be added once frozen. Sub-catalogs are not frozen, as
+// for other SimpleCatalog subclasses, and stay lazy.
+class LazySimpleCatalog : public SimpleCatalog {
+ public:
+  LazySimpleCatalog(const LazySimpleCatalog&) = delete;
+  LazySimpleCatalog& operator=(const LazySimpleCatalog&) = delete;
+
+  // Indexes <serialized_catalog>, a serialized SimpleCatalogProto, which must
+  // outlive the result. See SimpleCatalog::Deserialize() for details about
+  // <pools>, which must also outlive the result.
+  static absl::Status Create(
+      absl::string_view serialized_catalog,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      std::unique_ptr<LazySimpleCatalog>* result);
+
+  // Same as above, reading the serialized SimpleCatalogProto from the file at
+  // <path>, which is memory-mapped for the lifetime of the result.
+  static absl::Status CreateFromFile(
+      const std::string& path,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      std::unique_ptr<LazySimpleCatalog>* result);
+
+  absl::Status GetTable(const std::string& name, const Table** table,
+                        const FindOptions& options = FindOptions()) override
+      ABSL_LOCKS_EXCLUDED(lazy_mutex_);
+
+  absl::Status GetTables(
+      absl::flat_hash_set<const Table*>* output) const override
+      ABSL_LOCKS_EXCLUDED(lazy_mutex_);
+
+  // Tables that fail to deserialize are logged and left out, and looking
+  // them up returns the deserialization error.
+  void Freeze() override ABSL_LOCKS_EXCLUDED(lazy_mutex_);
+
+  // Deserializes all tables of this catalog (but not of its sub-catalogs)
+  // that have not been looked up yet.
+  absl::Status MaterializeAllTables() ABSL_LOCKS_EXCLUDED(lazy_mutex_);
+
+  // Returns the number of tables of this catalog that are not deserialized.
+  int num_unmaterialized_tables() const ABSL_LOCKS_EXCLUDED(lazy_mutex_);
+
+ private:
+  struct PendingTable {
+    std::string name;  // Name in the catalog, with its original case.
+    absl::string_view serialized_table;
+  };
+
+  LazySimpleCatalog(
+      const std::string& name, TypeFactory* type_factory,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      std::shared_ptr<const char> mapped_data);
+
+  // Indexes the serialized SimpleCatalogProto in <serialized_catalog> into
+  // this catalog.
+  absl::Status Index(absl::string_view serialized_catalog);
+
+  // Deserializes <pending>.
+  absl::Status DeserializeTable(const PendingTable& pending,
+                                std::unique_ptr<SimpleTable>* table);
+
+  // Deserializes the table at <it> and moves it into the SimpleCatalog.
+  absl::Status MaterializeTableLocked(
+      absl::flat_hash_map<std::string, PendingTable>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lazy_mutex_);
+
+  const std::vector<const google::protobuf::DescriptorPool*> pools_;
+
+  // Keeps the memory-mapped file alive, if there is one. Shared with
+  // sub-catalogs.
+  const std::shared_ptr<const char> mapped_data_;
+
+  mutable absl::Mutex lazy_mutex_;
+  // Tables that have not been deserialized yet, keyed by lowercased name.
+  absl::flat_hash_map<std::string, PendingTable> pending_tables_
+      ABSL_GUARDED_BY(lazy_mutex_);
+};
+
+// A DescriptorPool that builds descriptors from a serialized FileDescriptorSet
+// on first use, rather than all up front. This can be used for the <pools>
+// given to LazySimpleCatalog, or anywhere else a DescriptorPool is needed.
+// As with LazySimpleCatalog, the serialized bytes are referenced rather than
+// copied, and CreateFromFile() memory-maps the file.
+class LazyDescriptorPool {
+ public:
+  LazyDescriptorPool(const LazyDescriptorPool&) = delete;
+  LazyDescriptorPool& operator=(const LazyDescriptorPool&) = delete;
+
+  // <file_descriptor_set> must outlive the result.
+  static absl::Status Create(absl::string_view file_descriptor_set,
+                             std::unique_ptr<LazyDescriptorPool>* result);
+  static absl::Status CreateFromFile(
+      const std::string& path, std::unique_ptr<LazyDescriptorPool>* result);
+
+  const google::protobuf::DescriptorPool* pool() const { return &pool_; }
+
+ private:
+  LazyDescriptorPool() : pool_(&database_) {}
+
+  std::shared_ptr<const char> mapped_data_;
+  google::protobuf::EncodedDescriptorDatabase database_;
+  // Must be declared after <database_>, which it uses.
+  google::protobuf::DescriptorPool pool_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_LAZY_SIMPLE_CATALOG_H_
@@ -0,0 +1,206 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/lazy_simple_catalog.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.pb.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/proto/simple_catalog.pb.h"
+#include "zetasql/public/simple_table.pb.h"
+#include "zetasql/public/type.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/path.h"
+
+namespace zetasql {
+
+using ::testing::HasSubstr;
+using ::zetasql_base::testing::StatusIs;
+
+namespace {
+
+// Builds a catalog with tables at two levels, one of them using a proto
+// type, and serializes it. The serialized FileDescriptorSet for the proto
+// type is returned in <file_descriptor_set>.
+void MakeSerializedCatalog(std::string* serialized_catalog,
+                           std::string* file_descriptor_set) {
+  TypeFactory type_factory;
+  const ProtoType* proto_type;
+  ZETASQL_CHECK_OK(type_factory.MakeProtoType(
+      google::protobuf::FileDescriptorProto::descriptor(), &proto_type));
+
+  SimpleCatalog catalog("root", &type_factory);
+  catalog.AddOwnedTable(
+      new SimpleTable("T1", {{"a", type_factory.get_int64()}}));
+  catalog.AddOwnedTable(new SimpleTable("T2", {{"file", proto_type}}));
+  SimpleCatalog* nested = catalog.MakeOwnedSimpleCatalog("nested");
+  nested->AddOwnedTable(
+      new SimpleTable("T3", {{"b", type_factory.get_string()}}));
+  catalog.AddType("MyInt", type_factory.get_int64());
+
+  FileDescriptorSetMap file_descriptor_set_map;
+  SimpleCatalogProto proto;
+  ZETASQL_CHECK_OK(catalog.Serialize(&file_descriptor_set_map, &proto));
+  CHECK_EQ(1, file_descriptor_set_map.size());
+  CHECK(proto.SerializeToString(serialized_catalog));
+  CHECK(file_descriptor_set_map.begin()->second->file_descriptor_set
+            .SerializeToString(file_descriptor_set));
+}
+
+}  // namespace
+
+TEST(LazySimpleCatalogTest, MaterializesTablesOnFirstLookup) {
+  std::string serialized_catalog;
+  std::string file_descriptor_set;
+  MakeSerializedCatalog(&serialized_catalog, &file_descriptor_set);
+
+  std::unique_ptr<LazyDescriptorPool> pool;
+  ZETASQL_ASSERT_OK(LazyDescriptorPool::Create(file_descriptor_set, &pool));
+  std::unique_ptr<LazySimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(LazySimpleCatalog::Create(serialized_catalog, {pool->pool()},
+                                      &catalog));
+  EXPECT_EQ("root", catalog->FullName());
+  EXPECT_EQ(2, catalog->num_unmaterialized_tables());
+  EXPECT_TRUE(catalog->table_names().empty());
+
+  // Types are deserialized eagerly.
+  const Type* type;
+  ZETASQL_EXPECT_OK(catalog->FindType({"myint"}, &type));
+  EXPECT_TRUE(type->IsInt64());
+
+  const Table* table;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"t2"}, &table));
+  EXPECT_EQ("T2", table->Name());
+  EXPECT_EQ(1, catalog->num_unmaterialized_tables());
+  ASSERT_TRUE(table->GetColumn(0)->GetType()->IsProto());
+  EXPECT_EQ("google.protobuf.FileDescriptorProto",
+            table->GetColumn(0)->GetType()->AsProto()->descriptor()
+                ->full_name());
+
+  // A second lookup returns the same table.
+  const Table* table2;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"T2"}, &table2));
+  EXPECT_EQ(table, table2);
+
+  ZETASQL_ASSERT_OK(catalog->FindTable({"nested", "t3"}, &table));
+  EXPECT_EQ("T3", table->Name());
+  EXPECT_THAT(catalog->FindTable({"t3"}, &table),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  absl::flat_hash_set<const Table*> tables;
+  ZETASQL_ASSERT_OK(catalog->GetTables(&tables));
+  EXPECT_EQ(2, tables.size());
+  EXPECT_EQ(0, catalog->num_unmaterialized_tables());
+}
+
+TEST(LazySimpleCatalogTest, Freeze) {
+  std::string serialized_catalog;
+  std::string file_descriptor_set;
+  MakeSerializedCatalog(&serialized_catalog, &file_descriptor_set);
+
+  std::unique_ptr<LazyDescriptorPool> pool;
+  ZETASQL_ASSERT_OK(LazyDescriptorPool::Create(file_descriptor_set, &pool));
+  std::unique_ptr<LazySimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(LazySimpleCatalog::Create(serialized_catalog, {pool->pool()},
+                                      &catalog));
+
+  // Suggestions see tables that have not been looked up yet.
+  EXPECT_EQ("nested.T3", catalog->SuggestTable({"t3"}));
+
+  catalog->Freeze();
+  EXPECT_TRUE(catalog->is_frozen());
+  EXPECT_EQ(0, catalog->num_unmaterialized_tables());
+  EXPECT_EQ(2, catalog->table_names().size());
+
+  const Table* table;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"t1"}, &table));
+  EXPECT_EQ("T1", table->Name());
+  ZETASQL_ASSERT_OK(catalog->FindTable({"T2"}, &table));
+  EXPECT_EQ("T2", table->Name());
+  // The sub-catalog is not frozen, and still deserializes on lookup.
+  ZETASQL_ASSERT_OK(catalog->FindTable({"nested", "t3"}, &table));
+  EXPECT_EQ("T3", table->Name());
+}
+
+TEST(LazySimpleCatalogTest, FreezeWithMalformedTable) {
+  SimpleCatalogProto proto;
+  proto.set_name("root");
+  SimpleTableProto* table_proto = proto.add_table();
+  table_proto->set_name("bad");
+  // A primary key on a column that does not exist fails to deserialize.
+  table_proto->add_primary_key_column_index(5);
+  std::unique_ptr<LazySimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(
+      LazySimpleCatalog::Create(proto.SerializeAsString(), {}, &catalog));
+
+  catalog->Freeze();
+  EXPECT_EQ(1, catalog->num_unmaterialized_tables());
+  const Table* table;
+  EXPECT_FALSE(catalog->FindTable({"bad"}, &table).ok());
+  // The error is reported again rather than adding to the frozen catalog.
+  EXPECT_FALSE(catalog->FindTable({"bad"}, &table).ok());
+}
+
+TEST(LazySimpleCatalogTest, CreateFromFile) {
+  std::string serialized_catalog;
+  std::string file_descriptor_set;
+  MakeSerializedCatalog(&serialized_catalog, &file_descriptor_set);
+
+  const std::string catalog_path =
+      zetasql_base::JoinPath(::testing::TempDir(), "lazy_catalog.binarypb");
+  const std::string pool_path =
+      zetasql_base::JoinPath(::testing::TempDir(), "lazy_catalog_fds.binarypb");
+  std::ofstream(catalog_path, std::ios::binary) << serialized_catalog;
+  std::ofstream(pool_path, std::ios::binary) << file_descriptor_set;
+
+  std::unique_ptr<LazyDescriptorPool> pool;
+  ZETASQL_ASSERT_OK(LazyDescriptorPool::CreateFromFile(pool_path, &pool));
+  std::unique_ptr<LazySimpleCatalog> catalog;
+  ZETASQL_ASSERT_OK(
+      LazySimpleCatalog::CreateFromFile(catalog_path, {pool->pool()}, &catalog));
+  const Table* table;
+  ZETASQL_ASSERT_OK(catalog->FindTable({"t2"}, &table));
+  EXPECT_TRUE(table->GetColumn(0)->GetType()->IsProto());
+  ZETASQL_ASSERT_OK(catalog->FindTable({"nested", "t3"}, &table));
+
+  EXPECT_THAT(LazySimpleCatalog::CreateFromFile(
+                  zetasql_base::JoinPath(::testing::TempDir(), "does_not_exist"),
+                  {}, &catalog),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Failed to open")));
+}
+
+TEST(LazySimpleCatalogTest, Errors) {
+  std::unique_ptr<LazySimpleCatalog> catalog;
+  EXPECT_THAT(LazySimpleCatalog::Create("\xff", {}, &catalog),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Malformed serialized SimpleCatalogProto")));
+
+  SimpleCatalogProto proto;
+  proto.add_table()->set_name("t");
+  proto.add_table()->set_name("T");
+  EXPECT_THAT(
+      LazySimpleCatalog::Create(proto.SerializeAsString(), {}, &catalog),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("Duplicate table 'T'")));
+}
+
+}  // namespace zetasql
@@ -37,6 +37,7 @@
 #include "absl/strings/ascii.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "zetasql/base/endian.h"
 #include "zetasql/base/stl_util.h"
 #include "zetasql/base/mathutil.h"
@@ -1010,7 +1011,17 @@ zetasql_base::StatusOr<NumericValue> NumericValue::FromDouble(double value) {
 }
 
 zetasql_base::StatusOr<NumericValue> NumericValue::Multiply(NumericValue rh) const {
-  const __int128 value = as_packed_int();
+  NumericValue result;
+  if (ABSL_PREDICT_TRUE(MultiplyInternal(*this, rh, &result))) {
+    return result;
+  }
+  return MakeEvalError() << "numeric overflow: " << ToString() << " * "
+                         << rh.ToString();
+}
+
+bool NumericValue::MultiplyInternal(NumericValue lh, NumericValue rh,
+                                    NumericValue* out) {
+  const __int128 value = lh.as_packed_int();
   const __int128 rh_value = rh.as_packed_int();
   bool negative = value < 0;
   bool rh_negative = rh_value < 0;
@@ -1034,11 +1045,60 @@ zetasql_base::StatusOr<NumericValue> NumericValue::Multiply(NumericValue rh) con
     res /= kScalingFactor;
     unsigned __int128 v = static_cast<unsigned __int128>(res);
     // We already checked the value range, so no need to call FromPackedInt.
-    return NumericValue(
-        static_cast<__int128>(negative == rh_negative ? v : -v));
+    *out = NumericValue(static_cast<__int128>(negative == rh_negative ? v : -v));
+    return true;
   }
-  return MakeEvalError() << "numeric overflow: " << ToString() << " * "
-                         << rh.ToString();
+  return false;
+}
+
+absl::Status NumericValue::AddElementwise(absl::Span<const NumericValue> lh,
+                                          absl::Span<const NumericValue> rh,
+                                          absl::Span<NumericValue> out) {
+  DCHECK_EQ(lh.size(), rh.size());
+  DCHECK_EQ(lh.size(), out.size());
+  bool overflow = false;
+  for (size_t i = 0; i < out.size(); ++i) {
+    // The exact sum is within [2 * kNumericMin, 2 * kNumericMax]. If it does
+    // not fit into __int128, the wrapped-around sum has the opposite sign and
+    // is still outside of [kNumericMin, kNumericMax], so a single range check
+    // detects both kinds of overflow.
+    const __int128 sum = static_cast<__int128>(
+        static_cast<unsigned __int128>(lh[i].as_packed_int()) +
+        static_cast<unsigned __int128>(rh[i].as_packed_int()));
+    overflow |= (sum > internal::kNumericMax) | (sum < internal::kNumericMin);
+    out[i] = NumericValue(sum);
+  }
+  if (ABSL_PREDICT_TRUE(!overflow)) {
+    return absl::OkStatus();
+  }
+  for (size_t i = 0; i < out.size(); ++i) {
+    zetasql_base::StatusOr<NumericValue> sum = lh[i].Add(rh[i]);
+    if (!sum.ok()) {
+      return sum.status();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status NumericValue::MultiplyElementwise(
+    absl::Span<const NumericValue> lh, absl::Span<const NumericValue> rh,
+    absl::Span<NumericValue> out) {
+  DCHECK_EQ(lh.size(), rh.size());
+  DCHECK_EQ(lh.size(), out.size());
+  bool overflow = false;
+  for (size_t i = 0; i < out.size(); ++i) {
+    overflow |= !MultiplyInternal(lh[i], rh[i], &out[i]);
+  }
+  if (ABSL_PREDICT_TRUE(!overflow)) {
+    return absl::OkStatus();
+  }
+  for (size_t i = 0; i < out.size(); ++i) {
+    zetasql_base::StatusOr<NumericValue> product = lh[i].Multiply(rh[i]);
+    if (!product.ok()) {
+      return product.status();
+    }
+  }
+  return absl::OkStatus();
 }
 
 NumericValue NumericValue::Abs() const {
@@ -1649,12 +1709,33 @@ NumericValue::SumAggregator::DeserializeFromProtoBytes(
   return MakeEvalError() << "Invalid NumericValue::SumAggregator encoding";
 }
 
+void NumericValue::SumAggregator::Add(absl::Span<const NumericValue> values) {
+  FixedIntSumAccumulator<2> sum;
+  for (NumericValue value : values) {
+    sum.Add(FixedInt<64, 2>(value.as_packed_int()));
+  }
+  sum_ += sum.GetSum<3>();
+}
+
 void NumericValue::VarianceAggregator::Add(NumericValue value) {
   sum_ += FixedInt<64, 3>(value.as_packed_int());
   FixedInt<64, 2> v(value.as_packed_int());
   sum_square_ += FixedInt<64, 5>(ExtendAndMultiply(v, v));
 }
 
+void NumericValue::VarianceAggregator::Add(
+    absl::Span<const NumericValue> values) {
+  FixedIntSumAccumulator<2> sum;
+  FixedIntSumAccumulator<4> sum_square;
+  for (NumericValue value : values) {
+    FixedInt<64, 2> v(value.as_packed_int());
+    sum.Add(v);
+    sum_square.Add(ExtendAndMultiply(v, v));
+  }
+  sum_ += sum.GetSum<3>();
+  sum_square_ += sum_square.GetSum<5>();
+}
+
 void NumericValue::VarianceAggregator::Subtract(NumericValue value) {
   sum_ -= FixedInt<64, 3>(value.as_packed_int());
   FixedInt<64, 2> v(value.as_packed_int());
@@ -2183,6 +2264,15 @@ std::ostream& operator<<(std::ostream& out, const BigNumericValue& value) {
   return out << value.ToString();
 }
 
+void BigNumericValue::SumAggregator::Add(
+    absl::Span<const BigNumericValue> values) {
+  FixedIntSumAccumulator<4> sum;
+  for (const BigNumericValue& value : values) {
+    sum.Add(value.value_);
+  }
+  sum_ += sum.GetSum<5>();
+}
+
 zetasql_base::StatusOr<BigNumericValue> BigNumericValue::SumAggregator::GetSum() const {
   if (sum_.number()[4] ==
       static_cast<uint64_t>(static_cast<int64_t>(sum_.number()[3]) >> 63)) {
@@ -32,6 +32,7 @@
 #include "absl/base/port.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status_builder.h"
 #include "zetasql/base/statusor.h"
 
@@ -110,6 +111,18 @@ class NumericValue final {
   zetasql_base::StatusOr<NumericValue> Multiply(NumericValue rh) const;
   zetasql_base::StatusOr<NumericValue> Divide(NumericValue rh) const;
 
+  // Batched versions of Add and Multiply: compute out[i] = lh[i] op rh[i] for
+  // every i. The overflow check is deferred to the end of the batch, so the
+  // loop body has no error handling. On overflow these return the same error
+  // as the scalar operator for the first overflowing element, and the contents
+  // of <out> are unspecified. All three spans must have the same size.
+  static absl::Status AddElementwise(absl::Span<const NumericValue> lh,
+                                     absl::Span<const NumericValue> rh,
+                                     absl::Span<NumericValue> out);
+  static absl::Status MultiplyElementwise(absl::Span<const NumericValue> lh,
+                                          absl::Span<const NumericValue> rh,
+                                          absl::Span<NumericValue> out);
+
   // An integer division operation. Similar to general division followed by
   // truncating the result to the whole integer. May return OUT_OF_RANGE if an
   // overflow or division by zero happens. This operation is the same as the SQL
@@ -280,6 +293,9 @@ class NumericValue final {
    public:
     // Adds a NUMERIC value to the sum.
     void Add(NumericValue value);
+    // Adds all NUMERIC values in <values> to the sum. Equivalent to calling
+    // Add() for each value, but considerably faster for large batches.
+    void Add(absl::Span<const NumericValue> values);
     // Subtracts a NUMERIC value from the sum.
     void Subtract(NumericValue value);
     // Returns sum of all input values. Returns OUT_OF_RANGE error on overflow.
@@ -319,6 +335,9 @@ class NumericValue final {
    public:
     // Adds a NUMERIC value to the input.
     void Add(NumericValue value);
+    // Adds all NUMERIC values in <values> to the input. Equivalent to calling
+    // Add() for each value, but considerably faster for large batches.
+    void Add(absl::Span<const NumericValue> values);
     // Removes a previously added NUMERIC value from the input.
     // This method is provided for implementing analytic functions with
     // sliding windows. If the value has not been added to the input, or if it
@@ -459,6 +478,10 @@ class NumericValue final {
   static zetasql_base::StatusOr<NumericValue> FromStringInternal(
       absl::string_view str, bool is_strict);
 
+  // Stores lh * rh into <out> and returns true, or returns false on overflow.
+  static bool MultiplyInternal(NumericValue lh, NumericValue rh,
+                               NumericValue* out);
+
   template <int kNumBitsPerWord, int kNumWords>
   static zetasql_base::StatusOr<NumericValue> FromFixedUint(
       const FixedUint<kNumBitsPerWord, kNumWords>& val, bool negate);
@@ -650,6 +673,9 @@ class BigNumericValue final {
    public:
     // Adds a BIGNUMERIC value to the sum.
     void Add(const BigNumericValue& value);
+    // Adds all BIGNUMERIC values in <values> to the sum. Equivalent to calling
+    // Add() for each value, but considerably faster for large batches.
+    void Add(absl::Span<const BigNumericValue> values);
     // Subtracts a BIGNUMERIC value from the sum.
     void Subtract(const BigNumericValue& value);
     // Returns sum of all input values. Returns OUT_OF_RANGE error on overflow.
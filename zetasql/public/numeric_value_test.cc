@@ -45,6 +45,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "zetasql/base/bits.h"
 #include "zetasql/base/endian.h"
@@ -1171,6 +1172,61 @@ TEST_F(NumericValueTest, Multiply_Random) {
   TestMultiplication<NumericValue, int32_t, int64_t>(&random_);
 }
 
+// Verifies that <elementwise_op> produces the same results as applying
+// <scalar_op> to every pair of elements, or the error of the first failing
+// pair.
+template <typename ScalarOp, typename ElementwiseOp>
+void TestElementwiseOp(ScalarOp scalar_op, ElementwiseOp elementwise_op,
+                       const std::vector<NumericValue>& lh,
+                       const std::vector<NumericValue>& rh) {
+  std::vector<NumericValue> expected;
+  absl::Status expected_status;
+  for (size_t i = 0; i < lh.size(); ++i) {
+    zetasql_base::StatusOr<NumericValue> result = scalar_op(lh[i], rh[i]);
+    if (!result.ok()) {
+      expected_status = result.status();
+      break;
+    }
+    expected.push_back(*result);
+  }
+  std::vector<NumericValue> out(lh.size());
+  absl::Status status = elementwise_op(lh, rh, absl::MakeSpan(out));
+  EXPECT_EQ(status, expected_status);
+  if (expected_status.ok()) {
+    EXPECT_EQ(out, expected);
+  }
+}
+
+TEST_F(NumericValueTest, AddAndMultiplyElementwise) {
+  std::vector<NumericValue> values;
+  for (__int128 packed : kNumericValidPackedValues) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue value,
+                         NumericValue::FromPackedInt(packed));
+    values.push_back(value);
+  }
+  std::vector<NumericValue> reversed(values.rbegin(), values.rend());
+  std::vector<NumericValue> negated;
+  std::vector<NumericValue> halves;
+  for (NumericValue value : values) {
+    negated.push_back(value.Negate());
+    halves.push_back(NumericValue::FromString("0.5").value());
+  }
+  auto add = [](NumericValue x, NumericValue y) { return x.Add(y); };
+  auto multiply = [](NumericValue x, NumericValue y) {
+    return x.Multiply(y);
+  };
+  for (const std::vector<NumericValue>* rh :
+       {&values, &reversed, &negated, &halves}) {
+    TestElementwiseOp(add, NumericValue::AddElementwise, values, *rh);
+    TestElementwiseOp(multiply, NumericValue::MultiplyElementwise, values,
+                      *rh);
+  }
+
+  // Empty input.
+  EXPECT_EQ(NumericValue::AddElementwise({}, {}, {}), absl::OkStatus());
+  EXPECT_EQ(NumericValue::MultiplyElementwise({}, {}, {}), absl::OkStatus());
+}
+
 TEST_F(NumericValueTest, Negate) {
   EXPECT_EQ(NumericValue(0), NumericValue(0).Negate());
   EXPECT_EQ(NumericValue(-1), NumericValue(1).Negate());
@@ -2714,6 +2770,30 @@ TEST(NumericSumAggregatorTest, Avg) {
   }
 }
 
+TEST(NumericSumAggregatorTest, AddSpan) {
+  std::vector<NumericValue> inputs;
+  for (__int128 packed : kNumericValidPackedValues) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue input,
+                         NumericValue::FromPackedInt(packed));
+    // Add each value several times so that the sum exceeds the NUMERIC range.
+    inputs.insert(inputs.end(), 3, input);
+  }
+  for (size_t size = 0; size <= inputs.size(); ++size) {
+    absl::Span<const NumericValue> span(inputs.data(), size);
+    NumericValue::SumAggregator expected;
+    for (NumericValue input : span) {
+      expected.Add(input);
+    }
+    NumericValue::SumAggregator aggregator;
+    aggregator.Add(span);
+    EXPECT_TRUE(aggregator == expected) << size;
+    // Adding to a non-empty aggregator.
+    aggregator.Add(span);
+    expected.MergeWith(expected);
+    EXPECT_TRUE(aggregator == expected) << size;
+  }
+}
+
 static constexpr NumericValueWrapper kNumericUnaryAggregatorTestInputs[] = {
     1,
     0,
@@ -2818,6 +2898,25 @@ TEST_F(NumericValueTest, VarianceAggregatorManyValues) {
   VerifyVarianceAggregator(agg4, expect_pvar4, expect_svar4, kInputCount);
 }
 
+TEST_F(NumericValueTest, VarianceAggregatorAddSpan) {
+  std::vector<NumericValue> inputs;
+  for (__int128 packed : kNumericValidPackedValues) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(NumericValue input,
+                         NumericValue::FromPackedInt(packed));
+    inputs.insert(inputs.end(), 3, input);
+  }
+  for (size_t size = 0; size <= inputs.size(); ++size) {
+    absl::Span<const NumericValue> span(inputs.data(), size);
+    NumericValue::VarianceAggregator expected;
+    for (NumericValue input : span) {
+      expected.Add(input);
+    }
+    NumericValue::VarianceAggregator aggregator;
+    aggregator.Add(span);
+    EXPECT_TRUE(aggregator == expected) << size;
+  }
+}
+
 TEST_F(NumericValueTest, VarianceAggregatorMergeWith) {
   TestAggregatorMergeWith<NumericValue::VarianceAggregator>(
       kNumericUnaryAggregatorTestInputs);
@@ -5377,6 +5476,27 @@ TEST(BigNumericSumAggregatorTest, Sum) {
   }
 }
 
+TEST(BigNumericSumAggregatorTest, AddSpan) {
+  std::vector<BigNumericValue> inputs;
+  for (BigNumericStringTestData data : kBigNumericValueValidFromStringPairs) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(BigNumericValue input,
+                         BigNumericValue().FromString(data.first));
+    inputs.insert(inputs.end(), 3, input);
+  }
+  inputs.insert(inputs.end(), 3, BigNumericValue::MaxValue());
+  inputs.insert(inputs.end(), 3, BigNumericValue::MinValue());
+  for (size_t size = 0; size <= inputs.size(); ++size) {
+    absl::Span<const BigNumericValue> span(inputs.data(), size);
+    BigNumericValue::SumAggregator expected;
+    for (const BigNumericValue& input : span) {
+      expected.Add(input);
+    }
+    BigNumericValue::SumAggregator aggregator;
+    aggregator.Add(span);
+    EXPECT_TRUE(aggregator == expected) << size;
+  }
+}
+
 TEST(BigNumericSumAggregatorTest, Avg) {
   // Test repeated inputs with same value.
   for (BigNumericStringTestData data : kBigNumericValueValidFromStringPairs) {
@@ -18,6 +18,8 @@
 
 #include <map>
 #include <memory>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include "zetasql/base/logging.h"
@@ -32,6 +34,7 @@
 #include "absl/strings/ascii.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/source_location.h"
@@ -48,7 +51,7 @@ SimpleCatalog::SimpleCatalog(const std::string& name, TypeFactory* type_factory)
 absl::Status SimpleCatalog::GetTable(const std::string& name,
                                      const Table** table,
                                      const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *table = zetasql_base::FindPtrOrNull(tables_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -56,7 +59,7 @@ absl::Status SimpleCatalog::GetTable(const std::string& name,
 absl::Status SimpleCatalog::GetModel(const std::string& name,
                                      const Model** model,
                                      const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *model = zetasql_base::FindPtrOrNull(models_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -64,7 +67,7 @@ absl::Status SimpleCatalog::GetModel(const std::string& name,
 absl::Status SimpleCatalog::GetConnection(const std::string& name,
                                           const Connection** connection,
                                           const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *connection = zetasql_base::FindPtrOrNull(connections_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -72,7 +75,7 @@ absl::Status SimpleCatalog::GetConnection(const std::string& name,
 absl::Status SimpleCatalog::GetFunction(const std::string& name,
                                         const Function** function,
                                         const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *function = zetasql_base::FindPtrOrNull(functions_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -80,7 +83,7 @@ absl::Status SimpleCatalog::GetFunction(const std::string& name,
 absl::Status SimpleCatalog::GetTableValuedFunction(
     const std::string& name, const TableValuedFunction** function,
     const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *function =
       zetasql_base::FindPtrOrNull(table_valued_functions_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
@@ -89,7 +92,7 @@ absl::Status SimpleCatalog::GetTableValuedFunction(
 absl::Status SimpleCatalog::GetProcedure(const std::string& name,
                                          const Procedure** procedure,
                                          const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *procedure = zetasql_base::FindPtrOrNull(procedures_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -98,7 +101,7 @@ absl::Status SimpleCatalog::GetType(const std::string& name, const Type** type,
                                     const FindOptions& options) {
   const google::protobuf::DescriptorPool* pool;
   {
-    absl::MutexLock l(&mutex_);
+    absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
     // Types contained in types_ have case-insensitive names, so we lowercase
     // the name as is done in AddType.
     *type = zetasql_base::FindPtrOrNull(types_, absl::AsciiStrToLower(name));
@@ -129,7 +132,7 @@ absl::Status SimpleCatalog::GetType(const std::string& name, const Type** type,
 absl::Status SimpleCatalog::GetCatalog(const std::string& name,
                                        Catalog** catalog,
                                        const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *catalog = zetasql_base::FindPtrOrNull(catalogs_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
@@ -137,11 +140,108 @@ absl::Status SimpleCatalog::GetCatalog(const std::string& name,
 absl::Status SimpleCatalog::GetConstant(const std::string& name,
                                         const Constant** constant,
                                         const FindOptions& options) {
-  absl::MutexLock l(&mutex_);
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   *constant = zetasql_base::FindPtrOrNull(constants_, absl::AsciiStrToLower(name));
   return absl::OkStatus();
 }
 
+namespace {
+
+// Returns the key used for <path> in the precomputed path maps of a frozen
+// SimpleCatalog. Catalog names may contain any character except '\0'.
+std::string FrozenPathKey(absl::Span<const std::string> path) {
+  return absl::AsciiStrToLower(absl::StrJoin(path, absl::string_view("\0", 1)));
+}
+
+}  // namespace
+
+absl::Status SimpleCatalog::FindTable(const absl::Span<const std::string>& path,
+                                      const Table** table,
+                                      const FindOptions& options) {
+  if (path.size() > 1 && is_frozen()) {
+    *table = zetasql_base::FindPtrOrNull(frozen_table_paths_, FrozenPathKey(path));
+    if (*table != nullptr) {
+      return absl::OkStatus();
+    }
+  }
+  return Catalog::FindTable(path, table, options);
+}
+
+absl::Status SimpleCatalog::FindFunction(
+    const absl::Span<const std::string>& path, const Function** function,
+    const FindOptions& options) {
+  if (path.size() > 1 && is_frozen()) {
+    *function =
+        zetasql_base::FindPtrOrNull(frozen_function_paths_, FrozenPathKey(path));
+    if (*function != nullptr) {
+      return absl::OkStatus();
+    }
+  }
+  return Catalog::FindFunction(path, function, options);
+}
+
+void SimpleCatalog::Freeze() {
+  std::vector<std::pair<std::string, SimpleCatalog*>> sub_catalogs;
+  {
+    absl::MutexLock l(&mutex_);
+    if (freeze_started_) {
+      return;
+    }
+    freeze_started_ = true;
+    for (const auto& entry : catalogs_) {
+      // Only plain SimpleCatalogs are frozen. Subclasses may override the
+      // lookup methods, so paths through them are left to Catalog::Find*.
+      if (entry.second != nullptr &&
+          typeid(*entry.second) == typeid(SimpleCatalog)) {
+        sub_catalogs.emplace_back(entry.first,
+                                  static_cast<SimpleCatalog*>(entry.second));
+      }
+    }
+  }
+  // Make sure the TypeFactory exists before it can no longer be created.
+  type_factory();
+
+  absl::flat_hash_map<std::string, const Table*> table_paths;
+  absl::flat_hash_map<std::string, const Function*> function_paths;
+  for (const auto& entry : sub_catalogs) {
+    entry.second->Freeze();
+    // A sub-catalog that is still being frozen further up the stack is part
+    // of a cycle; its paths are not precomputed.
+    if (entry.second->is_frozen()) {
+      entry.second->CollectFrozenPaths(entry.first, &table_paths,
+                                       &function_paths);
+    }
+  }
+
+  absl::MutexLock l(&mutex_);
+  frozen_table_paths_ = std::move(table_paths);
+  frozen_function_paths_ = std::move(function_paths);
+  frozen_.store(true, std::memory_order_release);
+}
+
+void SimpleCatalog::CollectFrozenPaths(
+    const std::string& prefix,
+    absl::flat_hash_map<std::string, const Table*>* table_paths,
+    absl::flat_hash_map<std::string, const Function*>* function_paths) const {
+  DCHECK(is_frozen());
+  const std::string key_prefix = absl::StrCat(prefix, absl::string_view("\0", 1));
+  // Keys in the maps below are already lowercase.
+  for (const auto& entry : tables_) {
+    table_paths->emplace(absl::StrCat(key_prefix, entry.first), entry.second);
+  }
+  for (const auto& entry : functions_) {
+    function_paths->emplace(absl::StrCat(key_prefix, entry.first),
+                            entry.second);
+  }
+  for (const auto& entry : frozen_table_paths_) {
+    table_paths->emplace(absl::StrCat(key_prefix, entry.first), entry.second);
+  }
+  for (const auto& entry : frozen_function_paths_) {
+    function_paths->emplace(absl::StrCat(key_prefix, entry.first),
+                            entry.second);
+  }
+}
+
 std::string SimpleCatalog::SuggestTable(
     const absl::Span<const std::string>& mistyped_path) {
   if (mistyped_path.empty()) {
@@ -258,17 +358,20 @@ std::string SimpleCatalog::SuggestConstant(
 
 void SimpleCatalog::AddTable(const std::string& name, const Table* table) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&tables_, absl::AsciiStrToLower(name), table);
 }
 
 void SimpleCatalog::AddModel(const std::string& name, const Model* model) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&models_, absl::AsciiStrToLower(name), model);
 }
 
 void SimpleCatalog::AddConnection(const std::string& name,
                                   const Connection* connection) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&connections_, absl::AsciiStrToLower(name), connection);
 }
 
@@ -278,6 +381,7 @@ void SimpleCatalog::AddType(const std::string& name, const Type* type) {
 }
 
 void SimpleCatalog::AddTypeLocked(const std::string& name, const Type* type) {
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&types_, absl::AsciiStrToLower(name), type);
 }
 
@@ -288,11 +392,13 @@ void SimpleCatalog::AddCatalog(const std::string& name, Catalog* catalog) {
 
 void SimpleCatalog::AddCatalogLocked(const std::string& name,
                                      Catalog* catalog) {
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&catalogs_, absl::AsciiStrToLower(name), catalog);
 }
 
 void SimpleCatalog::AddFunctionLocked(const std::string& name,
                                       const Function* function) {
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&functions_, absl::AsciiStrToLower(name), function);
   if (!function->alias_name().empty() &&
       zetasql_base::StringCaseCompare(function->alias_name(), name) != 0) {
@@ -309,6 +415,7 @@ void SimpleCatalog::AddFunction(const std::string& name,
 
 void SimpleCatalog::AddTableValuedFunctionLocked(
     const std::string& name, const TableValuedFunction* table_function) {
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&table_valued_functions_, absl::AsciiStrToLower(name),
                    table_function);
 }
@@ -322,6 +429,7 @@ void SimpleCatalog::AddTableValuedFunction(
 void SimpleCatalog::AddProcedure(const std::string& name,
                                  const Procedure* procedure) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&procedures_, absl::AsciiStrToLower(name), procedure);
 }
 
@@ -333,6 +441,7 @@ void SimpleCatalog::AddConstant(const std::string& name,
 
 void SimpleCatalog::AddConstantLocked(const std::string& name,
                                       const Constant* constant) {
+  CheckNotFrozen();
   zetasql_base::InsertOrDie(&constants_, absl::AsciiStrToLower(name), constant);
 }
 
@@ -346,6 +455,7 @@ void SimpleCatalog::AddOwnedTable(const std::string& name,
 bool SimpleCatalog::AddOwnedTableIfNotPresent(
     const std::string& name, std::unique_ptr<const Table> table) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   if (!zetasql_base::InsertIfNotPresent(&tables_, absl::AsciiStrToLower(name),
                                table.get())) {
     return false;
@@ -427,6 +537,7 @@ void SimpleCatalog::AddOwnedProcedure(
 bool SimpleCatalog::AddOwnedProcedureIfNotPresent(
     std::unique_ptr<Procedure> procedure) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   if (!zetasql_base::InsertIfNotPresent(&procedures_,
                                absl::AsciiStrToLower(procedure->Name()),
                                procedure.get())) {
@@ -626,6 +737,7 @@ void SimpleCatalog::AddOwnedConstant(std::unique_ptr<const Constant> constant) {
 bool SimpleCatalog::AddOwnedConstantIfNotPresent(
     std::unique_ptr<const Constant> constant) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   if (!zetasql_base::InsertIfNotPresent(&constants_,
                                absl::AsciiStrToLower(constant->Name()),
                                constant.get())) {
@@ -647,6 +759,7 @@ SimpleCatalog* SimpleCatalog::MakeOwnedSimpleCatalog(const std::string& name) {
 
 void SimpleCatalog::SetDescriptorPool(const google::protobuf::DescriptorPool* pool) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   CHECK(descriptor_pool_ == nullptr)
       << "SimpleCatalog::SetDescriptorPool can only be called once";
   owned_descriptor_pool_.reset();
@@ -655,6 +768,7 @@ void SimpleCatalog::SetDescriptorPool(const google::protobuf::DescriptorPool* po
 
 void SimpleCatalog::SetOwnedDescriptorPool(const google::protobuf::DescriptorPool* pool) {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   CHECK(descriptor_pool_ == nullptr)
       << "SimpleCatalog::SetDescriptorPool can only be called once";
   owned_descriptor_pool_.reset(pool);
@@ -663,11 +777,18 @@ void SimpleCatalog::SetOwnedDescriptorPool(const google::protobuf::DescriptorPoo
 
 void SimpleCatalog::AddZetaSQLFunctions(
     const ZetaSQLBuiltinFunctionOptions& options) {
-  std::map<std::string, std::unique_ptr<Function>> function_map;
+  CheckNotFrozen();
+  // The builtin Functions are shared, immutable, and kept alive by
+  // <builtin_function_sets_>, so they are added without copying.
+  std::shared_ptr<const ZetaSQLBuiltinFunctionSet> function_set =
+      ZetaSQLBuiltinFunctionSet::GetShared(options);
+  {
+    absl::MutexLock l(&mutex_);
+    builtin_function_sets_.push_back(function_set);
+  }
   // We have to call type_factory() while not holding mutex_.
   TypeFactory* type_factory = this->type_factory();
-  GetZetaSQLFunctions(type_factory, options, &function_map);
-  for (auto& function_pair : function_map) {
+  for (const auto& function_pair : function_set->functions()) {
     const std::vector<std::string>& path =
         function_pair.second->FunctionNamePath();
     SimpleCatalog* catalog = this;
@@ -689,22 +810,25 @@ void SimpleCatalog::AddZetaSQLFunctions(
                 .second);
       }
     }
-    catalog->AddOwnedFunction(path.back(), std::move(function_pair.second));
+    catalog->AddFunction(path.back(), function_pair.second.get());
   }
 }
 
 void SimpleCatalog::ClearFunctions() {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   functions_.clear();
   owned_functions_.clear();
   for (const auto& pair : owned_zetasql_subcatalogs_) {
     catalogs_.erase(pair.first);
   }
   owned_zetasql_subcatalogs_.clear();
+  builtin_function_sets_.clear();
 }
 
 void SimpleCatalog::ClearTableValuedFunctions() {
   absl::MutexLock l(&mutex_);
+  CheckNotFrozen();
   table_valued_functions_.clear();
   owned_table_valued_functions_.clear();
   for (const auto& pair : owned_zetasql_subcatalogs_) {
@@ -713,8 +837,29 @@ void SimpleCatalog::ClearTableValuedFunctions() {
   owned_zetasql_subcatalogs_.clear();
 }
 
-TypeFactory* SimpleCatalog::type_factory() {
+void FrozenSimpleCatalogHolder::Publish(
+    std::shared_ptr<SimpleCatalog> catalog) {
+  // Freezing may walk a large tree, so do it before taking the lock.
+  if (catalog != nullptr) {
+    catalog->Freeze();
+  }
+  std::shared_ptr<SimpleCatalog> previous;
+  {
+    absl::MutexLock l(&mutex_);
+    previous = std::move(current_);
+    current_ = std::move(catalog);
+  }
+  // <previous> is released here, outside the lock.
+}
+
+std::shared_ptr<SimpleCatalog> FrozenSimpleCatalogHolder::Get() const {
   absl::MutexLock l(&mutex_);
+  return current_;
+}
+
+TypeFactory* SimpleCatalog::type_factory() {
+  // Freeze() creates the TypeFactory if needed, so it is fixed from then on.
+  absl::MutexLockMaybe l(is_frozen() ? nullptr : &mutex_);
   if (type_factory_ == nullptr) {
     DCHECK(owned_type_factory_ == nullptr);
     owned_type_factory_ = absl::make_unique<TypeFactory>();
@@ -723,9 +868,7 @@ TypeFactory* SimpleCatalog::type_factory() {
   return type_factory_;
 }
 
-namespace {
-
-absl::Status DeserializeImpl(
+absl::Status SimpleCatalog::DeserializeImpl(
     const SimpleCatalogProto& proto,
     const std::vector<const google::protobuf::DescriptorPool*>& pools,
     SimpleCatalog* catalog) {
@@ -815,6 +958,8 @@ absl::Status DeserializeImpl(
   return absl::OkStatus();
 }
 
+namespace {
+
 template <typename M, typename ValueContainer>
 void InsertValuesFromMap(const M& m, ValueContainer* value_container) {
   for (const auto& kv : m) {
@@ -17,6 +17,7 @@
 #ifndef ZETASQL_PUBLIC_SIMPLE_CATALOG_H_
 #define ZETASQL_PUBLIC_SIMPLE_CATALOG_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
@@ -107,6 +108,19 @@ class SimpleCatalog : public EnumerableCatalog {
                            const FindOptions& options = FindOptions()) override
       ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Once frozen, these resolve multi-part paths through nested SimpleCatalogs
+  // with a single lookup. Otherwise they behave like the Catalog versions.
+  // The precomputed paths are immutable once frozen and are read without
+  // holding <mutex_>.
+  absl::Status FindTable(const absl::Span<const std::string>& path,
+                         const Table** table,
+                         const FindOptions& options = FindOptions()) override
+      ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  absl::Status FindFunction(const absl::Span<const std::string>& path,
+                            const Function** function,
+                            const FindOptions& options = FindOptions()) override
+      ABSL_NO_THREAD_SAFETY_ANALYSIS;
+
   // For suggestions we look from the last level of <mistyped_path>:
   //  - Whether the object exists directly in sub-catalogs.
   //  - If not above, whether there is a single name that's misspelled in the
@@ -263,6 +277,9 @@ class SimpleCatalog : public EnumerableCatalog {
   // namespaces. If any of the selected functions are in namespaces,
   // sub-Catalogs will be created and the appropriate functions will be added in
   // those sub-Catalogs.
+  // The Functions are not copied; they come from the process-wide
+  // ZetaSQLBuiltinFunctionSet for <options>, which this catalog keeps alive,
+  // so repeated calls with equivalent <options> are cheap.
   // Also: Functions and Catalogs with the same names must not already exist.
   void AddZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options =
                                  ZetaSQLBuiltinFunctionOptions())
@@ -297,6 +314,21 @@ class SimpleCatalog : public EnumerableCatalog {
   // catalogs.
   void ClearTableValuedFunctions() ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Makes this catalog, and recursively every SimpleCatalog reachable through
+  // its sub-catalogs, immutable. After Freeze() returns, lookups no longer
+  // acquire the catalog mutex, and table and function paths through nested
+  // SimpleCatalogs are resolved from a table precomputed here. Any later
+  // attempt to add or remove objects CHECK-fails.
+  //
+  // Freezing is permanent. To change a frozen catalog, build a new catalog
+  // (which may reference objects owned by the old one) and publish it with
+  // FrozenSimpleCatalogHolder.
+  //
+  // Subclasses that add objects on first lookup must override this to add
+  // them before calling SimpleCatalog::Freeze().
+  virtual void Freeze() ABSL_LOCKS_EXCLUDED(mutex_);
+  bool is_frozen() const { return frozen_.load(std::memory_order_acquire); }
+
   // Deserialize SimpleCatalog from proto. Types will be deserialized using
   // the TypeFactory owned by this catalog and given Descriptors from the
   // given DescriptorPools. The DescriptorPools should have been created by
@@ -356,6 +388,14 @@ class SimpleCatalog : public EnumerableCatalog {
   std::vector<std::string> catalog_names() const ABSL_LOCKS_EXCLUDED(mutex_);
   std::vector<std::string> constant_names() const ABSL_LOCKS_EXCLUDED(mutex_);
 
+ protected:
+  // Adds the objects in <proto> to <catalog>, creating sub-catalogs as
+  // needed. See Deserialize() for details about <pools>.
+  static absl::Status DeserializeImpl(
+      const SimpleCatalogProto& proto,
+      const std::vector<const google::protobuf::DescriptorPool*>& pools,
+      SimpleCatalog* catalog);
+
  private:
   absl::Status SerializeImpl(absl::flat_hash_set<const Catalog*>* seen_catalogs,
                              FileDescriptorSetMap* file_descriptor_set_map,
@@ -388,6 +428,21 @@ class SimpleCatalog : public EnumerableCatalog {
   void AddConstantLocked(const std::string& name, const Constant* constant)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  void CheckNotFrozen() const {
+    CHECK(!is_frozen()) << "SimpleCatalog " << name_
+                        << " cannot be modified after Freeze()";
+  }
+
+  // Adds the tables and functions reachable from this frozen catalog to
+  // <table_paths> and <function_paths>, keyed by the lowercased path starting
+  // with <prefix>. Reads without holding <mutex_>, so must only be called
+  // once this catalog is frozen.
+  void CollectFrozenPaths(
+      const std::string& prefix,
+      absl::flat_hash_map<std::string, const Table*>* table_paths,
+      absl::flat_hash_map<std::string, const Function*>* function_paths) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS;
+
   // Unified implementation of SuggestFunction and SuggestTableValuedFunction.
   std::string SuggestFunctionOrTableValuedFunction(
       bool is_table_valued_function,
@@ -442,10 +497,60 @@ class SimpleCatalog : public EnumerableCatalog {
   absl::flat_hash_map<std::string, std::unique_ptr<SimpleCatalog>>
       owned_zetasql_subcatalogs_ ABSL_GUARDED_BY(mutex_);
 
+  // Shared builtin function sets whose Functions were added by
+  // AddZetaSQLFunctions.
+  std::vector<std::shared_ptr<const ZetaSQLBuiltinFunctionSet>>
+      builtin_function_sets_ ABSL_GUARDED_BY(mutex_);
+
   const google::protobuf::DescriptorPool* descriptor_pool_ ABSL_GUARDED_BY(mutex_) =
       nullptr;
   std::unique_ptr<const google::protobuf::DescriptorPool> ABSL_GUARDED_BY(mutex_)
       owned_descriptor_pool_;
+
+  // Set once Freeze() has completed. After that, none of the fields above
+  // change and they are read without acquiring <mutex_>.
+  std::atomic<bool> frozen_{false};
+  // Set when Freeze() starts, to stop recursion through cyclic sub-catalogs.
+  bool freeze_started_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Tables and functions in nested SimpleCatalogs, keyed by their lowercased
+  // multi-part path. Only populated once frozen. Paths through catalogs that
+  // are not plain SimpleCatalogs are not included, and fall back to the
+  // step-by-step lookup.
+  absl::flat_hash_map<std::string, const Table*> frozen_table_paths_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, const Function*> frozen_function_paths_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+// Holds the current version of a frozen SimpleCatalog tree, so that a new
+// version can be published while analyses are still running against the old
+// one. Readers take a reference to the current version with Get() and keep
+// using it for the duration of their work; Publish() does not wait for them,
+// and an old version is destroyed when its last reader releases it.
+//
+// Typical use:
+//   auto next = std::make_shared<SimpleCatalog>("catalog");
+//   ... populate <next> ...
+//   holder.Publish(std::move(next));
+class FrozenSimpleCatalogHolder {
+ public:
+  FrozenSimpleCatalogHolder() {}
+  FrozenSimpleCatalogHolder(const FrozenSimpleCatalogHolder&) = delete;
+  FrozenSimpleCatalogHolder& operator=(const FrozenSimpleCatalogHolder&) =
+      delete;
+
+  // Freezes <catalog> and makes it the current version.
+  void Publish(std::shared_ptr<SimpleCatalog> catalog)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the current version, or NULL if nothing has been published.
+  std::shared_ptr<SimpleCatalog> Get() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Only held to copy or swap <current_>.
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<SimpleCatalog> current_ ABSL_GUARDED_BY(mutex_);
 };
 
 // SimpleTable is a concrete implementation of the Table interface.
@@ -1119,7 +1119,7 @@ class GroupValue {
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> input_iter,
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context));
 
   // The key is owned by the GroupValue.
   absl::flat_hash_map<TupleDataPtr, std::unique_ptr<GroupValue>> group_map;
@@ -1199,6 +1199,10 @@ class GroupValue {
     }
   }
 
+  if (context->operator_stats() != nullptr) {
+    context->operator_stats()->AddCounter(this, "num_groups", group_map.size());
+  }
+
   // Build the tuples that the iterator should return.
   auto tuples = absl::make_unique<TupleDataDeque>(context->memory_accountant());
   for (auto& entry : group_map) {
@@ -536,6 +536,145 @@ TEST(EvalAggTest, SumNumericOverflow) {
   EXPECT_TRUE(context.IsDeterministicOutput());
 }
 
+TEST(EvalAggTest, NumericAcrossBatches) {
+  // NUMERIC and BIGNUMERIC inputs are added to the aggregators in batches, so
+  // use enough values to fill more than one batch.
+  std::vector<Value> numerics;
+  std::vector<Value> bignumerics;
+  for (int i = 1; i <= 150; ++i) {
+    numerics.push_back(Numeric(i));
+    bignumerics.push_back(BigNumeric(i));
+    if (i % 50 == 0) {
+      numerics.push_back(NullNumeric());
+      bignumerics.push_back(NullBigNumeric());
+    }
+  }
+  EvaluationContext context((EvaluationOptions()));
+
+  BuiltinAggregateFunction sum(FunctionKind::kSum, NumericType(),
+                               /*num_input_fields=*/1, NumericType());
+  EXPECT_THAT(EvalAgg(sum, numerics, &context),
+              IsOkAndHolds(Numeric(11325)));
+  BuiltinAggregateFunction avg(FunctionKind::kAvg, NumericType(),
+                               /*num_input_fields=*/1, NumericType());
+  EXPECT_THAT(
+      EvalAgg(avg, numerics, &context),
+      IsOkAndHolds(Numeric(NumericValue::FromString("75.5").value())));
+  BuiltinAggregateFunction bignumeric_sum(FunctionKind::kSum, BigNumericType(),
+                                          /*num_input_fields=*/1,
+                                          BigNumericType());
+  EXPECT_THAT(EvalAgg(bignumeric_sum, bignumerics, &context),
+              IsOkAndHolds(BigNumeric(11325)));
+
+  // A group with a single input does not request memory for a whole batch.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AggregateAccumulator> accumulator,
+                       sum.CreateAccumulator(/*args=*/{}, &context));
+  const int64_t bytes_in_use = context.memory_accountant()->num_bytes_in_use();
+  bool stop_accumulation;
+  absl::Status status;
+  ASSERT_TRUE(accumulator->Accumulate(Numeric(1), &stop_accumulation, &status));
+  EXPECT_LE(context.memory_accountant()->num_bytes_in_use() - bytes_in_use,
+            2 * sizeof(NumericValue));
+  EXPECT_THAT(accumulator->GetFinalResult(/*inputs_in_defined_order=*/false),
+              IsOkAndHolds(Numeric(1)));
+}
+
+TEST(EvalAggTest, ApproxCountDistinct) {
+  BuiltinAggregateFunction fct(FunctionKind::kApproxCountDistinct,
+                               Int64Type(), /*num_input_fields=*/1,
+                               StringType());
+  EvaluationContext context((EvaluationOptions()));
+  EXPECT_THAT(EvalAgg(fct, {}, &context), IsOkAndHolds(Int64(0)));
+  EXPECT_THAT(EvalAgg(fct,
+                      {String("a"), NullString(), String("b"), String("a")},
+                      &context),
+              IsOkAndHolds(Int64(2)));
+}
+
+TEST(EvalAggTest, HllCountInitAndMerge) {
+  BuiltinAggregateFunction init(FunctionKind::kHllCountInit, BytesType(),
+                                /*num_input_fields=*/1, Int64Type());
+  BuiltinAggregateFunction merge(FunctionKind::kHllCountMerge, Int64Type(),
+                                 /*num_input_fields=*/1, BytesType());
+  EvaluationContext context((EvaluationOptions()));
+  EXPECT_THAT(EvalAgg(init, {NullInt64()}, &context),
+              IsOkAndHolds(NullBytes()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const Value sketch1,
+      EvalAgg(init, {Int64(1), Int64(2), Int64(3)}, &context, {Int64(12)}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const Value sketch2,
+                       EvalAgg(init, {Int64(3), Int64(4)}, &context));
+  EXPECT_THAT(EvalAgg(merge, {sketch1, NullBytes(), sketch2}, &context),
+              IsOkAndHolds(Int64(4)));
+  EXPECT_THAT(EvalAgg(merge, {Bytes("invalid")}, &context),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST(EvalAggTest, KllQuantilesInitAndMerge) {
+  BuiltinAggregateFunction init(FunctionKind::kKllQuantilesInitInt64,
+                                BytesType(), /*num_input_fields=*/1,
+                                Int64Type());
+  BuiltinAggregateFunction merge(FunctionKind::kKllQuantilesMergeInt64,
+                                 Int64ArrayType(), /*num_input_fields=*/1,
+                                 BytesType());
+  BuiltinAggregateFunction merge_point(
+      FunctionKind::kKllQuantilesMergePointInt64, Int64Type(),
+      /*num_input_fields=*/1, BytesType());
+  BuiltinAggregateFunction merge_double(FunctionKind::kKllQuantilesMergeDouble,
+                                        DoubleArrayType(),
+                                        /*num_input_fields=*/1, BytesType());
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const Value sketch1,
+      EvalAgg(init, {Int64(1), Int64(2), NullInt64(), Int64(3)}, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const Value sketch2,
+                       EvalAgg(init, {Int64(4)}, &context, {Int64(100)}));
+  EXPECT_THAT(EvalAgg(merge, {sketch1, sketch2}, &context, {Int64(2)}),
+              IsOkAndHolds(Array({Int64(1), Int64(2), Int64(4)})));
+  EXPECT_THAT(EvalAgg(merge_point, {sketch1, sketch2}, &context, {Double(1)}),
+              IsOkAndHolds(Int64(4)));
+  EXPECT_THAT(EvalAgg(merge_point, {NullBytes()}, &context, {Double(0.5)}),
+              IsOkAndHolds(NullInt64()));
+  EXPECT_THAT(EvalAgg(merge_double, {sketch1}, &context, {Int64(2)}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  // Nothing was compacted, so the results do not depend on the input order.
+  EXPECT_TRUE(context.IsDeterministicOutput());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      const Value reordered_sketch1,
+      EvalAgg(init, {Int64(3), NullInt64(), Int64(2), Int64(1)}, &context));
+  EXPECT_EQ(sketch1, reordered_sketch1);
+  EXPECT_TRUE(context.IsDeterministicOutput());
+
+  // NULL arguments are errors.
+  EXPECT_THAT(EvalAgg(init, {Int64(1)}, &context, {NullInt64()}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_THAT(EvalAgg(merge, {sketch1}, &context, {NullInt64()}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_THAT(EvalAgg(merge_point, {sketch1}, &context, {NullDouble()}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST(EvalAggTest, KllQuantilesCompactedIsNonDeterministic) {
+  BuiltinAggregateFunction init(FunctionKind::kKllQuantilesInitInt64,
+                                BytesType(), /*num_input_fields=*/1,
+                                Int64Type());
+  std::vector<Value> values;
+  for (int64_t i = 0; i < 1000; ++i) {
+    values.push_back(Int64(i));
+  }
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK(EvalAgg(init, values, &context, {Int64(10)}).status());
+  EXPECT_FALSE(context.IsDeterministicOutput());
+}
+
+TEST(EvalAggTest, HllCountInitNullPrecision) {
+  BuiltinAggregateFunction init(FunctionKind::kHllCountInit, BytesType(),
+                                /*num_input_fields=*/1, Int64Type());
+  EvaluationContext context((EvaluationOptions()));
+  EXPECT_THAT(EvalAgg(init, {Int64(1)}, &context, {NullInt64()}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
 TEST(OrderPreservationTest, GroupByAggregate) {
   TypeFactory type_factory;
   VariableId a("a"), b("b"), c1("c1"), c2("c2"), k("k"), n("n"), d("d");
@@ -16,6 +16,7 @@
 
 #include "zetasql/reference_impl/algebrizer.h"
 
+#include <algorithm>
 #include <functional>
 #include <stack>
 #include <string>
@@ -600,11 +601,11 @@ Algebrizer::AlgebrizeAggregateFn(
       break;
   }
 
+  // APPROX_COUNT_DISTINCT does not need DISTINCT since duplicate inputs do
+  // not change its sketch.
   const AggregateArg::Distinctness distinctness =
-      (aggregate_function->distinct() ||
-       (kind == FunctionKind::kApproxCountDistinct))
-          ? AggregateArg::kDistinct
-          : AggregateArg::kAll;
+      aggregate_function->distinct() ? AggregateArg::kDistinct
+                                     : AggregateArg::kAll;
   return AggregateArg::Create(
       variable, std::move(function), std::move(arguments), distinctness,
       std::move(having_expr), having_kind, std::move(order_keys),
@@ -884,7 +885,8 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       // testing of this feature.
       ZETASQL_ASSIGN_OR_RETURN(auto subquery_valueop,
                        ExistsExpr::Create(std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(subquery_valueop));
+      return MaybeCacheSubqueryResult(subquery_expr,
+                                      std::move(subquery_valueop));
     }
     case ResolvedSubqueryExpr::SCALAR: {
       // A single column which may be a struct or an array.
@@ -897,7 +899,8 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       ZETASQL_ASSIGN_OR_RETURN(
           auto single_value_expr,
           SingleValueExpr::Create(std::move(deref), std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(single_value_expr));
+      return MaybeCacheSubqueryResult(subquery_expr,
+                                      std::move(single_value_expr));
     }
     case ResolvedSubqueryExpr::ARRAY: {
       // Either a single scalar column or a struct column.
@@ -906,7 +909,7 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
           NestSingleColumnRelation(output_columns, std::move(relation),
                                    /*is_with_table=*/false));
       column_to_variable_->set_map(original_column_to_variable);
-      return std::move(nest_expr);
+      return MaybeCacheSubqueryResult(subquery_expr, std::move(nest_expr));
     }
     case ResolvedSubqueryExpr::IN: {
       ZETASQL_RET_CHECK_EQ(1, scan->column_list().size());
@@ -1282,6 +1285,191 @@ static bool IsNonVolatile(const ResolvedExpr* expr) {
   }
 }
 
+// Returns true if 'subquery_expr' is known to be non-volatile: it calls no
+// VOLATILE functions and has no TABLESAMPLE or table-valued function scans, so
+// evaluating it more than once with the same parameters gives the same
+// result.
+static zetasql_base::StatusOr<bool> IsNonVolatileSubquery(
+    const ResolvedSubqueryExpr* subquery_expr) {
+  // ResolvedASTVisitor that records whether a volatile node was visited.
+  class VolatilityVisitor : public ResolvedASTVisitor {
+   public:
+    VolatilityVisitor() {}
+    VolatilityVisitor(const VolatilityVisitor&) = delete;
+    VolatilityVisitor& operator=(const VolatilityVisitor&) = delete;
+
+    bool is_volatile() const { return is_volatile_; }
+
+    absl::Status VisitResolvedFunctionCall(
+        const ResolvedFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedAggregateFunctionCall(
+        const ResolvedAggregateFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedAnalyticFunctionCall(
+        const ResolvedAnalyticFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedSampleScan(
+        const ResolvedSampleScan* node) override {
+      is_volatile_ = true;
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedTVFScan(const ResolvedTVFScan* node) override {
+      is_volatile_ = true;
+      return DefaultVisit(node);
+    }
+
+   private:
+    void RecordFunction(const Function* function) {
+      if (function->function_options().volatility == FunctionEnums::VOLATILE) {
+        is_volatile_ = true;
+      }
+    }
+
+    bool is_volatile_ = false;
+  };
+
+  VolatilityVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(subquery_expr->Accept(&visitor));
+  return !visitor.is_volatile();
+}
+
+// Returns true if the expressions in 'node' may be evaluated concurrently on
+// several threads, sharing their ValueExprs. This is an allow-list: some
+// function bodies keep mutable state (for example, RegexpFunction updates its
+// functions::RegExp on every call), and subqueries may read spools that are
+// shared by all threads, so everything not listed here is assumed unsafe.
+static zetasql_base::StatusOr<bool> IsSafeForParallelEvaluation(
+    const ResolvedNode* node) {
+  // Builtin functions whose evaluation only reads its ValueExpr.
+  static const auto* const kThreadSafeFunctions =
+      new absl::flat_hash_set<std::string>{
+          "$add", "$subtract", "$multiply", "$divide", "$unary_minus",
+          "safe_add", "safe_subtract", "safe_multiply", "safe_divide",
+          "safe_negate", "div", "mod", "ieee_divide", "abs", "sign", "round",
+          "trunc", "ceil", "floor", "is_nan", "is_inf", "sqrt", "pow", "exp",
+          "ln", "log10", "log", "$equal", "$not_equal", "$less",
+          "$less_or_equal", "$greater", "$greater_or_equal", "$between",
+          "$in", "$and", "$or", "$not", "$is_null", "$is_true", "$is_false",
+          "if", "ifnull", "nullif", "coalesce", "$case_no_value",
+          "$case_with_value", "least", "greatest", "$make_array",
+          "array_length", "$array_at_offset", "$array_at_ordinal",
+          "$safe_array_at_offset", "$safe_array_at_ordinal", "byte_length",
+          "char_length", "length", "concat", "lower", "upper"};
+
+  // ResolvedASTVisitor that records whether a node that is not on the
+  // allow-list was visited.
+  class ParallelEvaluationVisitor : public ResolvedASTVisitor {
+   public:
+    ParallelEvaluationVisitor() {}
+    ParallelEvaluationVisitor(const ParallelEvaluationVisitor&) = delete;
+    ParallelEvaluationVisitor& operator=(const ParallelEvaluationVisitor&) =
+        delete;
+
+    bool is_safe() const { return is_safe_; }
+
+    absl::Status DefaultVisit(const ResolvedNode* node) override {
+      switch (node->node_kind()) {
+        case RESOLVED_LITERAL:
+        case RESOLVED_PARAMETER:
+        case RESOLVED_EXPRESSION_COLUMN:
+        case RESOLVED_COLUMN_REF:
+        case RESOLVED_CAST:
+        case RESOLVED_MAKE_STRUCT:
+        case RESOLVED_GET_STRUCT_FIELD:
+        case RESOLVED_ANALYTIC_FUNCTION_CALL:
+        case RESOLVED_WINDOW_FRAME:
+        case RESOLVED_WINDOW_FRAME_EXPR:
+          return node->ChildrenAccept(this);
+        default:
+          is_safe_ = false;
+          return absl::OkStatus();
+      }
+    }
+
+    absl::Status VisitResolvedFunctionCall(
+        const ResolvedFunctionCall* node) override {
+      if (!node->function()->IsZetaSQLBuiltin() ||
+          !kThreadSafeFunctions->contains(
+              node->function()->FullName(/*include_group=*/false))) {
+        is_safe_ = false;
+        return absl::OkStatus();
+      }
+      return node->ChildrenAccept(this);
+    }
+
+   private:
+    bool is_safe_ = true;
+  };
+
+  ParallelEvaluationVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(node->Accept(&visitor));
+  return visitor.is_safe();
+}
+
+// Returns true if Value equality of two values of 'type' implies that a
+// subquery returns the same result for both, so that they can be used as
+// CachedSubqueryExpr keys. This excludes floating point types, because
+// 0.0 = -0.0 and NaN = NaN for Values, and types without equality.
+static bool IsSubqueryCacheKeyType(const Type* type) {
+  return (type->IsSimpleType() || type->IsEnum()) && !type->IsFloatingPoint() &&
+         type->SupportsEquality();
+}
+
+// Returns true if Value equality and hashing of values of 'type' agree with
+// the comparison of PARTITION BY keys, so that the rows of a partition can be
+// grouped with a hash table. Like IsSubqueryCacheKeyType(), this excludes
+// floating point types, including within STRUCTs.
+static bool IsHashPartitioningKeyType(const Type* type) {
+  if (type->IsStruct()) {
+    for (const StructType::StructField& field : type->AsStruct()->fields()) {
+      if (!IsHashPartitioningKeyType(field.type)) return false;
+    }
+    return true;
+  }
+  return IsSubqueryCacheKeyType(type);
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::MaybeCacheSubqueryResult(
+    const ResolvedSubqueryExpr* subquery_expr,
+    std::unique_ptr<ValueExpr> subquery_value) {
+  if (!algebrizer_options_.cache_subquery_results) return subquery_value;
+  // The recursive table of a WITH RECURSIVE changes on every iteration.
+  if (!recursive_var_id_stack_.empty()) return subquery_value;
+  // WITH tables, query parameters and system variables are constant during an
+  // evaluation, so the correlated parameters are the only inputs of a
+  // non-volatile subquery that can change.
+  ZETASQL_ASSIGN_OR_RETURN(const bool is_non_volatile,
+                   IsNonVolatileSubquery(subquery_expr));
+  if (!is_non_volatile) return subquery_value;
+
+  std::vector<std::unique_ptr<ValueExpr>> keys;
+  keys.reserve(subquery_expr->parameter_list_size());
+  for (const auto& parameter : subquery_expr->parameter_list()) {
+    const ResolvedColumn& column = parameter->column();
+    if (!IsSubqueryCacheKeyType(column.type())) return subquery_value;
+    ZETASQL_ASSIGN_OR_RETURN(const VariableId variable,
+                     column_to_variable_->LookupVariableNameForColumn(&column));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> key,
+                     DerefExpr::Create(variable, column.type()));
+    keys.push_back(std::move(key));
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<CachedSubqueryExpr> cached_subquery,
+      CachedSubqueryExpr::Create(std::move(keys), std::move(subquery_value)));
+  return std::unique_ptr<ValueExpr>(std::move(cached_subquery));
+}
+
 zetasql_base::StatusOr<std::unique_ptr<Algebrizer::FilterConjunctInfo>>
 Algebrizer::FilterConjunctInfo::Create(const ResolvedExpr* conjunct) {
   auto info = absl::make_unique<FilterConjunctInfo>();
@@ -1427,10 +1615,151 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeTable
       }
     }
 
+    absl::flat_hash_map<int, std::vector<ProtoFieldPath>> proto_field_path_map;
+    for (int i = 0; i < column_list.size(); ++i) {
+      auto it = table_scan_proto_field_paths_.find(column_list[i]);
+      if (it != table_scan_proto_field_paths_.end()) {
+        proto_field_path_map.emplace(i, it->second);
+      }
+    }
+
     return EvaluatorTableScanOp::Create(
         table_scan->table(), table_scan->alias(), column_idx_list, column_names,
-        variables, std::move(and_filters), std::move(system_time_expr));
+        variables, std::move(and_filters), std::move(system_time_expr),
+        std::move(proto_field_path_map));
+  }
+}
+
+// Computes the proto field paths through which the PROTO columns produced by
+// ResolvedTableScans are read. A column only gets an entry if every reference
+// to it is the base of a chain of ResolvedGetProtoFields. Any other reference
+// (e.g., passing the column to a function, returning it from a subquery, or
+// including it in a set operation) means that the whole value is needed.
+class TableScanProtoFieldPathVisitor : public ResolvedASTVisitor {
+ public:
+  static zetasql_base::StatusOr<
+      absl::flat_hash_map<ResolvedColumn, std::vector<ProtoFieldPath>>>
+  Run(const ResolvedQueryStmt* query) {
+    TableScanProtoFieldPathVisitor visitor;
+    ZETASQL_RETURN_IF_ERROR(query->Accept(&visitor));
+
+    absl::flat_hash_map<ResolvedColumn, std::vector<ProtoFieldPath>> result;
+    for (auto& entry : visitor.paths_) {
+      if (!visitor.scanned_proto_columns_.contains(entry.first) ||
+          visitor.fully_read_columns_.contains(entry.first)) {
+        continue;
+      }
+      result.emplace(entry.first, MinimizePaths(std::move(entry.second)));
+    }
+    return result;
+  }
+
+  absl::Status DefaultVisit(const ResolvedNode* node) override {
+    if (node->IsScan()) {
+      switch (node->node_kind()) {
+        case RESOLVED_TABLE_SCAN:
+        case RESOLVED_FILTER_SCAN:
+        case RESOLVED_JOIN_SCAN:
+        case RESOLVED_ARRAY_SCAN:
+        case RESOLVED_SAMPLE_SCAN:
+          // These scans only pass their input columns through to their
+          // parent, so listing a column does not read it.
+          break;
+        default:
+          // Other scans may produce a column as the value of a subquery or
+          // the output of a query, so be conservative.
+          for (const ResolvedColumn& column :
+               node->GetAs<ResolvedScan>()->column_list()) {
+            fully_read_columns_.insert(column);
+          }
+          break;
+      }
+    }
+    return node->ChildrenAccept(this);
+  }
+
+  absl::Status VisitResolvedTableScan(const ResolvedTableScan* node) override {
+    for (const ResolvedColumn& column : node->column_list()) {
+      if (column.type()->IsProto()) {
+        scanned_proto_columns_.insert(column);
+      }
+    }
+    return DefaultVisit(node);
+  }
+
+  absl::Status VisitResolvedGetProtoField(
+      const ResolvedGetProtoField* node) override {
+    ProtoFieldPath path;
+    const ResolvedExpr* base = node;
+    while (base->node_kind() == RESOLVED_GET_PROTO_FIELD) {
+      const ResolvedGetProtoField* get_field =
+          base->GetAs<ResolvedGetProtoField>();
+      path.push_back(get_field->field_descriptor());
+      base = get_field->expr();
+    }
+    if (base->node_kind() != RESOLVED_COLUMN_REF) {
+      return DefaultVisit(node);
+    }
+    std::reverse(path.begin(), path.end());
+    paths_[base->GetAs<ResolvedColumnRef>()->column()].push_back(
+        std::move(path));
+    return absl::OkStatus();
   }
+
+  absl::Status VisitResolvedColumnRef(const ResolvedColumnRef* node) override {
+    fully_read_columns_.insert(node->column());
+    return DefaultVisit(node);
+  }
+
+  absl::Status VisitResolvedOutputColumn(
+      const ResolvedOutputColumn* node) override {
+    fully_read_columns_.insert(node->column());
+    return DefaultVisit(node);
+  }
+
+ private:
+  // Sorts and deduplicates 'paths', and drops any path that has another path
+  // in 'paths' as a prefix, since reading a field reads all of its subfields.
+  static std::vector<ProtoFieldPath> MinimizePaths(
+      std::vector<ProtoFieldPath> paths) {
+    auto field_less = [](const google::protobuf::FieldDescriptor* a,
+                         const google::protobuf::FieldDescriptor* b) {
+      return a->number() < b->number();
+    };
+    std::sort(paths.begin(), paths.end(),
+              [&field_less](const ProtoFieldPath& a, const ProtoFieldPath& b) {
+                return std::lexicographical_compare(a.begin(), a.end(),
+                                                    b.begin(), b.end(),
+                                                    field_less);
+              });
+    std::vector<ProtoFieldPath> minimized;
+    for (ProtoFieldPath& path : paths) {
+      if (!minimized.empty()) {
+        const ProtoFieldPath& last = minimized.back();
+        if (last.size() <= path.size() &&
+            std::equal(last.begin(), last.end(), path.begin())) {
+          continue;
+        }
+      }
+      minimized.push_back(std::move(path));
+    }
+    return minimized;
+  }
+
+  absl::flat_hash_set<ResolvedColumn> scanned_proto_columns_;
+  absl::flat_hash_set<ResolvedColumn> fully_read_columns_;
+  absl::flat_hash_map<ResolvedColumn, std::vector<ProtoFieldPath>> paths_;
+};
+
+absl::Status Algebrizer::ComputeTableScanProtoFieldPaths(
+    const ResolvedQueryStmt* query) {
+  if (!algebrizer_options_.push_down_proto_field_paths ||
+      algebrizer_options_.use_arrays_for_tables) {
+    return absl::OkStatus();
+  }
+  ZETASQL_ASSIGN_OR_RETURN(table_scan_proto_field_paths_,
+                   TableScanProtoFieldPathVisitor::Run(query));
+  return absl::OkStatus();
 }
 
 // Returns true if any element of 'a' is in 'b'.
@@ -1674,8 +2003,9 @@ class FindWithEntryReferenceCountVisitor : public ResolvedASTVisitor {
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeWithScan(
     const ResolvedWithScan* scan) {
-  // Each named subquery is nested as an array, which is then unnested when
-  // referenced in other subquerieries or in the main query. Named subqueries
+  // Each named subquery is nested as an array (or spooled if
+  // 'spool_with_tables' is set), which is then unnested when referenced in
+  // other subquerieries or in the main query. Named subqueries
   // are stored in with_map_ to be used for algebrizing WithRef scans that
   // reference those subqueries.
   // Save the old with_map_ with names that are visible in the outer scope.
@@ -1711,13 +2041,26 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeWithS
     }
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> subquery,
                      AlgebrizeScan(with_entry->with_subquery()));
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::unique_ptr<ArrayNestExpr> nested_subquery,
-        NestRelationInStruct(with_entry->with_subquery()->column_list(),
-                             std::move(subquery),
-                             /*is_with_table=*/true));
     const VariableId subquery_variable =
         variable_gen_->GetNewVariableName(with_entry->with_query_name());
+    std::unique_ptr<ValueExpr> nested_subquery;
+    if (algebrizer_options_.spool_with_tables) {
+      std::vector<VariableId> columns;
+      for (const ResolvedColumn& column :
+           with_entry->with_subquery()->column_list()) {
+        columns.push_back(
+            column_to_variable_->GetVariableNameFromColumn(&column));
+      }
+      ZETASQL_ASSIGN_OR_RETURN(nested_subquery,
+                       SpoolExpr::Create(subquery_variable, std::move(columns),
+                                         std::move(subquery)));
+    } else {
+      ZETASQL_ASSIGN_OR_RETURN(
+          nested_subquery,
+          NestRelationInStruct(with_entry->with_subquery()->column_list(),
+                               std::move(subquery),
+                               /*is_with_table=*/true));
+    }
     ExprArg* arg = new ExprArg(subquery_variable, std::move(nested_subquery));
     // Record a mapping from subquery name to ExprArg.
     with_map_[with_entry->with_query_name()] = arg;
@@ -1781,6 +2124,16 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeWithR
   ZETASQL_RET_CHECK(it != with_map_.end())
       << "Can't find query in with_map_: " << query_name;
   const ExprArg* arg = it->second;
+  if (algebrizer_options_.spool_with_tables) {
+    // We are referencing a pre-computed spool storing the entire table.
+    std::vector<std::unique_ptr<ExprArg>> columns;
+    for (const ResolvedColumn& column : scan->column_list()) {
+      columns.push_back(absl::make_unique<ExprArg>(
+          column_to_variable_->GetVariableNameFromColumn(&column),
+          column.type()));
+    }
+    return SpoolScanOp::Create(arg->variable(), std::move(columns));
+  }
   ZETASQL_ASSIGN_OR_RETURN(
       auto deref_arg,
       DerefExpr::Create(arg->variable(), arg->value_expr()->output_type()));
@@ -2302,6 +2655,15 @@ static bool IsSubsetOf(const absl::flat_hash_set<ResolvedColumn>& a,
   return true;
 }
 
+// Returns true if 'a' and 'b' have a column in common.
+static bool IntersectsWith(const absl::flat_hash_set<ResolvedColumn>& a,
+                           const absl::flat_hash_set<ResolvedColumn>& b) {
+  for (const ResolvedColumn& column : a) {
+    if (b.contains(column)) return true;
+  }
+  return false;
+}
+
 zetasql_base::StatusOr<bool>
 Algebrizer::TryAlgebrizeFilterConjunctAsHashJoinEqualityExprs(
     const FilterConjunctInfo& conjunct_info,
@@ -2399,6 +2761,9 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeFilte
   algebrized_conjuncts.reserve(conjunct_infos.size());
   for (std::unique_ptr<FilterConjunctInfo>& info : conjunct_infos) {
     if (!info->redundant) {
+      ZETASQL_ASSIGN_OR_RETURN(const bool is_semi_join,
+                       TryAlgebrizeFilterConjunctAsSemiJoin(*info, &input));
+      if (is_semi_join) continue;
       ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
                        AlgebrizeExpression(info->conjunct));
       algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
@@ -2410,6 +2775,221 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeFilte
                                         std::move(algebrized_conjuncts));
 }
 
+zetasql_base::StatusOr<bool> Algebrizer::TryAlgebrizeFilterConjunctAsSemiJoin(
+    const FilterConjunctInfo& conjunct_info,
+    std::unique_ptr<RelationalOp>* input) {
+  if (!algebrizer_options_.allow_hash_join) return false;
+
+  const ResolvedExpr* expr = conjunct_info.conjunct;
+  JoinOp::JoinKind join_kind = JoinOp::kSemiJoin;
+  if (expr->node_kind() == RESOLVED_FUNCTION_CALL) {
+    const ResolvedFunctionCall* function_call =
+        expr->GetAs<ResolvedFunctionCall>();
+    if (!function_call->function()->IsZetaSQLBuiltin() ||
+        function_call->function()->FullName(/*include_group=*/false) !=
+            "$not" ||
+        function_call->argument_list_size() != 1) {
+      return false;
+    }
+    expr = function_call->argument_list(0);
+    join_kind = JoinOp::kAntiJoin;
+  }
+  if (expr->node_kind() != RESOLVED_SUBQUERY_EXPR) return false;
+  const ResolvedSubqueryExpr* subquery_expr =
+      expr->GetAs<ResolvedSubqueryExpr>();
+  switch (subquery_expr->subquery_type()) {
+    case ResolvedSubqueryExpr::EXISTS:
+      break;
+    case ResolvedSubqueryExpr::IN:
+      // NOT IN is not an anti join, because a NULL on either side makes it
+      // NULL rather than TRUE.
+      if (join_kind == JoinOp::kAntiJoin) return false;
+      break;
+    default:
+      return false;
+  }
+  // The subquery is evaluated at most once instead of once per row, which is
+  // only equivalent if it is non-volatile. (Like the subquery expression, it is
+  // not evaluated at all if the input is empty.) The IN expression is still
+  // evaluated once per row, as the hash join key.
+  ZETASQL_ASSIGN_OR_RETURN(const bool is_non_volatile,
+                   IsNonVolatileSubquery(subquery_expr));
+  if (!is_non_volatile) return false;
+  if (!subquery_expr->parameter_list().empty()) {
+    if (subquery_expr->subquery_type() != ResolvedSubqueryExpr::EXISTS) {
+      return false;
+    }
+    return TryAlgebrizeCorrelatedExistsAsSemiJoin(subquery_expr, join_kind,
+                                                  input);
+  }
+
+  // Restore 'column_to_variable_' after algebrizing the subquery, because its
+  // columns are not visible outside of it.
+  const ColumnToVariableMapping::Map original_column_to_variable =
+      column_to_variable_->map();
+  ZETASQL_RETURN_IF_ERROR(CheckHints(subquery_expr->hint_list()));
+  const ResolvedScan* scan = subquery_expr->subquery();
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation, AlgebrizeScan(scan));
+
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+  if (subquery_expr->subquery_type() == ResolvedSubqueryExpr::IN) {
+    ZETASQL_RET_CHECK_EQ(1, scan->column_list().size());
+    const ResolvedColumn& haystack_column = scan->column_list()[0];
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<ValueExpr> haystack,
+        DerefExpr::Create(
+            column_to_variable_->GetVariableNameFromColumn(&haystack_column),
+            haystack_column.type()));
+    column_to_variable_->set_map(original_column_to_variable);
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> needle,
+                     AlgebrizeExpression(subquery_expr->in_expr()));
+
+    JoinOp::HashJoinEqualityExprs exprs;
+    exprs.left_expr = absl::make_unique<ExprArg>(
+        variable_gen_->GetNewVariableName("a1"), std::move(needle));
+    exprs.right_expr = absl::make_unique<ExprArg>(
+        variable_gen_->GetNewVariableName("b1"), std::move(haystack));
+    equality_exprs.push_back(std::move(exprs));
+  } else {
+    column_to_variable_->set_map(original_column_to_variable);
+  }
+
+  ZETASQL_ASSIGN_OR_RETURN(auto remaining_condition,
+                   ConstExpr::Create(Value::Bool(true)));
+  ZETASQL_ASSIGN_OR_RETURN(
+      *input, JoinOp::Create(join_kind, std::move(equality_exprs),
+                             std::move(remaining_condition), std::move(*input),
+                             std::move(relation), /*left_outputs=*/{},
+                             /*right_outputs=*/{}));
+  return true;
+}
+
+zetasql_base::StatusOr<bool> Algebrizer::TryAlgebrizeCorrelatedExistsAsSemiJoin(
+    const ResolvedSubqueryExpr* subquery_expr, JoinOp::JoinKind join_kind,
+    std::unique_ptr<RelationalOp>* input) {
+  // The select list of an EXISTS subquery does not affect its result, as long
+  // as evaluating it cannot fail.
+  const ResolvedScan* scan = subquery_expr->subquery();
+  const ResolvedProjectScan* project_scan = nullptr;
+  if (scan->node_kind() == RESOLVED_PROJECT_SCAN) {
+    project_scan = scan->GetAs<ResolvedProjectScan>();
+    for (const auto& computed_column : project_scan->expr_list()) {
+      const ResolvedNodeKind kind = computed_column->expr()->node_kind();
+      if (kind != RESOLVED_LITERAL && kind != RESOLVED_COLUMN_REF) {
+        return false;
+      }
+    }
+    scan = project_scan->input_scan();
+  }
+  if (scan->node_kind() != RESOLVED_FILTER_SCAN) return false;
+  const ResolvedFilterScan* filter_scan = scan->GetAs<ResolvedFilterScan>();
+  // A table scan is never correlated, so only the filter references the
+  // correlated columns.
+  if (filter_scan->input_scan()->node_kind() != RESOLVED_TABLE_SCAN ||
+      filter_scan->input_scan()
+              ->GetAs<ResolvedTableScan>()
+              ->for_system_time_expr() != nullptr) {
+    return false;
+  }
+
+  absl::flat_hash_set<ResolvedColumn> correlated_columns;
+  for (const auto& parameter : subquery_expr->parameter_list()) {
+    correlated_columns.insert(parameter->column());
+  }
+
+  // Split the conjuncts of the filter into hash join equalities, whose first
+  // argument (after swapping) references only correlated columns and whose
+  // second argument references none, and uncorrelated conjuncts.
+  std::vector<std::unique_ptr<FilterConjunctInfo>> conjunct_infos;
+  ZETASQL_RETURN_IF_ERROR(
+      AddFilterConjunctsTo(filter_scan->filter_expr(), &conjunct_infos));
+  std::vector<std::pair<const ResolvedExpr*, const ResolvedExpr*>> equalities;
+  std::vector<const ResolvedExpr*> uncorrelated_conjuncts;
+  for (const std::unique_ptr<FilterConjunctInfo>& info : conjunct_infos) {
+    bool is_correlated = false;
+    for (const ResolvedColumn& column : info->referenced_columns) {
+      if (correlated_columns.contains(column)) {
+        is_correlated = true;
+        break;
+      }
+    }
+    if (!is_correlated) {
+      uncorrelated_conjuncts.push_back(info->conjunct);
+      continue;
+    }
+    if (!info->is_non_volatile || info->kind != FilterConjunctInfo::kEquals) {
+      return false;
+    }
+    ZETASQL_RET_CHECK_EQ(info->arguments.size(), 2);
+    int correlated_arg = -1;
+    for (int i = 0; i < 2; ++i) {
+      if (!info->argument_columns[i].empty() &&
+          IsSubsetOf(info->argument_columns[i], correlated_columns) &&
+          !IntersectsWith(info->argument_columns[1 - i], correlated_columns)) {
+        correlated_arg = i;
+        break;
+      }
+    }
+    if (correlated_arg == -1) return false;
+    equalities.emplace_back(info->arguments[correlated_arg],
+                            info->arguments[1 - correlated_arg]);
+  }
+  if (equalities.empty()) return false;
+
+  // Access 'parameters' and the select list to suppress the resolver check
+  // for non-accessed expressions.
+  for (const auto& parameter : subquery_expr->parameter_list()) {
+    parameter->column();
+  }
+  if (project_scan != nullptr) {
+    project_scan->MarkFieldsAccessed();
+  }
+  ZETASQL_RETURN_IF_ERROR(CheckHints(subquery_expr->hint_list()));
+
+  // Restore 'column_to_variable_' afterwards, because the columns of the
+  // subquery are not visible outside of it.
+  const ColumnToVariableMapping::Map original_column_to_variable =
+      column_to_variable_->map();
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation,
+                   AlgebrizeScan(filter_scan->input_scan()));
+  std::vector<std::unique_ptr<ValueExpr>> algebrized_conjuncts;
+  for (const ResolvedExpr* conjunct : uncorrelated_conjuncts) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
+                     AlgebrizeExpression(conjunct));
+    algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
+  }
+  ZETASQL_ASSIGN_OR_RETURN(relation,
+                   ApplyAlgebrizedFilterConjuncts(
+                       std::move(relation), std::move(algebrized_conjuncts)));
+
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+  for (const auto& equality : equalities) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> left,
+                     AlgebrizeExpression(equality.first));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> right,
+                     AlgebrizeExpression(equality.second));
+    const int next_var_number = equality_exprs.size() + 1;
+    JoinOp::HashJoinEqualityExprs exprs;
+    exprs.left_expr = absl::make_unique<ExprArg>(
+        variable_gen_->GetNewVariableName(absl::StrCat("a", next_var_number)),
+        std::move(left));
+    exprs.right_expr = absl::make_unique<ExprArg>(
+        variable_gen_->GetNewVariableName(absl::StrCat("b", next_var_number)),
+        std::move(right));
+    equality_exprs.push_back(std::move(exprs));
+  }
+  column_to_variable_->set_map(original_column_to_variable);
+
+  ZETASQL_ASSIGN_OR_RETURN(auto remaining_condition,
+                   ConstExpr::Create(Value::Bool(true)));
+  ZETASQL_ASSIGN_OR_RETURN(
+      *input, JoinOp::Create(join_kind, std::move(equality_exprs),
+                             std::move(remaining_condition), std::move(*input),
+                             std::move(relation), /*left_outputs=*/{},
+                             /*right_outputs=*/{}));
+  return true;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::ApplyAlgebrizedFilterConjuncts(
     std::unique_ptr<RelationalOp> input,
@@ -2485,12 +3065,106 @@ Algebrizer::AlgebrizeAggregateScan(
                              std::move(input));
 }
 
+absl::optional<Algebrizer::AnalyticPartitionLimit>
+Algebrizer::GetAnalyticPartitionLimit(
+    const ResolvedAnalyticScan* analytic_scan,
+    const std::vector<FilterConjunctInfo*>& active_conjuncts) {
+  if (!algebrizer_options_.limit_analytic_partitions_for_rank_filters ||
+      analytic_scan->function_group_list_size() != 1) {
+    return absl::nullopt;
+  }
+  // Maps the column of each ROW_NUMBER() call to false and the column of each
+  // RANK() call to true. Any other analytic function could depend on the rows
+  // beyond the limit.
+  absl::flat_hash_map<ResolvedColumn, bool> rank_columns;
+  for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
+       analytic_scan->function_group_list(0)->analytic_function_list()) {
+    if (analytic_column->expr()->node_kind() !=
+        RESOLVED_ANALYTIC_FUNCTION_CALL) {
+      return absl::nullopt;
+    }
+    const ResolvedAnalyticFunctionCall* analytic_function_call =
+        analytic_column->expr()->GetAs<ResolvedAnalyticFunctionCall>();
+    if (!analytic_function_call->function()->IsZetaSQLBuiltin()) {
+      return absl::nullopt;
+    }
+    switch (static_cast<FunctionSignatureId>(
+        analytic_function_call->signature().context_id())) {
+      case FN_ROW_NUMBER:
+        rank_columns[analytic_column->column()] = false;
+        break;
+      case FN_RANK:
+        rank_columns[analytic_column->column()] = true;
+        break;
+      default:
+        return absl::nullopt;
+    }
+  }
+
+  for (const FilterConjunctInfo* info : active_conjuncts) {
+    if (info->kind != FilterConjunctInfo::kLE &&
+        info->kind != FilterConjunctInfo::kGE &&
+        info->kind != FilterConjunctInfo::kEquals) {
+      continue;
+    }
+    if (info->arguments.size() != 2) continue;
+    // Normalize the conjunct to <column> <op> <literal>.
+    const ResolvedExpr* column_arg = info->arguments[0];
+    const ResolvedExpr* literal_arg = info->arguments[1];
+    bool column_is_first = true;
+    if (column_arg->node_kind() != RESOLVED_COLUMN_REF) {
+      std::swap(column_arg, literal_arg);
+      column_is_first = false;
+    }
+    if (column_arg->node_kind() != RESOLVED_COLUMN_REF ||
+        literal_arg->node_kind() != RESOLVED_LITERAL) {
+      continue;
+    }
+    // <column> >= <literal> and <literal> <= <column> do not bound <column>
+    // from above.
+    if ((info->kind == FilterConjunctInfo::kLE && !column_is_first) ||
+        (info->kind == FilterConjunctInfo::kGE && column_is_first)) {
+      continue;
+    }
+    const ResolvedColumnRef* column_ref =
+        column_arg->GetAs<ResolvedColumnRef>();
+    if (column_ref->is_correlated()) continue;
+    const auto rank_column = rank_columns.find(column_ref->column());
+    if (rank_column == rank_columns.end()) continue;
+    const Value& literal = literal_arg->GetAs<ResolvedLiteral>()->value();
+    if (!literal.type()->IsInt64() || literal.is_null()) continue;
+
+    int64_t limit = literal.int64_value();
+    const std::string name =
+        info->conjunct->GetAs<ResolvedFunctionCall>()->function()->FullName(
+            /*include_group=*/false);
+    if (name == "$less" || name == "$greater") {
+      // The bound is exclusive.
+      if (limit <= 1) continue;
+      --limit;
+    }
+    if (limit < 1) continue;
+
+    AnalyticPartitionLimit partition_limit;
+    partition_limit.limit = limit;
+    partition_limit.keep_ties = rank_column->second;
+    return partition_limit;
+  }
+  return absl::nullopt;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeAnalyticScan(
-    const ResolvedAnalyticScan* analytic_scan) {
+    const ResolvedAnalyticScan* analytic_scan,
+    std::vector<FilterConjunctInfo*>* active_conjuncts) {
   // Algebrize the input scan.
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation_op,
                    AlgebrizeScan(analytic_scan->input_scan()));
 
+  // The conjuncts are still applied above the AnalyticOp, but they may also
+  // bound the rows of each partition that are needed.
+  const absl::optional<AnalyticPartitionLimit> partition_limit =
+      GetAnalyticPartitionLimit(analytic_scan, *active_conjuncts);
+
   // Algebrize each ResolvedAnalyticFunctionGroup sequentially.
   std::set<ResolvedColumn> input_columns(
       analytic_scan->input_scan()->column_list().begin(),
@@ -2501,7 +3175,8 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeAnaly
     ZETASQL_ASSIGN_OR_RETURN(relation_op,
                      AlgebrizeAnalyticFunctionGroup(
                          input_columns, group.get(), std::move(relation_op),
-                         /*input_is_from_same_analytic_scan=*/!first));
+                         /*input_is_from_same_analytic_scan=*/!first,
+                         partition_limit));
     first = false;
     for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
          group->analytic_function_list()) {
@@ -2518,7 +3193,8 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
     const std::set<ResolvedColumn>& input_resolved_columns,
     const ResolvedAnalyticFunctionGroup* analytic_group,
     std::unique_ptr<RelationalOp> input_relation_op,
-    bool input_is_from_same_analytic_scan) {
+    bool input_is_from_same_analytic_scan,
+    const absl::optional<AnalyticPartitionLimit>& partition_limit) {
   const ResolvedWindowPartitioning* partition_by =
       analytic_group->partition_by();
   const ResolvedWindowOrdering* order_by =
@@ -2536,7 +3212,8 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
         input_relation_op,
         MaybeCreateSortForAnalyticOperator(
             input_resolved_columns, analytic_group,
-            std::move(input_relation_op), input_is_from_same_analytic_scan));
+            std::move(input_relation_op), input_is_from_same_analytic_scan,
+            partition_limit));
   }
 
   std::vector<std::unique_ptr<KeyArg>> partition_keys;
@@ -2561,6 +3238,9 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
   }
 
   std::vector<std::unique_ptr<AnalyticArg>> analytic_args;
+  // Partitions may be evaluated in parallel only if all analytic function
+  // calls can share their algebrized arguments between threads.
+  bool may_evaluate_partitions_in_parallel = true;
   for (const std::unique_ptr<const ResolvedComputedColumn>& analytic_column :
        analytic_group->analytic_function_list()) {
     ZETASQL_RET_CHECK_EQ(RESOLVED_ANALYTIC_FUNCTION_CALL,
@@ -2568,6 +3248,11 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
     const ResolvedAnalyticFunctionCall* analytic_function_call =
         static_cast<const ResolvedAnalyticFunctionCall*>(
             analytic_column->expr());
+    ZETASQL_ASSIGN_OR_RETURN(const bool is_safe_for_parallel_evaluation,
+                     IsSafeForParallelEvaluation(analytic_function_call));
+    if (!is_safe_for_parallel_evaluation) {
+      may_evaluate_partitions_in_parallel = false;
+    }
 
     ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<AnalyticArg> analytic_arg,
                      AlgebrizeAnalyticFunctionCall(
@@ -2578,7 +3263,7 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
   }
 
   ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<RelationalOp> analytic_op,
+      std::unique_ptr<AnalyticOp> analytic_op,
       AnalyticOp::Create(
           std::move(partition_keys), std::move(order_keys),
           std::move(analytic_args), std::move(input_relation_op),
@@ -2590,14 +3275,17 @@ Algebrizer::AlgebrizeAnalyticFunctionGroup(
           // analytic function groups with the same window, and would instead
           // consolidate into one analytic function group: b/123518026.
           /*preserves_order=*/input_is_from_same_analytic_scan));
-  return analytic_op;
+  analytic_op->set_may_evaluate_partitions_in_parallel(
+      may_evaluate_partitions_in_parallel);
+  return std::unique_ptr<RelationalOp>(std::move(analytic_op));
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::MaybeCreateSortForAnalyticOperator(
     const std::set<ResolvedColumn>& input_resolved_columns,
     const ResolvedAnalyticFunctionGroup* analytic_group,
-    std::unique_ptr<RelationalOp> input_relation_op, bool require_stable_sort) {
+    std::unique_ptr<RelationalOp> input_relation_op, bool require_stable_sort,
+    const absl::optional<AnalyticPartitionLimit>& partition_limit) {
   std::vector<std::unique_ptr<KeyArg>> sort_keys;
   // Map from each referenced column to its VariableId from the input.
   absl::flat_hash_map<int, VariableId> column_to_id_map;
@@ -2608,6 +3296,16 @@ Algebrizer::MaybeCreateSortForAnalyticOperator(
     ZETASQL_RETURN_IF_ERROR(AlgebrizePartitionExpressions(
         partition_by, &column_to_id_map, &sort_keys));
   }
+  int num_hash_partition_keys = 0;
+  if (algebrizer_options_.allow_hash_partitioning_for_analytic &&
+      std::all_of(sort_keys.begin(), sort_keys.end(),
+                  [](const std::unique_ptr<KeyArg>& key) {
+                    return IsHashPartitioningKeyType(key->type());
+                  })) {
+    num_hash_partition_keys = static_cast<int>(sort_keys.size());
+  }
+  const bool is_hash_partitioned =
+      num_hash_partition_keys == static_cast<int>(sort_keys.size());
 
   const ResolvedWindowOrdering* order_by =
       analytic_group->order_by();
@@ -2654,12 +3352,18 @@ Algebrizer::MaybeCreateSortForAnalyticOperator(
   }
 
   ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<RelationalOp> sort_op,
+      std::unique_ptr<SortOp> sort_op,
       SortOp::Create(std::move(sort_keys), std::move(non_sort_expressions),
                      /*limit=*/nullptr, /*offset=*/nullptr,
                      std::move(input_relation_op),
                      /*is_order_preserving=*/true, require_stable_sort));
-  return sort_op;
+  ZETASQL_RETURN_IF_ERROR(
+      sort_op->set_num_hash_partition_keys(num_hash_partition_keys));
+  if (partition_limit.has_value() && is_hash_partitioned) {
+    ZETASQL_RETURN_IF_ERROR(sort_op->set_partition_limit(partition_limit->limit,
+                                                 partition_limit->keep_ties));
+  }
+  return std::unique_ptr<RelationalOp>(std::move(sort_op));
 }
 
 absl::Status Algebrizer::AlgebrizeOrderByItems(
@@ -3040,35 +3744,32 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeUnion
   return aggr_op;
 }
 
-// Algebrization of INTERSECT / EXCEPT is done as follows.
-// Let Ri(X) be a query returning columns Xi = xi1,...,xiM
-//
-// R0 INTERSECT DISTINCT ... RN:
-//   WITH T AS
-//     (SELECT X0, SUM(bit0) cnt0, ..., SUM(bitN) cntN,
-//      FROM (SELECT X0, 1 bit0, 0 bit1, ..., 0 bitN FROM R0 UNION ALL
-//            SELECT X1, 0 bit0, 1 bit1, ..., 0 bitN FROM R1 UNION ALL ...
-//            SELECT XN, 0 bit0, 0 bit1, ..., 1 bitN FROM RN) AS U
-//      GROUP BY X0)
-//   SELECT X0 FROM T WHERE cnt0 > 0 AND ... cntN > 0
-//
-// R0 EXCEPT DISTINCT ... RN:
-//   WITH T AS ...
-//   SELECT X0 FROM T WHERE cnt0 > 0 AND cnt1 = 0 AND ... cntN = 0
-//
-// R0 INTERSECT ALL ... RN:
-//   WITH T AS ...
-//   SELECT X0 FROM T, Enumerate(Least(cnt0, ..., cntN))
-//
-// R0 EXCEPT ALL RN:
-//   WITH T AS ...
-//   SELECT X0 FROM T, Enumerate(cnt0 - cnt1 - ... - cntN)
-//
-// enumerate(min, max) is a function that returns an array of integers between
-// min (incl.) and max (excl.).
+// INTERSECT / EXCEPT are algebrized into a SetOperationOp, which loads the
+// distinct rows of the first input into a hash table and streams the other
+// inputs against it. As for UNION ALL, every input maps its columns to the
+// output columns of the set operation.
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeExceptIntersectScan(
     const ResolvedSetOperationScan* set_scan) {
+  SetOperationOp::SetOperationType type;
+  switch (set_scan->op_type()) {
+    case ResolvedSetOperationScan::INTERSECT_ALL:
+      type = SetOperationOp::kIntersectAll;
+      break;
+    case ResolvedSetOperationScan::INTERSECT_DISTINCT:
+      type = SetOperationOp::kIntersectDistinct;
+      break;
+    case ResolvedSetOperationScan::EXCEPT_ALL:
+      type = SetOperationOp::kExceptAll;
+      break;
+    case ResolvedSetOperationScan::EXCEPT_DISTINCT:
+      type = SetOperationOp::kExceptDistinct;
+      break;
+    default:
+      return ::zetasql_base::UnimplementedErrorBuilder()
+             << "Unimplemented set operation: " << set_scan->op_type();
+  }
+
   const ResolvedColumnList& output_columns = set_scan->column_list();
   int num_columns = output_columns.size();
   int num_input_relations = set_scan->input_item_list_size();
@@ -3079,176 +3780,26 @@ Algebrizer::AlgebrizeExceptIntersectScan(
                      AlgebrizeScan(set_scan->input_item_list(i)->scan()));
     children.push_back(std::move(child));
   }
-  // U = (SELECT X0, 1 bit0, 0 bit1, ..., 0 bitN FROM R0 UNION ALL
-  //      SELECT X1, 0 bit0, 1 bit1, ..., 0 bitN FROM R1 UNION ALL ...
-  //      SELECT XN, 0 bit0, 0 bit1, ..., 1 bitN FROM RN)
-
-  // There is one set of column mappings per input relation of the union.
-  std::vector<UnionAllOp::Input> union_inputs(num_input_relations);
-  // Create bit variables.
-  std::vector<VariableId> bit_variables;
-  bit_variables.reserve(num_input_relations);
-  for (int i = 0; i < num_input_relations; i++) {
-    bit_variables.push_back(
-        variable_gen_->GetNewVariableName(absl::StrCat("bit", i)));
-  }
-  for (int rel_idx = 0; rel_idx < num_input_relations; rel_idx++) {
-    union_inputs[rel_idx].first = std::move(children[rel_idx]);
-    // ProjectScan all existing columns of the input.
-    for (int j = 0; j < num_columns; j++) {
-      const ResolvedColumn column =
-          set_scan->input_item_list(rel_idx)->output_column_list(j);
-      const VariableId variable =
+  // There is one set of column mappings per input relation.
+  std::vector<SetOperationOp::Input> column_mappings(num_input_relations);
+  for (int i = 0; i < num_input_relations; ++i) {
+    column_mappings[i].first = std::move(children[i]);
+    // Connect the output columns with the input columns.
+    for (int j = 0; j < num_columns; ++j) {
+      ResolvedColumn column =
+          set_scan->input_item_list(i)->output_column_list(j);
+      VariableId variable =
           column_to_variable_->GetVariableNameFromColumn(&column);
       ZETASQL_ASSIGN_OR_RETURN(auto deref,
                        DerefExpr::Create(variable, output_columns[j].type()));
-      union_inputs[rel_idx].second.push_back(absl::make_unique<ExprArg>(
+      column_mappings[i].second.push_back(absl::make_unique<ExprArg>(
           column_to_variable_->GetVariableNameFromColumn(&output_columns[j]),
           std::move(deref)));
     }
-    // Add bit columns.
-    for (int bit_idx = 0; bit_idx < num_input_relations; bit_idx++) {
-      // bit variable i is set to 1 iff its index matches the relation index.
-      ZETASQL_ASSIGN_OR_RETURN(
-          auto const_expr,
-          ConstExpr::Create(Value::Int64(bit_idx == rel_idx ? 1 : 0)));
-      union_inputs[rel_idx].second.push_back(absl::make_unique<ExprArg>(
-          bit_variables[bit_idx], std::move(const_expr)));
-    }
-  }
-
-  // Construct the actual union.
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> query_u,
-                   UnionAllOp::Create(std::move(union_inputs)));
-
-  // Aggregate the result of the union:
-  // T = SELECT X0, SUM(bit0) cnt0, ..., SUM(bitN) cntN FROM U GROUP BY X0
-  // Keys: X0
-  std::vector<std::unique_ptr<KeyArg>> keys;
-  for (int j = 0; j < num_columns; j++) {
-    VariableId old_variable =
-        column_to_variable_->GetVariableNameFromColumn(&output_columns[j]);
-    VariableId new_variable =
-        column_to_variable_->AssignNewVariableToColumn(&output_columns[j]);
-    ZETASQL_ASSIGN_OR_RETURN(auto deref,
-                     DerefExpr::Create(old_variable, output_columns[j].type()));
-    keys.push_back(absl::make_unique<KeyArg>(new_variable, std::move(deref)));
-  }
-  // Aggregators: SUM(bit_i) cnt_i
-  std::vector<VariableId> cnt_vars;
-  std::vector<std::unique_ptr<AggregateArg>> aggregators;
-  for (int i = 0; i < num_input_relations; i++) {
-    const VariableId cnt_var =
-        variable_gen_->GetNewVariableName(absl::StrCat("cnt", i));
-    cnt_vars.push_back(cnt_var);
-
-    ZETASQL_ASSIGN_OR_RETURN(auto deref_bit,
-                     DerefExpr::Create(bit_variables[i], types::Int64Type()));
-
-    std::vector<std::unique_ptr<ValueExpr>> agg_func_args;
-    agg_func_args.push_back(std::move(deref_bit));
-
-    ZETASQL_ASSIGN_OR_RETURN(
-        auto agg_arg,
-        AggregateArg::Create(cnt_var,
-                             absl::make_unique<BuiltinAggregateFunction>(
-                                 FunctionKind::kSum, types::Int64Type(),
-                                 /*num_input_fields=*/1, types::Int64Type()),
-                             std::move(agg_func_args)));
-    aggregators.push_back(std::move(agg_arg));
-  }
-  ZETASQL_ASSIGN_OR_RETURN(auto query_t, AggregateOp::Create(
-      std::move(keys), std::move(aggregators), std::move(query_u)));
-
-  // Add filter or cross-apply depending on the kind of set operation.
-  switch (set_scan->op_type()) {
-    case ResolvedSetOperationScan::EXCEPT_DISTINCT:
-      // SELECT X0 FROM T WHERE 0 < cnt0 AND 0 = cnt1 AND ... 0 = cntN
-    case ResolvedSetOperationScan::INTERSECT_DISTINCT: {
-      // SELECT X0 FROM T WHERE 0 < cnt0 AND 0 < cnt1 AND ... 0 < cntN
-      std::vector<std::unique_ptr<ValueExpr>> predicates;
-      for (int i = 0; i < num_input_relations; i++) {
-        auto fct_kind = (i > 0 && set_scan->op_type() ==
-                         ResolvedSetOperationScan::EXCEPT_DISTINCT) ?
-            FunctionKind::kEqual : FunctionKind::kLess;
-
-        ZETASQL_ASSIGN_OR_RETURN(auto const_zero, ConstExpr::Create(Value::Int64(0)));
-        ZETASQL_ASSIGN_OR_RETURN(auto deref_cnt,
-                         DerefExpr::Create(cnt_vars[i], types::Int64Type()));
-
-        std::vector<std::unique_ptr<ValueExpr>> predicate_args;
-        predicate_args.push_back(std::move(const_zero));
-        predicate_args.push_back(std::move(deref_cnt));
-
-        ZETASQL_ASSIGN_OR_RETURN(auto predicate,
-                         BuiltinScalarFunction::CreateCall(
-                             fct_kind, language_options_, types::BoolType(),
-                             std::move(predicate_args)));
-        predicates.push_back(std::move(predicate));
-      }
-      ZETASQL_ASSIGN_OR_RETURN(auto condition,
-                       BuiltinScalarFunction::CreateCall(
-                           FunctionKind::kAnd, language_options_,
-                           types::BoolType(), std::move(predicates)));
-      ZETASQL_ASSIGN_OR_RETURN(
-          std::unique_ptr<RelationalOp> filter_op,
-          FilterOp::Create(std::move(condition), std::move(query_t)));
-      return filter_op;
-    }
-
-    case ResolvedSetOperationScan::EXCEPT_ALL: {
-      // rest = cnt0 - cnt1 - ... - cntN
-      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> rest,
-                       DerefExpr::Create(cnt_vars[0], types::Int64Type()));
-      for (int i = 1; i < num_input_relations; i++) {
-        ZETASQL_ASSIGN_OR_RETURN(auto deref_cnt,
-                         DerefExpr::Create(cnt_vars[i], types::Int64Type()));
-
-        std::vector<std::unique_ptr<ValueExpr>> args;
-        args.push_back(std::move(rest));
-        args.push_back(std::move(deref_cnt));
-
-        ZETASQL_ASSIGN_OR_RETURN(rest, BuiltinScalarFunction::CreateCall(
-                                   FunctionKind::kSubtract, language_options_,
-                                   types::Int64Type(), std::move(args)));
-      }
-      // SELECT X0 FROM T, Enumerate(rest)
-      ZETASQL_ASSIGN_OR_RETURN(auto enum_op, EnumerateOp::Create(std::move(rest)));
-      ZETASQL_ASSIGN_OR_RETURN(auto join_expr, ConstExpr::Create(Value::Bool(true)));
-      ZETASQL_ASSIGN_OR_RETURN(
-          std::unique_ptr<RelationalOp> join_op,
-          JoinOp::Create(JoinOp::kCrossApply, /*equality_exprs=*/{},
-                         std::move(join_expr), std::move(query_t),
-                         std::move(enum_op), {}, {}));  // no variable remapping
-      return join_op;
-    }
-
-    case ResolvedSetOperationScan::INTERSECT_ALL: {
-      // SELECT X0 FROM T, Enumerate(Least(cnt0, ..., cntN))
-      std::vector<std::unique_ptr<ValueExpr>> cnt_args;
-      cnt_args.reserve(num_input_relations);
-      for (int i = 0; i < num_input_relations; i++) {
-        ZETASQL_ASSIGN_OR_RETURN(auto deref,
-                         DerefExpr::Create(cnt_vars[i], types::Int64Type()));
-        cnt_args.push_back(std::move(deref));
-      }
-      ZETASQL_ASSIGN_OR_RETURN(auto least,
-                       BuiltinScalarFunction::CreateCall(
-                           FunctionKind::kLeast, language_options_,
-                           types::Int64Type(), std::move(cnt_args)));
-      ZETASQL_ASSIGN_OR_RETURN(auto enum_op, EnumerateOp::Create(std::move(least)));
-      ZETASQL_ASSIGN_OR_RETURN(auto join_expr, ConstExpr::Create(Value::Bool(true)));
-      ZETASQL_ASSIGN_OR_RETURN(
-          std::unique_ptr<RelationalOp> join_op,
-          JoinOp::Create(JoinOp::kCrossApply, /*equality_exprs=*/{},
-                         std::move(join_expr), std::move(query_t),
-                         std::move(enum_op), {}, {}));  // no variable remapping
-      return join_op;
-    }
-    default:
-      return ::zetasql_base::UnimplementedErrorBuilder()
-             << "Unimplemented set operation: " << set_scan->op_type();
   }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> set_op,
+                   SetOperationOp::Create(type, std::move(column_mappings)));
+  return set_op;
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeProjectScan(
@@ -3430,7 +3981,8 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeScan(
     }
     case RESOLVED_ANALYTIC_SCAN: {
       ZETASQL_ASSIGN_OR_RETURN(
-          rel_op, AlgebrizeAnalyticScan(scan->GetAs<ResolvedAnalyticScan>()));
+          rel_op, AlgebrizeAnalyticScan(scan->GetAs<ResolvedAnalyticScan>(),
+                                        active_conjuncts));
       break;
     }
     case RESOLVED_RECURSIVE_SCAN: {
@@ -3465,10 +4017,14 @@ Algebrizer::MaybeApplyFilterConjuncts(
          ++i) {
       FilterConjunctInfo* conjunct_info = *i;
       if (!conjunct_info->redundant) {
+        conjunct_info->redundant = true;
+        ZETASQL_ASSIGN_OR_RETURN(
+            const bool is_semi_join,
+            TryAlgebrizeFilterConjunctAsSemiJoin(*conjunct_info, &input));
+        if (is_semi_join) continue;
         ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> algebrized_conjunct,
                          AlgebrizeExpression(conjunct_info->conjunct));
         algebrized_conjuncts.push_back(std::move(algebrized_conjunct));
-        conjunct_info->redundant = true;
       }
     }
   }
@@ -3600,6 +4156,7 @@ Algebrizer::AlgebrizeQueryStatementAsRelation(
   ZETASQL_RETURN_IF_ERROR(CheckHints(query->hint_list()));
   const ResolvedScan* scan = query->query();
   ZETASQL_RETURN_IF_ERROR(CheckHints(scan->hint_list()));
+  ZETASQL_RETURN_IF_ERROR(ComputeTableScanProtoFieldPaths(query));
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation, AlgebrizeScan(scan));
 
   for (const std::unique_ptr<const ResolvedOutputColumn>& output_column :
@@ -3729,8 +4286,9 @@ absl::Status Algebrizer::AlgebrizeDescendantsOfDMLStatement(
 
       resolved_table_scan_or_null = stmt->table_scan();
       if (resolved_table_scan_or_null != nullptr) {
-        ZETASQL_RETURN_IF_ERROR(PopulateResolvedScanMap(resolved_table_scan_or_null,
-                                                resolved_scan_map));
+        ZETASQL_RETURN_IF_ERROR(PopulateResolvedScanMapForDMLTableScan(
+            resolved_table_scan_or_null, stmt->where_expr(),
+            resolved_scan_map));
       }
 
       if (stmt->array_offset_column() != nullptr) {
@@ -3756,8 +4314,9 @@ absl::Status Algebrizer::AlgebrizeDescendantsOfDMLStatement(
 
       resolved_table_scan_or_null = stmt->table_scan();
       if (resolved_table_scan_or_null != nullptr) {
-        ZETASQL_RETURN_IF_ERROR(PopulateResolvedScanMap(resolved_table_scan_or_null,
-                                                resolved_scan_map));
+        ZETASQL_RETURN_IF_ERROR(PopulateResolvedScanMapForDMLTableScan(
+            resolved_table_scan_or_null, stmt->where_expr(),
+            resolved_scan_map));
       }
 
       if (stmt->from_scan() != nullptr) {
@@ -3907,6 +4466,41 @@ absl::Status Algebrizer::PopulateResolvedScanMap(
   return absl::OkStatus();
 }
 
+absl::Status Algebrizer::PopulateResolvedScanMapForDMLTableScan(
+    const ResolvedTableScan* table_scan, const ResolvedExpr* where_expr,
+    ResolvedScanMap* resolved_scan_map) {
+  if (!algebrizer_options_.push_down_filters ||
+      !algebrizer_options_.push_down_dml_filters || where_expr == nullptr) {
+    return PopulateResolvedScanMap(table_scan, resolved_scan_map);
+  }
+
+  // Only conjuncts that reference nothing but the table can be evaluated by
+  // the scan. For example, an UPDATE ... FROM may also reference the columns
+  // of the FROM scan, which are not available there.
+  const absl::flat_hash_set<ResolvedColumn> table_columns(
+      table_scan->column_list().begin(), table_scan->column_list().end());
+  std::vector<std::unique_ptr<FilterConjunctInfo>> conjunct_infos;
+  ZETASQL_RETURN_IF_ERROR(AddFilterConjunctsTo(where_expr, &conjunct_infos));
+  std::vector<FilterConjunctInfo*> active_conjuncts;
+  // Push the conjuncts in reverse order (because it's a stack).
+  for (auto i = conjunct_infos.rbegin(); i != conjunct_infos.rend(); ++i) {
+    if (IsSubsetOf((*i)->referenced_columns, table_columns)) {
+      active_conjuncts.push_back(i->get());
+    }
+  }
+
+  // Call AlgebrizeTableScan() directly instead of AlgebrizeScan(), which would
+  // also apply the conjuncts in a FilterOp. The DML statement evaluates the
+  // WHERE clause itself.
+  ZETASQL_RETURN_IF_ERROR(CheckHints(table_scan->hint_list()));
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relational_op,
+                   AlgebrizeTableScan(table_scan, &active_conjuncts));
+  const auto ret =
+      resolved_scan_map->emplace(table_scan, std::move(relational_op));
+  ZETASQL_RET_CHECK(ret.second);
+  return absl::OkStatus();
+}
+
 absl::Status Algebrizer::PopulateResolvedExprMap(
     const ResolvedExpr* resolved_expr, ResolvedExprMap* resolved_expr_map) {
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> value_expr,
@@ -4004,6 +4598,8 @@ absl::Status Algebrizer::AlgebrizeStatement(
             id_string_pool.Make(it->column().table_name()),
             id_string_pool.Make(it->name()), it->column().type());
       }
+      ZETASQL_RETURN_IF_ERROR(
+          single_use_algebrizer.ComputeTableScanProtoFieldPaths(stmt));
       ZETASQL_ASSIGN_OR_RETURN(*output,
                        single_use_algebrizer.AlgebrizeRootScanAsValueExpr(
                            output_column_list, stmt->is_value_table(), scan));
@@ -4075,9 +4671,21 @@ absl::Status Algebrizer::AlgebrizeExpression(
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
 Algebrizer::AlgebrizeRecursiveScan(
     const ResolvedRecursiveScan* recursive_scan) {
-  if (recursive_scan->op_type() != ResolvedRecursiveScanEnums::UNION_ALL) {
-    return absl::UnimplementedError(
-        "UNION DISTINCT for WITH RECURSIVE is not implemented yet");
+  // Each iteration of the LoopOp only evaluates the recursive term over the
+  // rows produced by the previous iteration. For UNION DISTINCT, the LoopOp
+  // also drops the rows that were already produced, so the recursion ends
+  // once no new rows are found.
+  bool distinct_rows;
+  switch (recursive_scan->op_type()) {
+    case ResolvedRecursiveScanEnums::UNION_ALL:
+      distinct_rows = false;
+      break;
+    case ResolvedRecursiveScanEnums::UNION_DISTINCT:
+      distinct_rows = true;
+      break;
+    default:
+      return ::zetasql_base::InternalErrorBuilder()
+             << "Unknown recursive scan type: " << recursive_scan->op_type();
   }
 
   // Algebrize non-recursive term first.
@@ -4135,7 +4743,7 @@ Algebrizer::AlgebrizeRecursiveScan(
       absl::make_unique<ExprArg>(recursive_var, std::move(loop_assign_expr)));
 
   return LoopOp::Create(std::move(initial_assign), std::move(body),
-                        std::move(loop_assign));
+                        std::move(loop_assign), distinct_rows);
 }
 
 zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::MapColumns(
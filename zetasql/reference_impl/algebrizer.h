@@ -66,7 +66,10 @@ struct AlgebrizerOptions {
 
   // If true, the algebrizer attempts to use a hash join instead of a nested
   // loop join when the join condition is amenable, or when there is a
-  // compatible filter immediately above the join.
+  // compatible filter immediately above the join. Filter conjuncts of the form
+  // [NOT] EXISTS(<subquery>) and <expr> IN (<subquery>) with uncorrelated
+  // subqueries, and [NOT] EXISTS subqueries that are correlated only through
+  // equalities, are also algebrized as semi and anti joins.
   bool allow_hash_join = false;
 
   // If true, the algebrizer attempts to use a single operator for ORDER BY
@@ -79,6 +82,14 @@ struct AlgebrizerOptions {
   // EvaluatorTableIterator does not have to honor the filter.
   bool push_down_filters = false;
 
+  // If true (and 'push_down_filters' is true), the conjuncts of the WHERE
+  // clause of a top-level DELETE or UPDATE that only reference the target table
+  // are also pushed into its EvaluatorTableScanOp. The DML statement still
+  // evaluates the whole WHERE clause. Only valid if the statement is evaluated
+  // with EvaluationOptions::return_all_rows_for_dml = false, because a table
+  // that honors the filters does not return all the unmodified rows.
+  bool push_down_dml_filters = false;
+
   // True to inline references to WITH entries which are referenced at most
   // once. This causes rows in a WITH entry referenced only once to be evaluated
   // only when necessary to determine the primary query result, while also
@@ -88,6 +99,39 @@ struct AlgebrizerOptions {
   // evaluated up front, and the result stored in an in-memory array, which will
   // then be dereferenced when the WITH entry is referenced.
   bool inline_with_entries = false;
+
+  // If true, the algebrizer computes the proto field paths through which each
+  // PROTO column of a table scan is read, and passes them to
+  // EvaluatorTableIterator::SetColumnProtoFieldPathMap(). Only applies to
+  // query statements with 'use_arrays_for_tables' = false.
+  bool push_down_proto_field_paths = false;
+
+  // If true, EXISTS, scalar and ARRAY subqueries that are known to be
+  // non-volatile are evaluated at most once per distinct value of their
+  // correlated parameters (once per evaluation if they are uncorrelated), and
+  // the results are cached in the EvaluationContext.
+  bool cache_subquery_results = false;
+
+  // If true, WITH entries that are evaluated up front (see
+  // 'inline_with_entries') are materialized once into a spool owned by the
+  // EvaluationContext by a SpoolExpr, and each reference reads the spooled rows
+  // with its own SpoolScanOp. If false, they are nested in an array Value that
+  // each reference unnests with an ArrayScanOp.
+  bool spool_with_tables = false;
+
+  // If true, the SortOp below an AnalyticOp groups the rows by the PARTITION BY
+  // keys with a hash table and only sorts each partition by the ORDER BY keys,
+  // instead of sorting the entire input by both. Not done for partitioning
+  // keys that contain floating point values.
+  bool allow_hash_partitioning_for_analytic = false;
+
+  // If true, a filter above an AnalyticScan with a single analytic function
+  // group of ROW_NUMBER() and RANK() calls that bounds one of them by a
+  // constant (as in "WHERE rn <= 3") is also applied by the SortOp below the
+  // AnalyticOp, which only keeps that many rows of each partition in memory.
+  // Only applies if the partitioning keys are hash-partitioned (see
+  // 'allow_hash_partitioning_for_analytic') or there are none.
+  bool limit_analytic_partitions_for_rank_filters = false;
 };
 
 class Algebrizer {
@@ -155,6 +199,7 @@ class Algebrizer {
   friend class AlgebrizerTestFunctions;
   friend class AlgebrizerTestFilters;
   friend class AlgebrizerTestGroupingAggregation;
+  friend class AlgebrizerTestAnalyticPartitionLimit;
   FRIEND_TEST(ExpressionAlgebrizerTest, Parameters);
   FRIEND_TEST(ExpressionAlgebrizerTest, PositionalParametersInExpressions);
   FRIEND_TEST(StatementAlgebrizerTest, SingleRowScan);
@@ -216,6 +261,12 @@ class Algebrizer {
       const ResolvedExpr* expr);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeSubqueryExpr(
       const ResolvedSubqueryExpr* subquery_expr);
+  // Returns 'subquery_value', the algebrized form of 'subquery_expr', wrapped
+  // in a CachedSubqueryExpr keyed by the correlated parameters if
+  // 'cache_subquery_results' is enabled and caching is known to be safe.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> MaybeCacheSubqueryResult(
+      const ResolvedSubqueryExpr* subquery_expr,
+      std::unique_ptr<ValueExpr> subquery_value);
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeInArray(
       std::unique_ptr<ValueExpr> in_value,
       std::unique_ptr<ValueExpr> array_value);
@@ -387,7 +438,26 @@ class Algebrizer {
   // partitioning and ordering expressions, even when the input relation has
   // been already sorted by those expressions.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeAnalyticScan(
-      const ResolvedAnalyticScan* analytic_scan);
+      const ResolvedAnalyticScan* analytic_scan,
+      std::vector<FilterConjunctInfo*>* active_conjuncts);
+
+  // A bound on the rank of the rows of each partition of an analytic function
+  // group that can pass a filter above it.
+  struct AnalyticPartitionLimit {
+    int64_t limit = 0;
+    // True if the bound is on RANK() rather than ROW_NUMBER(), so rows that
+    // are tied with the last row within the bound also pass.
+    bool keep_ties = false;
+  };
+
+  // Returns the AnalyticPartitionLimit implied by 'active_conjuncts' if
+  // 'analytic_scan' has a single analytic function group that only computes
+  // ROW_NUMBER() and RANK(), and one of 'active_conjuncts' compares one of them
+  // with an INT64 literal that bounds it from above. Returns absl::nullopt
+  // otherwise.
+  absl::optional<AnalyticPartitionLimit> GetAnalyticPartitionLimit(
+      const ResolvedAnalyticScan* analytic_scan,
+      const std::vector<FilterConjunctInfo*>& active_conjuncts);
 
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeRecursiveScan(
       const ResolvedRecursiveScan* recursive_scan);
@@ -402,11 +472,13 @@ class Algebrizer {
   // groups. 'input_is_from_same_analytic_scan' must be true if 'analytic_group'
   // and 'input_relation_op' correspond to the same AnalyticScan resolved AST
   // node.
+  // 'partition_limit' is passed to MaybeCreateSortForAnalyticOperator().
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> AlgebrizeAnalyticFunctionGroup(
       const std::set<ResolvedColumn>& input_resolved_columns,
       const ResolvedAnalyticFunctionGroup* analytic_group,
       std::unique_ptr<RelationalOp> input_relation_op,
-      bool input_is_from_same_analytic_scan);
+      bool input_is_from_same_analytic_scan,
+      const absl::optional<AnalyticPartitionLimit>& partition_limit);
 
   // Returns 'input_relation_op' if all the partitioning and ordering
   // expressions in 'analytic_group' are correlated column references.
@@ -414,13 +486,16 @@ class Algebrizer {
   // non-correlated partitioning and ordering expressions as order keys.
   // 'input_resolved_columns' contains the input columns produced by
   // 'input_relation_op'. If 'require_stable_sort' is true, then any SortOp
-  // created performs a stable sort over its input.
+  // created performs a stable sort over its input. If 'partition_limit' is set
+  // and the SortOp hash-partitions its input (or there are no partitioning
+  // keys), the SortOp drops the rows beyond the limit in each partition.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>>
   MaybeCreateSortForAnalyticOperator(
       const std::set<ResolvedColumn>& input_resolved_columns,
       const ResolvedAnalyticFunctionGroup* analytic_group,
       std::unique_ptr<RelationalOp> input_relation_op,
-      bool require_stable_sort);
+      bool require_stable_sort,
+      const absl::optional<AnalyticPartitionLimit>& partition_limit);
 
   // Converts each ResolvedOrderByItem to a KeyArg.
   // If 'drop_correlated_columns' is true, the output 'order_by_keys' does not
@@ -514,6 +589,13 @@ class Algebrizer {
   absl::Status PopulateResolvedScanMap(const ResolvedScan* resolved_scan,
                                          ResolvedScanMap* resolved_scan_map);
 
+  // Like PopulateResolvedScanMap(), but for the target table scan of a
+  // top-level DELETE or UPDATE with WHERE clause 'where_expr'. See
+  // 'push_down_dml_filters'.
+  absl::Status PopulateResolvedScanMapForDMLTableScan(
+      const ResolvedTableScan* table_scan, const ResolvedExpr* where_expr,
+      ResolvedScanMap* resolved_scan_map);
+
   // Adds the entry corresponding to 'resolved_expr' to 'resolved_expr_map'
   // (whose key is 'resolved_expr' and whose value is the algebrized
   // expression). Note that the map does not own the ResolvedExpr nodes.
@@ -628,6 +710,30 @@ class Algebrizer {
       std::unique_ptr<RelationalOp> input,
       std::vector<FilterConjunctInfo*>* active_conjuncts);
 
+  // If 'conjunct_info' is an EXISTS, NOT EXISTS or IN subquery expression
+  // with an uncorrelated, non-volatile subquery, replaces '*input' with a semi
+  // join (or an anti join for NOT EXISTS) of '*input' and the subquery, and
+  // returns true. IN becomes a hash semi join on the IN expression and the
+  // subquery column. Correlated [NOT] EXISTS subqueries are handled by
+  // TryAlgebrizeCorrelatedExistsAsSemiJoin(). Otherwise returns false. This is
+  // only correct for filter conjuncts, which discard rows for both FALSE and
+  // NULL.
+  zetasql_base::StatusOr<bool> TryAlgebrizeFilterConjunctAsSemiJoin(
+      const FilterConjunctInfo& conjunct_info,
+      std::unique_ptr<RelationalOp>* input);
+
+  // Decorrelates a non-volatile [NOT] EXISTS subquery of the form
+  //   SELECT <literals or columns> FROM <table> WHERE <conjuncts>
+  // where each conjunct that references a correlated column is an equality
+  // between an expression of only correlated columns and an expression of
+  // only table columns. If 'subquery_expr' has that form, replaces '*input'
+  // with a hash join of kind 'join_kind' (kSemiJoin or kAntiJoin) on those
+  // equalities, whose right input is the table filtered by the remaining
+  // conjuncts, and returns true. Otherwise returns false.
+  zetasql_base::StatusOr<bool> TryAlgebrizeCorrelatedExistsAsSemiJoin(
+      const ResolvedSubqueryExpr* subquery_expr, JoinOp::JoinKind join_kind,
+      std::unique_ptr<RelationalOp>* input);
+
   // Returns a RelationalOp corresponding to 'input' that applies
   // 'algebrized_conjuncts' as filters.
   zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> ApplyAlgebrizedFilterConjuncts(
@@ -770,6 +876,10 @@ class Algebrizer {
     std::string DebugString() const;
   };
 
+  // If 'algebrizer_options_.push_down_proto_field_paths' is true, populates
+  // 'table_scan_proto_field_paths_' for the ResolvedTableScans in 'query'.
+  absl::Status ComputeTableScanProtoFieldPaths(const ResolvedQueryStmt* query);
+
   // Adds a FieldRegistry to 'get_proto_field_caches_' and returns the
   // corresponding pointer. If 'id' is set, also updates
   // 'proto_field_registry_map_'.
@@ -879,6 +989,13 @@ class Algebrizer {
   absl::flat_hash_map<SharedProtoFieldPath, ProtoFieldReader*>
       get_proto_field_reader_map_;
 
+  // Maps each PROTO column produced by a ResolvedTableScan to the field paths
+  // through which it is read, if the column is only ever read through
+  // ResolvedGetProtoField chains. Populated by
+  // ComputeTableScanProtoFieldPaths() and consumed by AlgebrizeTableScan().
+  absl::flat_hash_map<ResolvedColumn, std::vector<ProtoFieldPath>>
+      table_scan_proto_field_paths_;
+
   TypeFactory* type_factory_;  // Not owned.
 
   // For generating unique column names.
@@ -54,6 +54,7 @@ namespace zetasql {
 
 using testing::HasSubstr;
 using testing::MatchesRegex;
+using testing::Not;
 using testing::TestWithParam;
 using testing::ValuesIn;
 using zetasql_base::testing::StatusIs;
@@ -1107,6 +1108,165 @@ TEST_P(AlgebrizerTestFilters, Filters) {
 INSTANTIATE_TEST_SUITE_P(AlgebrizerTestFiltersTest, AlgebrizerTestFilters,
                          ValuesIn(AlgebrizerTestFilters::AllFilterTests()));
 
+class AlgebrizerTestAnalyticPartitionLimit : public StatementAlgebrizerTest {
+ protected:
+  void SetUp() override {
+    algebrizer_options_.allow_hash_partitioning_for_analytic = true;
+    algebrizer_options_.limit_analytic_partitions_for_rank_filters = true;
+    StatementAlgebrizerTest::SetUp();
+  }
+
+  // Algebrizes
+  //   SELECT * FROM (
+  //     SELECT *, <function>() OVER (PARTITION BY <partition_column>
+  //                                  ORDER BY col_int64) AS r
+  //     FROM table_all_types)
+  //   WHERE r <comparison> <bound>
+  // and returns the DebugString of the result. The operands of <comparison>
+  // are swapped if <column_first> is false. There is no PARTITION BY if
+  // <partition_column_idx> is kInvalidColIdx. If <num_groups> is 2, the
+  // AnalyticScan computes the same function again in a second function group
+  // with a different ORDER BY.
+  std::string AlgebrizeRankFilter(FunctionSignatureId function_id,
+                                  const std::string& comparison,
+                                  bool column_first, int64_t bound,
+                                  int partition_column_idx = kStringColIdx,
+                                  int num_groups = 1) {
+    const std::string function_name =
+        function_id == FN_RANK ? "rank" : "row_number";
+    functions_.push_back(absl::make_unique<Function>(
+        function_name, Function::kZetaSQLFunctionGroupName, Function::ANALYTIC,
+        FunctionOptions(FunctionOptions::ORDER_REQUIRED,
+                        /*window_framing_support_in=*/false)));
+    const Function* rank_function = functions_.back().get();
+    functions_.push_back(absl::make_unique<Function>(
+        comparison, Function::kZetaSQLFunctionGroupName, Function::SCALAR));
+    const Function* comparison_function = functions_.back().get();
+
+    ResolvedColumnList column_list = columns_;
+    std::vector<std::unique_ptr<const ResolvedAnalyticFunctionGroup>> groups;
+    for (int i = 0; i < num_groups; ++i) {
+      const ResolvedColumn rank_column(100 + i, "$analytic", "r", Int64Type());
+      column_list.push_back(rank_column);
+
+      std::unique_ptr<const ResolvedWindowPartitioning> partition_by;
+      if (partition_column_idx != kInvalidColIdx) {
+        const ResolvedColumn& partition_column = columns_[partition_column_idx];
+        partition_by = MakeResolvedWindowPartitioning(
+            MakeNodeVector(MakeResolvedColumnRef(
+                partition_column.type(), partition_column, kNonCorrelated)));
+      }
+      const ResolvedColumn& order_column =
+          columns_[i == 0 ? kInt64ColIdx : kInt32ColIdx];
+      auto order_by = MakeResolvedWindowOrdering(
+          MakeNodeVector(MakeResolvedOrderByItem(
+              MakeResolvedColumnRef(order_column.type(), order_column,
+                                    kNonCorrelated),
+              /*collation_name=*/nullptr, /*is_descending=*/false,
+              ResolvedOrderByItem::ORDER_UNSPECIFIED)));
+      auto analytic_call = MakeResolvedAnalyticFunctionCall(
+          Int64Type(), rank_function,
+          FunctionSignature(Int64Type(), {}, function_id),
+          /*argument_list=*/{}, DEFAULT_ERROR_MODE, /*distinct=*/false,
+          ResolvedNonScalarFunctionCallBase::DEFAULT_NULL_HANDLING,
+          /*window_frame=*/nullptr);
+      groups.push_back(MakeResolvedAnalyticFunctionGroup(
+          std::move(partition_by), std::move(order_by),
+          MakeNodeVector(MakeResolvedComputedColumn(
+              rank_column, std::move(analytic_call)))));
+    }
+    const ResolvedColumn filter_column = column_list.back();
+    auto analytic_scan = MakeResolvedAnalyticScan(
+        column_list, MakeResolvedTableScan(columns_, &table_, nullptr),
+        std::move(groups));
+
+    std::vector<std::unique_ptr<const ResolvedExpr>> arguments;
+    arguments.push_back(
+        MakeResolvedColumnRef(Int64Type(), filter_column, kNonCorrelated));
+    arguments.push_back(MakeResolvedLiteral(Value::Int64(bound)));
+    if (!column_first) std::swap(arguments[0], arguments[1]);
+    auto filter_scan = MakeResolvedFilterScan(
+        column_list, std::move(analytic_scan),
+        MakeResolvedFunctionCall(
+            BoolType(), comparison_function,
+            FunctionSignature(BoolType(), {Int64Type(), Int64Type()},
+                              /*context_id=*/-1),
+            std::move(arguments), DEFAULT_ERROR_MODE));
+
+    zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> algebrized =
+        algebrizer_->AlgebrizeScan(filter_scan.get());
+    ZETASQL_EXPECT_OK(algebrized.status());
+    return algebrized.ok() ? algebrized.value()->DebugString() : "";
+  }
+};
+
+TEST_F(AlgebrizerTestAnalyticPartitionLimit, RowNumberUpperBounds) {
+  // rn <= 3 and 3 >= rn.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less_or_equal",
+                                  /*column_first=*/true, 3),
+              HasSubstr("num_hash_partition_keys=1, partition_limit=3\n"));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$greater_or_equal",
+                                  /*column_first=*/false, 3),
+              HasSubstr("num_hash_partition_keys=1, partition_limit=3\n"));
+  // rn = 3, in either order.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$equal",
+                                  /*column_first=*/true, 3),
+              HasSubstr("partition_limit=3\n"));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$equal",
+                                  /*column_first=*/false, 3),
+              HasSubstr("partition_limit=3\n"));
+  // The bound of rn < 3 and 3 > rn is exclusive.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less",
+                                  /*column_first=*/true, 3),
+              HasSubstr("partition_limit=2\n"));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$greater",
+                                  /*column_first=*/false, 3),
+              HasSubstr("partition_limit=2\n"));
+}
+
+TEST_F(AlgebrizerTestAnalyticPartitionLimit, NoLimit) {
+  // rn < 1 and rn <= 0 do not allow any row.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less",
+                                  /*column_first=*/true, 1),
+              Not(HasSubstr("partition_limit")));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less_or_equal",
+                                  /*column_first=*/true, 0),
+              Not(HasSubstr("partition_limit")));
+  // rn > 3, rn >= 3 and 3 <= rn bound rn from below.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$greater",
+                                  /*column_first=*/true, 3),
+              Not(HasSubstr("partition_limit")));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$greater_or_equal",
+                                  /*column_first=*/true, 3),
+              Not(HasSubstr("partition_limit")));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less_or_equal",
+                                  /*column_first=*/false, 3),
+              Not(HasSubstr("partition_limit")));
+  // Only analytic scans with a single function group are limited.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less_or_equal",
+                                  /*column_first=*/true, 3, kStringColIdx,
+                                  /*num_groups=*/2),
+              Not(HasSubstr("partition_limit")));
+  // DOUBLE partitioning keys are not hash partitioned, so the SortOp sorts
+  // whole partitions.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_ROW_NUMBER, "$less_or_equal",
+                                  /*column_first=*/true, 3, kDoubleColIdx),
+              Not(HasSubstr("partition_limit")));
+}
+
+TEST_F(AlgebrizerTestAnalyticPartitionLimit, RankKeepsTies) {
+  EXPECT_THAT(AlgebrizeRankFilter(FN_RANK, "$less_or_equal",
+                                  /*column_first=*/true, 3),
+              HasSubstr("partition_limit=3 with ties\n"));
+  EXPECT_THAT(AlgebrizeRankFilter(FN_RANK, "$greater",
+                                  /*column_first=*/false, 3),
+              HasSubstr("partition_limit=2 with ties\n"));
+  // Without PARTITION BY the whole input is a single partition.
+  EXPECT_THAT(AlgebrizeRankFilter(FN_RANK, "$less_or_equal",
+                                  /*column_first=*/true, 3, kInvalidColIdx),
+              HasSubstr("partition_limit=3 with ties\n"));
+}
+
 TEST_F(StatementAlgebrizerTest, SubqueryInFrom) {
   // Build a resolved AST for a query based on the following template with all
   // column types represented:
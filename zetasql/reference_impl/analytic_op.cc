@@ -18,10 +18,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -2126,12 +2128,34 @@ absl::Status AnalyticOp::SetSchemasForEvaluation(
 }
 
 namespace {
+// Gives every slot of 'tuple' its own SharedProtoState. GetProtoFieldExpr
+// updates the SharedProtoState of the slots it reads, which copies of a
+// TupleSlot share, so a tuple must not share it with tuples read on other
+// threads.
+void UnshareProtoState(TupleData* tuple) {
+  for (int i = 0; i < tuple->num_slots(); ++i) {
+    TupleSlot* slot = tuple->mutable_slot(i);
+    // The extra slots are not populated yet.
+    if (slot->value().is_valid()) {
+      VirtualTupleSlot(slot).MaybeResetSharedProtoState();
+    }
+  }
+}
+
 // Partitions the tuples from 'input_iter' (which must have
 // 'analytic_args.size()' extra slots by 'partition_keys'. Evaluates all of the
 // 'analytic_args' on each partition and adds corresponding values to the
 // tuples.
+//
+// If 'num_threads' is greater than 1, loads batches of partitions and evaluates
+// the partitions of each batch on up to 'num_threads' threads.
 class AnalyticTupleIterator : public TupleIterator {
  public:
+  // In parallel mode, a batch is loaded until it has at least this many rows
+  // per thread (or the input is exhausted), so that each thread has enough work
+  // to make up for starting it.
+  static constexpr int64_t kMinRowsPerThread = 1024;
+
   AnalyticTupleIterator(absl::Span<const TupleData* const> params,
                         absl::Span<const KeyArg* const> partition_keys,
                         absl::Span<const KeyArg* const> order_keys,
@@ -2139,7 +2163,7 @@ class AnalyticTupleIterator : public TupleIterator {
                         std::unique_ptr<TupleIterator> input_iter,
                         std::unique_ptr<TupleComparator> partition_comparator,
                         std::unique_ptr<TupleSchema> output_schema,
-                        EvaluationContext* context)
+                        int num_threads, EvaluationContext* context)
       : params_(params.begin(), params.end()),
         partition_keys_(partition_keys.begin(), partition_keys.end()),
         order_keys_(order_keys.begin(), order_keys.end()),
@@ -2147,6 +2171,7 @@ class AnalyticTupleIterator : public TupleIterator {
         input_iter_(std::move(input_iter)),
         partition_comparator_(std::move(partition_comparator)),
         output_schema_(std::move(output_schema)),
+        num_threads_(num_threads),
         remaining_current_partition_(context->memory_accountant()),
         context_(context) {}
 
@@ -2175,6 +2200,17 @@ class AnalyticTupleIterator : public TupleIterator {
       return current_.get();
     }
 
+    // In parallel mode, consume the partitions evaluated by the last batch.
+    while (!evaluated_partitions_.empty()) {
+      TupleDataDeque* partition = evaluated_partitions_.front().get();
+      if (!partition->IsEmpty()) {
+        output_empty_ = false;
+        current_ = partition->PopFront();
+        return current_.get();
+      }
+      evaluated_partitions_.pop_front();
+    }
+
     if (is_last_partition_) {
       if (!output_empty_) {
         // Partitioning by a floating point type is a non-deterministic
@@ -2188,26 +2224,60 @@ class AnalyticTupleIterator : public TupleIterator {
       return nullptr;
     }
 
-    // Load a new partition.
+    if (num_threads_ > 1) {
+      if (!LoadAndEvaluatePartitionBatch()) return nullptr;
+      return Next();
+    }
+
+    if (!LoadNextPartition(&remaining_current_partition_)) return nullptr;
+
+    std::vector<std::vector<Value>> arg_values;
+    absl::Status status =
+        EvaluateAnalyticArgs(remaining_current_partition_, params_, context_,
+                             &arg_values);
+    if (status.ok()) {
+      status = SetAnalyticArgSlots(std::move(arg_values),
+                                   &remaining_current_partition_);
+    }
+    if (!status.ok()) {
+      status_ = status;
+      return nullptr;
+    }
+
+    output_empty_ = false;
+    current_ = remaining_current_partition_.PopFront();
+    return current_.get();
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return AnalyticOp::GetIteratorDebugString(input_iter_->DebugString());
+  }
+
+ private:
+  // Loads the next partition from 'input_iter_' into 'partition', which must be
+  // empty. Returns false if there is no next partition or on error, in which
+  // case 'status_' is populated.
+  bool LoadNextPartition(TupleDataDeque* partition) {
     std::unique_ptr<TupleData> first_tuple_in_current_partition;
     if (first_tuple_in_next_partition_ == nullptr) {
       // We are loading the first tuple of the first partition.
       const TupleData* input_data = input_iter_->Next();
       if (input_data == nullptr) {
         status_ = input_iter_->Status();
-        return nullptr;
+        return false;
       }
-      first_tuple_in_current_partition =
-          absl::make_unique<TupleData>(*input_data);
+      first_tuple_in_current_partition = CopyInputTuple(*input_data);
     } else {
       first_tuple_in_current_partition =
           std::move(first_tuple_in_next_partition_);
     }
     TupleData* first_tuple_in_current_partition_ptr =
         first_tuple_in_current_partition.get();
-    if (!remaining_current_partition_.PushBack(
-            std::move(first_tuple_in_current_partition), &status_)) {
-      return nullptr;
+    if (!partition->PushBack(std::move(first_tuple_in_current_partition),
+                             &status_)) {
+      return false;
     }
 
     // We have determined the first tuple of the next partition. Now load the
@@ -2216,7 +2286,7 @@ class AnalyticTupleIterator : public TupleIterator {
       const TupleData* input_data = input_iter_->Next();
       if (input_data == nullptr) {
         status_ = input_iter_->Status();
-        if (!status_.ok()) return nullptr;
+        if (!status_.ok()) return false;
         is_last_partition_ = true;
         break;
       }
@@ -2229,56 +2299,175 @@ class AnalyticTupleIterator : public TupleIterator {
       if (!comparator_equals) {
         // We are done loading the current partition. 'input_data' belongs in
         // the next partition.
-        first_tuple_in_next_partition_ =
-            absl::make_unique<TupleData>(*input_data);
+        first_tuple_in_next_partition_ = CopyInputTuple(*input_data);
         break;
       }
       // 'input_data' belongs in the current partition (which we are still
       // loading).
-      if (!remaining_current_partition_.PushBack(
-              absl::make_unique<TupleData>(*input_data), &status_)) {
-        return nullptr;
+      if (!partition->PushBack(CopyInputTuple(*input_data), &status_)) {
+        return false;
       }
     }
+    return true;
+  }
 
-    absl::Status status = PopulateAnalyticArgSlots();
-    if (!status.ok()) {
-      status_ = status;
-      return nullptr;
+  std::unique_ptr<TupleData> CopyInputTuple(const TupleData& input_data) {
+    auto tuple = absl::make_unique<TupleData>(input_data);
+    if (num_threads_ > 1) {
+      UnshareProtoState(tuple.get());
     }
-
-    output_empty_ = false;
-    current_ = remaining_current_partition_.PopFront();
-    return current_.get();
+    return tuple;
   }
 
-  absl::Status Status() const override { return status_; }
+  // Loads partitions until there are at least kMinRowsPerThread rows per thread
+  // or the input is exhausted, evaluates the analytic arguments of the
+  // partitions on separate threads, and appends the partitions to
+  // 'evaluated_partitions_'. Returns false on error, in which case 'status_' is
+  // populated, or if there are no more partitions.
+  bool LoadAndEvaluatePartitionBatch() {
+    std::vector<std::unique_ptr<TupleDataDeque>> batch;
+    int64_t num_rows = 0;
+    while (!is_last_partition_ && num_rows < kMinRowsPerThread * num_threads_) {
+      auto partition =
+          absl::make_unique<TupleDataDeque>(context_->memory_accountant());
+      if (!LoadNextPartition(partition.get())) {
+        if (!status_.ok()) return false;
+        break;
+      }
+      num_rows += partition->GetSize();
+      batch.push_back(std::move(partition));
+    }
+    if (batch.empty()) {
+      is_last_partition_ = true;
+      return false;
+    }
 
-  std::string DebugString() const override {
-    return AnalyticOp::GetIteratorDebugString(input_iter_->DebugString());
-  }
+    // Assign consecutive partitions with roughly the same number of rows to
+    // each worker.
+    const int num_workers =
+        static_cast<int>(std::min<int64_t>(num_threads_, batch.size()));
+    // Split the remaining memory evenly between the workers. The batch stays
+    // charged to 'context_' while the workers run.
+    const int64_t worker_byte_size =
+        context_->memory_accountant()->remaining_bytes() / num_workers;
+    std::vector<Worker> workers(num_workers);
+    int64_t rows_assigned = 0;
+    int next_partition = 0;
+    for (int i = 0; i < num_workers; ++i) {
+      Worker& worker = workers[i];
+      worker.begin = next_partition;
+      const int64_t target_rows = num_rows * (i + 1) / num_workers;
+      // Leave at least one partition for each of the remaining workers.
+      const int max_end =
+          static_cast<int>(batch.size()) - (num_workers - i - 1);
+      do {
+        rows_assigned += batch[next_partition]->GetSize();
+        ++next_partition;
+      } while (next_partition < max_end && rows_assigned < target_rows);
+      worker.end = next_partition;
+      worker.arg_values.resize(worker.end - worker.begin);
+
+      worker.context = context_->CreateChildContext(worker_byte_size);
+      // Copy the parameters so that reading their protos does not race with
+      // other threads.
+      worker.params.reserve(params_.size());
+      for (const TupleData* param : params_) {
+        worker.params.push_back(absl::make_unique<TupleData>(*param));
+        UnshareProtoState(worker.params.back().get());
+      }
+    }
+    DCHECK_EQ(next_partition, batch.size());
 
- private:
-  // For each AnalyticArg in 'analytic_args', populates the corresponding slot
-  // in all the rows in 'current_partition_'.
-  absl::Status PopulateAnalyticArgSlots() {
-    for (int arg_idx = 0; arg_idx < analytic_args_.size(); ++arg_idx) {
-      const AnalyticArg* analytic_arg = analytic_args_[arg_idx];
+    auto run_worker = [this, &batch](Worker* worker) {
+      std::vector<const TupleData*> params;
+      params.reserve(worker->params.size());
+      for (const std::unique_ptr<TupleData>& param : worker->params) {
+        params.push_back(param.get());
+      }
+      for (int i = worker->begin; i < worker->end; ++i) {
+        worker->status = EvaluateAnalyticArgs(
+            *batch[i], params, worker->context.get(),
+            &worker->arg_values[i - worker->begin]);
+        if (!worker->status.ok()) return;
+      }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers - 1);
+    for (int i = 1; i < num_workers; ++i) {
+      threads.emplace_back(run_worker, &workers[i]);
+    }
+    run_worker(&workers[0]);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
 
-      std::vector<const TupleData*> current_partition_ptrs =
-          remaining_current_partition_.GetTuplePtrs();
+    for (Worker& worker : workers) {
+      if (!worker.status.ok()) {
+        status_ = worker.status;
+        return false;
+      }
+      if (!worker.context->IsDeterministicOutput()) {
+        context_->SetNonDeterministicOutput();
+      }
+      for (int i = worker.begin; i < worker.end; ++i) {
+        absl::Status status = SetAnalyticArgSlots(
+            std::move(worker.arg_values[i - worker.begin]), batch[i].get());
+        if (!status.ok()) {
+          status_ = status;
+          return false;
+        }
+      }
+    }
+    for (std::unique_ptr<TupleDataDeque>& partition : batch) {
+      evaluated_partitions_.push_back(std::move(partition));
+    }
+    return true;
+  }
 
-      std::vector<Value> values;
-      ZETASQL_RETURN_IF_ERROR(analytic_arg->Eval(current_partition_ptrs, order_keys_,
-                                         params_, context_, &values));
+  // Evaluates the analytic arguments on 'partition'. 'arg_values' is populated
+  // with the values of each argument for each tuple in 'partition'. Does not
+  // modify this object, so it can be called on separate threads with separate
+  // 'params' and 'context'.
+  absl::Status EvaluateAnalyticArgs(
+      const TupleDataDeque& partition,
+      absl::Span<const TupleData* const> params, EvaluationContext* context,
+      std::vector<std::vector<Value>>* arg_values) const {
+    const std::vector<const TupleData*> partition_ptrs =
+        partition.GetTuplePtrs();
+    arg_values->resize(analytic_args_.size());
+    for (int arg_idx = 0; arg_idx < analytic_args_.size(); ++arg_idx) {
+      ZETASQL_RETURN_IF_ERROR(analytic_args_[arg_idx]->Eval(
+          partition_ptrs, order_keys_, params, context,
+          &(*arg_values)[arg_idx]));
+    }
+    return absl::OkStatus();
+  }
 
+  // For each AnalyticArg in 'analytic_args', populates the corresponding slot
+  // in all the rows in 'partition' with the values from 'arg_values'.
+  absl::Status SetAnalyticArgSlots(std::vector<std::vector<Value>> arg_values,
+                                   TupleDataDeque* partition) {
+    ZETASQL_RET_CHECK_EQ(arg_values.size(), analytic_args_.size());
+    for (int arg_idx = 0; arg_idx < analytic_args_.size(); ++arg_idx) {
       const int slot_idx = input_iter_->Schema().num_variables() + arg_idx;
       ZETASQL_RETURN_IF_ERROR(
-          remaining_current_partition_.SetSlot(slot_idx, std::move(values)));
+          partition->SetSlot(slot_idx, std::move(arg_values[arg_idx])));
     }
     return absl::OkStatus();
   }
 
+  // The state of a thread that evaluates a range of the partitions of a batch.
+  struct Worker {
+    // The range [begin, end) of the partitions in the batch.
+    int begin = 0;
+    int end = 0;
+    std::unique_ptr<EvaluationContext> context;
+    std::vector<std::unique_ptr<TupleData>> params;
+    // The values of the analytic arguments for each partition in the range.
+    std::vector<std::vector<std::vector<Value>>> arg_values;
+    absl::Status status;
+  };
+
   const std::vector<const TupleData*> params_;
   const std::vector<const KeyArg*> partition_keys_;
   const std::vector<const KeyArg*> order_keys_;
@@ -2286,11 +2475,15 @@ class AnalyticTupleIterator : public TupleIterator {
   std::unique_ptr<TupleIterator> input_iter_;
   std::unique_ptr<TupleComparator> partition_comparator_;
   std::unique_ptr<TupleSchema> output_schema_;
+  const int num_threads_;
   // The last tuple returned. NULL if Next() has never been called.
   std::unique_ptr<TupleData> current_;
   // The partition we are currently consuming, augmented by the values
   // of the analytic arguments. Empty if Next() has never been called.
   TupleDataDeque remaining_current_partition_;
+  // In parallel mode, the partitions of the last batch that have not been fully
+  // consumed, augmented by the values of the analytic arguments.
+  std::deque<std::unique_ptr<TupleDataDeque>> evaluated_partitions_;
   // True if 'current_partition_' is the last one.
   bool is_last_partition_ = false;
   bool output_empty_ = true;
@@ -2308,7 +2501,7 @@ class AnalyticTupleIterator : public TupleIterator {
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> iter,
-      input()->CreateIterator(
+      input()->CreateIteratorWithStats(
           {params}, analytic_args().size() + num_extra_slots, context));
 
   std::vector<int> slots_for_partition_keys;
@@ -2327,9 +2520,15 @@ class AnalyticTupleIterator : public TupleIterator {
       TupleComparator::Create(partition_keys(), slots_for_partition_keys,
                               params, context));
 
+  // Without partition keys, there is only one partition.
+  const int num_threads =
+      may_evaluate_partitions_in_parallel() && !partition_keys().empty()
+          ? std::max(context->options().analytic_num_threads, 1)
+          : 1;
   iter = absl::make_unique<AnalyticTupleIterator>(
       params, partition_keys(), order_keys(), analytic_args(), std::move(iter),
-      std::move(partition_comparator), CreateOutputSchema(), context);
+      std::move(partition_comparator), CreateOutputSchema(), num_threads,
+      context);
   if (is_order_preserving()) {
     return iter;
   } else {
@@ -3512,6 +3512,27 @@ TEST_P(AnalyticOpTest, AnalyticOpTest) {
     EXPECT_EQ(data[i].num_slots(), expected_output_schema.num_variables() + 1);
   }
 
+  // Do it again with the partitions evaluated on separate threads.
+  analytic_op->set_may_evaluate_partitions_in_parallel(true);
+  EvaluationOptions parallel_options;
+  parallel_options.analytic_num_threads = 3;
+  EvaluationContext parallel_context(parallel_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, analytic_op->CreateIterator(EmptyParams(),
+                                        /*num_extra_slots=*/1,
+                                        &parallel_context));
+  EXPECT_TRUE(iter->PreservesOrder());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), expected_tuples.size());
+  for (int i = 0; i < expected_tuples.size(); ++i) {
+    EXPECT_EQ(
+        Tuple(&expected_output_schema, &data[i]).DebugString(),
+        Tuple(&expected_output_schema, &expected_tuples[i]).DebugString());
+  }
+  EXPECT_EQ(parallel_context.IsDeterministicOutput(),
+            context.IsDeterministicOutput());
+  analytic_op->set_may_evaluate_partitions_in_parallel(false);
+
   // Do it again with cancellation.
   context.ClearDeadlineAndCancellationState();
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -3552,5 +3573,91 @@ TEST_P(AnalyticOpTest, AnalyticOpTest) {
                        HasSubstr("Out of memory")));
 }
 
+TEST(AnalyticOpParallelTest, ManyPartitionsPerWorker) {
+  VariableId a("a"), b("b"), c("c"), sum("sum"), rank("rank");
+  // 10000 rows in partitions of 37 rows, so that each batch of partitions has
+  // many partitions for each thread.
+  constexpr int kNumRows = 10000;
+  constexpr int kPartitionSize = 37;
+  std::vector<std::vector<Value>> rows;
+  rows.reserve(kNumRows);
+  for (int i = 0; i < kNumRows; ++i) {
+    rows.push_back({Int64(i / kPartitionSize), Int64(i % kPartitionSize),
+                    Int64(i)});
+  }
+  const std::vector<TupleData> input_tuples = CreateTestTupleDatas(rows);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> sum_args;
+  sum_args.push_back(std::move(deref_c));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sum_agg,
+      AggregateArg::Create(sum,
+                           absl::make_unique<BuiltinAggregateFunction>(
+                               FunctionKind::kSum, Int64Type(),
+                               /*num_input_fields=*/1, Int64Type()),
+                           std::move(sum_args)));
+  // SUM(c) OVER (PARTITION BY a ORDER BY b
+  //              ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW)
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sum_analytic,
+      AggregateAnalyticArg::Create(
+          AnalyticWindowTest::CreateWindowFrameFromParam(
+              AnalyticWindowTest::CreateUnboundedPrecedingCurrentRow(
+                  WindowFrameArg::kRows)),
+          std::move(sum_agg), DEFAULT_ERROR_MODE));
+  // RANK() OVER (PARTITION BY a ORDER BY b)
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto rank_analytic,
+      NonAggregateAnalyticArg::Create(
+          rank, nullptr /* window_frame */, absl::make_unique<RankFunction>(),
+          {} /* non_const_arguments */, {} /* const_arguments */,
+          DEFAULT_ERROR_MODE));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+  std::vector<std::unique_ptr<KeyArg>> partition_keys;
+  partition_keys.emplace_back(
+      absl::make_unique<KeyArg>(a, std::move(deref_a), KeyArg::kNotApplicable));
+  std::vector<std::unique_ptr<KeyArg>> order_keys;
+  order_keys.emplace_back(
+      absl::make_unique<KeyArg>(b, std::move(deref_b), KeyArg::kAscending));
+  std::vector<std::unique_ptr<AnalyticArg>> analytic_args;
+  analytic_args.push_back(std::move(sum_analytic));
+  analytic_args.push_back(std::move(rank_analytic));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto analytic_op,
+      AnalyticOp::Create(std::move(partition_keys), std::move(order_keys),
+                         std::move(analytic_args),
+                         absl::make_unique<TestRelationalOp>(
+                             std::vector<VariableId>{a, b, c}, input_tuples,
+                             /*preserves_order=*/true),
+                         /*preserves_order=*/true));
+  ZETASQL_ASSERT_OK(analytic_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  analytic_op->set_may_evaluate_partitions_in_parallel(true);
+
+  EvaluationOptions options;
+  options.analytic_num_threads = 4;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      analytic_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                  &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), kNumRows);
+  int64_t running_sum = 0;
+  for (int i = 0; i < kNumRows; ++i) {
+    if (i % kPartitionSize == 0) running_sum = 0;
+    running_sum += i;
+    ASSERT_EQ(data[i].num_slots(), 5);
+    EXPECT_EQ(data[i].slot(2).value(), Int64(i)) << i;
+    EXPECT_EQ(data[i].slot(3).value(), Int64(running_sum)) << i;
+    EXPECT_EQ(data[i].slot(4).value(), Int64(i % kPartitionSize + 1)) << i;
+  }
+  EXPECT_TRUE(context.IsDeterministicOutput());
+}
+
 }  // namespace
 }  // namespace zetasql
@@ -84,7 +84,83 @@ absl::Status ValidateFirstColumnPrimaryKey(
 EvaluationContext::EvaluationContext(const EvaluationOptions& options)
     : options_(options),
       memory_accountant_(options.max_intermediate_byte_size),
-      deterministic_output_(true) {}
+      deterministic_output_(true),
+      subquery_cache_accountant_(options.max_subquery_cache_byte_size) {
+  if (options.collect_operator_stats) {
+    operator_stats_ = absl::make_unique<OperatorStatsCollector>();
+  }
+}
+
+EvaluationContext::~EvaluationContext() {
+  subquery_cache_accountant_.ReturnBytes(
+      subquery_cache_accountant_.num_bytes_in_use());
+}
+
+std::unique_ptr<EvaluationContext> EvaluationContext::CreateChildContext(
+    int64_t max_intermediate_byte_size) {
+  EvaluationOptions child_options = options_;
+  child_options.max_intermediate_byte_size = max_intermediate_byte_size;
+  child_options.collect_operator_stats = false;
+  child_options.analytic_num_threads = 1;
+  auto child = absl::make_unique<EvaluationContext>(child_options);
+  child->parent_ = this;
+  child->language_options_ = language_options_;
+  child->statement_eval_deadline_ = statement_eval_deadline_;
+  child->clock_ = clock_;
+  // Initialize the current timestamp here so that every child sees the same
+  // one, without reading 'clock_' concurrently.
+  LazilyInitializeCurrentTimestamp();
+  child->default_timezone_ = default_timezone_;
+  child->current_timestamp_ = current_timestamp_;
+  child->current_date_in_default_timezone_ = current_date_in_default_timezone_;
+  child->current_datetime_in_default_timezone_ =
+      current_datetime_in_default_timezone_;
+  child->current_time_in_default_timezone_ = current_time_in_default_timezone_;
+  return child;
+}
+
+const Value* EvaluationContext::FindSubqueryResult(
+    const ValueExpr* expr, const std::vector<Value>& key) const {
+  const auto it = subquery_results_.find(expr);
+  if (it == subquery_results_.end()) return nullptr;
+  return zetasql_base::FindOrNull(it->second, key);
+}
+
+void EvaluationContext::AddSubqueryResult(const ValueExpr* expr,
+                                          std::vector<Value> key,
+                                          const Value& result) {
+  int64_t byte_size = result.physical_byte_size();
+  for (const Value& value : key) {
+    byte_size += value.physical_byte_size();
+  }
+  absl::Status status;
+  if (!subquery_cache_accountant_.RequestBytes(byte_size, &status)) return;
+  if (!subquery_results_[expr].emplace(std::move(key), result).second) {
+    subquery_cache_accountant_.ReturnBytes(byte_size);
+    return;
+  }
+  ++num_cached_subquery_results_;
+}
+
+void EvaluationContext::SetSpool(const VariableId& spool,
+                                 std::unique_ptr<TupleDataDeque> rows) {
+  auto entry = std::make_shared<Spool>();
+  entry->row_ptrs = rows->GetTuplePtrs();
+  entry->rows = std::move(rows);
+  spools_[spool] = std::move(entry);
+}
+
+std::shared_ptr<const std::vector<const TupleData*>>
+EvaluationContext::GetSpool(const VariableId& spool) const {
+  const std::shared_ptr<const Spool>* entry =
+      zetasql_base::FindOrNull(spools_, spool);
+  if (entry == nullptr) {
+    return parent_ == nullptr ? nullptr : parent_->GetSpool(spool);
+  }
+  // Points to the row pointers, but owns the whole Spool.
+  return std::shared_ptr<const std::vector<const TupleData*>>(
+      *entry, &(*entry)->row_ptrs);
+}
 
 absl::Status EvaluationContext::AddTableAsArray(
     const std::string& table_name, bool is_value_table, Value array,
@@ -106,7 +182,7 @@ absl::Status EvaluationContext::AddTableAsArray(
 }
 
 absl::Status EvaluationContext::VerifyNotAborted() const {
-  if (cancelled_) {
+  if (cancelled_ || (parent_ != nullptr && parent_->cancelled_)) {
     return zetasql_base::CancelledErrorBuilder() << "The statement has been cancelled";
   }
   if (clock_->TimeNow() > statement_eval_deadline_) {
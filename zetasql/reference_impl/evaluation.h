@@ -19,6 +19,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,7 +27,9 @@
 #include "zetasql/public/civil_time.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/operator_stats.h"
 #include "zetasql/reference_impl/tuple.h"
+#include "zetasql/reference_impl/variable_id.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include <cstdint>
 #include "absl/container/flat_hash_map.h"
@@ -94,6 +97,12 @@ struct EvaluationOptions {
   // limit results in an error.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
 
+  // The limit on the maximum number of in-memory bytes used to cache subquery
+  // results (see EvaluationContext::AddSubqueryResult()). This is tracked
+  // separately from 'max_intermediate_byte_size', so the cache never causes an
+  // operator to run out of memory. Results beyond the limit are not cached.
+  int64_t max_subquery_cache_byte_size = 32 * 1024 * 1024;
+
   // If true, the results of DML statements will include all rows in the
   // modified table; otherwise, only modified rows (i.e. those matching the
   // WHERE clause) are included. For DELETE, 'modified rows' means the rows to
@@ -102,9 +111,34 @@ struct EvaluationOptions {
   // Note that rows are considered modified even if the new row happens to be
   // the same as the old as long as they match the WHERE clause.
   bool return_all_rows_for_dml = true;
+
+  // If true and 'return_all_rows_for_dml' is false, an INSERT into a table with
+  // a primary key does not read the whole table to detect primary key
+  // collisions. Instead, it passes kInList ColumnFilters with the inserted key
+  // values to Table::CreateEvaluatorTableIterator(), so that a table that
+  // honors the filters (e.g., with an index on its primary key) only returns
+  // the rows that may collide. An INSERT into a table without a primary key
+  // does not read the table at all. Requires the table to be read through the
+  // Catalog rather than EvaluationContext::AddTableAsArray().
+  bool use_primary_key_lookups_for_dml = false;
+
+  // If true, EvaluationContext::operator_stats() collects runtime statistics
+  // for every RelationalOp that is evaluated. This adds a clock read around
+  // every row produced by every operator, so it is off by default.
+  bool collect_operator_stats = false;
+
+  // Maximum number of threads, including the calling thread, that an AnalyticOp
+  // with partition keys may use to evaluate its analytic functions. With more
+  // than one thread, the AnalyticOp loads batches of consecutive partitions and
+  // evaluates each batch on separate threads, each with a child
+  // EvaluationContext (see CreateChildContext()). The output order is the same
+  // as with one thread. Only AnalyticOps for which
+  // may_evaluate_partitions_in_parallel() is true are affected.
+  int analytic_num_threads = 1;
 };
 
 class ProtoFieldReader;
+class ValueExpr;
 
 // Contains state about the evaluation in progress.
 class EvaluationContext {
@@ -117,17 +151,24 @@ class EvaluationContext {
   explicit EvaluationContext(const EvaluationOptions& options);
   EvaluationContext(const EvaluationContext&) = delete;
   EvaluationContext& operator=(const EvaluationContext&) = delete;
+  ~EvaluationContext();
 
   const EvaluationOptions& options() const { return options_; }
 
   MemoryAccountant* memory_accountant() { return &memory_accountant_; }
 
+  // NULL unless 'options().collect_operator_stats' is true.
+  OperatorStatsCollector* operator_stats() { return operator_stats_.get(); }
+
   // Returns the contents of table 'table_name' or Value::Invalid().
-  Value GetTableAsArray(const std::string& table_name) {
+  Value GetTableAsArray(const std::string& table_name) const {
     const auto it = tables_.find(table_name);
     if (it != tables_.end()) {
       return it->second;
     }
+    if (parent_ != nullptr) {
+      return parent_->GetTableAsArray(table_name);
+    }
     return Value();
   }
 
@@ -136,6 +177,19 @@ class EvaluationContext {
                                  bool is_value_table, Value array,
                                  const LanguageOptions& language_options);
 
+  // Returns a context for evaluating part of the current statement on another
+  // thread. The child has the same options, language options, default time
+  // zone, current timestamp and deadline as this context, and reads tables and
+  // spools from it. It has its own MemoryAccountant with a limit of
+  // 'max_intermediate_byte_size' bytes and its own subquery cache, and does not
+  // collect operator stats. Cancelling this context also aborts the child.
+  //
+  // This context must outlive the child and must not be modified while the
+  // child is in use. The caller is responsible for propagating
+  // IsDeterministicOutput() of the child back to this context.
+  std::unique_ptr<EvaluationContext> CreateChildContext(
+      int64_t max_intermediate_byte_size);
+
   // Indicates that the result of evaluation is non-deterministic.
   void SetNonDeterministicOutput() { deterministic_output_ = false; }
 
@@ -283,6 +337,40 @@ class EvaluationContext {
     num_proto_deserializations_ = n;
   }
 
+  // Returns the cached result of evaluating the subquery 'expr' with the
+  // correlated parameter values 'key', or NULL if there is none.
+  const Value* FindSubqueryResult(const ValueExpr* expr,
+                                  const std::vector<Value>& key) const;
+
+  // Caches 'result' as the result of evaluating the subquery 'expr' with the
+  // correlated parameter values 'key'. The cache may use at most
+  // EvaluationOptions::max_subquery_cache_byte_size bytes, which are not
+  // charged to memory_accountant(); beyond that, results are silently not
+  // cached.
+  void AddSubqueryResult(const ValueExpr* expr, std::vector<Value> key,
+                         const Value& result);
+
+  int64_t num_cached_subquery_results() const {
+    return num_cached_subquery_results_;
+  }
+
+  int64_t subquery_cache_byte_size() const {
+    return subquery_cache_accountant_.num_bytes_in_use();
+  }
+
+  // Stores 'rows' as the spool named 'spool', replacing any previous spool with
+  // that name. The rows stay charged to memory_accountant() until they are
+  // replaced or this object is destroyed, and no pointer returned by
+  // GetSpool() for them is alive.
+  void SetSpool(const VariableId& spool, std::unique_ptr<TupleDataDeque> rows);
+
+  // Returns the rows of the spool named 'spool', or NULL if there is none. The
+  // returned pointer shares ownership of the rows, so they stay valid even if
+  // the spool is replaced or other spools are added. It must not outlive this
+  // object.
+  std::shared_ptr<const std::vector<const TupleData*>> GetSpool(
+      const VariableId& spool) const;
+
   bool used_top_n_accumulator() const { return used_top_n_accumulator_; }
 
   void set_used_top_n_accumulator(bool value) {
@@ -330,7 +418,10 @@ class EvaluationContext {
   void InitializeCurrentTimestamp();
 
   const EvaluationOptions options_;
+  // The context that created this one with CreateChildContext(), or NULL.
+  const EvaluationContext* parent_ = nullptr;
   MemoryAccountant memory_accountant_;
+  std::unique_ptr<OperatorStatsCollector> operator_stats_;
   // Tables added by AddTableAsArray().
   std::map<std::string, Value> tables_;
   // Indicates that the result of evaluation is non-deterministic.
@@ -369,6 +460,24 @@ class EvaluationContext {
 
   // Records whether a TopNAccumulator was used. Only for unit tests.
   bool used_top_n_accumulator_ = false;
+
+  // Tracks the bytes used by 'subquery_results_'.
+  MemoryAccountant subquery_cache_accountant_;
+  // Maps a subquery to its results keyed by the correlated parameter values.
+  // Uncorrelated subqueries have a single entry with an empty key.
+  absl::flat_hash_map<const ValueExpr*,
+                      absl::flat_hash_map<std::vector<Value>, Value>>
+      subquery_results_;
+  int64_t num_cached_subquery_results_ = 0;
+
+  // A spool set by SetSpool() together with pointers to its rows.
+  struct Spool {
+    std::unique_ptr<TupleDataDeque> rows;
+    std::vector<const TupleData*> row_ptrs;
+  };
+  // Declared after 'memory_accountant_' so that the spools return their bytes
+  // before it is destroyed. Shared with the pointers returned by GetSpool().
+  absl::flat_hash_map<VariableId, std::shared_ptr<const Spool>> spools_;
 };
 
 // Returns true if we should suppress 'error' (which must not be OK) in
@@ -71,6 +71,7 @@
 #include "zetasql/reference_impl/common.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/proto_util.h"
+#include "zetasql/reference_impl/sketches.h"
 #include "zetasql/reference_impl/tuple_comparator.h"
 #include <cstdint>
 #include "absl/base/optimization.h"
@@ -401,6 +402,8 @@ FunctionMap::FunctionMap() {
   RegisterFunction(FunctionKind::kAnd, "$and", "And");
   RegisterFunction(FunctionKind::kAndAgg, kPrivate, "AndAgg");
   RegisterFunction(FunctionKind::kAnyValue, "any_value", "AnyValue");
+  RegisterFunction(FunctionKind::kApproxCountDistinct, "approx_count_distinct",
+                   "ApproxCountDistinct");
   RegisterFunction(FunctionKind::kArrayAgg, "array_agg", "ArrayAgg");
   RegisterFunction(FunctionKind::kArrayConcat, "array_concat", "ArrayConcat");
   RegisterFunction(FunctionKind::kArrayConcatAgg, "array_concat_agg",
@@ -474,6 +477,52 @@ FunctionMap::FunctionMap() {
   RegisterFunction(FunctionKind::kJsonQuery, "json_query", "JsonQuery");
   RegisterFunction(FunctionKind::kJsonValue, "json_value", "JsonValue");
   RegisterFunction(FunctionKind::kGreatest, "greatest", "Greatest");
+  RegisterFunction(FunctionKind::kHllCountInit, "hll_count.init",
+                   "HllCountInit");
+  RegisterFunction(FunctionKind::kHllCountMerge, "hll_count.merge",
+                   "HllCountMerge");
+  RegisterFunction(FunctionKind::kHllCountMergePartial,
+                   "hll_count.merge_partial", "HllCountMergePartial");
+  RegisterFunction(FunctionKind::kHllCountExtract, "hll_count.extract",
+                   "HllCountExtract");
+  RegisterFunction(FunctionKind::kKllQuantilesInitInt64,
+                   "kll_quantiles.init_int64", "KllQuantilesInitInt64");
+  RegisterFunction(FunctionKind::kKllQuantilesInitUint64,
+                   "kll_quantiles.init_uint64", "KllQuantilesInitUint64");
+  RegisterFunction(FunctionKind::kKllQuantilesInitDouble,
+                   "kll_quantiles.init_double", "KllQuantilesInitDouble");
+  RegisterFunction(FunctionKind::kKllQuantilesMergePartial,
+                   "kll_quantiles.merge_partial", "KllQuantilesMergePartial");
+  RegisterFunction(FunctionKind::kKllQuantilesMergeInt64,
+                   "kll_quantiles.merge_int64", "KllQuantilesMergeInt64");
+  RegisterFunction(FunctionKind::kKllQuantilesMergeUint64,
+                   "kll_quantiles.merge_uint64", "KllQuantilesMergeUint64");
+  RegisterFunction(FunctionKind::kKllQuantilesMergeDouble,
+                   "kll_quantiles.merge_double", "KllQuantilesMergeDouble");
+  RegisterFunction(FunctionKind::kKllQuantilesMergePointInt64,
+                   "kll_quantiles.merge_point_int64",
+                   "KllQuantilesMergePointInt64");
+  RegisterFunction(FunctionKind::kKllQuantilesMergePointUint64,
+                   "kll_quantiles.merge_point_uint64",
+                   "KllQuantilesMergePointUint64");
+  RegisterFunction(FunctionKind::kKllQuantilesMergePointDouble,
+                   "kll_quantiles.merge_point_double",
+                   "KllQuantilesMergePointDouble");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractInt64,
+                   "kll_quantiles.extract_int64", "KllQuantilesExtractInt64");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractUint64,
+                   "kll_quantiles.extract_uint64", "KllQuantilesExtractUint64");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractDouble,
+                   "kll_quantiles.extract_double", "KllQuantilesExtractDouble");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractPointInt64,
+                   "kll_quantiles.extract_point_int64",
+                   "KllQuantilesExtractPointInt64");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractPointUint64,
+                   "kll_quantiles.extract_point_uint64",
+                   "KllQuantilesExtractPointUint64");
+  RegisterFunction(FunctionKind::kKllQuantilesExtractPointDouble,
+                   "kll_quantiles.extract_point_double",
+                   "KllQuantilesExtractPointDouble");
   RegisterFunction(FunctionKind::kIsNull, "$is_null", "IsNull");
   RegisterFunction(FunctionKind::kIsTrue, "$is_true", "IsTrue");
   RegisterFunction(FunctionKind::kIsFalse, "$is_false", "IsFalse");
@@ -1423,6 +1472,15 @@ BuiltinScalarFunction::CreateValidatedRaw(
     case FunctionKind::kFarmFingerprint:
       // Hash functions are optional.
       return BuiltinFunctionRegistry::GetScalarFunction(kind, output_type);
+    case FunctionKind::kHllCountExtract:
+      return new HllCountExtractFunction;
+    case FunctionKind::kKllQuantilesExtractInt64:
+    case FunctionKind::kKllQuantilesExtractUint64:
+    case FunctionKind::kKllQuantilesExtractDouble:
+    case FunctionKind::kKllQuantilesExtractPointInt64:
+    case FunctionKind::kKllQuantilesExtractPointUint64:
+    case FunctionKind::kKllQuantilesExtractPointDouble:
+      return new KllQuantilesExtractFunction(kind, output_type);
     case FunctionKind::kError:
       return new ErrorFunction(output_type);
     default:
@@ -2539,6 +2597,61 @@ std::string BuiltinAggregateFunction::debug_name() const {
   return BuiltinFunctionCatalog::GetDebugNameByKind(kind());
 }
 
+// Returns the type of the items in the KLL sketches consumed by 'kind'.
+static KllSketch::ItemType KllItemTypeForFunction(FunctionKind kind) {
+  switch (kind) {
+    case FunctionKind::kKllQuantilesInitUint64:
+    case FunctionKind::kKllQuantilesMergeUint64:
+    case FunctionKind::kKllQuantilesMergePointUint64:
+    case FunctionKind::kKllQuantilesExtractUint64:
+    case FunctionKind::kKllQuantilesExtractPointUint64:
+      return KllSketch::kUint64;
+    case FunctionKind::kKllQuantilesInitDouble:
+    case FunctionKind::kKllQuantilesMergeDouble:
+    case FunctionKind::kKllQuantilesMergePointDouble:
+    case FunctionKind::kKllQuantilesExtractDouble:
+    case FunctionKind::kKllQuantilesExtractPointDouble:
+      return KllSketch::kDouble;
+    default:
+      return KllSketch::kInt64;
+  }
+}
+
+// Returns true if 'kind' is an aggregate function that builds a sketch.
+static bool IsSketchFunction(FunctionKind kind) {
+  switch (kind) {
+    case FunctionKind::kApproxCountDistinct:
+    case FunctionKind::kHllCountInit:
+    case FunctionKind::kHllCountMerge:
+    case FunctionKind::kHllCountMergePartial:
+    case FunctionKind::kKllQuantilesInitInt64:
+    case FunctionKind::kKllQuantilesInitUint64:
+    case FunctionKind::kKllQuantilesInitDouble:
+    case FunctionKind::kKllQuantilesMergePartial:
+    case FunctionKind::kKllQuantilesMergeInt64:
+    case FunctionKind::kKllQuantilesMergeUint64:
+    case FunctionKind::kKllQuantilesMergeDouble:
+    case FunctionKind::kKllQuantilesMergePointInt64:
+    case FunctionKind::kKllQuantilesMergePointUint64:
+    case FunctionKind::kKllQuantilesMergePointDouble:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Parses a KLL sketch that must hold items of type 'item_type'.
+static zetasql_base::StatusOr<std::unique_ptr<KllSketch>> DeserializeKllSketch(
+    const Value& bytes, KllSketch::ItemType item_type) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<KllSketch> sketch,
+                   KllSketch::Deserialize(bytes.bytes_value()));
+  if (sketch->item_type() != item_type) {
+    return ::zetasql_base::OutOfRangeErrorBuilder()
+           << "KLL sketch has a different item type than expected";
+  }
+  return sketch;
+}
+
 namespace {
 // kOrAgg is an aggregate function used internally to execute IN subqueries and
 // later ANY(SELECT ...) subqueries, once supported in ZetaSQL. The function
@@ -2591,6 +2704,48 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
 
   MemoryAccountant* accountant() { return context_->memory_accountant(); }
 
+  // NUMERIC and BIGNUMERIC inputs to Sum, Avg and Var are buffered and folded
+  // into the aggregators in batches of this size, using the span-based Add()
+  // methods which are much faster than adding the values one at a time.
+  static constexpr int kNumericBatchSize = 64;
+
+  // Appends 'value' to 'pending' and flushes the pending values if the batch
+  // is full. 'pending' grows with its inputs, so that groups with only a few
+  // values do not pay for a full batch. Returns the number of bytes allocated
+  // for 'pending', which the caller must request from 'accountant()'.
+  template <typename T>
+  int64_t AddPendingNumeric(const T& value, std::vector<T>* pending) {
+    const size_t old_capacity = pending->capacity();
+    pending->push_back(value);
+    const int64_t allocated_bytes =
+        (pending->capacity() - old_capacity) * sizeof(T);
+    if (pending->size() >= kNumericBatchSize) {
+      FlushPendingNumerics();
+    }
+    return allocated_bytes;
+  }
+
+  // Adds all buffered NUMERIC and BIGNUMERIC values to the aggregators.
+  void FlushPendingNumerics();
+
+  // Adds the non-NULL 'value' to 'hll_sketch_' or 'kll_sketch_'. Sketches
+  // for the *.MERGE* functions are created from the first input.
+  absl::Status AddToSketch(const Value& value);
+
+  // Which items survive a KLL compaction depends on the order of the inputs,
+  // which the KLL_QUANTILES functions do not define (they take no ORDER BY).
+  void MaybeSetNonDeterministicKllOutput() {
+    if (!kll_sketch_->is_exact()) {
+      context_->SetNonDeterministicOutput();
+    }
+  }
+
+  // Returns the number of bytes used by 'hll_sketch_' and 'kll_sketch_'.
+  int64_t GetSketchMemoryUsage() const {
+    return (hll_sketch_ == nullptr ? 0 : hll_sketch_->GetMemoryUsage()) +
+           (kll_sketch_ == nullptr ? 0 : kll_sketch_->GetMemoryUsage());
+  }
+
   const BuiltinAggregateFunction* function_;
   const Type* input_type_;
   const std::vector<Value> args_;
@@ -2618,6 +2773,9 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
   NumericValue::SumAggregator numeric_aggregator_;  // Avg, Sum
   BigNumericValue::SumAggregator bignumeric_aggregator_;  // Avg, Sum
   NumericValue::VarianceAggregator numeric_variance_aggregator_;  // Var, Stddev
+  // Inputs not yet added to the aggregators above. See AddPendingNumeric().
+  std::vector<NumericValue> pending_numerics_;
+  std::vector<BigNumericValue> pending_bignumerics_;
   std::string out_string_ = "";                  // Max, Min, StringAgg
   std::string delimiter_ = ",";                  // StringAgg
   // OrAgg, AndAgg, LogicalOr, LogicalAnd.
@@ -2632,10 +2790,20 @@ class BuiltinAggregateAccumulator : public AggregateAccumulator {
   std::vector<Value> array_agg_;  // ArrayAgg and ArrayConcatAgg.
   // An output array for Min, Max.
   Value min_max_out_array_;
+  // ApproxCountDistinct and HllCount*. NULL for the merge functions until the
+  // first input.
+  std::unique_ptr<HllSketch> hll_sketch_;
+  // KllQuantiles*. NULL for the merge functions until the first input.
+  std::unique_ptr<KllSketch> kll_sketch_;
+  int64_t num_quantiles_ = 0;  // KllQuantilesMerge{Int64,Uint64,Double}
+  double phi_ = 0;             // KllQuantilesMergePoint*
 };
 
 absl::Status BuiltinAggregateAccumulator::Reset() {
   accountant()->ReturnBytes(requested_bytes_);
+  // Release the pending buffers along with the bytes requested for them.
+  std::vector<NumericValue>().swap(pending_numerics_);
+  std::vector<BigNumericValue>().swap(pending_bignumerics_);
   requested_bytes_ = sizeof(*this);
   absl::Status status;
   if (!accountant()->RequestBytes(requested_bytes_, &status)) {
@@ -2692,9 +2860,82 @@ absl::Status BuiltinAggregateAccumulator::Reset() {
     case FunctionKind::kLogicalAnd:
       has_false_ = false;
       break;
+    case FunctionKind::kApproxCountDistinct:
+    case FunctionKind::kHllCountInit: {
+      int64_t precision = HllSketch::kDefaultPrecision;
+      if (!args_.empty()) {
+        if (args_[0].is_null()) {
+          return ::zetasql_base::OutOfRangeErrorBuilder()
+                 << "HLL_COUNT.INIT precision cannot be NULL";
+        }
+        precision = args_[0].int64_value();
+        if (precision < HllSketch::kMinPrecision ||
+            precision > HllSketch::kMaxPrecision) {
+          return ::zetasql_base::OutOfRangeErrorBuilder()
+                 << "HLL_COUNT.INIT precision must be between "
+                 << HllSketch::kMinPrecision << " and "
+                 << HllSketch::kMaxPrecision;
+        }
+      }
+      hll_sketch_ = absl::make_unique<HllSketch>(precision);
+      break;
+    }
+    case FunctionKind::kHllCountMerge:
+    case FunctionKind::kHllCountMergePartial:
+      hll_sketch_.reset();
+      break;
+    case FunctionKind::kKllQuantilesInitInt64:
+    case FunctionKind::kKllQuantilesInitUint64:
+    case FunctionKind::kKllQuantilesInitDouble:
+      if (!args_.empty() && args_[0].is_null()) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "KLL_QUANTILES.INIT inv_eps cannot be NULL";
+      }
+      kll_sketch_ = absl::make_unique<KllSketch>(
+          KllItemTypeForFunction(function_->kind()),
+          args_.empty() ? KllSketch::kDefaultInvEps : args_[0].int64_value());
+      break;
+    case FunctionKind::kKllQuantilesMergeInt64:
+    case FunctionKind::kKllQuantilesMergeUint64:
+    case FunctionKind::kKllQuantilesMergeDouble:
+      ZETASQL_RET_CHECK_EQ(1, args_.size());
+      if (args_[0].is_null()) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The number of quantiles cannot be NULL";
+      }
+      num_quantiles_ = args_[0].int64_value();
+      if (num_quantiles_ < 1) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The number of quantiles must be positive";
+      }
+      kll_sketch_.reset();
+      break;
+    case FunctionKind::kKllQuantilesMergePointInt64:
+    case FunctionKind::kKllQuantilesMergePointUint64:
+    case FunctionKind::kKllQuantilesMergePointDouble:
+      ZETASQL_RET_CHECK_EQ(1, args_.size());
+      if (args_[0].is_null()) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The quantile cannot be NULL";
+      }
+      phi_ = args_[0].double_value();
+      if (!(phi_ >= 0 && phi_ <= 1)) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The quantile must be in [0, 1]";
+      }
+      kll_sketch_.reset();
+      break;
+    case FunctionKind::kKllQuantilesMergePartial:
+      kll_sketch_.reset();
+      break;
     default:
       break;
   }
+  const int64_t sketch_bytes = GetSketchMemoryUsage();
+  if (!accountant()->RequestBytes(sketch_bytes, &status)) {
+    return status;
+  }
+  requested_bytes_ += sketch_bytes;
 
   switch (FCT(function_->kind(), input_type_->kind())) {
     case FCT(FunctionKind::kCountIf, TYPE_BOOL):
@@ -2858,6 +3099,18 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
   }
 
   ++count_;
+  if (IsSketchFunction(function_->kind())) {
+    // The sketch grows, or shrinks when it switches representations.
+    const int64_t old_sketch_bytes = GetSketchMemoryUsage();
+    *status = AddToSketch(value);
+    if (!status->ok()) return false;
+    const int64_t new_sketch_bytes = GetSketchMemoryUsage();
+    if (new_sketch_bytes > old_sketch_bytes) {
+      additional_bytes_to_request = new_sketch_bytes - old_sketch_bytes;
+    } else {
+      bytes_to_return = old_sketch_bytes - new_sketch_bytes;
+    }
+  }
   switch (FCT(function_->kind(), input_type_->kind())) {
     // Avg
     case FCT(FunctionKind::kAvg, TYPE_INT64):
@@ -2876,13 +3129,15 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
     case FCT(FunctionKind::kAvg, TYPE_NUMERIC): {
       // For Numeric type the sum is accumulated in numeric_aggregator, then
       // divided by count at the end.
-      numeric_aggregator_.Add(value.numeric_value());
+      additional_bytes_to_request =
+          AddPendingNumeric(value.numeric_value(), &pending_numerics_);
       break;
     }
     case FCT(FunctionKind::kAvg, TYPE_BIGNUMERIC): {
       // For BigNumeric type the sum is accumulated in bignumeric_aggregator,
       // then divided by count at the end.
-      bignumeric_aggregator_.Add(value.bignumeric_value());
+      additional_bytes_to_request =
+          AddPendingNumeric(value.bignumeric_value(), &pending_bignumerics_);
       break;
     }
     case FCT(FunctionKind::kVarPop, TYPE_DOUBLE):
@@ -2895,7 +3150,8 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
     // Variance and Stddev for NumericValue
     case FCT(FunctionKind::kVarPop, TYPE_NUMERIC):
     case FCT(FunctionKind::kVarSamp, TYPE_NUMERIC): {
-      numeric_variance_aggregator_.Add(value.numeric_value());
+      additional_bytes_to_request =
+          AddPendingNumeric(value.numeric_value(), &pending_numerics_);
       break;
     }
     // Bitwise aggregates.
@@ -3152,11 +3408,13 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       break;
     }
     case FCT(FunctionKind::kSum, TYPE_NUMERIC): {
-      numeric_aggregator_.Add(value.numeric_value());
+      additional_bytes_to_request =
+          AddPendingNumeric(value.numeric_value(), &pending_numerics_);
       break;
     }
     case FCT(FunctionKind::kSum, TYPE_BIGNUMERIC): {
-      bignumeric_aggregator_.Add(value.bignumeric_value());
+      additional_bytes_to_request =
+          AddPendingNumeric(value.bignumeric_value(), &pending_bignumerics_);
       break;
     }
     case FCT(FunctionKind::kStringAgg, TYPE_STRING): {
@@ -3206,8 +3464,67 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
   return true;
 }
 
+absl::Status BuiltinAggregateAccumulator::AddToSketch(const Value& value) {
+  switch (function_->kind()) {
+    case FunctionKind::kApproxCountDistinct:
+    case FunctionKind::kHllCountInit:
+      hll_sketch_->AddHash(HashValueForSketch(value));
+      return absl::OkStatus();
+    case FunctionKind::kHllCountMerge:
+    case FunctionKind::kHllCountMergePartial: {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<HllSketch> sketch,
+                       HllSketch::Deserialize(value.bytes_value()));
+      if (hll_sketch_ == nullptr) {
+        hll_sketch_ = std::move(sketch);
+      } else {
+        hll_sketch_->Merge(*sketch);
+      }
+      return absl::OkStatus();
+    }
+    case FunctionKind::kKllQuantilesInitInt64:
+    case FunctionKind::kKllQuantilesInitUint64:
+    case FunctionKind::kKllQuantilesInitDouble:
+      kll_sketch_->Add(value);
+      return absl::OkStatus();
+    default: {
+      // The KLL merge functions.
+      std::unique_ptr<KllSketch> sketch;
+      if (function_->kind() == FunctionKind::kKllQuantilesMergePartial) {
+        ZETASQL_ASSIGN_OR_RETURN(sketch,
+                         KllSketch::Deserialize(value.bytes_value()));
+      } else {
+        ZETASQL_ASSIGN_OR_RETURN(
+            sketch, DeserializeKllSketch(
+                        value, KllItemTypeForFunction(function_->kind())));
+      }
+      if (kll_sketch_ == nullptr) {
+        kll_sketch_ = std::move(sketch);
+        return absl::OkStatus();
+      }
+      return kll_sketch_->Merge(*sketch);
+    }
+  }
+}
+
+void BuiltinAggregateAccumulator::FlushPendingNumerics() {
+  if (!pending_numerics_.empty()) {
+    if (function_->kind() == FunctionKind::kVarPop ||
+        function_->kind() == FunctionKind::kVarSamp) {
+      numeric_variance_aggregator_.Add(pending_numerics_);
+    } else {
+      numeric_aggregator_.Add(pending_numerics_);
+    }
+    pending_numerics_.clear();
+  }
+  if (!pending_bignumerics_.empty()) {
+    bignumeric_aggregator_.Add(pending_bignumerics_);
+    pending_bignumerics_.clear();
+  }
+}
+
 ::zetasql_base::StatusOr<Value> BuiltinAggregateAccumulator::GetFinalResult(
     bool inputs_in_defined_order) {
+  FlushPendingNumerics();
   ZETASQL_ASSIGN_OR_RETURN(const Value result,
                    GetFinalResultInternal(inputs_in_defined_order));
   if (result.physical_byte_size() > context_->options().max_value_byte_size) {
@@ -3256,6 +3573,33 @@ bool BuiltinAggregateAccumulator::Accumulate(const Value& value,
       return Value::Int64(count_);
     case FunctionKind::kCountIf:
       return Value::Int64(countif_);
+    case FunctionKind::kApproxCountDistinct:
+    case FunctionKind::kHllCountMerge:
+      return Value::Int64(hll_sketch_ == nullptr ? 0 : hll_sketch_->Estimate());
+    case FunctionKind::kHllCountInit:
+    case FunctionKind::kHllCountMergePartial:
+      // Sketches are NULL over empty input, or if all the inputs are NULLs.
+      return count_ == 0 ? Value::NullBytes()
+                         : Value::Bytes(hll_sketch_->Serialize());
+    case FunctionKind::kKllQuantilesInitInt64:
+    case FunctionKind::kKllQuantilesInitUint64:
+    case FunctionKind::kKllQuantilesInitDouble:
+    case FunctionKind::kKllQuantilesMergePartial:
+      if (count_ == 0) return Value::NullBytes();
+      MaybeSetNonDeterministicKllOutput();
+      return Value::Bytes(kll_sketch_->Serialize());
+    case FunctionKind::kKllQuantilesMergeInt64:
+    case FunctionKind::kKllQuantilesMergeUint64:
+    case FunctionKind::kKllQuantilesMergeDouble:
+      if (kll_sketch_ == nullptr) return Value::Null(output_type);
+      MaybeSetNonDeterministicKllOutput();
+      return kll_sketch_->GetQuantiles(num_quantiles_);
+    case FunctionKind::kKllQuantilesMergePointInt64:
+    case FunctionKind::kKllQuantilesMergePointUint64:
+    case FunctionKind::kKllQuantilesMergePointDouble:
+      if (kll_sketch_ == nullptr) return Value::Null(output_type);
+      MaybeSetNonDeterministicKllOutput();
+      return kll_sketch_->GetQuantile(phi_);
     default:
       break;
   }
@@ -5610,6 +5954,50 @@ zetasql_base::StatusOr<Value> RandFunction::Eval(absl::Span<const Value> args,
       absl::Uniform<double>(*context->GetRandomNumberGenerator(), 0, 1));
 }
 
+zetasql_base::StatusOr<Value> HllCountExtractFunction::Eval(
+    absl::Span<const Value> args, EvaluationContext* context) const {
+  ZETASQL_RET_CHECK_EQ(1, args.size());
+  // A NULL sketch has no inputs.
+  if (args[0].is_null()) {
+    return Value::Int64(0);
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<HllSketch> sketch,
+                   HllSketch::Deserialize(args[0].bytes_value()));
+  return Value::Int64(sketch->Estimate());
+}
+
+zetasql_base::StatusOr<Value> KllQuantilesExtractFunction::Eval(
+    absl::Span<const Value> args, EvaluationContext* context) const {
+  ZETASQL_RET_CHECK_EQ(2, args.size());
+  if (args[0].is_null()) {
+    return Value::Null(output_type());
+  }
+  if (args[1].is_null()) {
+    return ::zetasql_base::OutOfRangeErrorBuilder()
+           << debug_name() << " does not accept a NULL second argument";
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<KllSketch> sketch,
+                   DeserializeKllSketch(args[0], KllItemTypeForFunction(kind())));
+  switch (kind()) {
+    case FunctionKind::kKllQuantilesExtractInt64:
+    case FunctionKind::kKllQuantilesExtractUint64:
+    case FunctionKind::kKllQuantilesExtractDouble:
+      if (args[1].int64_value() < 1) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The number of quantiles must be positive";
+      }
+      return sketch->GetQuantiles(args[1].int64_value());
+    default: {
+      const double phi = args[1].double_value();
+      if (!(phi >= 0 && phi <= 1)) {
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "The quantile must be in [0, 1]";
+      }
+      return sketch->GetQuantile(phi);
+    }
+  }
+}
+
 zetasql_base::StatusOr<Value> ErrorFunction::Eval(absl::Span<const Value> args,
                                           EvaluationContext* context) const {
   ZETASQL_RET_CHECK_EQ(1, args.size());
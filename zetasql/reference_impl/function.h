@@ -86,6 +86,19 @@ enum class FunctionKind {
   kCorr,
   kCovarPop,
   kCovarSamp,
+  kHllCountInit,
+  kHllCountMerge,
+  kHllCountMergePartial,
+  kKllQuantilesInitInt64,
+  kKllQuantilesInitUint64,
+  kKllQuantilesInitDouble,
+  kKllQuantilesMergePartial,
+  kKllQuantilesMergeInt64,
+  kKllQuantilesMergeUint64,
+  kKllQuantilesMergeDouble,
+  kKllQuantilesMergePointInt64,
+  kKllQuantilesMergePointUint64,
+  kKllQuantilesMergePointDouble,
   kLogicalAnd,
   kLogicalOr,
   kMax,
@@ -303,6 +316,15 @@ enum class FunctionKind {
   kSha512,
   kFarmFingerprint,
 
+  // Sketch functions
+  kHllCountExtract,
+  kKllQuantilesExtractInt64,
+  kKllQuantilesExtractUint64,
+  kKllQuantilesExtractDouble,
+  kKllQuantilesExtractPointInt64,
+  kKllQuantilesExtractPointUint64,
+  kKllQuantilesExtractPointDouble,
+
   // Error function
   kError,
 };
@@ -1039,6 +1061,25 @@ class RandFunction : public SimpleBuiltinScalarFunction {
                              EvaluationContext* context) const override;
 };
 
+// HLL_COUNT.EXTRACT.
+class HllCountExtractFunction : public SimpleBuiltinScalarFunction {
+ public:
+  HllCountExtractFunction()
+      : SimpleBuiltinScalarFunction(FunctionKind::kHllCountExtract,
+                                    types::Int64Type()) {}
+  zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
+                             EvaluationContext* context) const override;
+};
+
+// KLL_QUANTILES.EXTRACT_* and KLL_QUANTILES.EXTRACT_POINT_*.
+class KllQuantilesExtractFunction : public SimpleBuiltinScalarFunction {
+ public:
+  KllQuantilesExtractFunction(FunctionKind kind, const Type* output_type)
+      : SimpleBuiltinScalarFunction(kind, output_type) {}
+  zetasql_base::StatusOr<Value> Eval(absl::Span<const Value> args,
+                             EvaluationContext* context) const override;
+};
+
 class ErrorFunction : public SimpleBuiltinScalarFunction {
  public:
   explicit ErrorFunction(const Type* output_type)
@@ -61,6 +61,7 @@
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node.h"
 #include <cstdint>
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/node_hash_map.h"
 #include "absl/hash/hash.h"
 #include "absl/memory/memory.h"
@@ -1143,6 +1144,14 @@ class RelationalOp : public AlgebraNode {
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const = 0;
 
+  // Calls CreateIterator(). If 'context' collects operator stats, also records
+  // the evaluation and wraps the iterator to record the rows it produces.
+  // Operators must create the iterators for their input operators with this
+  // method so that the inputs show up in the stats.
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorWithStats(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const;
+
   // Returns a copy of the output schema of the TupleIterator corresponding to
   // this operator.
   virtual std::unique_ptr<TupleSchema> CreateOutputSchema() const = 0;
@@ -1200,7 +1209,9 @@ class EvaluatorTableScanOp : public RelationalOp {
       absl::Span<const std::string> column_names,
       absl::Span<const VariableId> variables,
       std::vector<std::unique_ptr<ColumnFilterArg>> and_filters,
-      std::unique_ptr<ValueExpr> read_time);
+      std::unique_ptr<ValueExpr> read_time,
+      absl::flat_hash_map<int, std::vector<ProtoFieldPath>>
+          proto_field_path_map);
 
   // Returns a ColumnFilter corresponding to the intersection of 'filters'. This
   // method is only public for unit testing purposes.
@@ -1230,7 +1241,9 @@ class EvaluatorTableScanOp : public RelationalOp {
       absl::Span<const std::string> column_names,
       absl::Span<const VariableId> variables,
       std::vector<std::unique_ptr<ColumnFilterArg>> and_filters,
-      std::unique_ptr<ValueExpr> read_time);
+      std::unique_ptr<ValueExpr> read_time,
+      absl::flat_hash_map<int, std::vector<ProtoFieldPath>>
+          proto_field_path_map);
 
   const Table* table_;
   const std::string alias_;
@@ -1239,6 +1252,10 @@ class EvaluatorTableScanOp : public RelationalOp {
   const std::vector<VariableId> variables_;
   std::vector<std::unique_ptr<ColumnFilterArg>> and_filters_;
   std::unique_ptr<ValueExpr> read_time_;
+  // Passed to EvaluatorTableIterator::SetColumnProtoFieldPathMap(). Keyed on
+  // the index of a column in the scan.
+  const absl::flat_hash_map<int, std::vector<ProtoFieldPath>>
+      proto_field_path_map_;
 };
 
 // Evaluates some expressions and makes them available to 'body'. Each
@@ -1310,6 +1327,16 @@ class LetOp : public RelationalOp {
 // have correlated parameters; their inputs must be evaluated only once for
 // correctness. Correlated input of cross/outer apply may be evaluated multiple
 // times even if no correlated references are present.
+//
+// Semi join returns each left tuple that joins with at least one right tuple
+// exactly once, and anti join returns each left tuple that joins with no right
+// tuple. Both pass through the variables from the left and nothing from the
+// right, so neither 'left_outputs' nor 'right_outputs' may be specified. Like
+// inner join, the right-hand side must not be correlated; with
+// HashJoinEqualityExprs, only the right-hand side is held in memory and the
+// left-hand side is streamed. Since these joins replace [NOT] EXISTS and IN
+// subqueries, the right-hand side is only evaluated once the left-hand side
+// produces a tuple, so it does not fail over an empty left-hand side.
 class JoinOp : public RelationalOp {
  public:
   enum JoinKind {
@@ -1318,7 +1345,9 @@ class JoinOp : public RelationalOp {
     kRightOuterJoin,
     kFullOuterJoin,
     kCrossApply,
-    kOuterApply
+    kOuterApply,
+    kSemiJoin,
+    kAntiJoin
   };
 
   // Represents an equality in the join condition where one side is determined
@@ -1504,6 +1533,19 @@ class AnalyticOp : public RelationalOp {
 
   bool may_preserve_order() const override { return true; }
 
+  // If true, the analytic arguments of different partitions may be evaluated
+  // on separate threads when EvaluationOptions::analytic_num_threads is greater
+  // than 1. All threads share the same ValueExprs, so this is only safe if
+  // evaluating the analytic arguments neither modifies state in them (as
+  // RegexpFunction does) nor reads state that other threads may also read,
+  // such as the rows of a spool read by a subquery.
+  void set_may_evaluate_partitions_in_parallel(bool value) {
+    may_evaluate_partitions_in_parallel_ = value;
+  }
+  bool may_evaluate_partitions_in_parallel() const {
+    return may_evaluate_partitions_in_parallel_;
+  }
+
  private:
   enum ArgKind { kPartitionKey, kOrderKey, kAnalytic, kInput };
 
@@ -1523,6 +1565,8 @@ class AnalyticOp : public RelationalOp {
 
   const RelationalOp* input() const;
   RelationalOp* mutable_input();
+
+  bool may_evaluate_partitions_in_parallel_ = false;
 };
 
 // Sorts 'values' in 'input' using 'keys'.
@@ -1570,6 +1614,32 @@ class SortOp : public RelationalOp {
 
   bool may_preserve_order() const override { return true; }
 
+  // If positive, the first 'num_hash_partition_keys' keys only partition the
+  // input instead of ordering it. The tuples are grouped by those keys with a
+  // hash table, and each group is sorted by the remaining keys just before it
+  // is returned and freed as soon as it has been returned. Groups are returned
+  // in the order in which their first tuples appear in the input. This is
+  // enough for an AnalyticOp, which only needs the tuples of each partition to
+  // be adjacent, and sorts each partition separately instead of the entire
+  // input. Value equality and hashing of the partitioning keys must agree with
+  // the comparison of the keys (e.g., they must not contain floating point
+  // values). Not supported together with 'limit'.
+  absl::Status set_num_hash_partition_keys(int num_hash_partition_keys);
+  int num_hash_partition_keys() const { return num_hash_partition_keys_; }
+
+  // Only returns the first 'partition_limit' tuples of each hash partition (see
+  // set_num_hash_partition_keys(); without partitioning keys, the entire input
+  // is a single partition) in the order of the remaining keys. If 'keep_ties'
+  // is true, the tuples that are equal to the last of them with respect to
+  // those keys are also returned. This implements filters like
+  // "ROW_NUMBER() OVER (...) <= 'partition_limit'" (with 'keep_ties' = false)
+  // and "RANK() OVER (...) <= 'partition_limit'" (with 'keep_ties' = true)
+  // before the analytic functions are evaluated, and each partition only keeps
+  // the tuples that may be returned in memory. If 'keep_ties' is false and a
+  // dropped tuple is equal to the last returned tuple of its partition, the
+  // output is marked non-deterministic. 'partition_limit' must be positive.
+  absl::Status set_partition_limit(int64_t partition_limit, bool keep_ties);
+
  private:
   enum ArgKind { kKey, kValue, kLimit, kOffset, kInput };
 
@@ -1598,6 +1668,9 @@ class SortOp : public RelationalOp {
   const bool has_limit_;
   const bool has_offset_;
   const bool is_stable_sort_;
+  int num_hash_partition_keys_ = 0;
+  absl::optional<int64_t> partition_limit_;
+  bool partition_limit_keeps_ties_ = false;
 };
 
 // Scans (or unnests) an 'array' as a relation. Each output tuple contains an
@@ -1672,6 +1745,46 @@ class ArrayScanOp : public RelationalOp {
   ValueExpr* mutable_array_expr();
 };
 
+// Scans the rows materialized by the SpoolExpr assigned to 'spool', which must
+// be bound by an enclosing LetOp or LetExpr. Each output tuple binds
+// 'variables' to the spooled columns in order. Several SpoolScanOps may read
+// the same spool; each one walks the shared rows with its own cursor.
+class SpoolScanOp : public RelationalOp {
+ public:
+  SpoolScanOp(const SpoolScanOp&) = delete;
+  SpoolScanOp& operator=(const SpoolScanOp&) = delete;
+
+  static std::string GetIteratorDebugString(const VariableId& spool);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<SpoolScanOp>> Create(
+      const VariableId& spool, std::vector<std::unique_ptr<ExprArg>> columns);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const override;
+
+  // Returns the schema consisting of the variables of 'columns'.
+  std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
+
+  std::string IteratorDebugString() const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kColumn };
+
+  SpoolScanOp(const VariableId& spool,
+              std::vector<std::unique_ptr<ExprArg>> columns);
+
+  absl::Span<const ExprArg* const> columns() const;
+
+  const VariableId spool_;
+};
+
 // Returns the union of N relations in 'inputs'. Each output tuple is
 // constructed by evaluating M value operators. (The resolved AST allows for
 // union operations to arbitrarily remap the columns in an underlying scan,
@@ -1722,6 +1835,76 @@ class UnionAllOp : public RelationalOp {
   const int num_rel_;
 };
 
+// Evaluates INTERSECT or EXCEPT over the tuples produced by 'inputs'. As in
+// UnionAllOp, each input comes with ExprArgs that compute the output variables
+// from the input tuples, and the ExprArgs of all inputs must assign the same
+// variables.
+//
+// The first input is loaded into a hash table with one entry per distinct
+// output tuple, and the remaining inputs are streamed against it: tuples that
+// do not appear in the first input are discarded right away, so the memory
+// used is proportional to the number of distinct tuples in the first input.
+// Output tuples are compared using Value equality, so NULLs are equal to each
+// other. Every entry counts its occurrences in each input, and is returned:
+//   INTERSECT ALL: min(count in each input) times.
+//   INTERSECT DISTINCT: once, if it occurs in every input.
+//   EXCEPT ALL: max(0, count in the first input - count in other inputs)
+//               times.
+//   EXCEPT DISTINCT: once, if it does not occur in any other input.
+class SetOperationOp : public RelationalOp {
+ public:
+  enum SetOperationType {
+    kIntersectAll,
+    kIntersectDistinct,
+    kExceptAll,
+    kExceptDistinct
+  };
+
+  SetOperationOp(const SetOperationOp&) = delete;
+  SetOperationOp& operator=(const SetOperationOp&) = delete;
+
+  using Input = UnionAllOp::Input;
+
+  static const std::string& SetOperationTypeToString(SetOperationType type);
+
+  static std::string GetIteratorDebugString(
+      SetOperationType type,
+      absl::Span<const std::string> input_iter_debug_strings);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<SetOperationOp>> Create(
+      SetOperationType type, std::vector<Input> inputs);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+      absl::Span<const TupleData* const> params, int num_extra_slots,
+      EvaluationContext* context) const override;
+
+  // Returns the schema consisting of the variables passed in the ExprArgs to
+  // the constructor.
+  std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
+
+  std::string IteratorDebugString() const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  SetOperationOp(SetOperationType type, std::vector<Input> inputs);
+
+  absl::Span<const ExprArg* const> values(int i) const;
+  absl::Span<ExprArg* const> mutable_values(int i);
+
+  const RelationalOp* rel(int i) const;
+  RelationalOp* mutable_rel(int i);
+
+  int num_rel() const { return num_rel_; }
+
+  const SetOperationType type_;
+  const int num_rel_;
+};
+
 // Executes a series of assignments, followed by a body in a loop.
 //
 // The recursion is initialized by creating new variables defined by each
@@ -1748,12 +1931,23 @@ class UnionAllOp : public RelationalOp {
 //   FOR EACH ExprArg a IN <loop_assign>:
 //     SET <a.variable()> = <a.value().Eval()>
 // END LOOP
+//
+// If <distinct_rows> is true, every variable must be an array whose elements
+// represent rows. Each assigned array is then reduced to the elements that
+// have not been assigned to that variable before, dropping duplicates within
+// the array as well, so that each variable only holds the new rows of its
+// iteration. Together with a body that scans the variable, this implements
+// WITH RECURSIVE ... UNION DISTINCT with semi-naive evaluation: each
+// iteration only processes the rows produced by the previous one, and the
+// loop ends once an iteration produces no new rows. The rows seen so far are
+// kept in a hash set charged to the MemoryAccountant.
 class LoopOp : public RelationalOp {
  public:
   static zetasql_base::StatusOr<std::unique_ptr<LoopOp>> Create(
       std::vector<std::unique_ptr<ExprArg>> initial_assign,
       std::unique_ptr<RelationalOp> body,
-      std::vector<std::unique_ptr<ExprArg>> loop_assign);
+      std::vector<std::unique_ptr<ExprArg>> loop_assign,
+      bool distinct_rows = false);
 
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
@@ -1789,13 +1983,15 @@ class LoopOp : public RelationalOp {
   // <initial_assign_expr()> to be unique.
   zetasql_base::StatusOr<int> GetVariableIndexFromLoopAssignIndex(int i) const;
 
+  bool distinct_rows() const { return distinct_rows_; }
+
  private:
   enum ArgKind { kInitialAssign, kBody, kLoopAssign };
 
   LoopOp(std::vector<std::unique_ptr<ExprArg>> initial_assign,
          std::unique_ptr<RelationalOp> body,
          std::vector<std::unique_ptr<ExprArg>> loop_assign,
-         std::vector<int> loop_assign_indexes);
+         std::vector<int> loop_assign_indexes, bool distinct_rows);
 
   // For each value in loop_assign_expr(), stores the index in
   // initial_assign_expr() of the corresponding variable being assigned to.
@@ -1804,6 +2000,8 @@ class LoopOp : public RelationalOp {
   // GetVariableIndexFromLoopAssignIndex(i) simply returns
   // loop_assign_indexes_[i].
   std::vector<int> loop_assign_indexes_;
+
+  const bool distinct_rows_;
 };
 
 // Augments the tuples from 'input' by 'map' slots computed for each tuple.
@@ -2281,6 +2479,47 @@ class ArrayNestExpr : public ValueExpr {
   const bool is_with_table_;
 };
 
+// Materializes 'input' into a spool stored in the EvaluationContext under the
+// variable 'spool', replacing any previous spool with that name, and returns
+// the number of rows. Only the slots of 'columns' are kept. The spooled rows
+// are charged to the context's MemoryAccountant until the spool is replaced or
+// the context is destroyed, and are read back by SpoolScanOp. The result must
+// be assigned to 'spool' by a LetOp or LetExpr.
+class SpoolExpr : public ValueExpr {
+ public:
+  SpoolExpr(const SpoolExpr&) = delete;
+  SpoolExpr& operator=(const SpoolExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<SpoolExpr>> Create(
+      const VariableId& spool, std::vector<VariableId> columns,
+      std::unique_ptr<RelationalOp> input);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            absl::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kInput };
+
+  SpoolExpr(const VariableId& spool, std::vector<VariableId> columns,
+            std::unique_ptr<RelationalOp> input);
+
+  const RelationalOp* input() const;
+  RelationalOp* mutable_input();
+
+  const VariableId spool_;
+  const std::vector<VariableId> columns_;
+  // Slots of 'columns_' in the output of 'input'. Set by
+  // SetSchemasForEvaluation().
+  std::vector<int> column_slots_;
+};
+
 // Constructs a struct of the given 'type' and 'args'. Number and order of
 // fields must match the type definition.
 class NewStructExpr : public ValueExpr {
@@ -2436,6 +2675,45 @@ class ExistsExpr : public ValueExpr {
   RelationalOp* mutable_input();
 };
 
+// Evaluates 'subquery' (typically an ExistsExpr, a SingleValueExpr or an
+// ArrayNestExpr) at most once per distinct value of 'keys' during an
+// evaluation, and returns the cached result for repeated keys. 'keys' are the
+// correlated parameters of the subquery; if there are none, the subquery is
+// evaluated once per evaluation. The algebrizer only uses this for
+// non-volatile subqueries whose keys have types for which Value equality
+// implies that the subquery returns the same result. Errors are not cached.
+class CachedSubqueryExpr : public ValueExpr {
+ public:
+  CachedSubqueryExpr(const CachedSubqueryExpr&) = delete;
+  CachedSubqueryExpr& operator=(const CachedSubqueryExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<CachedSubqueryExpr>> Create(
+      std::vector<std::unique_ptr<ValueExpr>> keys,
+      std::unique_ptr<ValueExpr> subquery);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            absl::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kKeys, kSubquery };
+
+  CachedSubqueryExpr(std::vector<std::unique_ptr<ValueExpr>> keys,
+                     std::unique_ptr<ValueExpr> subquery);
+
+  absl::Span<const ExprArg* const> keys() const;
+  absl::Span<ExprArg* const> mutable_keys();
+
+  const ValueExpr* subquery() const;
+  ValueExpr* mutable_subquery();
+};
+
 // Defines an executable function.
 class FunctionBody {
  public:
@@ -3461,6 +3739,16 @@ class DMLInsertValueExpr : public DMLValueExpr {
       absl::Span<const TupleData* const> params, EvaluationContext* context,
       std::vector<std::vector<Value>>* original_rows) const;
 
+  // Like PopulateRowsInOriginalTable(), but only populates 'original_rows' with
+  // the rows whose primary key is the primary key of a row in
+  // 'rows_to_insert', which are read directly from the table with kInList
+  // ColumnFilters on the primary key columns. Leaves 'original_rows' empty if
+  // the table does not have a primary key.
+  absl::Status PopulateRowsInOriginalTableWithPrimaryKeys(
+      const std::vector<std::vector<Value>>& rows_to_insert,
+      EvaluationContext* context,
+      std::vector<std::vector<Value>>* original_rows) const;
+
   // Adds the rows in 'rows_to_insert' to 'row_map' and returns the number of
   // rows modified. Handles all the various insert modes and possibly generates
   // an error if there is a primary key collision.
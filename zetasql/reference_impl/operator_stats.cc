@@ -0,0 +1,185 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/operator_stats.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/reference_impl/operator.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "zetasql/base/map_util.h"
+
+namespace zetasql {
+
+namespace {
+
+// Forwards to another TupleIterator, recording OperatorStats.
+class StatsCollectingTupleIterator : public TupleIterator {
+ public:
+  StatsCollectingTupleIterator(OperatorStats* stats,
+                               MemoryAccountant* accountant,
+                               std::unique_ptr<TupleIterator> iter)
+      : stats_(stats), accountant_(accountant), iter_(std::move(iter)) {
+    RecordMemory();
+  }
+
+  StatsCollectingTupleIterator(const StatsCollectingTupleIterator&) = delete;
+  StatsCollectingTupleIterator& operator=(
+      const StatsCollectingTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return iter_->Schema(); }
+
+  TupleData* Next() override {
+    const absl::Time start = absl::Now();
+    TupleData* data = iter_->Next();
+    stats_->time += absl::Now() - start;
+    if (data != nullptr) {
+      ++stats_->num_rows;
+      RecordMemory();
+    }
+    return data;
+  }
+
+  absl::Status Status() const override { return iter_->Status(); }
+
+  bool PreservesOrder() const override { return iter_->PreservesOrder(); }
+
+  absl::Status DisableReordering() override {
+    return iter_->DisableReordering();
+  }
+
+  // This iterator is transparent in debug strings.
+  std::string DebugString() const override { return iter_->DebugString(); }
+
+ private:
+  void RecordMemory() {
+    stats_->peak_memory_bytes =
+        std::max(stats_->peak_memory_bytes, accountant_->num_bytes_in_use());
+  }
+
+  OperatorStats* stats_;
+  MemoryAccountant* accountant_;
+  std::unique_ptr<TupleIterator> iter_;
+};
+
+// Returns the operator kind from its debug string, e.g. "JoinOp".
+std::string OperatorName(const RelationalOp& op) {
+  const std::string debug_string = op.DebugInternal("\n", /*verbose=*/false);
+  return debug_string.substr(0, debug_string.find_first_of("(\n"));
+}
+
+// Appends to 'inputs' the RelationalOps directly below 'node', looking
+// through expressions.
+void FindInputOps(const AlgebraNode& node,
+                  std::vector<const RelationalOp*>* inputs) {
+  for (const AlgebraArg* arg : node.GetArgs()) {
+    if (arg == nullptr || !arg->has_node()) continue;
+    const RelationalOp* op = arg->node()->AsRelationalOp();
+    if (op != nullptr) {
+      inputs->push_back(op);
+    } else {
+      FindInputOps(*arg->node(), inputs);
+    }
+  }
+}
+
+void AppendProtoString(const OperatorStatsProto& proto,
+                       const std::string& indent, std::string* out) {
+  absl::StrAppend(out, proto.name(),
+                  " [evaluations=", proto.num_evaluations(),
+                  " rows=", proto.num_rows(),
+                  " time=", absl::FormatDuration(
+                                absl::Microseconds(proto.time_micros())),
+                  " self_time=", absl::FormatDuration(
+                                     absl::Microseconds(
+                                         proto.self_time_micros())),
+                  " peak_memory_bytes=", proto.peak_memory_bytes());
+  for (const OperatorStatsProto::Counter& counter : proto.counter()) {
+    absl::StrAppend(out, " ", counter.name(), "=", counter.value());
+  }
+  absl::StrAppend(out, "]\n");
+  for (int i = 0; i < proto.input_size(); ++i) {
+    const bool is_last = i == proto.input_size() - 1;
+    absl::StrAppend(out, indent, AlgebraNode::kIndentFork);
+    AppendProtoString(proto.input(i),
+                      absl::StrCat(indent, is_last ? AlgebraNode::kIndentSpace
+                                                   : AlgebraNode::kIndentBar),
+                      out);
+  }
+}
+
+}  // namespace
+
+const OperatorStats* OperatorStatsCollector::Find(
+    const RelationalOp* op) const {
+  return zetasql_base::FindOrNull(stats_, op);
+}
+
+void OperatorStatsCollector::AddCounter(const RelationalOp* op,
+                                        absl::string_view name,
+                                        int64_t value) {
+  GetOrCreate(op)->counters[std::string(name)] += value;
+}
+
+std::unique_ptr<TupleIterator> OperatorStatsCollector::WrapIterator(
+    OperatorStats* stats, MemoryAccountant* accountant,
+    std::unique_ptr<TupleIterator> iter) {
+  return absl::make_unique<StatsCollectingTupleIterator>(stats, accountant,
+                                                         std::move(iter));
+}
+
+void OperatorStatsCollector::ToProto(const RelationalOp& root,
+                                     OperatorStatsProto* proto) const {
+  proto->Clear();
+  proto->set_name(OperatorName(root));
+  const OperatorStats* stats = Find(&root);
+  if (stats != nullptr) {
+    proto->set_num_evaluations(stats->num_evaluations);
+    proto->set_num_rows(stats->num_rows);
+    proto->set_time_micros(absl::ToInt64Microseconds(stats->time));
+    proto->set_peak_memory_bytes(stats->peak_memory_bytes);
+    for (const auto& entry : stats->counters) {
+      OperatorStatsProto::Counter* counter = proto->add_counter();
+      counter->set_name(entry.first);
+      counter->set_value(entry.second);
+    }
+  }
+
+  std::vector<const RelationalOp*> inputs;
+  FindInputOps(root, &inputs);
+  int64_t input_time_micros = 0;
+  for (const RelationalOp* input : inputs) {
+    OperatorStatsProto* input_proto = proto->add_input();
+    ToProto(*input, input_proto);
+    input_time_micros += input_proto->time_micros();
+  }
+  proto->set_self_time_micros(
+      std::max<int64_t>(0, proto->time_micros() - input_time_micros));
+}
+
+std::string OperatorStatsProtoToString(const OperatorStatsProto& proto) {
+  std::string out;
+  AppendProtoString(proto, /*indent=*/"", &out);
+  return out;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,87 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_OPERATOR_STATS_H_
+#define ZETASQL_REFERENCE_IMPL_OPERATOR_STATS_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "zetasql/public/operator_stats.pb.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace zetasql {
+
+class RelationalOp;
+
+// Runtime statistics for one RelationalOp, accumulated over all evaluations of
+// the operator in one EvaluationContext. See OperatorStatsProto for the
+// meaning of the fields.
+struct OperatorStats {
+  int64_t num_evaluations = 0;
+  int64_t num_rows = 0;
+  // Includes the time spent in the operator's inputs.
+  absl::Duration time;
+  int64_t peak_memory_bytes = 0;
+  // Operator-specific counters.
+  std::map<std::string, int64_t> counters;
+};
+
+// Collects OperatorStats for the RelationalOps evaluated with one
+// EvaluationContext. Not thread-safe, like EvaluationContext.
+class OperatorStatsCollector {
+ public:
+  OperatorStatsCollector() {}
+  OperatorStatsCollector(const OperatorStatsCollector&) = delete;
+  OperatorStatsCollector& operator=(const OperatorStatsCollector&) = delete;
+
+  // The returned pointer remains valid for the lifetime of this object.
+  OperatorStats* GetOrCreate(const RelationalOp* op) { return &stats_[op]; }
+
+  // Returns NULL if 'op' has not been evaluated.
+  const OperatorStats* Find(const RelationalOp* op) const;
+
+  // Adds 'value' to the counter 'name' of 'op'.
+  void AddCounter(const RelationalOp* op, absl::string_view name,
+                  int64_t value);
+
+  // Returns an iterator that forwards to 'iter' and adds the time spent in
+  // Next(), the rows returned and the memory reserved from 'accountant' to
+  // 'stats'.
+  static std::unique_ptr<TupleIterator> WrapIterator(
+      OperatorStats* stats, MemoryAccountant* accountant,
+      std::unique_ptr<TupleIterator> iter);
+
+  // Populates 'proto' with the statistics for the plan rooted at 'root'.
+  // Operators that were never evaluated appear with zero counts.
+  void ToProto(const RelationalOp& root, OperatorStatsProto* proto) const;
+
+ private:
+  absl::node_hash_map<const RelationalOp*, OperatorStats> stats_;
+};
+
+// Returns the plan in 'proto' as an indented tree, with the statistics of each
+// operator on its line. This is the output of EXPLAIN ANALYZE.
+std::string OperatorStatsProtoToString(const OperatorStatsProto& proto);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_OPERATOR_STATS_H_
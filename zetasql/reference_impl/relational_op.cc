@@ -91,8 +91,8 @@ absl::Status RelationalOp::set_is_order_preserving(bool is_order_preserving) {
       DeepCopyTupleDatas(params);
   PassThroughTupleIterator::IteratorFactory iterator_factory =
       [this, params_copies, num_extra_slots, context]() {
-        return CreateIterator(StripSharedPtrs(params_copies), num_extra_slots,
-                              context);
+        return CreateIteratorWithStats(StripSharedPtrs(params_copies),
+                                       num_extra_slots, context);
       };
   const std::unique_ptr<const TupleSchema> schema = CreateOutputSchema();
   PassThroughTupleIterator::DebugStringFactory debug_string_factory = [this]() {
@@ -104,6 +104,25 @@ absl::Status RelationalOp::set_is_order_preserving(bool is_order_preserving) {
   return iter;
 }
 
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
+RelationalOp::CreateIteratorWithStats(absl::Span<const TupleData* const> params,
+                                      int num_extra_slots,
+                                      EvaluationContext* context) const {
+  OperatorStatsCollector* collector = context->operator_stats();
+  if (collector == nullptr) {
+    return CreateIterator(params, num_extra_slots, context);
+  }
+  OperatorStats* stats = collector->GetOrCreate(this);
+  const absl::Time start = absl::Now();
+  zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> iter =
+      CreateIterator(params, num_extra_slots, context);
+  stats->time += absl::Now() - start;
+  ++stats->num_evaluations;
+  ZETASQL_RETURN_IF_ERROR(iter.status());
+  return OperatorStatsCollector::WrapIterator(
+      stats, context->memory_accountant(), std::move(iter).value());
+}
+
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RelationalOp::MaybeReorder(
     std::unique_ptr<TupleIterator> iter, EvaluationContext* context) const {
   if (context->options().scramble_undefined_orderings) {
@@ -315,10 +334,17 @@ EvaluatorTableScanOp::Create(
     absl::Span<const std::string> column_names,
     absl::Span<const VariableId> variables,
     std::vector<std::unique_ptr<ColumnFilterArg>> and_filters,
-    std::unique_ptr<ValueExpr> read_time) {
+    std::unique_ptr<ValueExpr> read_time,
+    absl::flat_hash_map<int, std::vector<ProtoFieldPath>>
+        proto_field_path_map) {
+  for (const auto& entry : proto_field_path_map) {
+    ZETASQL_RET_CHECK_GE(entry.first, 0);
+    ZETASQL_RET_CHECK_LT(entry.first, variables.size());
+  }
   return absl::WrapUnique(new EvaluatorTableScanOp(
       table, alias, column_idxs, column_names, variables,
-      std::move(and_filters), std::move(read_time)));
+      std::move(and_filters), std::move(read_time),
+      std::move(proto_field_path_map)));
 }
 
 ::zetasql_base::StatusOr<std::unique_ptr<ColumnFilter>>
@@ -539,6 +565,11 @@ EvaluatorTableScanOp::CreateIterator(absl::Span<const TupleData* const> params,
   ZETASQL_RETURN_IF_ERROR(
       evaluator_table_iter->SetColumnFilterMap(std::move(filter_map)));
 
+  if (!proto_field_path_map_.empty()) {
+    ZETASQL_RETURN_IF_ERROR(evaluator_table_iter->SetColumnProtoFieldPathMap(
+        proto_field_path_map_));
+  }
+
   std::unique_ptr<TupleIterator> tuple_iter =
       absl::make_unique<EvaluatorTableTupleIterator>(
           table_->Name(), CreateOutputSchema(), num_extra_slots, context,
@@ -572,11 +603,36 @@ std::string EvaluatorTableScanOp::DebugInternal(const std::string& indent,
     filter_strings.push_back(filter->DebugInternal(indent_input, verbose));
   }
 
+  // Print the proto field paths in column order so that the output is
+  // deterministic.
+  std::vector<std::string> proto_field_path_strings;
+  for (int i = 0; i < column_names_.size(); ++i) {
+    auto it = proto_field_path_map_.find(i);
+    if (it == proto_field_path_map_.end()) continue;
+    std::vector<std::string> path_strings;
+    for (const ProtoFieldPath& path : it->second) {
+      path_strings.push_back(absl::StrJoin(
+          path, ".",
+          [](std::string* out, const google::protobuf::FieldDescriptor* field) {
+            if (field->is_extension()) {
+              absl::StrAppend(out, "(", field->full_name(), ")");
+            } else {
+              absl::StrAppend(out, field->name());
+            }
+          }));
+    }
+    proto_field_path_strings.push_back(
+        absl::StrCat("proto_fields(", column_names_[i], "#", column_idxs_[i],
+                     "): ", absl::StrJoin(path_strings, ", ")));
+  }
+
   return absl::StrCat(
       "EvaluatorTableScanOp(", column_names_.empty() ? "" : indent_input,
       absl::StrJoin(column_strings, indent_input),
       filter_strings.empty() ? "" : indent_input,
-      absl::StrJoin(filter_strings, indent_input), indent_input,
+      absl::StrJoin(filter_strings, indent_input),
+      proto_field_path_strings.empty() ? "" : indent_input,
+      absl::StrJoin(proto_field_path_strings, indent_input), indent_input,
       "table: ", table_->Name(),
       alias_.empty() ? "" : absl::StrCat(indent_input, "alias: ", alias_), ")");
 }
@@ -587,14 +643,16 @@ EvaluatorTableScanOp::EvaluatorTableScanOp(
     absl::Span<const std::string> column_names,
     absl::Span<const VariableId> variables,
     std::vector<std::unique_ptr<ColumnFilterArg>> and_filters,
-    std::unique_ptr<ValueExpr> read_time)
+    std::unique_ptr<ValueExpr> read_time,
+    absl::flat_hash_map<int, std::vector<ProtoFieldPath>> proto_field_path_map)
     : table_(table),
       alias_(alias),
       column_idxs_(column_idxs.begin(), column_idxs.end()),
       column_names_(column_names.begin(), column_names.end()),
       variables_(variables.begin(), variables.end()),
       and_filters_(std::move(and_filters)),
-      read_time_(std::move(read_time)) {}
+      read_time_(std::move(read_time)),
+      proto_field_path_map_(std::move(proto_field_path_map)) {}
 
 // -------------------------------------------------------
 // LetOp
@@ -705,9 +763,10 @@ class LetOpTupleIterator : public TupleIterator {
 
   std::vector<std::shared_ptr<const TupleData>> all_params_copies =
       DeepCopyTupleDatas(all_params);
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   body()->CreateIterator(StripSharedPtrs(all_params_copies),
-                                          num_extra_slots, context));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      body()->CreateIteratorWithStats(StripSharedPtrs(all_params_copies),
+                                      num_extra_slots, context));
   iter = absl::make_unique<LetOpTupleIterator>(
       std::move(new_params), all_params_copies, std::move(iter));
   return iter;
@@ -812,6 +871,59 @@ absl::Status SortOp::SetSchemasForEvaluation(
 }
 
 namespace {
+// Takes 'tuples' sorted by 'comparator' and scrambles the order of tuples that
+// are equal with respect to 'comparator'.
+absl::Status ScrambleTuplesWithSameKey(const TupleComparator& comparator,
+                                       TupleDataDeque* tuples_deque) {
+  std::vector<std::unique_ptr<TupleData>> tuples;
+  tuples.reserve(tuples_deque->GetSize());
+  while (!tuples_deque->IsEmpty()) {
+    tuples.push_back(tuples_deque->PopFront());
+  }
+  std::vector<int> scrambled_idxs;
+  scrambled_idxs.reserve(tuples.size());
+  for (int start_idx = 0; start_idx < tuples.size();) {
+    const TupleData& start_tuple = *tuples[start_idx];
+    int equal_length = 1;
+    while (start_idx + equal_length < tuples.size()) {
+      const int tuple_idx = start_idx + equal_length;
+      const TupleData& tuple = *tuples[tuple_idx];
+      const bool start_equals_tuple = !comparator(start_tuple, tuple) &&
+                                      !comparator(tuple, start_tuple);
+      if (!start_equals_tuple) {
+        break;
+      }
+      ++equal_length;
+    }
+    // This is similar shuffling logic to ReorderingTupleIterator. It is
+    // needed for backwards compatibility with the text-based reference
+    // implementation compliance tests.
+    for (int range_idx = 0; range_idx < equal_length; ++range_idx) {
+      // Iterates over odd indexes, then even indexes. Example for 5 tuples:
+      // 0 -> 1  // [0 .. size/2) is mapped to odd indexes
+      // 1 -> 3
+      // 2 -> 0  // [size/2 .. size) is mapped to even indexes
+      // 3 -> 2
+      // 4 -> 4
+      const int half_size = equal_length / 2;
+      const int scrambled_range_idx = range_idx < half_size
+                                          ? (range_idx * 2 + 1)
+                                          : 2 * (range_idx - half_size);
+      scrambled_idxs.push_back(start_idx + scrambled_range_idx);
+    }
+    start_idx += equal_length;
+  }
+
+  ZETASQL_RET_CHECK(tuples_deque->IsEmpty());
+  absl::Status status;
+  for (int idx : scrambled_idxs) {
+    if (!tuples_deque->PushBack(std::move(tuples[idx]), &status)) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
 // Takes a list of tuples sorted by 'comparator'. If DisableReordering() is
 // called before Next(), returns them in order. Otherwise, scrambles the order
 // of tuples that are equal with respect to 'comparator'.
@@ -877,53 +989,155 @@ class SortTupleIterator : public TupleIterator {
   // Iterates over 'tuples_' and scrambles the order of tuples with the same
   // key.
   absl::Status ReorderTuplesWithSameKey() {
-    // Scramble the sorted order.
-    std::vector<std::unique_ptr<TupleData>> tuples;
-    tuples.reserve(tuples_->GetSize());
-    while (!tuples_->IsEmpty()) {
-      tuples.push_back(tuples_->PopFront());
-    }
-    std::vector<int> scrambled_idxs;
-    scrambled_idxs.reserve(tuples.size());
-    for (int start_idx = 0; start_idx < tuples.size();) {
-      const TupleData& start_tuple = *tuples[start_idx];
-      int equal_length = 1;
-      while (start_idx + equal_length < tuples.size()) {
-        const int tuple_idx = start_idx + equal_length;
-        const TupleData& tuple = *tuples[tuple_idx];
-        const bool start_equals_tuple = !(*comparator_)(start_tuple, tuple) &&
-                                        !(*comparator_)(tuple, start_tuple);
-        if (!start_equals_tuple) {
-          break;
-        }
-        ++equal_length;
-      }
-      // This is similar shuffling logic to ReorderingTupleIterator. It is
-      // needed for backwards compatibility with the text-based reference
-      // implementation compliance tests.
-      for (int range_idx = 0; range_idx < equal_length; ++range_idx) {
-        // Iterates over odd indexes, then even indexes. Example for 5 tuples:
-        // 0 -> 1  // [0 .. size/2) is mapped to odd indexes
-        // 1 -> 3
-        // 2 -> 0  // [size/2 .. size) is mapped to even indexes
-        // 3 -> 2
-        // 4 -> 4
-        const int half_size = equal_length / 2;
-        const int scrambled_range_idx = range_idx < half_size
-                                            ? (range_idx * 2 + 1)
-                                            : 2 * (range_idx - half_size);
-        scrambled_idxs.push_back(start_idx + scrambled_range_idx);
+    return ScrambleTuplesWithSameKey(*comparator_, tuples_.get());
+  }
+
+  // We store a TupleIterator instead of the debug string to avoid having to
+  // compute the debug string unnecessarily.
+  const std::unique_ptr<TupleIterator> input_iter_for_debug_string_;
+  const std::unique_ptr<const TupleSchema> schema_;
+  const std::unique_ptr<TupleComparator> comparator_;
+  std::unique_ptr<TupleDataDeque> tuples_;
+  int64_t num_next_calls_ = 0;
+  std::unique_ptr<TupleData> current_;
+  EvaluationContext* context_;
+  bool enable_reordering_ = true;
+  absl::Status status_;
+};
+
+// Refers to the first 'num_keys' slots of a TupleData, and hashes and compares
+// as their values.
+struct HashPartitionKey {
+  HashPartitionKey(const TupleData* tuple_in, int num_keys_in)
+      : tuple(tuple_in), num_keys(num_keys_in) {}
+
+  const TupleData* tuple = nullptr;
+  int num_keys = 0;
+
+  bool operator==(const HashPartitionKey& k) const {
+    for (int i = 0; i < num_keys; ++i) {
+      if (tuple->slot(i).value() != k.tuple->slot(i).value()) return false;
+    }
+    return true;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const HashPartitionKey& k) {
+    for (int i = 0; i < k.num_keys; ++i) {
+      h = H::combine(std::move(h), k.tuple->slot(i).value());
+    }
+    return h;
+  }
+};
+
+// Drops the tuples at the end of 'partition' that are not among the first
+// 'limit' tuples. If 'keep_ties' is true, tuples that are equal to the last of
+// the first 'limit' tuples are kept. Otherwise, one more tuple is kept so that
+// the caller can determine whether it is equal to the last of them.
+void DropTuplesBeyondPartitionLimit(int64_t limit, bool keep_ties,
+                                    TupleDataOrderedQueue* partition) {
+  if (!keep_ties) {
+    if (partition->GetSize() > limit + 1) {
+      partition->PopBack();
+    }
+    return;
+  }
+  // The tuples that are equal to the last one are dropped together if more
+  // than 'limit' tuples precede them.
+  while (partition->GetSize() > limit) {
+    const int64_t num_equal_to_back = partition->GetNumEqualToBack();
+    if (partition->GetSize() - num_equal_to_back < limit) break;
+    for (int64_t i = 0; i < num_equal_to_back; ++i) {
+      partition->PopBack();
+    }
+  }
+}
+
+// Returns the tuples of 'partitions' one partition at a time. Unless
+// 'partitions_are_sorted' is true, each partition is sorted by 'comparator'
+// when Next() reaches it. A partition is freed once all of its tuples have
+// been returned. If DisableReordering() is not called before
+// Next(), scrambles the order of tuples in a partition that are equal with
+// respect to 'comparator', unless the order of the partition is unique.
+class HashPartitionedSortTupleIterator : public TupleIterator {
+ public:
+  HashPartitionedSortTupleIterator(
+      std::unique_ptr<TupleIterator> input_iter_for_debug_string,
+      std::unique_ptr<const TupleSchema> schema,
+      std::unique_ptr<TupleComparator> comparator, bool use_stable_sort,
+      bool partitions_are_sorted, std::vector<int> slots_for_values,
+      std::vector<std::unique_ptr<TupleDataDeque>> partitions,
+      EvaluationContext* context)
+      : input_iter_for_debug_string_(std::move(input_iter_for_debug_string)),
+        schema_(std::move(schema)),
+        comparator_(std::move(comparator)),
+        use_stable_sort_(use_stable_sort),
+        partitions_are_sorted_(partitions_are_sorted),
+        slots_for_values_(std::move(slots_for_values)),
+        partitions_(std::move(partitions)),
+        context_(context) {}
+
+  HashPartitionedSortTupleIterator(const HashPartitionedSortTupleIterator&) =
+      delete;
+  HashPartitionedSortTupleIterator& operator=(
+      const HashPartitionedSortTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  TupleData* Next() override {
+    if (num_next_calls_ %
+            absl::GetFlag(
+                FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      status_ = context_->VerifyNotAborted();
+      if (!status_.ok()) {
+        return nullptr;
       }
-      start_idx += equal_length;
     }
+    ++num_next_calls_;
 
-    ZETASQL_RET_CHECK(tuples_->IsEmpty());
-    absl::Status status;
-    for (int idx : scrambled_idxs) {
-      if (!tuples_->PushBack(std::move(tuples[idx]), &status)) {
-        return status;
+    while (current_partition_ == nullptr || current_partition_->IsEmpty()) {
+      if (next_partition_idx_ == partitions_.size()) return nullptr;
+      // This frees the previous partition.
+      current_partition_ = std::move(partitions_[next_partition_idx_]);
+      ++next_partition_idx_;
+      status_ = SortPartition(current_partition_.get());
+      if (!status_.ok()) {
+        return nullptr;
       }
     }
+
+    current_ = current_partition_->PopFront();
+    return current_.get();
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  bool PreservesOrder() const override { return !enable_reordering_; }
+
+  absl::Status DisableReordering() override {
+    ZETASQL_RET_CHECK_EQ(num_next_calls_, 0)
+        << "DisableReordering() cannot be called after Next()";
+    enable_reordering_ = false;
+    return absl::OkStatus();
+  }
+
+  std::string DebugString() const override {
+    return SortOp::GetIteratorDebugString(
+        input_iter_for_debug_string_->DebugString());
+  }
+
+ private:
+  absl::Status SortPartition(TupleDataDeque* partition) const {
+    // Without keys, all the tuples are equal with respect to 'comparator_'.
+    if (!partitions_are_sorted_ && !comparator_->keys().empty()) {
+      partition->Sort(*comparator_, use_stable_sort_);
+    }
+    if (enable_reordering_ &&
+        !comparator_->IsUniquelyOrdered(partition->GetTuplePtrs(),
+                                        slots_for_values_)) {
+      return ScrambleTuplesWithSameKey(*comparator_, partition);
+    }
     return absl::OkStatus();
   }
 
@@ -932,7 +1146,15 @@ class SortTupleIterator : public TupleIterator {
   const std::unique_ptr<TupleIterator> input_iter_for_debug_string_;
   const std::unique_ptr<const TupleSchema> schema_;
   const std::unique_ptr<TupleComparator> comparator_;
-  std::unique_ptr<TupleDataDeque> tuples_;
+  const bool use_stable_sort_;
+  const bool partitions_are_sorted_;
+  const std::vector<int> slots_for_values_;
+  // The partitions in the order in which they are returned. Partitions before
+  // 'next_partition_idx_' have been moved into 'current_partition_' (and
+  // freed).
+  std::vector<std::unique_ptr<TupleDataDeque>> partitions_;
+  int64_t next_partition_idx_ = 0;
+  std::unique_ptr<TupleDataDeque> current_partition_;
   int64_t num_next_calls_ = 0;
   std::unique_ptr<TupleData> current_;
   EvaluationContext* context_;
@@ -990,7 +1212,7 @@ class SortTupleIterator : public TupleIterator {
 
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> input_iter,
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context));
 
   std::vector<int> slots_for_keys;
   slots_for_keys.reserve(keys().size());
@@ -1007,6 +1229,31 @@ class SortTupleIterator : public TupleIterator {
       std::unique_ptr<TupleComparator> comparator,
       TupleComparator::Create(keys(), slots_for_keys, params, context));
 
+  const bool use_hash_partitions =
+      num_hash_partition_keys_ > 0 || partition_limit_.has_value();
+  // If 'use_hash_partitions' is true, 'partitions' contains the rows grouped by
+  // the partitioning keys, and 'partition_idxs' maps the keys of each group to
+  // its index in 'partitions'. The keys refer to the first row of each group,
+  // or to a copy of its keys in 'partition_key_copies' if 'partition_limit_' is
+  // set, because then the first row may be dropped. In that case, the rows are
+  // accumulated in 'limited_partitions' first.
+  std::vector<std::unique_ptr<TupleDataDeque>> partitions;
+  std::vector<std::unique_ptr<TupleDataOrderedQueue>> limited_partitions;
+  std::vector<std::unique_ptr<TupleData>> partition_key_copies;
+  absl::flat_hash_map<HashPartitionKey, int64_t> partition_idxs;
+  // The tuples of a partition are equal with respect to the partitioning keys,
+  // so they only need to be sorted by the remaining keys.
+  std::unique_ptr<TupleComparator> order_comparator;
+  if (use_hash_partitions) {
+    std::vector<int> slots_for_order_keys(
+        slots_for_keys.begin() + num_hash_partition_keys_,
+        slots_for_keys.end());
+    ZETASQL_ASSIGN_OR_RETURN(
+        order_comparator,
+        TupleComparator::Create(keys().subspan(num_hash_partition_keys_),
+                                slots_for_order_keys, params, context));
+  }
+
   // If 'limit_offset' is set, 'top_n_outputs' contains the top
   // 'limit_offset.limit + limit_offset.offset' rows. Otherwise, 'outputs'
   // contains all the rows.
@@ -1050,6 +1297,41 @@ class SortTupleIterator : public TupleIterator {
           limit_offset->offset) {
         top_n_outputs->PopBack();
       }
+    } else if (use_hash_partitions) {
+      HashPartitionKey key(next_output.get(), num_hash_partition_keys_);
+      int64_t partition_idx;
+      auto found = partition_idxs.find(key);
+      if (found != partition_idxs.end()) {
+        partition_idx = found->second;
+      } else if (partition_limit_.has_value()) {
+        partition_idx = limited_partitions.size();
+        auto key_copy = absl::make_unique<TupleData>(num_hash_partition_keys_);
+        for (int i = 0; i < num_hash_partition_keys_; ++i) {
+          key_copy->mutable_slot(i)->SetValue(next_output->slot(i).value());
+        }
+        key = HashPartitionKey(key_copy.get(), num_hash_partition_keys_);
+        partition_key_copies.push_back(std::move(key_copy));
+        limited_partitions.push_back(absl::make_unique<TupleDataOrderedQueue>(
+            *order_comparator, context->memory_accountant()));
+        partition_idxs.emplace(key, partition_idx);
+      } else {
+        partition_idx = partitions.size();
+        partitions.push_back(
+            absl::make_unique<TupleDataDeque>(context->memory_accountant()));
+        partition_idxs.emplace(key, partition_idx);
+      }
+      if (partition_limit_.has_value()) {
+        TupleDataOrderedQueue* partition =
+            limited_partitions[partition_idx].get();
+        if (!partition->Insert(std::move(next_output), &status)) {
+          return status;
+        }
+        DropTuplesBeyondPartitionLimit(
+            partition_limit_.value(), partition_limit_keeps_ties_, partition);
+      } else if (!partitions[partition_idx]->PushBack(std::move(next_output),
+                                                      &status)) {
+        return status;
+      }
     } else {
       if (!outputs->PushBack(std::move(next_output), &status)) {
         return status;
@@ -1057,6 +1339,52 @@ class SortTupleIterator : public TupleIterator {
     }
   }
 
+  if (use_hash_partitions) {
+    ZETASQL_RET_CHECK(!limit_offset.has_value());
+    // Some keys refer to tuples that the iterator frees.
+    partition_idxs.clear();
+    for (std::unique_ptr<TupleDataOrderedQueue>& limited_partition :
+         limited_partitions) {
+      // The queue keeps one tuple beyond the limit if
+      // 'partition_limit_keeps_ties_' is false, which is dropped here.
+      auto partition =
+          absl::make_unique<TupleDataDeque>(context->memory_accountant());
+      const TupleData* last_tuple = nullptr;
+      while (!limited_partition->IsEmpty() &&
+             (partition_limit_keeps_ties_ ||
+              partition->GetSize() < partition_limit_.value())) {
+        std::unique_ptr<TupleData> tuple = limited_partition->PopFront();
+        last_tuple = tuple.get();
+        if (!partition->PushBack(std::move(tuple), &status)) {
+          return status;
+        }
+      }
+      if (!limited_partition->IsEmpty() &&
+          !(*order_comparator)(*last_tuple, *limited_partition->PopFront())) {
+        // The dropped tuple could have been returned instead of 'last_tuple'.
+        context->SetNonDeterministicOutput();
+      }
+      limited_partition.reset();
+      partitions.push_back(std::move(partition));
+    }
+    std::unique_ptr<TupleIterator> iter =
+        absl::make_unique<HashPartitionedSortTupleIterator>(
+            std::move(input_iter), CreateOutputSchema(),
+            std::move(order_comparator),
+            context->options().always_use_stable_sort || is_stable_sort_,
+            /*partitions_are_sorted=*/partition_limit_.has_value(),
+            std::move(slots_for_values), std::move(partitions), context);
+    if (!context->options().scramble_undefined_orderings || is_stable_sort_ ||
+        !is_order_preserving()) {
+      ZETASQL_RETURN_IF_ERROR(iter->DisableReordering());
+    }
+    if (context->options().scramble_undefined_orderings &&
+        !is_order_preserving()) {
+      iter = absl::make_unique<ReorderingTupleIterator>(std::move(iter));
+    }
+    return iter;
+  }
+
   // If there is a limit set, drop the first 'offset' entries from
   // 'top_n_outputs' and dump the rest into 'outputs'.
   bool is_uniquely_ordered;
@@ -1136,6 +1464,14 @@ std::string SortOp::DebugInternal(const std::string& indent,
                                   bool verbose) const {
   return absl::StrCat(
       "SortOp(", is_order_preserving() ? "ordered" : "unordered",
+      num_hash_partition_keys_ > 0
+          ? absl::StrCat(", num_hash_partition_keys=",
+                         num_hash_partition_keys_)
+          : "",
+      partition_limit_.has_value()
+          ? absl::StrCat(", partition_limit=", partition_limit_.value(),
+                         partition_limit_keeps_ties_ ? " with ties" : "")
+          : "",
       ArgDebugString(
           {"keys", "values", "limit", "offset", "input"},
           {kN, kN, has_limit() ? k1 : k0, has_offset() ? k1 : k0, k1}, indent,
@@ -1166,6 +1502,24 @@ SortOp::SortOp(std::vector<std::unique_ptr<KeyArg>> keys,
   SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
 }
 
+absl::Status SortOp::set_num_hash_partition_keys(
+    int num_hash_partition_keys) {
+  ZETASQL_RET_CHECK_GE(num_hash_partition_keys, 0);
+  ZETASQL_RET_CHECK_LE(num_hash_partition_keys, keys().size());
+  ZETASQL_RET_CHECK(num_hash_partition_keys == 0 || !has_limit_);
+  num_hash_partition_keys_ = num_hash_partition_keys;
+  return absl::OkStatus();
+}
+
+absl::Status SortOp::set_partition_limit(int64_t partition_limit,
+                                         bool keep_ties) {
+  ZETASQL_RET_CHECK_GT(partition_limit, 0);
+  ZETASQL_RET_CHECK(!has_limit_);
+  partition_limit_ = partition_limit;
+  partition_limit_keeps_ties_ = keep_ties;
+  return absl::OkStatus();
+}
+
 absl::Span<const KeyArg* const> SortOp::keys() const {
   return GetArgs<KeyArg>(kKey);
 }
@@ -1318,7 +1672,8 @@ class ComputeTupleIterator : public TupleIterator {
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> iter,
-      input()->CreateIterator(params, num_extra_slots + map().size(), context));
+      input()->CreateIteratorWithStats(params, num_extra_slots + map().size(),
+                                       context));
   iter = absl::make_unique<ComputeTupleIterator>(params, map(), std::move(iter),
                                                  CreateOutputSchema(), context);
   return MaybeReorder(std::move(iter), context);
@@ -1451,8 +1806,9 @@ class FilterTupleIterator : public TupleIterator {
 zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> FilterOp::CreateIterator(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   input()->CreateIterator(params, num_extra_slots, context));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      input()->CreateIteratorWithStats(params, num_extra_slots, context));
   iter = absl::make_unique<FilterTupleIterator>(params, predicate(),
                                                 std::move(iter), context);
   return MaybeReorder(std::move(iter), context);
@@ -1637,8 +1993,9 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIterator(
            << "Limit requires non-negative count and offset";
   }
 
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   input()->CreateIterator(params, num_extra_slots, context));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      input()->CreateIteratorWithStats(params, num_extra_slots, context));
   const bool underlying_iter_preserves_order = iter->PreservesOrder();
 
   iter = absl::make_unique<LimitTupleIterator>(count.int64_value(),
@@ -1823,7 +2180,9 @@ const std::string& JoinOp::JoinKindToString(JoinOp::JoinKind kind) {
       {JoinOp::kRightOuterJoin, "RIGHT OUTER"},
       {JoinOp::kFullOuterJoin, "FULL OUTER"},
       {JoinOp::kCrossApply, "CROSS APPLY"},
-      {JoinOp::kOuterApply, "OUTER APPLY"}};
+      {JoinOp::kOuterApply, "OUTER APPLY"},
+      {JoinOp::kSemiJoin, "SEMI"},
+      {JoinOp::kAntiJoin, "ANTI"}};
   return (*join_names)[kind];
 }
 
@@ -1879,6 +2238,8 @@ absl::Status JoinOp::SetSchemasForEvaluation(
     case kLeftOuterJoin:
     case kRightOuterJoin:
     case kFullOuterJoin:
+    case kSemiJoin:
+    case kAntiJoin:
       // Uncorrelated right-hand side.
       ZETASQL_RETURN_IF_ERROR(
           mutable_right_input()->SetSchemasForEvaluation(params_schemas));
@@ -2073,6 +2434,9 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
 
   const TupleSchema& Schema() const override { return *schema_; }
 
+  // Returns the number of distinct keys in the hash table.
+  int64_t num_keys() const { return right_tuple_map_->size(); }
+
   absl::Status ResetForLeftInput(const Tuple* left_input) override {
     if (left_input == nullptr) {
       matching_right_tuple_list_ = absl::nullopt;
@@ -2243,8 +2607,9 @@ absl::Status ExtractFromRelationalOp(
     const RelationalOp* op, absl::Span<const TupleData* const> params,
     EvaluationContext* context, TupleDataDeque* tuples,
     std::unique_ptr<TupleIterator>* iter_for_debug_string) {
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   op->CreateIterator(params, /*num_extra_slots=*/0, context));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      op->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context));
   tuples->Clear();
   absl::Status status;
   while (true) {
@@ -2339,6 +2704,108 @@ class CorrelatedRightInput : public RightInputForJoin {
   std::vector<const TupleData*> tuple_ptrs_;
 };
 
+// Reads all the tuples of 'right_op' for the uncorrelated right-hand side of
+// 'join_op'. If there are hash join equalities, the tuples are hashed on
+// 'right_equality_exprs'.
+zetasql_base::StatusOr<std::unique_ptr<RightInputForJoin>> CreateUncorrelatedRightInput(
+    const RelationalOp* join_op, const RelationalOp* right_op,
+    absl::Span<const ExprArg* const> left_equality_exprs,
+    absl::Span<const ExprArg* const> right_equality_exprs,
+    absl::Span<const TupleData* const> params, EvaluationContext* context) {
+  auto tuples = absl::make_unique<TupleDataDeque>(context->memory_accountant());
+  std::unique_ptr<TupleIterator> iter_for_right_debug_string;
+  ZETASQL_RETURN_IF_ERROR(ExtractFromRelationalOp(right_op, params, context,
+                                          tuples.get(),
+                                          &iter_for_right_debug_string));
+  if (left_equality_exprs.empty()) {
+    return absl::make_unique<UncorrelatedRightInput>(
+        right_op->CreateOutputSchema(), std::move(tuples),
+        std::move(iter_for_right_debug_string));
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<UncorrelatedHashedRightInput> hashed_right_input,
+      UncorrelatedHashedRightInput::Create(
+          params, left_equality_exprs, right_equality_exprs,
+          right_op->CreateOutputSchema(), std::move(tuples),
+          std::move(iter_for_right_debug_string), context));
+  if (context->operator_stats() != nullptr) {
+    context->operator_stats()->AddCounter(join_op, "hash_table_keys",
+                                          hashed_right_input->num_keys());
+  }
+  return std::unique_ptr<RightInputForJoin>(std::move(hashed_right_input));
+}
+
+// Represents the uncorrelated right-hand input side of a semi or anti join,
+// which is only read by the first call to ResetForLeftInput(). Semi and anti
+// joins replace [NOT] EXISTS and IN subqueries, which are not evaluated at all
+// if there are no left tuples, so an error in the right-hand side must not
+// surface in that case either.
+class DeferredRightInput : public RightInputForJoin {
+ public:
+  DeferredRightInput(const RelationalOp* join_op, const RelationalOp* right_op,
+                     absl::Span<const ExprArg* const> left_equality_exprs,
+                     absl::Span<const ExprArg* const> right_equality_exprs,
+                     absl::Span<const TupleData* const> params,
+                     EvaluationContext* context)
+      : join_op_(join_op),
+        right_op_(right_op),
+        left_equality_exprs_(left_equality_exprs),
+        right_equality_exprs_(right_equality_exprs),
+        params_(params.begin(), params.end()),
+        context_(context) {}
+
+  DeferredRightInput(const DeferredRightInput&) = delete;
+  DeferredRightInput& operator=(const DeferredRightInput&) = delete;
+
+  ~DeferredRightInput() override {}
+
+  bool IsCorrelated() const override { return false; }
+
+  const TupleSchema& Schema() const override { return input_->Schema(); }
+
+  absl::Status ResetForLeftInput(const Tuple* left_input) override {
+    if (input_ == nullptr) {
+      ZETASQL_ASSIGN_OR_RETURN(input_, CreateUncorrelatedRightInput(
+                                   join_op_, right_op_, left_equality_exprs_,
+                                   right_equality_exprs_, params_, context_));
+    }
+    return input_->ResetForLeftInput(left_input);
+  }
+
+  int64_t GetNumMatchingTuples() const override {
+    return input_->GetNumMatchingTuples();
+  }
+
+  const TupleData& GetMatchingTuple(int64_t index) const override {
+    return input_->GetMatchingTuple(index);
+  }
+
+  absl::Status RecordMatchingTupleJoined(int64_t index) override {
+    return input_->RecordMatchingTupleJoined(index);
+  }
+
+  zetasql_base::StatusOr<bool> DidMatchingTupleJoin(int64_t index) const override {
+    return input_->DidMatchingTupleJoin(index);
+  }
+
+  std::string DebugString() const override {
+    if (input_ == nullptr) {
+      return right_op_->IteratorDebugString();
+    }
+    return input_->DebugString();
+  }
+
+ private:
+  const RelationalOp* join_op_;
+  const RelationalOp* right_op_;
+  const absl::Span<const ExprArg* const> left_equality_exprs_;
+  const absl::Span<const ExprArg* const> right_equality_exprs_;
+  const std::vector<const TupleData*> params_;
+  EvaluationContext* context_;
+  // NULL until the first call to ResetForLeftInput().
+  std::unique_ptr<RightInputForJoin> input_;
+};
+
 // Takes left tuples, right tuples, and an arbitrary join predicate, and outputs
 // the joined tuples that match the join predicate.
 class JoinTupleIterator : public TupleIterator {
@@ -2418,12 +2885,18 @@ class JoinTupleIterator : public TupleIterator {
         status_ = status_or_joined.status();
         return nullptr;
       }
-      const bool joined = status_or_joined.value();
+      bool joined = status_or_joined.value();
 
       if (!left_padding_right_tuples_ && next_right_tuple_idx_ >= 0 && joined) {
         left_tuple_joined_ = true;
 
-        if (!right_input_->IsCorrelated()) {
+        if (join_kind_ == JoinKind::kSemiJoin ||
+            join_kind_ == JoinKind::kAntiJoin) {
+          // One match decides the left tuple, so skip its remaining right
+          // tuples. Anti join never outputs a matching left tuple.
+          next_right_tuple_idx_ = right_input_->GetNumMatchingTuples() - 1;
+          joined = join_kind_ == JoinKind::kSemiJoin;
+        } else if (!right_input_->IsCorrelated()) {
           absl::Status joined_status =
               right_input_->RecordMatchingTupleJoined(next_right_tuple_idx_);
           if (!joined_status.ok()) {
@@ -2497,7 +2970,8 @@ class JoinTupleIterator : public TupleIterator {
       // output it. Advance to the next left tuple.
       ZETASQL_RET_CHECK(join_kind_ == JoinKind::kLeftOuterJoin ||
                 join_kind_ == JoinKind::kOuterApply ||
-                join_kind_ == JoinKind::kFullOuterJoin)
+                join_kind_ == JoinKind::kFullOuterJoin ||
+                join_kind_ == JoinKind::kAntiJoin)
           << JoinOp::JoinKindToString(join_kind_);
       return AdvanceToNextLeftTupleWithJoinCandidates();
     }
@@ -2595,10 +3069,14 @@ class JoinTupleIterator : public TupleIterator {
       case JoinKind::kInnerJoin:
       case JoinKind::kRightOuterJoin:
       case JoinKind::kCrossApply:
+      case JoinKind::kSemiJoin:
         return true;  // Don't pad with NULLs.
       case JoinKind::kLeftOuterJoin:
       case JoinKind::kOuterApply:
       case JoinKind::kFullOuterJoin:
+      case JoinKind::kAntiJoin:
+        // Anti join outputs the left tuple by itself, which works like
+        // padding it with NULLs for an empty list of right outputs.
         next_right_tuple_idx_ = -1;
         return false;  // Pad with NULLs.
     }
@@ -2616,6 +3094,8 @@ class JoinTupleIterator : public TupleIterator {
       case JoinKind::kLeftOuterJoin:
       case JoinKind::kCrossApply:
       case JoinKind::kOuterApply:
+      case JoinKind::kSemiJoin:
+      case JoinKind::kAntiJoin:
         done_ = true;
         return absl::OkStatus();
       case JoinKind::kRightOuterJoin:
@@ -2717,6 +3197,8 @@ class JoinTupleIterator : public TupleIterator {
       case JoinKind::kCrossApply:
       case JoinKind::kOuterApply:
       case JoinKind::kLeftOuterJoin:
+      case JoinKind::kSemiJoin:
+      case JoinKind::kAntiJoin:
         ZETASQL_RET_CHECK(left_input != nullptr);
         ZETASQL_RET_CHECK_GE(output_tuple_.num_slots(),
                      left_input->schema->num_variables());
@@ -2757,6 +3239,8 @@ class JoinTupleIterator : public TupleIterator {
       case JoinKind::kFullOuterJoin:
       case JoinKind::kLeftOuterJoin:
       case JoinKind::kOuterApply:
+      case JoinKind::kSemiJoin:
+      case JoinKind::kAntiJoin:
         break;
       case JoinKind::kInnerJoin:
       case JoinKind::kRightOuterJoin:
@@ -2845,25 +3329,18 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
     case kLeftOuterJoin:
     case kRightOuterJoin:
     case kFullOuterJoin: {
-      auto tuples =
-          absl::make_unique<TupleDataDeque>(context->memory_accountant());
-      std::unique_ptr<TupleIterator> iter_for_right_debug_string;
-      ZETASQL_RETURN_IF_ERROR(ExtractFromRelationalOp(right_input(), params, context,
-                                              tuples.get(),
-                                              &iter_for_right_debug_string));
-      if (hash_join_equality_left_exprs().empty()) {
-        right_hand_side = absl::make_unique<UncorrelatedRightInput>(
-            right_input()->CreateOutputSchema(), std::move(tuples),
-            std::move(iter_for_right_debug_string));
-      } else {
-        ZETASQL_ASSIGN_OR_RETURN(
-            right_hand_side,
-            UncorrelatedHashedRightInput::Create(
-                params, hash_join_equality_left_exprs(),
-                hash_join_equality_right_exprs(),
-                right_input()->CreateOutputSchema(), std::move(tuples),
-                std::move(iter_for_right_debug_string), context));
-      }
+      ZETASQL_ASSIGN_OR_RETURN(
+          right_hand_side,
+          CreateUncorrelatedRightInput(
+              this, right_input(), hash_join_equality_left_exprs(),
+              hash_join_equality_right_exprs(), params, context));
+      break;
+    }
+    case kSemiJoin:
+    case kAntiJoin: {
+      right_hand_side = absl::make_unique<DeferredRightInput>(
+          this, right_input(), hash_join_equality_left_exprs(),
+          hash_join_equality_right_exprs(), params, context);
       break;
     }
     case kCrossApply:
@@ -2876,7 +3353,8 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
 
   ZETASQL_ASSIGN_OR_RETURN(
       std::unique_ptr<TupleIterator> left_iter,
-      left_input()->CreateIterator(params, /*num_extra_slots=*/0, context));
+      left_input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0,
+                                            context));
 
   std::unique_ptr<TupleIterator> iter = absl::make_unique<JoinTupleIterator>(
       join_kind_, params, remaining_join_expr(), std::move(left_iter),
@@ -2906,6 +3384,8 @@ std::unique_ptr<TupleSchema> JoinOp::CreateOutputSchema() const {
     case JoinOp::kLeftOuterJoin:
     case JoinOp::kCrossApply:
     case JoinOp::kOuterApply:
+    case JoinOp::kSemiJoin:
+    case JoinOp::kAntiJoin:
       output_variables.insert(output_variables.end(),
                               left_schema->variables().begin(),
                               left_schema->variables().end());
@@ -2930,6 +3410,8 @@ std::unique_ptr<TupleSchema> JoinOp::CreateOutputSchema() const {
     case JoinOp::kLeftOuterJoin:
     case JoinOp::kFullOuterJoin:
     case JoinOp::kOuterApply:
+    case JoinOp::kSemiJoin:
+    case JoinOp::kAntiJoin:
       break;
   }
 
@@ -2968,7 +3450,10 @@ std::string JoinOp::DebugInternal(const std::string& indent,
   const ArgPrintMode left_output_mode =
       (join_kind_ == kRightOuterJoin || join_kind_ == kFullOuterJoin) ? kN : k0;
   const ArgPrintMode right_output_mode =
-      (join_kind_ == kInnerJoin || join_kind_ == kCrossApply) ? k0 : kN;
+      (join_kind_ == kInnerJoin || join_kind_ == kCrossApply ||
+       join_kind_ == kSemiJoin || join_kind_ == kAntiJoin)
+          ? k0
+          : kN;
   return absl::StrCat(
       "JoinOp(", JoinKindToString(join_kind_),
       ArgDebugString(*arg_names,
@@ -3297,6 +3782,146 @@ const VariableId& ArrayScanOp::position() const {
                                       : *empty_str;
 }
 
+// -------------------------------------------------------
+// SpoolScanOp
+// -------------------------------------------------------
+
+std::string SpoolScanOp::GetIteratorDebugString(const VariableId& spool) {
+  return absl::StrCat("SpoolScanTupleIterator($", spool.ToString(), ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<SpoolScanOp>> SpoolScanOp::Create(
+    const VariableId& spool, std::vector<std::unique_ptr<ExprArg>> columns) {
+  ZETASQL_RET_CHECK(spool.is_valid());
+  for (const std::unique_ptr<ExprArg>& column : columns) {
+    ZETASQL_RET_CHECK(column->has_variable());
+    ZETASQL_RET_CHECK(!column->has_node());
+  }
+  return absl::WrapUnique(new SpoolScanOp(spool, std::move(columns)));
+}
+
+absl::Status SpoolScanOp::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  // The spool is bound by an enclosing LetOp or LetExpr.
+  for (const TupleSchema* schema : params_schemas) {
+    if (schema->FindIndexForVariable(spool_).has_value()) {
+      return absl::OkStatus();
+    }
+  }
+  ZETASQL_RET_CHECK_FAIL() << "Spool " << spool_ << " is not in scope";
+}
+
+namespace {
+// Returns the rows of a spool. The rows are shared with the EvaluationContext,
+// so the iterator only keeps a position, and copies the slots of the current
+// row into 'current_' (which also has room for the extra slots). Sharing
+// ownership keeps the rows alive if the spool is replaced during the scan.
+class SpoolScanTupleIterator : public TupleIterator {
+ public:
+  SpoolScanTupleIterator(
+      const VariableId& spool,
+      std::shared_ptr<const std::vector<const TupleData*>> rows,
+      std::unique_ptr<TupleSchema> schema, int num_extra_slots,
+      EvaluationContext* context)
+      : spool_(spool),
+        rows_(std::move(rows)),
+        schema_(std::move(schema)),
+        current_(schema_->num_variables() + num_extra_slots),
+        context_(context) {}
+
+  SpoolScanTupleIterator(const SpoolScanTupleIterator&) = delete;
+  SpoolScanTupleIterator& operator=(const SpoolScanTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  TupleData* Next() override {
+    if (next_row_idx_ %
+            absl::GetFlag(
+                FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      absl::Status status = context_->VerifyNotAborted();
+      if (!status.ok()) {
+        status_ = status;
+        return nullptr;
+      }
+    }
+
+    if (next_row_idx_ == rows_->size()) return nullptr;
+    const TupleData* row = (*rows_)[next_row_idx_];
+    for (int i = 0; i < schema_->num_variables(); ++i) {
+      *current_.mutable_slot(i) = row->slot(i);
+    }
+    ++next_row_idx_;
+    return &current_;
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    return SpoolScanOp::GetIteratorDebugString(spool_);
+  }
+
+ private:
+  const VariableId spool_;
+  const std::shared_ptr<const std::vector<const TupleData*>> rows_;
+  const std::unique_ptr<TupleSchema> schema_;
+  TupleData current_;
+  EvaluationContext* context_;
+  int64_t next_row_idx_ = 0;
+  absl::Status status_;
+};
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SpoolScanOp::CreateIterator(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  std::shared_ptr<const std::vector<const TupleData*>> rows =
+      context->GetSpool(spool_);
+  ZETASQL_RET_CHECK(rows != nullptr) << "Spool " << spool_ << " was not computed";
+  if (!rows->empty()) {
+    ZETASQL_RET_CHECK_EQ(rows->front()->num_slots(), columns().size());
+  }
+  std::unique_ptr<TupleIterator> iter =
+      absl::make_unique<SpoolScanTupleIterator>(
+          spool_, std::move(rows), CreateOutputSchema(), num_extra_slots,
+          context);
+  return MaybeReorder(std::move(iter), context);
+}
+
+std::unique_ptr<TupleSchema> SpoolScanOp::CreateOutputSchema() const {
+  std::vector<VariableId> vars;
+  vars.reserve(columns().size());
+  for (const ExprArg* column : columns()) {
+    vars.push_back(column->variable());
+  }
+  return absl::make_unique<TupleSchema>(vars);
+}
+
+std::string SpoolScanOp::IteratorDebugString() const {
+  return GetIteratorDebugString(spool_);
+}
+
+std::string SpoolScanOp::DebugInternal(const std::string& indent,
+                                       bool verbose) const {
+  std::vector<std::string> column_strs;
+  column_strs.reserve(columns().size());
+  for (const ExprArg* column : columns()) {
+    column_strs.push_back(column->DebugInternal(indent, verbose));
+  }
+  return absl::StrCat("SpoolScanOp($", spool_.ToString(), ": ",
+                      absl::StrJoin(column_strs, ", "), ")");
+}
+
+SpoolScanOp::SpoolScanOp(const VariableId& spool,
+                         std::vector<std::unique_ptr<ExprArg>> columns)
+    : spool_(spool) {
+  SetArgs<ExprArg>(kColumn, std::move(columns));
+}
+
+absl::Span<const ExprArg* const> SpoolScanOp::columns() const {
+  return GetArgs<ExprArg>(kColumn);
+}
+
 // -------------------------------------------------------
 // UnionAllOp
 // -------------------------------------------------------
@@ -3451,7 +4076,8 @@ class UnionAllTupleIterator : public TupleIterator {
   for (int i = 0; i < num_rel(); ++i) {
     ZETASQL_ASSIGN_OR_RETURN(
         std::unique_ptr<TupleIterator> iter,
-        rel(i)->CreateIterator(params, /*num_extra_slots=*/0, context));
+        rel(i)->CreateIteratorWithStats(params, /*num_extra_slots=*/0,
+                                        context));
     iters.push_back(std::move(iter));
   }
 
@@ -3538,19 +4164,314 @@ RelationalOp* UnionAllOp::mutable_rel(int i) {
   return GetMutableArg(rel_index(i))->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// SetOperationOp
+// -------------------------------------------------------
+
+const std::string& SetOperationOp::SetOperationTypeToString(
+    SetOperationType type) {
+  static auto* type_names = new std::map<SetOperationType, std::string>{
+      {kIntersectAll, "INTERSECT ALL"},
+      {kIntersectDistinct, "INTERSECT DISTINCT"},
+      {kExceptAll, "EXCEPT ALL"},
+      {kExceptDistinct, "EXCEPT DISTINCT"}};
+  return (*type_names)[type];
+}
+
+std::string SetOperationOp::GetIteratorDebugString(
+    SetOperationType type,
+    absl::Span<const std::string> input_iter_debug_strings) {
+  return absl::StrCat("SetOperationTupleIterator(",
+                      SetOperationTypeToString(type), ", ",
+                      absl::StrJoin(input_iter_debug_strings, ","), ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<SetOperationOp>> SetOperationOp::Create(
+    SetOperationType type, std::vector<Input> inputs) {
+  ZETASQL_RET_CHECK_GE(inputs.size(), 2);
+  for (int i = 0; i < inputs.size(); ++i) {
+    // Check that all output variable names agree.
+    ZETASQL_RET_CHECK_EQ(inputs[i].second.size(), inputs[0].second.size());
+    for (int j = 0; j < inputs[i].second.size(); ++j) {
+      ZETASQL_RET_CHECK_EQ(inputs[i].second[j]->variable(),
+                   inputs[0].second[j]->variable());
+    }
+  }
+  return absl::WrapUnique(new SetOperationOp(type, std::move(inputs)));
+}
+
+absl::Status SetOperationOp::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  for (int i = 0; i < num_rel(); ++i) {
+    RelationalOp* rel = mutable_rel(i);
+    ZETASQL_RETURN_IF_ERROR(rel->SetSchemasForEvaluation(params_schemas));
+    const std::unique_ptr<const TupleSchema> schema = rel->CreateOutputSchema();
+    for (ExprArg* value : mutable_values(i)) {
+      ZETASQL_RETURN_IF_ERROR(value->mutable_value_expr()->SetSchemasForEvaluation(
+          ConcatSpans(params_schemas, {schema.get()})));
+    }
+  }
+  return absl::OkStatus();
+}
+
+namespace {
+// Wraps a const TupleData* but hashes and compares as the underlying
+// TupleData.
+struct TupleDataPtr {
+  explicit TupleDataPtr(const TupleData* data_in) : data(data_in) {}
+
+  const TupleData* data = nullptr;
+
+  bool operator==(const TupleDataPtr& t) const { return *data == *t.data; }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TupleDataPtr& t) {
+    return H::combine(std::move(h), *t.data);
+  }
+};
+
+// Returns the distinct tuples in 'rows' along with the number of times
+// each one is to be output.
+class SetOperationTupleIterator : public TupleIterator {
+ public:
+  SetOperationTupleIterator(std::unique_ptr<TupleSchema> output_schema,
+                            int num_extra_slots,
+                            std::unique_ptr<TupleDataDeque> rows,
+                            std::vector<int64_t> output_counts,
+                            std::string debug_string)
+      : output_schema_(std::move(output_schema)),
+        rows_(std::move(rows)),
+        row_ptrs_(rows_->GetTuplePtrs()),
+        output_counts_(std::move(output_counts)),
+        data_(output_schema_->num_variables() + num_extra_slots),
+        debug_string_(std::move(debug_string)) {}
+
+  SetOperationTupleIterator(const SetOperationTupleIterator&) = delete;
+  SetOperationTupleIterator& operator=(const SetOperationTupleIterator&) =
+      delete;
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    while (row_idx_ < row_ptrs_.size() &&
+           num_outputs_for_row_ >= output_counts_[row_idx_]) {
+      ++row_idx_;
+      num_outputs_for_row_ = 0;
+    }
+    if (row_idx_ == row_ptrs_.size()) {
+      // Free the hash table for other operators.
+      row_ptrs_.clear();
+      rows_->Clear();
+      return nullptr;
+    }
+    if (num_outputs_for_row_ == 0) {
+      const TupleData& row = *row_ptrs_[row_idx_];
+      for (int i = 0; i < row.num_slots(); ++i) {
+        *data_.mutable_slot(i) = row.slot(i);
+      }
+    }
+    ++num_outputs_for_row_;
+    return &data_;
+  }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+
+  std::string DebugString() const override { return debug_string_; }
+
+ private:
+  const std::unique_ptr<TupleSchema> output_schema_;
+  std::unique_ptr<TupleDataDeque> rows_;
+  // The TupleDatas owned by 'rows_'.
+  std::vector<const TupleData*> row_ptrs_;
+  // The number of times to output each element of 'row_ptrs_'.
+  const std::vector<int64_t> output_counts_;
+  int64_t row_idx_ = 0;
+  int64_t num_outputs_for_row_ = 0;
+  TupleData data_;
+  const std::string debug_string_;
+};
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SetOperationOp::CreateIterator(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  std::unique_ptr<TupleSchema> output_schema = CreateOutputSchema();
+  const int num_variables = output_schema->num_variables();
+
+  // Distinct output tuples of the first input, in the order of their first
+  // occurrence, and the indexes of these tuples in 'rows'.
+  auto rows = absl::make_unique<TupleDataDeque>(context->memory_accountant());
+  absl::flat_hash_map<TupleDataPtr, int64_t> row_indexes;
+  // For the first input, the number of occurrences of each row. Afterwards,
+  // the number of times to output each row given the inputs seen so far.
+  std::vector<int64_t> output_counts;
+  // The number of occurrences of each row in the current input.
+  std::vector<int64_t> input_counts;
+
+  std::vector<std::string> iter_debug_strings;
+  iter_debug_strings.reserve(num_rel());
+  TupleData row(num_variables);
+  for (int i = 0; i < num_rel(); ++i) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleIterator> iter,
+        rel(i)->CreateIteratorWithStats(params, /*num_extra_slots=*/0,
+                                        context));
+    iter_debug_strings.push_back(iter->DebugString());
+    absl::Span<const ExprArg* const> input_values = values(i);
+    input_counts.assign(output_counts.size(), 0);
+    while (true) {
+      const TupleData* input_data = iter->Next();
+      if (input_data == nullptr) {
+        ZETASQL_RETURN_IF_ERROR(iter->Status());
+        break;
+      }
+      for (int j = 0; j < num_variables; ++j) {
+        absl::Status status;
+        if (!input_values[j]->value_expr()->EvalSimple(
+                ConcatSpans(params, {input_data}), context,
+                row.mutable_slot(j), &status)) {
+          return status;
+        }
+      }
+      const auto it = row_indexes.find(TupleDataPtr(&row));
+      if (it != row_indexes.end()) {
+        ++(i == 0 ? output_counts : input_counts)[it->second];
+      } else if (i == 0) {
+        auto new_row = absl::make_unique<TupleData>(row);
+        const TupleData* new_row_ptr = new_row.get();
+        absl::Status status;
+        if (!rows->PushBack(std::move(new_row), &status)) {
+          return status;
+        }
+        row_indexes.emplace(TupleDataPtr(new_row_ptr), output_counts.size());
+        output_counts.push_back(1);
+      }
+      // Rows that are not in the first input do not contribute to the output.
+    }
+    if (i == 0) continue;
+
+    for (int64_t r = 0; r < output_counts.size(); ++r) {
+      switch (type_) {
+        case kIntersectAll:
+        case kIntersectDistinct:
+          output_counts[r] = std::min(output_counts[r], input_counts[r]);
+          break;
+        case kExceptAll:
+          output_counts[r] = std::max<int64_t>(
+              0, output_counts[r] - input_counts[r]);
+          break;
+        case kExceptDistinct:
+          if (input_counts[r] > 0) output_counts[r] = 0;
+          break;
+      }
+    }
+  }
+  if (type_ == kIntersectDistinct || type_ == kExceptDistinct) {
+    for (int64_t& count : output_counts) {
+      count = std::min<int64_t>(count, 1);
+    }
+  }
+
+  if (context->operator_stats() != nullptr) {
+    context->operator_stats()->AddCounter(this, "hash_table_keys",
+                                          row_indexes.size());
+  }
+
+  std::unique_ptr<TupleIterator> iter =
+      absl::make_unique<SetOperationTupleIterator>(
+          std::move(output_schema), num_extra_slots, std::move(rows),
+          std::move(output_counts),
+          GetIteratorDebugString(type_, iter_debug_strings));
+  return MaybeReorder(std::move(iter), context);
+}
+
+std::unique_ptr<TupleSchema> SetOperationOp::CreateOutputSchema() const {
+  std::vector<VariableId> variables;
+  variables.reserve(values(0).size());
+  for (const ExprArg* value : values(0)) {
+    variables.push_back(value->variable());
+  }
+  return absl::make_unique<TupleSchema>(variables);
+}
+
+std::string SetOperationOp::IteratorDebugString() const {
+  std::vector<std::string> iter_strings;
+  iter_strings.reserve(num_rel());
+  for (int i = 0; i < num_rel(); ++i) {
+    iter_strings.push_back(rel(i)->IteratorDebugString());
+  }
+  return GetIteratorDebugString(type_, iter_strings);
+}
+
+std::string SetOperationOp::DebugInternal(const std::string& indent,
+                                          bool verbose) const {
+  std::vector<std::string> srels;
+  for (int i = 0; i < num_rel(); i++) {
+    std::vector<std::string> sterm;
+    std::string indent_input = indent + kIndentFork;
+    std::string indent_child = indent;
+    if (i < num_rel() - 1) {
+      absl::StrAppend(&indent_child, kIndentBar);
+    } else {
+      // No tree line is required beside the last child.
+      absl::StrAppend(&indent_child, kIndentSpace);
+    }
+    for (auto ch : values(i)) {
+      sterm.push_back(indent_child + kIndentFork +
+                      ch->DebugInternal(indent_child, verbose));
+    }
+    std::string srel;
+    absl::StrAppend(&srel, indent_input, "rel[", i, "]: {");
+    absl::StrAppend(&srel, absl::StrJoin(sterm, ","), ",");
+    absl::StrAppend(&srel, indent_child + kIndentFork, "input: ",
+                    rel(i)->DebugInternal(indent_child + kIndentSpace, verbose),
+                    "}");
+    srels.push_back(srel);
+  }
+  return absl::StrCat("SetOperationOp(", SetOperationTypeToString(type_), ",",
+                      absl::StrJoin(srels, ","), ")");
+}
+
+SetOperationOp::SetOperationOp(SetOperationType type, std::vector<Input> inputs)
+    : type_(type), num_rel_(inputs.size()) {
+  for (int i = 0; i < inputs.size(); i++) {
+    SetArg(rel_index(i),
+           absl::make_unique<RelationalArg>(std::move(inputs[i].first)));
+    SetArgs<ExprArg>(terms_index(i), std::move(inputs[i].second));
+  }
+}
+
+absl::Span<const ExprArg* const> SetOperationOp::values(int i) const {
+  return GetArgs<ExprArg>(terms_index(i));
+}
+
+absl::Span<ExprArg* const> SetOperationOp::mutable_values(int i) {
+  return GetMutableArgs<ExprArg>(terms_index(i));
+}
+
+const RelationalOp* SetOperationOp::rel(int i) const {
+  return GetArg(rel_index(i))->node()->AsRelationalOp();
+}
+
+RelationalOp* SetOperationOp::mutable_rel(int i) {
+  return GetMutableArg(rel_index(i))->mutable_node()->AsMutableRelationalOp();
+}
+
 // -------------------------------------------------------
 // LoopOp
 // -------------------------------------------------------
 zetasql_base::StatusOr<std::unique_ptr<LoopOp>> LoopOp::Create(
     std::vector<std::unique_ptr<ExprArg>> initial_assign,
     std::unique_ptr<RelationalOp> body,
-    std::vector<std::unique_ptr<ExprArg>> loop_assign) {
+    std::vector<std::unique_ptr<ExprArg>> loop_assign, bool distinct_rows) {
   // Make sure all variable targets of <loop_assign> are in <initial_assign>
   // and populate loop_assign_indexes_.
   absl::flat_hash_map<VariableId, int> varid_to_index;
   for (const std::unique_ptr<ExprArg>& arg : initial_assign) {
     ZETASQL_RET_CHECK(!varid_to_index.contains(arg->variable()))
         << "Duplicate variable " << arg->variable() << " in <initial_assign>";
+    ZETASQL_RET_CHECK(!distinct_rows || arg->type()->IsArray())
+        << "Variable " << arg->variable() << " must be an array";
     varid_to_index[arg->variable()] = static_cast<int>(varid_to_index.size());
   }
 
@@ -3563,16 +4484,17 @@ zetasql_base::StatusOr<std::unique_ptr<LoopOp>> LoopOp::Create(
         << " in <loop_assign>, but not <initial_assign>";
     loop_assign_indexes.push_back(it->second);
   }
-  return absl::WrapUnique(new LoopOp(std::move(initial_assign), std::move(body),
-                                     std::move(loop_assign),
-                                     std::move(loop_assign_indexes)));
+  return absl::WrapUnique(new LoopOp(
+      std::move(initial_assign), std::move(body), std::move(loop_assign),
+      std::move(loop_assign_indexes), distinct_rows));
 }
 
 LoopOp::LoopOp(std::vector<std::unique_ptr<ExprArg>> initial_assign,
                std::unique_ptr<RelationalOp> body,
                std::vector<std::unique_ptr<ExprArg>> loop_assign,
-               std::vector<int> loop_assign_indexes)
-    : loop_assign_indexes_(std::move(loop_assign_indexes)) {
+               std::vector<int> loop_assign_indexes, bool distinct_rows)
+    : loop_assign_indexes_(std::move(loop_assign_indexes)),
+      distinct_rows_(distinct_rows) {
   SetArgs(kInitialAssign, std::move(initial_assign));
   SetArg(kBody, std::make_unique<RelationalArg>(std::move(body)));
   SetArgs(kLoopAssign, std::move(loop_assign));
@@ -3586,7 +4508,7 @@ zetasql_base::StatusOr<int> LoopOp::GetVariableIndexFromLoopAssignIndex(int i) c
 
 std::string LoopOp::DebugInternal(const std::string& indent,
                                   bool verbose) const {
-  return absl::StrCat("LoopOp(",
+  return absl::StrCat("LoopOp(", distinct_rows_ ? "distinct_rows" : "",
                       ArgDebugString({"initial_assign", "body", "loop_assign"},
                                      {kN, k1, kN}, indent, verbose),
                       ")");
@@ -3684,6 +4606,10 @@ namespace {
 // iterator eventually either fails or completes without producing any new
 // tuples.
 //
+// If op_->distinct_rows() is true, each newly assigned variable is reduced to
+// the array elements not seen in that variable before, which are recorded in
+// 'seen_rows_'.
+//
 // While LoopTupleOperator does not contain any explicit checks to cut off
 // runaway iteration, it is expected that inner evaluations will eventually
 // start failing when memory limits are reached as a result of producing too
@@ -3727,7 +4653,15 @@ class LoopTupleIterator : public TupleIterator {
                         {loop_variables_.get()})),
         num_extra_slots_(num_extra_slots),
         context_(context),
-        output_schema_(op_->CreateOutputSchema()) {}
+        output_schema_(op_->CreateOutputSchema()) {
+    if (op_->distinct_rows()) {
+      seen_rows_.reserve(op_->num_variables());
+      for (int i = 0; i < op_->num_variables(); ++i) {
+        seen_rows_.push_back(
+            absl::make_unique<ValueHashSet>(context_->memory_accountant()));
+      }
+    }
+  }
 
   // Returns the next tuple in the enumeration(), nullptr if enumeration is
   // complete, or a failed status if an error occurs.
@@ -3746,6 +4680,7 @@ class LoopTupleIterator : public TupleIterator {
                 loop_variables_->mutable_slot(i), &status)) {
           return status;
         }
+        ZETASQL_RETURN_IF_ERROR(RemoveSeenRows(i));
       }
       ZETASQL_ASSIGN_OR_RETURN(data, BeginNextIteration());
       return data;
@@ -3773,6 +4708,34 @@ class LoopTupleIterator : public TupleIterator {
               loop_variables_->mutable_slot(var_index), &status)) {
         return status;
       }
+      ZETASQL_RETURN_IF_ERROR(RemoveSeenRows(var_index));
+    }
+    return absl::OkStatus();
+  }
+
+  // If op_->distinct_rows() is true, removes the elements of the array in
+  // loop variable 'var_index' that were already seen in that variable, and
+  // records the remaining ones as seen.
+  absl::Status RemoveSeenRows(int var_index) {
+    if (!op_->distinct_rows()) return absl::OkStatus();
+    TupleSlot* slot = loop_variables_->mutable_slot(var_index);
+    const Value& rows = slot->value();
+    if (rows.is_null()) return absl::OkStatus();
+
+    std::vector<Value> new_rows;
+    for (int i = 0; i < rows.num_elements(); ++i) {
+      const Value& row = rows.element(i);
+      bool inserted;
+      absl::Status status;
+      if (!seen_rows_[var_index]->Insert(row, &inserted, &status)) {
+        return status;
+      }
+      if (inserted) new_rows.push_back(row);
+    }
+    if (new_rows.size() < rows.num_elements()) {
+      slot->SetValue(InternalValue::ArrayNotChecked(
+          rows.type()->AsArray(), InternalValue::order_kind(rows),
+          std::move(new_rows)));
     }
     return absl::OkStatus();
   }
@@ -3786,9 +4749,9 @@ class LoopTupleIterator : public TupleIterator {
   //  - An error status if an error occurred.
   zetasql_base::StatusOr<TupleData*> BeginNextIteration() {
     // Create a new iterator for the body
-    ZETASQL_ASSIGN_OR_RETURN(iter_,
-                     op_->body()->CreateIterator(params_and_loop_variables_,
-                                                 num_extra_slots_, context_));
+    ZETASQL_ASSIGN_OR_RETURN(iter_, op_->body()->CreateIteratorWithStats(
+                                 params_and_loop_variables_, num_extra_slots_,
+                                 context_));
 
     // Fetch the first TupleData of the next iteration
     TupleData* data = iter_->Next();
@@ -3808,7 +4771,7 @@ class LoopTupleIterator : public TupleIterator {
   // Contains a copy of params passed to constructor with <variables_> appended.
   const std::vector<const TupleData*> params_and_loop_variables_;
 
-  // Passed down into CreateIterator() on the loop body.
+  // Passed down into CreateIteratorWithStats() on the loop body.
   const int num_extra_slots_;
 
   // EvaluationContext, passed down into child evaluations.
@@ -3825,6 +4788,10 @@ class LoopTupleIterator : public TupleIterator {
 
   // Current status of loop iteration.
   absl::Status status_;
+
+  // For each loop variable, the rows assigned to it so far. Only populated if
+  // op_->distinct_rows() is true.
+  std::vector<std::unique_ptr<ValueHashSet>> seen_rows_;
 };
 
 }  // namespace
@@ -3852,7 +4819,7 @@ absl::Status RootOp::SetSchemasForEvaluation(
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RootOp::CreateIterator(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
-  return input()->CreateIterator(params, num_extra_slots, context);
+  return input()->CreateIteratorWithStats(params, num_extra_slots, context);
 }
 
 std::unique_ptr<TupleSchema> RootOp::CreateOutputSchema() const {
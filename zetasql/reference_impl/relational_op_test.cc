@@ -689,7 +689,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOp) {
       auto scan_op,
       EvaluatorTableScanOp::Create(&table, /*alias=*/"", {2, 3, 1},
                                    {"column2", "column3", "column1"}, {x, y, z},
-                                   /*and_filters=*/{}, /*read_time=*/nullptr));
+                                   /*and_filters=*/{}, /*read_time=*/nullptr,
+                                   /*proto_field_path_map=*/{}));
   EXPECT_EQ(scan_op->IteratorDebugString(),
             "EvaluatorTableTupleIterator(TestTable)");
   EXPECT_EQ(scan_op->DebugString(),
@@ -755,7 +756,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpWithColumnFilter) {
       auto scan_op,
       EvaluatorTableScanOp::Create(
           &table, /*alias=*/"", {2, 3, 1}, {"column2", "column3", "column1"},
-          {x, y, z}, std::move(and_filters), /*read_time=*/nullptr));
+          {x, y, z}, std::move(and_filters), /*read_time=*/nullptr,
+          /*proto_field_path_map=*/{}));
   EXPECT_EQ(scan_op->IteratorDebugString(),
             "EvaluatorTableTupleIterator(TestTable)");
   EXPECT_EQ(scan_op->DebugString(),
@@ -785,6 +787,58 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpWithColumnFilter) {
                   IsTupleSlotWith(Int64(100), IsNull()), _));
 }
 
+TEST_F(CreateIteratorTest, EvaluatorTableScanOpWithProtoFieldPaths) {
+  VariableId x("x"), y("y");
+  SimpleTable table("TestTable", {{"column0", types::Int64Type()},
+                                  {"column1", proto_type_}});
+  table.SetContents({{Int64(10), GetProtoValue(0)}});
+
+  const google::protobuf::Descriptor* descriptor = proto_type_->descriptor();
+  const google::protobuf::FieldDescriptor* nested_value =
+      descriptor->FindFieldByName("nested_value");
+  absl::flat_hash_map<int, std::vector<ProtoFieldPath>> proto_field_path_map;
+  proto_field_path_map[1] = {
+      {descriptor->FindFieldByName("int64_key_2")},
+      {nested_value,
+       nested_value->message_type()->FindFieldByName("nested_int64")}};
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto scan_op,
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0, 1},
+                                   {"column0", "column1"}, {x, y},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr,
+                                   std::move(proto_field_path_map)));
+  EXPECT_EQ(scan_op->DebugString(),
+            "EvaluatorTableScanOp(\n"
+            "+-column0#0\n"
+            "+-column1#1\n"
+            "+-proto_fields(column1#1): int64_key_2, "
+            "nested_value.nested_int64\n"
+            "+-table: TestTable)");
+
+  // SimpleTable ignores the field paths and returns the whole proto.
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      scan_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 1);
+  EXPECT_THAT(data[0].slots(),
+              ElementsAre(IsTupleSlotWith(Int64(10), IsNull()),
+                          IsTupleSlotWith(GetProtoValue(0), _)));
+
+  // Column indexes in the map must refer to columns of the scan.
+  absl::flat_hash_map<int, std::vector<ProtoFieldPath>> bad_map;
+  bad_map[2] = {{descriptor->FindFieldByName("int64_key_2")}};
+  EXPECT_THAT(
+      EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0, 1},
+                                   {"column0", "column1"}, {x, y},
+                                   /*and_filters=*/{}, /*read_time=*/nullptr,
+                                   std::move(bad_map)),
+      StatusIs(absl::StatusCode::kInternal));
+}
+
 TEST_F(CreateIteratorTest, EvaluatorTableScanOpFailure) {
   const std::string error = "Failed to read row from TestTable";
   const absl::Status failure = zetasql_base::OutOfRangeErrorBuilder() << error;
@@ -795,7 +849,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpFailure) {
       auto scan_op, EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0},
                                                  {"column0"}, {VariableId("x")},
                                                  /*and_filters=*/{},
-                                                 /*read_time=*/nullptr));
+                                                 /*read_time=*/nullptr,
+                                                 /*proto_field_path_map=*/{}));
 
   EvaluationContext context((EvaluationOptions()));
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -823,7 +878,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpCancellation) {
       auto scan_op, EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0},
                                                  {"column0"}, {VariableId("x")},
                                                  /*and_filters=*/{},
-                                                 /*read_time=*/nullptr));
+                                                 /*read_time=*/nullptr,
+                                                 /*proto_field_path_map=*/{}));
 
   EvaluationContext context((EvaluationOptions()));
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -857,7 +913,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpDeadlineExceeded) {
       auto scan_op, EvaluatorTableScanOp::Create(&table, /*alias=*/"", {0},
                                                  {"column0"}, {VariableId("x")},
                                                  /*and_filters=*/{},
-                                                 /*read_time=*/nullptr));
+                                                 /*read_time=*/nullptr,
+                                                 /*proto_field_path_map=*/{}));
 
   EvaluationContext context((EvaluationOptions()));
   context.SetClockAndClearCurrentTimestamp(&clock);
@@ -2377,6 +2434,179 @@ TEST_F(CreateIteratorTest, FullOuterHashJoin) {
                        HasSubstr("Out of memory")));
 }
 
+TEST_F(CreateIteratorTest, SemiAndAntiHashJoin) {
+  VariableId x("x"), y("y"), a("a"), b("b");
+
+  for (JoinOp::JoinKind join_kind : {JoinOp::kSemiJoin, JoinOp::kAntiJoin}) {
+    SCOPED_TRACE(JoinOp::JoinKindToString(join_kind));
+    auto input1 = absl::WrapUnique(new TestRelationalOp(
+        {x},
+        CreateTestTupleDatas({{Int64(1)},
+                              {Int64(2)},
+                              {Int64(2)},
+                              {Int64(3)},
+                              {NullInt64()}}),
+        /*preserves_order=*/true));
+    auto input2 = absl::WrapUnique(new TestRelationalOp(
+        {y},
+        CreateTestTupleDatas(
+            {{Int64(1)}, {Int64(1)}, {Int64(2)}, {NullInt64()}}),
+        /*preserves_order=*/true));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+    JoinOp::HashJoinEqualityExprs equality_expr;
+    equality_expr.left_expr = absl::make_unique<ExprArg>(a, std::move(deref_x));
+    equality_expr.right_expr =
+        absl::make_unique<ExprArg>(b, std::move(deref_y));
+    std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs;
+    equality_exprs.push_back(std::move(equality_expr));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        auto join_op,
+        JoinOp::Create(join_kind, std::move(equality_exprs),
+                       std::move(true_expr), std::move(input1),
+                       std::move(input2),
+                       /*left_outputs=*/{}, /*right_outputs=*/{}));
+    const std::string join_kind_string = JoinOp::JoinKindToString(join_kind);
+    EXPECT_EQ(absl::StrCat("JoinOp(", join_kind_string,
+                           "\n"
+                           "+-hash_join_equality_left_exprs: {\n"
+                           "| +-$a := $x},\n"
+                           "+-hash_join_equality_right_exprs: {\n"
+                           "| +-$b := $y},\n"
+                           "+-remaining_condition: ConstExpr(true),\n"
+                           "+-left_input: TestRelationalOp,\n"
+                           "+-right_input: TestRelationalOp)"),
+              join_op->DebugString());
+    std::unique_ptr<TupleSchema> output_schema = join_op->CreateOutputSchema();
+    EXPECT_THAT(output_schema->variables(), ElementsAre(x));
+
+    ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                         join_op->CreateIterator(
+                             EmptyParams(), /*num_extra_slots=*/1, &context));
+    EXPECT_EQ(iter->DebugString(),
+              absl::StrCat("JoinTupleIterator(", join_kind_string,
+                           ", left=TestTupleIterator, "
+                           "right=TestTupleIterator)"));
+    EXPECT_TRUE(iter->PreservesOrder());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    // Each left tuple is returned at most once, even if it has several
+    // matches, and NULL never matches.
+    std::vector<Value> expected_values;
+    if (join_kind == JoinOp::kSemiJoin) {
+      expected_values = {Int64(1), Int64(2), Int64(2)};
+    } else {
+      expected_values = {Int64(3), NullInt64()};
+    }
+    ASSERT_EQ(data.size(), expected_values.size());
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(data[i].slots(),
+                  ElementsAre(IsTupleSlotWith(expected_values[i], IsNull()), _));
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, SemiAndAntiJoinWithoutEqualities) {
+  VariableId x("x"), y("y");
+
+  for (JoinOp::JoinKind join_kind : {JoinOp::kSemiJoin, JoinOp::kAntiJoin}) {
+    for (bool empty_right_input : {false, true}) {
+      SCOPED_TRACE(absl::StrCat(JoinOp::JoinKindToString(join_kind),
+                                " empty_right_input=", empty_right_input));
+      auto input1 = absl::WrapUnique(new TestRelationalOp(
+          {x}, CreateTestTupleDatas({{Int64(1)}, {Int64(2)}}),
+          /*preserves_order=*/true));
+      auto input2 = absl::WrapUnique(new TestRelationalOp(
+          {y},
+          empty_right_input ? std::vector<TupleData>()
+                            : CreateTestTupleDatas({{Int64(1)}, {Int64(2)}}),
+          /*preserves_order=*/true));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          auto join_op,
+          JoinOp::Create(join_kind, /*equality_exprs=*/{},
+                         std::move(true_expr), std::move(input1),
+                         std::move(input2),
+                         /*left_outputs=*/{}, /*right_outputs=*/{}));
+      ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+      EvaluationContext context((EvaluationOptions()));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                           join_op->CreateIterator(
+                               EmptyParams(), /*num_extra_slots=*/0, &context));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                           ReadFromTupleIterator(iter.get()));
+      // Every left tuple matches all right tuples, if there are any.
+      const bool expect_left_tuples =
+          empty_right_input == (join_kind == JoinOp::kAntiJoin);
+      if (expect_left_tuples) {
+        ASSERT_EQ(data.size(), 2);
+        EXPECT_THAT(data[0].slots(),
+                    ElementsAre(IsTupleSlotWith(Int64(1), IsNull())));
+        EXPECT_THAT(data[1].slots(),
+                    ElementsAre(IsTupleSlotWith(Int64(2), IsNull())));
+      } else {
+        EXPECT_TRUE(data.empty());
+      }
+    }
+  }
+}
+
+TEST_F(CreateIteratorTest, SemiAndAntiJoinReadRightInputOnlyForLeftTuples) {
+  VariableId x("x"), y("y");
+
+  for (JoinOp::JoinKind join_kind : {JoinOp::kSemiJoin, JoinOp::kAntiJoin}) {
+    for (bool empty_left_input : {false, true}) {
+      SCOPED_TRACE(absl::StrCat(JoinOp::JoinKindToString(join_kind),
+                                " empty_left_input=", empty_left_input));
+      auto input1 = absl::WrapUnique(new TestRelationalOp(
+          {x},
+          empty_left_input ? std::vector<TupleData>()
+                           : CreateTestTupleDatas({{Int64(1)}}),
+          /*preserves_order=*/true));
+      auto input2 = absl::WrapUnique(new TestRelationalOp(
+          {y},
+          CreateTestTupleDatas(
+              {{Int64(1)}, {Int64(2)}, {Int64(3)}, {Int64(4)}}),
+          /*preserves_order=*/true));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          auto join_op,
+          JoinOp::Create(join_kind, /*equality_exprs=*/{},
+                         std::move(true_expr), std::move(input1),
+                         std::move(input2),
+                         /*left_outputs=*/{}, /*right_outputs=*/{}));
+      ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+      // Loading the right-hand side into memory fails, which must not
+      // matter if there are no left tuples, just like an EXISTS subquery is
+      // not evaluated for an empty input.
+      EvaluationContext memory_context(GetIntermediateMemoryEvaluationOptions(
+          /*total_bytes=*/100));
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          std::unique_ptr<TupleIterator> iter,
+          join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                  &memory_context));
+      absl::Status status;
+      const std::vector<TupleData> data =
+          ReadFromTupleIteratorFull(iter.get(), &status);
+      EXPECT_TRUE(data.empty());
+      if (empty_left_input) {
+        ZETASQL_EXPECT_OK(status);
+      } else {
+        EXPECT_THAT(status, StatusIs(absl::StatusCode::kResourceExhausted,
+                                     HasSubstr("Out of memory")));
+      }
+    }
+  }
+}
+
 TEST_F(CreateIteratorTest, SortOpTotalOrder) {
   VariableId a("a"), b("b"), c("c"), param("param"), k("k"), v1("v1"), v2("v2"),
       v3("v3");
@@ -2848,6 +3078,158 @@ TEST_F(CreateIteratorTest, SortOpPartialOrderStableSort) {
   EXPECT_EQ(data[3].num_slots(), 2);
 }
 
+TEST_F(CreateIteratorTest, SortOpHashPartitioned) {
+  VariableId a("a"), b("b"), c("c"), p("p"), o("o"), v("v");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  keys.push_back(
+      absl::make_unique<KeyArg>(p, std::move(deref_a), KeyArg::kAscending));
+  keys.push_back(
+      absl::make_unique<KeyArg>(o, std::move(deref_b), KeyArg::kDescending));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, Int64Type()));
+
+  std::vector<std::unique_ptr<ExprArg>> values;
+  values.push_back(absl::make_unique<ExprArg>(v, std::move(deref_c)));
+
+  auto input = absl::WrapUnique(new TestRelationalOp(
+      {a, b, c},
+      CreateTestTupleDatas({{Int64(2), Int64(30), Int64(1)},
+                            {Int64(1), Int64(10), Int64(2)},
+                            {Int64(2), Int64(10), Int64(3)},
+                            {Int64(1), Int64(20), Int64(4)},
+                            {Int64(2), Int64(20), Int64(5)},
+                            {Int64(1), Int64(10), Int64(6)}}),
+      /*preserves_order=*/true));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sort_op,
+      SortOp::Create(std::move(keys), std::move(values),
+                     /*limit=*/nullptr, /*offset=*/nullptr, std::move(input),
+                     /*is_order_preserving=*/true,
+                     /*is_stable_sort=*/true));
+  EXPECT_FALSE(sort_op->set_num_hash_partition_keys(3).ok());
+  ZETASQL_ASSERT_OK(sort_op->set_num_hash_partition_keys(1));
+  ZETASQL_ASSERT_OK(sort_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EXPECT_EQ(
+      "SortOp(ordered, num_hash_partition_keys=1\n"
+      "+-keys: {\n"
+      "| +-$p := $a ASC,\n"
+      "| +-$o := $b DESC},\n"
+      "+-values: {\n"
+      "| +-$v := $c},\n"
+      "+-input: TestRelationalOp)",
+      sort_op->DebugString());
+
+  EvaluationContext scramble_context((GetScramblingEvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                              &scramble_context));
+  EXPECT_EQ(iter->DebugString(), "SortTupleIterator(TestTupleIterator)");
+  // The partitions are returned in the order in which they first appear in the
+  // input, and each one is sorted by the remaining key. Ties are broken by the
+  // input order because the sort is stable.
+  EXPECT_TRUE(iter->PreservesOrder());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  EXPECT_TRUE(scramble_context.IsDeterministicOutput());
+  ASSERT_EQ(data.size(), 6);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(), "<p:2,o:30,v:1>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(), "<p:2,o:20,v:5>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[2]).DebugString(), "<p:2,o:10,v:3>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[3]).DebugString(), "<p:1,o:20,v:4>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[4]).DebugString(), "<p:1,o:10,v:2>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[5]).DebugString(), "<p:1,o:10,v:6>");
+  for (const TupleData& tuple : data) {
+    EXPECT_EQ(tuple.num_slots(), 4);
+  }
+}
+
+TEST_F(CreateIteratorTest, SortOpHashPartitionedWithPartitionLimit) {
+  VariableId a("a"), b("b"), c("c"), p("p"), o("o"), v("v");
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_b, DerefExpr::Create(b, Int64Type()));
+
+  std::vector<std::unique_ptr<KeyArg>> keys;
+  keys.push_back(
+      absl::make_unique<KeyArg>(p, std::move(deref_a), KeyArg::kAscending));
+  keys.push_back(
+      absl::make_unique<KeyArg>(o, std::move(deref_b), KeyArg::kDescending));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, Int64Type()));
+
+  std::vector<std::unique_ptr<ExprArg>> values;
+  values.push_back(absl::make_unique<ExprArg>(v, std::move(deref_c)));
+
+  auto input = absl::WrapUnique(new TestRelationalOp(
+      {a, b, c},
+      CreateTestTupleDatas({{Int64(1), Int64(10), Int64(1)},
+                            {Int64(2), Int64(5), Int64(2)},
+                            {Int64(1), Int64(30), Int64(3)},
+                            {Int64(1), Int64(20), Int64(4)},
+                            {Int64(1), Int64(20), Int64(5)},
+                            {Int64(2), Int64(7), Int64(6)}}),
+      /*preserves_order=*/true));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto sort_op,
+      SortOp::Create(std::move(keys), std::move(values),
+                     /*limit=*/nullptr, /*offset=*/nullptr, std::move(input),
+                     /*is_order_preserving=*/true,
+                     /*is_stable_sort=*/false));
+  ZETASQL_ASSERT_OK(sort_op->set_num_hash_partition_keys(1));
+  EXPECT_FALSE(sort_op->set_partition_limit(0, /*keep_ties=*/false).ok());
+  ZETASQL_ASSERT_OK(sort_op->set_partition_limit(2, /*keep_ties=*/false));
+  ZETASQL_ASSERT_OK(sort_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EXPECT_EQ(
+      "SortOp(ordered, num_hash_partition_keys=1, partition_limit=2\n"
+      "+-keys: {\n"
+      "| +-$p := $a ASC,\n"
+      "| +-$o := $b DESC},\n"
+      "+-values: {\n"
+      "| +-$v := $c},\n"
+      "+-input: TestRelationalOp)",
+      sort_op->DebugString());
+
+  // Like ROW_NUMBER() <= 2. The third row of the first partition is dropped
+  // even though it is tied with the second one, which makes the output
+  // non-deterministic.
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  EXPECT_FALSE(context.IsDeterministicOutput());
+  ASSERT_EQ(data.size(), 4);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(), "<p:1,o:30,v:3>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(), "<p:1,o:20,v:4>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[2]).DebugString(), "<p:2,o:7,v:6>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[3]).DebugString(), "<p:2,o:5,v:2>");
+
+  // Like RANK() <= 2. Rows tied with the second row are kept.
+  ZETASQL_ASSERT_OK(sort_op->set_partition_limit(2, /*keep_ties=*/true));
+  EvaluationContext ties_context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                    &ties_context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, ReadFromTupleIterator(iter.get()));
+  EXPECT_TRUE(ties_context.IsDeterministicOutput());
+  ASSERT_EQ(data.size(), 5);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(), "<p:1,o:30,v:3>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(), "<p:1,o:20,v:4>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[2]).DebugString(), "<p:1,o:20,v:5>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[3]).DebugString(), "<p:2,o:7,v:6>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[4]).DebugString(), "<p:2,o:5,v:2>");
+}
+
 // Tests the reordering functionality in SortTupleIterator.
 TEST_F(CreateIteratorTest, SortOpPartialInputReordersTest) {
   const int num_keys = 10;
@@ -3171,6 +3553,152 @@ TEST_F(CreateIteratorTest, ArrayScanOpNonDeterministic) {
   EXPECT_FALSE(context.IsDeterministicOutput());
 }
 
+TEST_F(CreateIteratorTest, SpoolScanOp) {
+  VariableId a("a"), b("b"), t("t"), x("x"), y("y");
+  std::vector<TupleData> test_values =
+      CreateTestTupleDatas({{Int64(1), Int64(10)}, {Int64(2), Int64(20)}});
+  auto input = absl::WrapUnique(
+      new TestRelationalOp({a, b}, test_values, /*preserves_order=*/true));
+
+  // Only 'b' is spooled.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto spool_expr,
+                       SpoolExpr::Create(t, {b}, std::move(input)));
+  std::vector<std::unique_ptr<ExprArg>> x_columns;
+  x_columns.push_back(absl::make_unique<ExprArg>(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto scan_x,
+                       SpoolScanOp::Create(t, std::move(x_columns)));
+  std::vector<std::unique_ptr<ExprArg>> y_columns;
+  y_columns.push_back(absl::make_unique<ExprArg>(y, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto scan_y,
+                       SpoolScanOp::Create(t, std::move(y_columns)));
+  EXPECT_EQ(spool_expr->DebugString(),
+            "SpoolExpr($t: $b\n"
+            "+-input: TestRelationalOp)");
+  EXPECT_EQ(scan_x->DebugString(), "SpoolScanOp($t: $x)");
+  EXPECT_EQ(scan_x->IteratorDebugString(), "SpoolScanTupleIterator($t)");
+  EXPECT_THAT(scan_x->CreateOutputSchema()->variables(), ElementsAre(x));
+
+  // The spool must be in scope.
+  TupleSchema empty_schema({});
+  EXPECT_THAT(scan_x->SetSchemasForEvaluation({&empty_schema}),
+              StatusIs(absl::StatusCode::kInternal));
+  TupleSchema spool_schema({t});
+  ZETASQL_ASSERT_OK(spool_expr->SetSchemasForEvaluation({}));
+  ZETASQL_ASSERT_OK(scan_x->SetSchemasForEvaluation({&spool_schema}));
+  ZETASQL_ASSERT_OK(scan_y->SetSchemasForEvaluation({&spool_schema}));
+
+  EvaluationContext context((EvaluationOptions()));
+  TupleData spool_data(/*num_slots=*/1);
+  EXPECT_THAT(scan_x->CreateIterator({&spool_data}, /*num_extra_slots=*/0,
+                                     &context),
+              StatusIs(absl::StatusCode::kInternal));
+
+  absl::Status status;
+  ASSERT_TRUE(spool_expr->EvalSimple({}, &context,
+                                     spool_data.mutable_slot(0), &status))
+      << status;
+  EXPECT_EQ(spool_data.slot(0).value(), Int64(2));
+  const int64_t spool_bytes = context.memory_accountant()->num_bytes_in_use();
+  EXPECT_GT(spool_bytes, 0);
+
+  // Interleave two cursors over the same spool.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter_x,
+                       scan_x->CreateIterator({&spool_data},
+                                              /*num_extra_slots=*/1, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter_y,
+                       scan_y->CreateIterator({&spool_data},
+                                              /*num_extra_slots=*/0, &context));
+  EXPECT_EQ(iter_x->DebugString(), "SpoolScanTupleIterator($t)");
+  const TupleData* data = iter_x->Next();
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(Tuple(&iter_x->Schema(), data).DebugString(), "<x:10>");
+  EXPECT_EQ(data->num_slots(), 2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> y_data,
+                       ReadFromTupleIterator(iter_y.get()));
+  ASSERT_EQ(y_data.size(), 2);
+  EXPECT_EQ(Tuple(&iter_y->Schema(), &y_data[0]).DebugString(), "<y:10>");
+  EXPECT_EQ(Tuple(&iter_y->Schema(), &y_data[1]).DebugString(), "<y:20>");
+  data = iter_x->Next();
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(Tuple(&iter_x->Schema(), data).DebugString(), "<x:20>");
+  EXPECT_EQ(iter_x->Next(), nullptr);
+  ZETASQL_EXPECT_OK(iter_x->Status());
+
+  // Re-evaluating the SpoolExpr replaces the spool instead of adding to it.
+  // The iterators share ownership of the old rows, so release them first.
+  iter_x.reset();
+  iter_y.reset();
+  ASSERT_TRUE(spool_expr->EvalSimple({}, &context,
+                                     spool_data.mutable_slot(0), &status))
+      << status;
+  EXPECT_EQ(context.memory_accountant()->num_bytes_in_use(), spool_bytes);
+
+  // The spooled rows are charged to the memory accountant.
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 1;
+  EvaluationContext memory_context(options);
+  EXPECT_FALSE(spool_expr->EvalSimple({}, &memory_context,
+                                      spool_data.mutable_slot(0), &status));
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kResourceExhausted,
+                               HasSubstr("Out of memory")));
+}
+
+TEST_F(CreateIteratorTest, SpoolScanOpWhileSpoolsAreSet) {
+  VariableId t("t"), x("x");
+  std::vector<std::unique_ptr<ExprArg>> x_columns;
+  x_columns.push_back(absl::make_unique<ExprArg>(x, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto scan_x,
+                       SpoolScanOp::Create(t, std::move(x_columns)));
+  TupleSchema spool_schema({t});
+  ZETASQL_ASSERT_OK(scan_x->SetSchemasForEvaluation({&spool_schema}));
+
+  EvaluationContext context((EvaluationOptions()));
+  auto set_spool = [&context](const VariableId& spool,
+                              const std::vector<TupleData>& rows) {
+    auto deque =
+        absl::make_unique<TupleDataDeque>(context.memory_accountant());
+    absl::Status status;
+    for (const TupleData& row : rows) {
+      CHECK(deque->PushBack(absl::make_unique<TupleData>(row), &status))
+          << status;
+    }
+    context.SetSpool(spool, std::move(deque));
+  };
+  set_spool(t, CreateTestTupleDatas({{Int64(1)}, {Int64(2)}}));
+
+  TupleData spool_data(/*num_slots=*/1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                       scan_x->CreateIterator({&spool_data},
+                                              /*num_extra_slots=*/0, &context));
+  const TupleData* data = iter->Next();
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(Tuple(&iter->Schema(), data).DebugString(), "<x:1>");
+
+  // Evaluating a subquery with its own WITH tables in the middle of the scan
+  // adds more spools, which may move the existing entries, and evaluating the
+  // same WITH table again replaces the spool. Neither affects the scan.
+  for (int i = 0; i < 100; ++i) {
+    set_spool(VariableId(absl::StrCat("s", i)),
+              CreateTestTupleDatas({{Int64(i)}}));
+  }
+  set_spool(t, CreateTestTupleDatas({{Int64(3)}}));
+
+  data = iter->Next();
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(Tuple(&iter->Schema(), data).DebugString(), "<x:2>");
+  EXPECT_EQ(iter->Next(), nullptr);
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  // A new scan reads the replacement.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter,
+                       scan_x->CreateIterator({&spool_data},
+                                              /*num_extra_slots=*/0, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> rows,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(Tuple(&iter->Schema(), &rows[0]).DebugString(), "<x:3>");
+}
+
 TEST_F(CreateIteratorTest, ScanArrayOfStructs) {
   VariableId x("x"), v1("v1"), v2("v2");
   ZETASQL_ASSERT_OK_AND_ASSIGN(
@@ -3377,6 +3905,111 @@ TEST_F(CreateIteratorTest, UnionAllOp) {
   EXPECT_FALSE(iter->PreservesOrder());
 }
 
+TEST_F(CreateIteratorTest, SetOperationOp) {
+  VariableId a("a"), a1("a1"), a2("a2");
+
+  const auto create_set_op = [&](SetOperationOp::SetOperationType type)
+      -> zetasql_base::StatusOr<std::unique_ptr<SetOperationOp>> {
+    std::vector<SetOperationOp::Input> inputs(2);
+    inputs[0].first = absl::WrapUnique(new TestRelationalOp(
+        {a1},
+        CreateTestTupleDatas({{Int64(1)},
+                              {Int64(1)},
+                              {Int64(1)},
+                              {Int64(2)},
+                              {NullInt64()},
+                              {NullInt64()},
+                              {Int64(3)}}),
+        /*preserves_order=*/true));
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_a1, DerefExpr::Create(a1, Int64Type()));
+    inputs[0].second.push_back(
+        absl::make_unique<ExprArg>(a, std::move(deref_a1)));
+
+    inputs[1].first = absl::WrapUnique(new TestRelationalOp(
+        {a2},
+        CreateTestTupleDatas({{Int64(4)},
+                              {Int64(2)},
+                              {NullInt64()},
+                              {Int64(1)},
+                              {Int64(2)}}),
+        /*preserves_order=*/true));
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_a2, DerefExpr::Create(a2, Int64Type()));
+    inputs[1].second.push_back(
+        absl::make_unique<ExprArg>(a, std::move(deref_a2)));
+    return SetOperationOp::Create(type, std::move(inputs));
+  };
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SetOperationOp> set_op,
+                       create_set_op(SetOperationOp::kExceptAll));
+  EXPECT_EQ(
+      "SetOperationOp(EXCEPT ALL,\n"
+      "+-rel[0]: {\n"
+      "| +-$a := $a1,\n"
+      "| +-input: TestRelationalOp},\n"
+      "+-rel[1]: {\n"
+      "  +-$a := $a2,\n"
+      "  +-input: TestRelationalOp})",
+      set_op->DebugString());
+  EXPECT_EQ(set_op->IteratorDebugString(),
+            "SetOperationTupleIterator(EXCEPT ALL, "
+            "TestTupleIterator,TestTupleIterator)");
+  std::unique_ptr<TupleSchema> output_schema = set_op->CreateOutputSchema();
+  EXPECT_THAT(output_schema->variables(), ElementsAre(a));
+
+  // Rows are returned in the order of their first occurrence in the first
+  // input.
+  const std::vector<
+      std::pair<SetOperationOp::SetOperationType, std::vector<Value>>>
+      test_cases = {
+          {SetOperationOp::kIntersectAll, {Int64(1), Int64(2), NullInt64()}},
+          {SetOperationOp::kIntersectDistinct,
+           {Int64(1), Int64(2), NullInt64()}},
+          {SetOperationOp::kExceptAll,
+           {Int64(1), Int64(1), NullInt64(), Int64(3)}},
+          {SetOperationOp::kExceptDistinct, {Int64(3)}}};
+  for (const auto& test_case : test_cases) {
+    SCOPED_TRACE(SetOperationOp::SetOperationTypeToString(test_case.first));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(set_op, create_set_op(test_case.first));
+    ZETASQL_ASSERT_OK(set_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TupleIterator> iter,
+                         set_op->CreateIterator(
+                             EmptyParams(), /*num_extra_slots=*/1, &context));
+    EXPECT_EQ(iter->DebugString(),
+              absl::StrCat("SetOperationTupleIterator(",
+                           SetOperationOp::SetOperationTypeToString(
+                               test_case.first),
+                           ", TestTupleIterator,TestTupleIterator)"));
+    EXPECT_TRUE(iter->PreservesOrder());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                         ReadFromTupleIterator(iter.get()));
+    ASSERT_EQ(data.size(), test_case.second.size());
+    for (int i = 0; i < data.size(); ++i) {
+      EXPECT_THAT(data[i].slots(),
+                  ElementsAre(IsTupleSlotWith(test_case.second[i], IsNull()),
+                              _));
+    }
+
+    // Check that scrambling works.
+    EvaluationContext scramble_context(GetScramblingEvaluationOptions());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(iter, set_op->CreateIterator(EmptyParams(),
+                                                      /*num_extra_slots=*/1,
+                                                      &scramble_context));
+    EXPECT_FALSE(iter->PreservesOrder());
+    ZETASQL_ASSERT_OK_AND_ASSIGN(data, ReadFromTupleIterator(iter.get()));
+    EXPECT_EQ(data.size(), test_case.second.size());
+
+    // Check that if the memory bound is too low, we get an error.
+    EvaluationContext memory_context(GetIntermediateMemoryEvaluationOptions(
+        /*total_bytes=*/1));
+    EXPECT_THAT(set_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/1,
+                                       &memory_context),
+                StatusIs(absl::StatusCode::kResourceExhausted,
+                         HasSubstr("Out of memory")));
+  }
+}
+
 TEST_F(CreateIteratorTest, LoopOp) {
   VariableId a("a"), x("x"), y("y"), z("z");
 
@@ -3513,6 +4146,102 @@ LoopOp(
                           IsTupleSlotWith(Int64(26), IsNull()), _));
 }
 
+TEST_F(CreateIteratorTest, LoopOpDistinctRows) {
+  // Follows the cycle 0 -> 1 -> 2 -> 0, which only terminates because rows
+  // that were already produced are dropped.
+  VariableId r("r"), a("a"), b("b"), c("c");
+
+  std::vector<std::unique_ptr<ExprArg>> initial_assign(1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      initial_assign[0],
+      AssignValueToVar(r, Value::Array(Int64ArrayType(),
+                                       {Int64(0), Int64(0), Int64(1)})));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_body_r,
+                       DerefExpr::Create(r, Int64ArrayType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto body,
+                       ArrayScanOp::Create(a, VariableId(), /*fields=*/{},
+                                           std::move(deref_body_r)));
+
+  // $r := ARRAY(SELECT MOD($a + 1, 3) FROM UNNEST($r) AS a)
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_loop_r,
+                       DerefExpr::Create(r, Int64ArrayType()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto scan_r,
+                       ArrayScanOp::Create(a, VariableId(), /*fields=*/{},
+                                           std::move(deref_loop_r)));
+  std::vector<std::unique_ptr<ValueExpr>> mod_args(2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(mod_args[0], DerefExpr::Create(b, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(mod_args[1], ConstExpr::Create(Int64(3)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto mod_expr,
+      ScalarFunctionCallExpr::Create(
+          CreateFunction(FunctionKind::kMod, Int64Type()), std::move(mod_args)));
+  std::vector<std::unique_ptr<ExprArg>> map(2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(map[0], ComputeSum(a, Int64(1), b));
+  map[1] = absl::make_unique<ExprArg>(c, std::move(mod_expr));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto compute_op,
+                       ComputeOp::Create(std::move(map), std::move(scan_r)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_c, DerefExpr::Create(c, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto nest_expr,
+      ArrayNestExpr::Create(Int64ArrayType(), std::move(deref_c),
+                            std::move(compute_op), /*is_with_table=*/false));
+  std::vector<std::unique_ptr<ExprArg>> loop_assign;
+  loop_assign.push_back(absl::make_unique<ExprArg>(r, std::move(nest_expr)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto loop_op,
+      LoopOp::Create(std::move(initial_assign), std::move(body),
+                     std::move(loop_assign), /*distinct_rows=*/true));
+  EXPECT_EQ(loop_op->DebugString(), absl::StripAsciiWhitespace(R"(
+LoopOp(distinct_rows
++-initial_assign: {
+| +-$r := ConstExpr([0, 0, 1])},
++-body: ArrayScanOp(
+| +-$a := element,
+| +-array: $r),
++-loop_assign: {
+  +-$r := ArrayNestExpr(is_with_table=0
+  +-element: $c,
+  +-input: ComputeOp(
+    +-map: {
+    | +-$b := Add($a, ConstExpr(1)),
+    | +-$c := Mod($b, ConstExpr(3))},
+    +-input: ArrayScanOp(
+      +-$a := element,
+      +-array: $r)))})
+  )"));
+
+  TupleSchema params_schema({});
+  ZETASQL_ASSERT_OK(loop_op->SetSchemasForEvaluation({&params_schema}));
+  TupleData params_data = CreateTestTupleData({});
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      loop_op->CreateIterator({&params_data}, /*num_extra_slots=*/0, &context));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 3);
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[0]).DebugString(), "<a:0>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[1]).DebugString(), "<a:1>");
+  EXPECT_EQ(Tuple(&iter->Schema(), &data[2]).DebugString(), "<a:2>");
+  iter.reset();
+  EXPECT_EQ(context.memory_accountant()->num_bytes_in_use(), 0);
+
+  // The rows seen so far are charged to the memory accountant.
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 1;
+  EvaluationContext memory_context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter,
+                       loop_op->CreateIterator({&params_data},
+                                               /*num_extra_slots=*/0,
+                                               &memory_context));
+  EXPECT_THAT(ReadFromTupleIterator(iter.get()),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("Out of memory")));
+}
+
 TEST_F(CreateIteratorTest, ComputeOp) {
   VariableId a("a"), b("b"), param("param"), minus("minus"), plus("plus");
   std::vector<TupleData> test_values =
@@ -0,0 +1,702 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/functions/hash.h"
+#include "zetasql/public/type.h"
+#include "absl/base/casts.h"
+#include "absl/memory/memory.h"
+#include "zetasql/base/bits.h"
+#include "zetasql/base/endian.h"
+#include "zetasql/base/status_builder.h"
+
+namespace zetasql {
+
+namespace {
+
+// The first two bytes of every serialized sketch.
+constexpr char kHllMagic = 'H';
+constexpr char kKllMagic = 'K';
+constexpr char kFormatVersion = 1;
+
+constexpr int kHllSparseRepresentation = 0;
+constexpr int kHllDenseRepresentation = 1;
+// Number of bits of a sparse entry that hold the register value.
+constexpr int kHllRegisterBits = 6;
+
+// Capacities of KLL compactors shrink by this factor per level below the top.
+constexpr double kKllCapacityFactor = 2.0 / 3.0;
+constexpr int64_t kKllMinCapacity = 2;
+constexpr int64_t kKllMinK = 8;
+constexpr int64_t kKllMaxK = 1 << 16;
+constexpr int kKllMaxLevels = 62;
+
+void AppendUint8(uint8_t value, std::string* out) {
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendUint32(uint32_t value, std::string* out) {
+  value = zetasql_base::LittleEndian::FromHost32(value);
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendUint64(uint64_t value, std::string* out) {
+  value = zetasql_base::LittleEndian::FromHost64(value);
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads little-endian values from the front of a serialized sketch.
+class SketchReader {
+ public:
+  explicit SketchReader(absl::string_view bytes) : bytes_(bytes) {}
+
+  bool ReadUint8(uint8_t* value) {
+    if (bytes_.empty()) return false;
+    *value = static_cast<uint8_t>(bytes_[0]);
+    bytes_.remove_prefix(1);
+    return true;
+  }
+
+  bool ReadUint32(uint32_t* value) {
+    if (bytes_.size() < sizeof(*value)) return false;
+    memcpy(value, bytes_.data(), sizeof(*value));
+    *value = zetasql_base::LittleEndian::ToHost32(*value);
+    bytes_.remove_prefix(sizeof(*value));
+    return true;
+  }
+
+  bool ReadUint64(uint64_t* value) {
+    if (bytes_.size() < sizeof(*value)) return false;
+    memcpy(value, bytes_.data(), sizeof(*value));
+    *value = zetasql_base::LittleEndian::ToHost64(*value);
+    bytes_.remove_prefix(sizeof(*value));
+    return true;
+  }
+
+  // Reads the magic and version bytes.
+  bool ReadHeader(char magic) {
+    uint8_t actual_magic, version;
+    return ReadUint8(&actual_magic) && actual_magic == magic &&
+           ReadUint8(&version) && version == kFormatVersion;
+  }
+
+  absl::string_view remaining() const { return bytes_; }
+
+ private:
+  absl::string_view bytes_;
+};
+
+uint64_t Fingerprint(absl::string_view bytes) {
+  return absl::bit_cast<uint64_t>(functions::FarmFingerprint(bytes));
+}
+
+uint64_t FingerprintUint64(uint64_t value) {
+  value = zetasql_base::LittleEndian::FromHost64(value);
+  return Fingerprint(
+      absl::string_view(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+// Returns the register value for the bits that follow the index bits of a
+// hash: one more than the number of leading zeros in <bits>, which holds
+// <num_bits> significant bits in its high end.
+uint8_t RegisterValue(uint64_t bits, int num_bits) {
+  const int leading_zeros = zetasql_base::Bits::CountLeadingZeros64(bits);
+  return static_cast<uint8_t>(std::min(leading_zeros, num_bits) + 1);
+}
+
+// Returns the register value at a lower precision for a register at a
+// higher precision, where <dropped_index_bits> are the <num_dropped> index
+// bits that become part of the remaining hash bits.
+uint8_t ReducedRegisterValue(uint32_t dropped_index_bits, int num_dropped,
+                             uint8_t value) {
+  if (dropped_index_bits != 0) {
+    return static_cast<uint8_t>(
+        zetasql_base::Bits::CountLeadingZeros32(dropped_index_bits) -
+        (32 - num_dropped) + 1);
+  }
+  return static_cast<uint8_t>(num_dropped + value);
+}
+
+absl::Status InvalidSketchError(absl::string_view sketch_kind) {
+  return ::zetasql_base::OutOfRangeErrorBuilder()
+         << "Invalid " << sketch_kind << " sketch";
+}
+
+}  // namespace
+
+uint64_t HashValueForSketch(const Value& value) {
+  DCHECK(!value.is_null());
+  switch (value.type_kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_BOOL:
+    case TYPE_DATE:
+    case TYPE_ENUM:
+      return FingerprintUint64(absl::bit_cast<uint64_t>(value.ToInt64()));
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+      return FingerprintUint64(value.ToUint64());
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE: {
+      double d = value.type_kind() == TYPE_FLOAT ? value.float_value()
+                                                 : value.double_value();
+      // Values that are equal for grouping must have the same hash.
+      if (d == 0) {
+        d = 0;
+      } else if (std::isnan(d)) {
+        d = std::numeric_limits<double>::quiet_NaN();
+      }
+      return FingerprintUint64(absl::bit_cast<uint64_t>(d));
+    }
+    case TYPE_STRING:
+      return Fingerprint(value.string_value());
+    case TYPE_BYTES:
+      return Fingerprint(value.bytes_value());
+    case TYPE_NUMERIC:
+      return Fingerprint(value.numeric_value().SerializeAsProtoBytes());
+    case TYPE_BIGNUMERIC:
+      return Fingerprint(value.bignumeric_value().SerializeAsProtoBytes());
+    default:
+      return FingerprintUint64(value.HashCode());
+  }
+}
+
+HllSketch::HllSketch(int precision) : precision_(precision) {
+  DCHECK_GE(precision, kMinPrecision);
+  DCHECK_LE(precision, kMaxPrecision);
+}
+
+void HllSketch::AddHash(uint64_t hash) {
+  if (is_sparse()) {
+    const uint32_t index = hash >> (64 - kSparsePrecision);
+    const uint8_t value =
+        RegisterValue(hash << kSparsePrecision, 64 - kSparsePrecision);
+    sparse_buffer_.push_back((index << kHllRegisterBits) | value);
+    if (sparse_buffer_.size() >= std::max(64, (1 << precision_) / 16)) {
+      FlushSparseBuffer();
+    }
+  } else {
+    const uint32_t index = hash >> (64 - precision_);
+    const uint8_t value = RegisterValue(hash << precision_, 64 - precision_);
+    registers_[index] = std::max(registers_[index], value);
+  }
+}
+
+// Sorts <entries> and keeps the largest value for each sparse index.
+static void SortAndDedupSparseEntries(std::vector<uint32_t>* entries) {
+  std::sort(entries->begin(), entries->end());
+  // Entries with the same index are ordered by value, so keep the last one.
+  size_t num_kept = 0;
+  for (size_t i = 0; i < entries->size(); ++i) {
+    if (i + 1 < entries->size() && ((*entries)[i] >> kHllRegisterBits) ==
+                                       ((*entries)[i + 1] >> kHllRegisterBits)) {
+      continue;
+    }
+    (*entries)[num_kept++] = (*entries)[i];
+  }
+  entries->resize(num_kept);
+}
+
+void HllSketch::FlushSparseBuffer() {
+  if (!sparse_buffer_.empty()) {
+    sparse_.insert(sparse_.end(), sparse_buffer_.begin(),
+                   sparse_buffer_.end());
+    sparse_buffer_.clear();
+    SortAndDedupSparseEntries(&sparse_);
+  }
+  // Sparse entries take 4 bytes and dense registers 1 byte.
+  if (sparse_.size() > (1 << precision_) / 4) {
+    ConvertToDense();
+  }
+}
+
+void HllSketch::AddSparseEntryToRegisters(uint32_t entry) {
+  const int num_dropped = kSparsePrecision - precision_;
+  const uint32_t sparse_index = entry >> kHllRegisterBits;
+  const uint8_t sparse_value = entry & ((1 << kHllRegisterBits) - 1);
+  const uint32_t index = sparse_index >> num_dropped;
+  const uint8_t value = ReducedRegisterValue(
+      sparse_index & ((1u << num_dropped) - 1), num_dropped, sparse_value);
+  registers_[index] = std::max(registers_[index], value);
+}
+
+void HllSketch::ConvertToDense() {
+  if (!is_sparse()) return;
+  registers_.assign(1 << precision_, 0);
+  for (uint32_t entry : sparse_) {
+    AddSparseEntryToRegisters(entry);
+  }
+  for (uint32_t entry : sparse_buffer_) {
+    AddSparseEntryToRegisters(entry);
+  }
+  std::vector<uint32_t>().swap(sparse_);
+  std::vector<uint32_t>().swap(sparse_buffer_);
+}
+
+void HllSketch::ReducePrecision(int precision) {
+  DCHECK_LE(precision, precision_);
+  if (precision == precision_) return;
+  if (!is_sparse()) {
+    const int num_dropped = precision_ - precision;
+    std::vector<uint8_t> registers(1 << precision, 0);
+    for (uint32_t i = 0; i < registers_.size(); ++i) {
+      if (registers_[i] == 0) continue;
+      uint8_t& reduced = registers[i >> num_dropped];
+      reduced = std::max(
+          reduced, ReducedRegisterValue(i & ((1u << num_dropped) - 1),
+                                        num_dropped, registers_[i]));
+    }
+    registers_.swap(registers);
+  }
+  // Sparse entries do not depend on the precision.
+  precision_ = precision;
+  if (is_sparse()) {
+    FlushSparseBuffer();
+  }
+}
+
+void HllSketch::Merge(const HllSketch& other) {
+  ReducePrecision(std::min(precision_, other.precision_));
+  if (is_sparse() && other.is_sparse()) {
+    sparse_buffer_.insert(sparse_buffer_.end(), other.sparse_.begin(),
+                          other.sparse_.end());
+    sparse_buffer_.insert(sparse_buffer_.end(), other.sparse_buffer_.begin(),
+                          other.sparse_buffer_.end());
+    FlushSparseBuffer();
+    return;
+  }
+  ConvertToDense();
+  if (other.is_sparse()) {
+    for (uint32_t entry : other.sparse_) {
+      AddSparseEntryToRegisters(entry);
+    }
+    for (uint32_t entry : other.sparse_buffer_) {
+      AddSparseEntryToRegisters(entry);
+    }
+    return;
+  }
+  const int num_dropped = other.precision_ - precision_;
+  for (uint32_t i = 0; i < other.registers_.size(); ++i) {
+    if (other.registers_[i] == 0) continue;
+    uint8_t& value = registers_[i >> num_dropped];
+    value = std::max(value, num_dropped == 0
+                                ? other.registers_[i]
+                                : ReducedRegisterValue(
+                                      i & ((1u << num_dropped) - 1),
+                                      num_dropped, other.registers_[i]));
+  }
+}
+
+int64_t HllSketch::Estimate() const {
+  if (is_sparse()) {
+    std::vector<uint32_t> entries = sparse_;
+    entries.insert(entries.end(), sparse_buffer_.begin(),
+                   sparse_buffer_.end());
+    SortAndDedupSparseEntries(&entries);
+    // Linear counting over the sparse registers.
+    const double m = static_cast<double>(1 << kSparsePrecision);
+    return std::llround(m * std::log(m / (m - entries.size())));
+  }
+
+  const double m = static_cast<double>(registers_.size());
+  double sum = 0;
+  int64_t num_zeros = 0;
+  for (uint8_t value : registers_) {
+    sum += std::ldexp(1.0, -value);
+    if (value == 0) ++num_zeros;
+  }
+  const double alpha = 0.7213 / (1 + 1.079 / m);
+  const double estimate = alpha * m * m / sum;
+  if (estimate <= 2.5 * m && num_zeros > 0) {
+    return std::llround(m * std::log(m / num_zeros));
+  }
+  return std::llround(estimate);
+}
+
+std::string HllSketch::Serialize() const {
+  std::string out;
+  out.push_back(kHllMagic);
+  out.push_back(kFormatVersion);
+  AppendUint8(precision_, &out);
+  if (is_sparse()) {
+    std::vector<uint32_t> entries = sparse_;
+    entries.insert(entries.end(), sparse_buffer_.begin(),
+                   sparse_buffer_.end());
+    SortAndDedupSparseEntries(&entries);
+    AppendUint8(kHllSparseRepresentation, &out);
+    AppendUint32(entries.size(), &out);
+    for (uint32_t entry : entries) {
+      AppendUint32(entry, &out);
+    }
+  } else {
+    AppendUint8(kHllDenseRepresentation, &out);
+    out.append(reinterpret_cast<const char*>(registers_.data()),
+               registers_.size());
+  }
+  return out;
+}
+
+zetasql_base::StatusOr<std::unique_ptr<HllSketch>> HllSketch::Deserialize(
+    absl::string_view bytes) {
+  SketchReader reader(bytes);
+  uint8_t precision, representation;
+  if (!reader.ReadHeader(kHllMagic) || !reader.ReadUint8(&precision) ||
+      precision < kMinPrecision || precision > kMaxPrecision ||
+      !reader.ReadUint8(&representation)) {
+    return InvalidSketchError("HLL");
+  }
+  auto sketch = absl::make_unique<HllSketch>(precision);
+  if (representation == kHllSparseRepresentation) {
+    uint32_t num_entries;
+    if (!reader.ReadUint32(&num_entries) ||
+        reader.remaining().size() != num_entries * sizeof(uint32_t)) {
+      return InvalidSketchError("HLL");
+    }
+    sketch->sparse_.reserve(num_entries);
+    for (uint32_t i = 0; i < num_entries; ++i) {
+      uint32_t entry = 0;
+      if (!reader.ReadUint32(&entry)) {
+        return InvalidSketchError("HLL");
+      }
+      const uint8_t value = entry & ((1 << kHllRegisterBits) - 1);
+      if (value == 0 || value > 64 - kSparsePrecision + 1 ||
+          (entry >> kHllRegisterBits) >= (1u << kSparsePrecision) ||
+          (!sketch->sparse_.empty() &&
+           (entry >> kHllRegisterBits) <=
+               (sketch->sparse_.back() >> kHllRegisterBits))) {
+        return InvalidSketchError("HLL");
+      }
+      sketch->sparse_.push_back(entry);
+    }
+    sketch->FlushSparseBuffer();
+  } else if (representation == kHllDenseRepresentation) {
+    const absl::string_view registers = reader.remaining();
+    if (registers.size() != (1u << precision)) {
+      return InvalidSketchError("HLL");
+    }
+    sketch->registers_.assign(registers.begin(), registers.end());
+    for (uint8_t value : sketch->registers_) {
+      if (value > 64 - precision + 1) {
+        return InvalidSketchError("HLL");
+      }
+    }
+  } else {
+    return InvalidSketchError("HLL");
+  }
+  return sketch;
+}
+
+int64_t HllSketch::GetMemoryUsage() const {
+  return sizeof(*this) + sparse_.capacity() * sizeof(uint32_t) +
+         sparse_buffer_.capacity() * sizeof(uint32_t) + registers_.capacity();
+}
+
+KllSketch::KllSketch(ItemType item_type, int64_t inv_eps)
+    : item_type_(item_type),
+      k_(std::min(std::max(inv_eps, kKllMinK), kKllMaxK)),
+      levels_(1) {
+  UpdateTotalCapacity();
+}
+
+bool KllSketch::Less(uint64_t a, uint64_t b) const {
+  switch (item_type_) {
+    case kInt64:
+      return absl::bit_cast<int64_t>(a) < absl::bit_cast<int64_t>(b);
+    case kUint64:
+      return a < b;
+    case kDouble: {
+      const double da = absl::bit_cast<double>(a);
+      const double db = absl::bit_cast<double>(b);
+      // NaN is smaller than all other values.
+      if (std::isnan(db)) return false;
+      return std::isnan(da) || da < db;
+    }
+  }
+}
+
+const Type* KllSketch::item_value_type() const {
+  switch (item_type_) {
+    case kInt64:
+      return types::Int64Type();
+    case kUint64:
+      return types::Uint64Type();
+    case kDouble:
+      return types::DoubleType();
+  }
+}
+
+Value KllSketch::ItemToValue(uint64_t item) const {
+  switch (item_type_) {
+    case kInt64:
+      return Value::Int64(absl::bit_cast<int64_t>(item));
+    case kUint64:
+      return Value::Uint64(item);
+    case kDouble:
+      return Value::Double(absl::bit_cast<double>(item));
+  }
+}
+
+void KllSketch::Add(const Value& value) {
+  uint64_t item = 0;
+  switch (item_type_) {
+    case kInt64:
+      item = absl::bit_cast<uint64_t>(value.int64_value());
+      break;
+    case kUint64:
+      item = value.uint64_value();
+      break;
+    case kDouble:
+      item = absl::bit_cast<uint64_t>(value.double_value());
+      break;
+  }
+  if (num_items_ == 0 || Less(item, min_item_)) min_item_ = item;
+  if (num_items_ == 0 || Less(max_item_, item)) max_item_ = item;
+  ++num_items_;
+  levels_[0].push_back(item);
+  ++num_stored_items_;
+  Compress();
+}
+
+int64_t KllSketch::LevelCapacity(int level) const {
+  const int depth = static_cast<int>(levels_.size()) - 1 - level;
+  return std::max<int64_t>(
+      kKllMinCapacity,
+      static_cast<int64_t>(std::ceil(k_ * std::pow(kKllCapacityFactor, depth))));
+}
+
+void KllSketch::UpdateTotalCapacity() {
+  total_capacity_ = 0;
+  for (int level = 0; level < levels_.size(); ++level) {
+    total_capacity_ += LevelCapacity(level);
+  }
+}
+
+void KllSketch::CompactLevel(int level) {
+  if (level + 1 == levels_.size()) {
+    levels_.emplace_back();
+    UpdateTotalCapacity();
+  }
+  std::vector<uint64_t>& items = levels_[level];
+  std::sort(items.begin(), items.end(),
+            [this](uint64_t a, uint64_t b) { return Less(a, b); });
+  // With an odd number of items, the largest one stays at this level.
+  const size_t num_compacted = items.size() & ~static_cast<size_t>(1);
+  std::vector<uint64_t>& next_items = levels_[level + 1];
+  for (size_t i = keep_odd_items_ ? 1 : 0; i < num_compacted; i += 2) {
+    next_items.push_back(items[i]);
+  }
+  keep_odd_items_ = !keep_odd_items_;
+  items.erase(items.begin(), items.begin() + num_compacted);
+  num_stored_items_ -= num_compacted / 2;
+}
+
+void KllSketch::Compress() {
+  while (num_stored_items_ >= total_capacity_) {
+    // Some level is at or above its capacity since the total is.
+    int level = 0;
+    while (levels_[level].size() < LevelCapacity(level)) {
+      ++level;
+    }
+    CompactLevel(level);
+  }
+}
+
+absl::Status KllSketch::Merge(const KllSketch& other) {
+  if (other.item_type_ != item_type_) {
+    return ::zetasql_base::OutOfRangeErrorBuilder()
+           << "Cannot merge KLL sketches of different types";
+  }
+  if (other.num_items_ == 0) {
+    return absl::OkStatus();
+  }
+  if (num_items_ == 0 || Less(other.min_item_, min_item_)) {
+    min_item_ = other.min_item_;
+  }
+  if (num_items_ == 0 || Less(max_item_, other.max_item_)) {
+    max_item_ = other.max_item_;
+  }
+  num_items_ += other.num_items_;
+  k_ = std::min(k_, other.k_);
+  if (levels_.size() < other.levels_.size()) {
+    levels_.resize(other.levels_.size());
+  }
+  for (int level = 0; level < other.levels_.size(); ++level) {
+    levels_[level].insert(levels_[level].end(), other.levels_[level].begin(),
+                          other.levels_[level].end());
+  }
+  num_stored_items_ += other.num_stored_items_;
+  UpdateTotalCapacity();
+  Compress();
+  return absl::OkStatus();
+}
+
+std::vector<std::pair<uint64_t, int64_t>> KllSketch::GetWeightedItems() const {
+  std::vector<std::pair<uint64_t, int64_t>> weighted_items;
+  weighted_items.reserve(num_stored_items_);
+  for (int level = 0; level < levels_.size(); ++level) {
+    for (uint64_t item : levels_[level]) {
+      weighted_items.emplace_back(item, int64_t{1} << level);
+    }
+  }
+  std::sort(weighted_items.begin(), weighted_items.end(),
+            [this](const std::pair<uint64_t, int64_t>& a,
+                   const std::pair<uint64_t, int64_t>& b) {
+              return Less(a.first, b.first);
+            });
+  return weighted_items;
+}
+
+uint64_t KllSketch::QuantileFromWeightedItems(
+    const std::vector<std::pair<uint64_t, int64_t>>& weighted_items,
+    double phi) const {
+  if (phi <= 0) return min_item_;
+  if (phi >= 1) return max_item_;
+  const double rank = phi * num_items_;
+  int64_t cumulative_weight = 0;
+  for (const auto& weighted_item : weighted_items) {
+    cumulative_weight += weighted_item.second;
+    if (cumulative_weight >= rank) {
+      return weighted_item.first;
+    }
+  }
+  return max_item_;
+}
+
+Value KllSketch::GetQuantile(double phi) const {
+  if (num_items_ == 0) {
+    return Value::Null(item_value_type());
+  }
+  return ItemToValue(QuantileFromWeightedItems(GetWeightedItems(), phi));
+}
+
+Value KllSketch::GetQuantiles(int64_t num_quantiles) const {
+  DCHECK_GE(num_quantiles, 1);
+  const ArrayType* array_type;
+  switch (item_type_) {
+    case kInt64:
+      array_type = types::Int64ArrayType();
+      break;
+    case kUint64:
+      array_type = types::Uint64ArrayType();
+      break;
+    case kDouble:
+      array_type = types::DoubleArrayType();
+      break;
+  }
+  if (num_items_ == 0) {
+    return Value::Null(array_type);
+  }
+  const std::vector<std::pair<uint64_t, int64_t>> weighted_items =
+      GetWeightedItems();
+  std::vector<Value> quantiles;
+  quantiles.reserve(num_quantiles + 1);
+  for (int64_t i = 0; i <= num_quantiles; ++i) {
+    quantiles.push_back(ItemToValue(QuantileFromWeightedItems(
+        weighted_items, static_cast<double>(i) / num_quantiles)));
+  }
+  return Value::Array(array_type, quantiles);
+}
+
+std::string KllSketch::Serialize() const {
+  std::string out;
+  out.push_back(kKllMagic);
+  out.push_back(kFormatVersion);
+  AppendUint8(item_type_, &out);
+  AppendUint8(keep_odd_items_, &out);
+  AppendUint64(k_, &out);
+  AppendUint64(num_items_, &out);
+  AppendUint64(min_item_, &out);
+  AppendUint64(max_item_, &out);
+  AppendUint32(levels_.size(), &out);
+  // Levels are in arrival order until they are compacted. Sorting them makes
+  // the bytes of exact sketches independent of the input order.
+  std::vector<uint64_t> sorted_items;
+  for (const std::vector<uint64_t>& items : levels_) {
+    sorted_items.assign(items.begin(), items.end());
+    std::sort(sorted_items.begin(), sorted_items.end(),
+              [this](uint64_t a, uint64_t b) { return Less(a, b); });
+    AppendUint32(sorted_items.size(), &out);
+    for (uint64_t item : sorted_items) {
+      AppendUint64(item, &out);
+    }
+  }
+  return out;
+}
+
+zetasql_base::StatusOr<std::unique_ptr<KllSketch>> KllSketch::Deserialize(
+    absl::string_view bytes) {
+  SketchReader reader(bytes);
+  uint8_t item_type, keep_odd_items;
+  uint64_t k, num_items, min_item, max_item;
+  uint32_t num_levels;
+  if (!reader.ReadHeader(kKllMagic) || !reader.ReadUint8(&item_type) ||
+      item_type < kInt64 || item_type > kDouble ||
+      !reader.ReadUint8(&keep_odd_items) || keep_odd_items > 1 ||
+      !reader.ReadUint64(&k) || k < kKllMinK || k > kKllMaxK ||
+      !reader.ReadUint64(&num_items) ||
+      num_items > std::numeric_limits<int64_t>::max() ||
+      !reader.ReadUint64(&min_item) || !reader.ReadUint64(&max_item) ||
+      !reader.ReadUint32(&num_levels) || num_levels == 0 ||
+      num_levels > kKllMaxLevels) {
+    return InvalidSketchError("KLL");
+  }
+  auto sketch = absl::make_unique<KllSketch>(
+      static_cast<ItemType>(item_type), static_cast<int64_t>(k));
+  sketch->keep_odd_items_ = keep_odd_items;
+  sketch->num_items_ = num_items;
+  sketch->min_item_ = min_item;
+  sketch->max_item_ = max_item;
+  sketch->levels_.resize(num_levels);
+  // The weights of the stored items must add up to the number of items.
+  uint64_t total_weight = 0;
+  for (uint32_t level = 0; level < num_levels; ++level) {
+    uint32_t num_level_items;
+    if (!reader.ReadUint32(&num_level_items) ||
+        reader.remaining().size() < num_level_items * sizeof(uint64_t)) {
+      return InvalidSketchError("KLL");
+    }
+    std::vector<uint64_t>& items = sketch->levels_[level];
+    items.resize(num_level_items);
+    for (uint64_t& item : items) {
+      reader.ReadUint64(&item);
+    }
+    sketch->num_stored_items_ += num_level_items;
+    total_weight += static_cast<uint64_t>(num_level_items) << level;
+  }
+  if (!reader.remaining().empty() || total_weight != num_items) {
+    return InvalidSketchError("KLL");
+  }
+  sketch->UpdateTotalCapacity();
+  sketch->Compress();
+  return sketch;
+}
+
+int64_t KllSketch::GetMemoryUsage() const {
+  int64_t bytes = sizeof(*this) + levels_.capacity() * sizeof(levels_[0]);
+  for (const std::vector<uint64_t>& items : levels_) {
+    bytes += items.capacity() * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,203 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_SKETCHES_H_
+#define ZETASQL_REFERENCE_IMPL_SKETCHES_H_
+
+// Mergeable sketches used by the reference implementation of the approximate
+// aggregate functions APPROX_COUNT_DISTINCT, HLL_COUNT.* and KLL_QUANTILES.*.
+// Sketches use a fixed amount of memory per group regardless of the number of
+// inputs, and their serialized form (the BYTES values returned by the *.INIT
+// and *.MERGE_PARTIAL functions) can be merged across groups and queries.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Returns a 64-bit hash of <value> for use with HllSketch. The hash of
+// INT32, INT64, UINT32, UINT64, BOOL, DATE, ENUM, FLOAT, DOUBLE, STRING,
+// BYTES, NUMERIC and BIGNUMERIC values is stable across processes, so
+// serialized sketches of these types can be merged with sketches built
+// elsewhere. Other types use Value::HashCode(). <value> must not be NULL.
+uint64_t HashValueForSketch(const Value& value);
+
+// A HyperLogLog++ cardinality sketch over 64-bit hashes.
+//
+// Small cardinalities are stored in a sparse list at precision
+// kSparsePrecision and estimated with linear counting, which is close to
+// exact. The sketch switches to 2^precision dense one-byte registers once the
+// sparse list would be larger. The dense estimate uses linear counting for
+// small ranges and the raw HyperLogLog estimate otherwise; the empirical bias
+// correction of HLL++ is not applied.
+class HllSketch {
+ public:
+  static constexpr int kMinPrecision = 10;
+  static constexpr int kMaxPrecision = 24;
+  static constexpr int kDefaultPrecision = 15;
+  static constexpr int kSparsePrecision = 25;
+
+  // <precision> must be in [kMinPrecision, kMaxPrecision].
+  explicit HllSketch(int precision);
+  HllSketch(const HllSketch&) = delete;
+  HllSketch& operator=(const HllSketch&) = delete;
+
+  // Parses a sketch produced by Serialize(). Returns an OUT_OF_RANGE error if
+  // <bytes> is not a valid HLL sketch.
+  static zetasql_base::StatusOr<std::unique_ptr<HllSketch>> Deserialize(
+      absl::string_view bytes);
+
+  int precision() const { return precision_; }
+
+  void AddHash(uint64_t hash);
+
+  // Adds all inputs of <other> to this sketch. If the precisions differ, the
+  // result has the lower precision.
+  void Merge(const HllSketch& other);
+
+  // Returns the estimated number of distinct hashes added.
+  int64_t Estimate() const;
+
+  std::string Serialize() const;
+
+  // Returns the approximate number of bytes used by this sketch.
+  int64_t GetMemoryUsage() const;
+
+ private:
+  bool is_sparse() const { return registers_.empty(); }
+
+  // Sorts and deduplicates <sparse_buffer_> into <sparse_>, and switches to
+  // the dense representation if the sparse one has become too large.
+  void FlushSparseBuffer();
+  void ConvertToDense();
+
+  // Lowers the precision of this sketch to <precision>.
+  void ReducePrecision(int precision);
+
+  // Sets the register for the sparse entry <entry> to at least its value.
+  void AddSparseEntryToRegisters(uint32_t entry);
+
+  int precision_;
+  // Sorted sparse entries, with at most one entry per sparse index. Each
+  // entry is the sparse index shifted left by 6 bits, ORed with the
+  // register value.
+  std::vector<uint32_t> sparse_;
+  // Sparse entries not yet merged into <sparse_>.
+  std::vector<uint32_t> sparse_buffer_;
+  // Dense registers, empty while the sketch is sparse.
+  std::vector<uint8_t> registers_;
+};
+
+// A KLL quantiles sketch over INT64, UINT64 or DOUBLE values.
+//
+// The sketch keeps a hierarchy of compactors with capacities that shrink
+// geometrically from the top level. The largest capacity is derived from
+// <inv_eps>, so the rank error is roughly proportional to 1/<inv_eps>. The
+// minimum and maximum values are tracked exactly. Compactions alternate
+// between keeping the odd and the even items, which keeps the results
+// deterministic for a given input order. Which items survive a compaction
+// depends on the input order; see is_exact().
+class KllSketch {
+ public:
+  enum ItemType { kInt64 = 1, kUint64 = 2, kDouble = 3 };
+
+  static constexpr int64_t kDefaultInvEps = 1000;
+
+  // <inv_eps> is clamped to [8, 65536] to bound the size of the sketch.
+  KllSketch(ItemType item_type, int64_t inv_eps);
+  KllSketch(const KllSketch&) = delete;
+  KllSketch& operator=(const KllSketch&) = delete;
+
+  // Parses a sketch produced by Serialize(). Returns an OUT_OF_RANGE error if
+  // <bytes> is not a valid KLL sketch.
+  static zetasql_base::StatusOr<std::unique_ptr<KllSketch>> Deserialize(
+      absl::string_view bytes);
+
+  ItemType item_type() const { return item_type_; }
+  int64_t num_items() const { return num_items_; }
+
+  // Returns true if the sketch still stores every item it was given, i.e. no
+  // compaction has happened here or in any merged sketch. Only then are the
+  // quantiles exact and Serialize() independent of the order of the inputs
+  // and merges.
+  bool is_exact() const { return num_stored_items_ == num_items_; }
+
+  // Adds <value>, which must be a non-NULL value of the item type. NaN
+  // doubles sort before all other doubles, as in ORDER BY.
+  void Add(const Value& value);
+
+  // Adds all inputs of <other> to this sketch. Returns an error if the item
+  // types differ.
+  absl::Status Merge(const KllSketch& other);
+
+  // Returns the approximate <phi>-quantile for <phi> in [0, 1], or NULL if
+  // the sketch is empty. Quantiles 0 and 1 are the exact minimum and maximum.
+  Value GetQuantile(double phi) const;
+
+  // Returns an array with the minimum, the <num_quantiles> - 1 approximate
+  // quantiles i / <num_quantiles> and the maximum, or a NULL array if the
+  // sketch is empty. <num_quantiles> must be at least 1.
+  Value GetQuantiles(int64_t num_quantiles) const;
+
+  std::string Serialize() const;
+
+  // Returns the approximate number of bytes used by this sketch.
+  int64_t GetMemoryUsage() const;
+
+ private:
+  // Items are stored as the bit patterns of int64_t, uint64_t or double.
+  bool Less(uint64_t a, uint64_t b) const;
+  Value ItemToValue(uint64_t item) const;
+  const Type* item_value_type() const;
+
+  int64_t LevelCapacity(int level) const;
+  // Recomputes <total_capacity_> after the number of levels or k changed.
+  void UpdateTotalCapacity();
+  // Compacts levels until the number of stored items fits the capacity.
+  void Compress();
+  // Sorts <level> and promotes every other item to the next level.
+  void CompactLevel(int level);
+
+  // Returns all stored items with their weights, sorted by item.
+  std::vector<std::pair<uint64_t, int64_t>> GetWeightedItems() const;
+  // Returns the item of rank <phi> * num_items() in <weighted_items>.
+  uint64_t QuantileFromWeightedItems(
+      const std::vector<std::pair<uint64_t, int64_t>>& weighted_items,
+      double phi) const;
+
+  ItemType item_type_;
+  int64_t k_;
+  int64_t num_items_ = 0;
+  uint64_t min_item_ = 0;
+  uint64_t max_item_ = 0;
+  // Items in levels_[i] have weight 2^i.
+  std::vector<std::vector<uint64_t>> levels_;
+  int64_t num_stored_items_ = 0;
+  int64_t total_capacity_ = 0;
+  // Alternates the items kept by compactions.
+  bool keep_odd_items_ = false;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_SKETCHES_H_
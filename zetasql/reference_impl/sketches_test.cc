@@ -0,0 +1,230 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/sketches.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace zetasql {
+namespace {
+
+using zetasql_base::testing::StatusIs;
+
+// Returns a sketch of the hashes of the INT64 values in [begin, end).
+std::unique_ptr<HllSketch> MakeHllSketch(int precision, int64_t begin,
+                                         int64_t end) {
+  auto sketch = absl::make_unique<HllSketch>(precision);
+  for (int64_t i = begin; i < end; ++i) {
+    sketch->AddHash(HashValueForSketch(Value::Int64(i)));
+  }
+  return sketch;
+}
+
+// Returns true if <estimate> is within <relative_error> of <expected>.
+bool IsNear(int64_t estimate, int64_t expected, double relative_error) {
+  return std::abs(estimate - expected) <= relative_error * expected;
+}
+
+TEST(HashValueForSketch, EqualValuesHaveEqualHashes) {
+  EXPECT_EQ(HashValueForSketch(Value::Int32(5)),
+            HashValueForSketch(Value::Int64(5)));
+  EXPECT_EQ(HashValueForSketch(Value::Double(0.0)),
+            HashValueForSketch(Value::Double(-0.0)));
+  EXPECT_NE(HashValueForSketch(Value::String("a")),
+            HashValueForSketch(Value::String("b")));
+}
+
+TEST(HllSketch, SmallCardinalitiesAreExact) {
+  for (int64_t n : {0, 1, 10, 1000}) {
+    std::unique_ptr<HllSketch> sketch =
+        MakeHllSketch(HllSketch::kDefaultPrecision, 0, n);
+    // Duplicates do not change the estimate.
+    for (int64_t i = 0; i < n; ++i) {
+      sketch->AddHash(HashValueForSketch(Value::Int64(i)));
+    }
+    EXPECT_EQ(sketch->Estimate(), n);
+  }
+}
+
+TEST(HllSketch, LargeCardinalities) {
+  for (int precision : {HllSketch::kMinPrecision, 14}) {
+    for (int64_t n : {10000, 200000}) {
+      std::unique_ptr<HllSketch> sketch = MakeHllSketch(precision, 0, n);
+      // The standard error is 1.04 / sqrt(2^precision).
+      EXPECT_TRUE(IsNear(sketch->Estimate(), n,
+                         5 * 1.04 / std::sqrt(1 << precision)))
+          << "precision=" << precision << " n=" << n
+          << " estimate=" << sketch->Estimate();
+    }
+  }
+}
+
+TEST(HllSketch, Merge) {
+  // Merge sparse into sparse, sparse into dense and dense into dense, with
+  // overlapping inputs.
+  for (int64_t n : {100, 100000}) {
+    std::unique_ptr<HllSketch> sketch = MakeHllSketch(12, 0, n);
+    std::unique_ptr<HllSketch> other = MakeHllSketch(14, n / 2, 2 * n);
+    std::unique_ptr<HllSketch> expected = MakeHllSketch(12, 0, 2 * n);
+    sketch->Merge(*other);
+    EXPECT_EQ(sketch->precision(), 12);
+    EXPECT_EQ(sketch->Estimate(), expected->Estimate()) << "n=" << n;
+    EXPECT_EQ(sketch->Serialize(), expected->Serialize()) << "n=" << n;
+  }
+}
+
+TEST(HllSketch, SerializeRoundTrip) {
+  for (int64_t n : {0, 100, 100000}) {
+    std::unique_ptr<HllSketch> sketch = MakeHllSketch(13, 0, n);
+    const std::string bytes = sketch->Serialize();
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HllSketch> copy,
+                         HllSketch::Deserialize(bytes));
+    EXPECT_EQ(copy->precision(), 13);
+    EXPECT_EQ(copy->Estimate(), sketch->Estimate());
+    EXPECT_EQ(copy->Serialize(), bytes);
+  }
+}
+
+TEST(HllSketch, DeserializeInvalid) {
+  const std::string bytes = MakeHllSketch(13, 0, 100)->Serialize();
+  for (const std::string& invalid :
+       {std::string(), std::string("abc"), bytes.substr(0, bytes.size() - 1),
+        absl::StrCat(bytes, "x"),
+        KllSketch(KllSketch::kInt64, KllSketch::kDefaultInvEps).Serialize()}) {
+    EXPECT_THAT(HllSketch::Deserialize(invalid),
+                StatusIs(absl::StatusCode::kOutOfRange));
+  }
+}
+
+// Returns a sketch of the INT64 values in [begin, end).
+std::unique_ptr<KllSketch> MakeKllSketch(int64_t inv_eps, int64_t begin,
+                                         int64_t end) {
+  auto sketch = absl::make_unique<KllSketch>(KllSketch::kInt64, inv_eps);
+  for (int64_t i = begin; i < end; ++i) {
+    sketch->Add(Value::Int64(i));
+  }
+  return sketch;
+}
+
+TEST(KllSketch, Empty) {
+  KllSketch sketch(KllSketch::kDouble, KllSketch::kDefaultInvEps);
+  EXPECT_EQ(sketch.GetQuantile(0.5), Value::NullDouble());
+  EXPECT_EQ(sketch.GetQuantiles(4), Value::Null(types::DoubleArrayType()));
+}
+
+TEST(KllSketch, SmallInputsAreExact) {
+  std::unique_ptr<KllSketch> sketch = MakeKllSketch(KllSketch::kDefaultInvEps, 1, 101);
+  EXPECT_EQ(sketch->num_items(), 100);
+  EXPECT_EQ(sketch->GetQuantile(0), Value::Int64(1));
+  EXPECT_EQ(sketch->GetQuantile(0.5), Value::Int64(50));
+  EXPECT_EQ(sketch->GetQuantile(1), Value::Int64(100));
+  EXPECT_EQ(sketch->GetQuantiles(4),
+            Value::Array(types::Int64ArrayType(),
+                         {Value::Int64(1), Value::Int64(25), Value::Int64(50),
+                          Value::Int64(75), Value::Int64(100)}));
+}
+
+TEST(KllSketch, SerializeIsOrderIndependentWhileExact) {
+  KllSketch sketch(KllSketch::kInt64, KllSketch::kDefaultInvEps);
+  KllSketch reversed(KllSketch::kInt64, KllSketch::kDefaultInvEps);
+  for (int64_t i = 0; i < 100; ++i) {
+    sketch.Add(Value::Int64(i));
+    reversed.Add(Value::Int64(99 - i));
+  }
+  EXPECT_TRUE(sketch.is_exact());
+  EXPECT_EQ(sketch.Serialize(), reversed.Serialize());
+
+  // Compactions keep only some of the items.
+  std::unique_ptr<KllSketch> compacted = MakeKllSketch(8, 0, 1000);
+  EXPECT_FALSE(compacted->is_exact());
+  ZETASQL_ASSERT_OK(sketch.Merge(*compacted));
+  EXPECT_FALSE(sketch.is_exact());
+}
+
+TEST(KllSketch, LargeInputs) {
+  const int64_t n = 1000000;
+  const int64_t inv_eps = 200;
+  std::unique_ptr<KllSketch> sketch = MakeKllSketch(inv_eps, 0, n);
+  EXPECT_LT(sketch->GetMemoryUsage(), n);
+  EXPECT_EQ(sketch->GetQuantile(0), Value::Int64(0));
+  EXPECT_EQ(sketch->GetQuantile(1), Value::Int64(n - 1));
+  for (double phi : {0.1, 0.5, 0.9}) {
+    const int64_t quantile = sketch->GetQuantile(phi).int64_value();
+    EXPECT_LE(std::abs(quantile - phi * n), 2.0 * n / inv_eps)
+        << "phi=" << phi << " quantile=" << quantile;
+  }
+}
+
+TEST(KllSketch, DoubleOrder) {
+  KllSketch sketch(KllSketch::kDouble, KllSketch::kDefaultInvEps);
+  for (double d : {1.0, -2.0, std::nan(""), 3.0}) {
+    sketch.Add(Value::Double(d));
+  }
+  EXPECT_TRUE(std::isnan(sketch.GetQuantile(0).double_value()));
+  EXPECT_EQ(sketch.GetQuantile(0.5), Value::Double(-2.0));
+  EXPECT_EQ(sketch.GetQuantile(1), Value::Double(3.0));
+}
+
+TEST(KllSketch, Merge) {
+  std::unique_ptr<KllSketch> sketch = MakeKllSketch(200, 0, 50000);
+  ZETASQL_ASSERT_OK(sketch->Merge(*MakeKllSketch(100, 50000, 100000)));
+  EXPECT_EQ(sketch->num_items(), 100000);
+  EXPECT_EQ(sketch->GetQuantile(0), Value::Int64(0));
+  EXPECT_EQ(sketch->GetQuantile(1), Value::Int64(99999));
+  const int64_t median = sketch->GetQuantile(0.5).int64_value();
+  EXPECT_LE(std::abs(median - 50000), 2000);
+
+  KllSketch uint64_sketch(KllSketch::kUint64, KllSketch::kDefaultInvEps);
+  EXPECT_THAT(sketch->Merge(uint64_sketch),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST(KllSketch, SerializeRoundTrip) {
+  for (int64_t n : {0, 10, 100000}) {
+    std::unique_ptr<KllSketch> sketch = MakeKllSketch(100, 0, n);
+    const std::string bytes = sketch->Serialize();
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KllSketch> copy,
+                         KllSketch::Deserialize(bytes));
+    EXPECT_EQ(copy->item_type(), KllSketch::kInt64);
+    EXPECT_EQ(copy->num_items(), n);
+    EXPECT_EQ(copy->GetQuantiles(10), sketch->GetQuantiles(10));
+    EXPECT_EQ(copy->Serialize(), bytes);
+  }
+}
+
+TEST(KllSketch, DeserializeInvalid) {
+  const std::string bytes = MakeKllSketch(100, 0, 1000)->Serialize();
+  for (const std::string& invalid :
+       {std::string(), bytes.substr(0, bytes.size() - 1),
+        absl::StrCat(bytes, "x"), MakeHllSketch(12, 0, 10)->Serialize()}) {
+    EXPECT_THAT(KllSketch::Deserialize(invalid),
+                StatusIs(absl::StatusCode::kOutOfRange));
+  }
+}
+
+}  // namespace
+}  // namespace zetasql
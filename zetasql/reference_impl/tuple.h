@@ -637,8 +637,14 @@ class MemoryAccountant {
     DCHECK_LE(remaining_bytes_, total_num_bytes_);
   }
 
+  int64_t total_num_bytes() const { return total_num_bytes_; }
+
   int64_t remaining_bytes() const { return remaining_bytes_; }
 
+  int64_t num_bytes_in_use() const {
+    return total_num_bytes_ - remaining_bytes_;
+  }
+
  private:
   const int64_t total_num_bytes_;
   int64_t remaining_bytes_;
@@ -771,6 +777,14 @@ class TupleDataOrderedQueue {
     return std::move(value_entry.second);
   }
 
+  // Returns the number of elements that are equal to the last element of the
+  // queue (including the last element), which must be non-empty.
+  int64_t GetNumEqualToBack() const {
+    auto iter = entries_.end();
+    --iter;
+    return entries_.count(iter->first);
+  }
+
   // Clears the queue.
   void Clear() {
     while (!IsEmpty()) {
@@ -35,6 +35,7 @@
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/message.h"
 #include "zetasql/common/internal_value.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/proto_util.h"
@@ -56,6 +57,7 @@
 #include "zetasql/base/cleanup.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
@@ -325,7 +327,7 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
                          EvaluationContext* context, VirtualTupleSlot* result,
                          absl::Status* status) const {
   auto status_or_iter =
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context);
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context);
   if (!status_or_iter.ok()) {
     *status = status_or_iter.status();
     return false;
@@ -430,6 +432,100 @@ RelationalOp* ArrayNestExpr::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// SpoolExpr
+// -------------------------------------------------------
+
+std::string SpoolExpr::DebugInternal(const std::string& indent,
+                                     bool verbose) const {
+  std::vector<std::string> column_strs;
+  column_strs.reserve(columns_.size());
+  for (const VariableId& column : columns_) {
+    column_strs.push_back(absl::StrCat("$", column.ToString()));
+  }
+  return absl::StrCat("SpoolExpr($", spool_.ToString(), ": ",
+                      absl::StrJoin(column_strs, ", "),
+                      ArgDebugString({"input"}, {k1}, indent, verbose), ")");
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<SpoolExpr>> SpoolExpr::Create(
+    const VariableId& spool, std::vector<VariableId> columns,
+    std::unique_ptr<RelationalOp> input) {
+  ZETASQL_RET_CHECK(spool.is_valid());
+  return absl::WrapUnique(
+      new SpoolExpr(spool, std::move(columns), std::move(input)));
+}
+
+absl::Status SpoolExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(mutable_input()->SetSchemasForEvaluation(params_schemas));
+  const std::unique_ptr<const TupleSchema> input_schema =
+      input()->CreateOutputSchema();
+  column_slots_.clear();
+  column_slots_.reserve(columns_.size());
+  for (const VariableId& column : columns_) {
+    absl::optional<int> slot = input_schema->FindIndexForVariable(column);
+    ZETASQL_RET_CHECK(slot.has_value()) << "Missing spool column " << column;
+    column_slots_.push_back(slot.value());
+  }
+  return absl::OkStatus();
+}
+
+bool SpoolExpr::Eval(absl::Span<const TupleData* const> params,
+                     EvaluationContext* context, VirtualTupleSlot* result,
+                     absl::Status* status) const {
+  auto status_or_iter =
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context);
+  if (!status_or_iter.ok()) {
+    *status = status_or_iter.status();
+    return false;
+  }
+  std::unique_ptr<TupleIterator> iter = std::move(status_or_iter).value();
+  // As in ArrayNestExpr, spool the rows in their original order so that all
+  // readers see the same rows. SpoolScanOp scrambles its own output if needed.
+  *status = iter->DisableReordering();
+  if (!status->ok()) return false;
+
+  // If we fail early, 'rows' returns the accumulated bytes when it goes out of
+  // scope.
+  auto rows = absl::make_unique<TupleDataDeque>(context->memory_accountant());
+  while (true) {
+    const TupleData* tuple = iter->Next();
+    if (tuple == nullptr) {
+      *status = iter->Status();
+      if (!status->ok()) return false;
+      break;
+    }
+
+    auto row = absl::make_unique<TupleData>(column_slots_.size());
+    for (int i = 0; i < column_slots_.size(); ++i) {
+      *row->mutable_slot(i) = tuple->slot(column_slots_[i]);
+    }
+    if (!rows->PushBack(std::move(row), status)) return false;
+  }
+
+  const int64_t num_rows = rows->GetSize();
+  context->SetSpool(spool_, std::move(rows));
+  result->SetValue(Value::Int64(num_rows));
+  return true;
+}
+
+SpoolExpr::SpoolExpr(const VariableId& spool, std::vector<VariableId> columns,
+                     std::unique_ptr<RelationalOp> input)
+    : ValueExpr(types::Int64Type()),
+      spool_(spool),
+      columns_(std::move(columns)) {
+  SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
+}
+
+const RelationalOp* SpoolExpr::input() const {
+  return GetArg(kInput)->node()->AsRelationalOp();
+}
+
+RelationalOp* SpoolExpr::mutable_input() {
+  return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
+}
+
 // -------------------------------------------------------
 // DerefExpr
 // -------------------------------------------------------
@@ -850,7 +946,7 @@ bool SingleValueExpr::Eval(absl::Span<const TupleData* const> params,
                            EvaluationContext* context, VirtualTupleSlot* result,
                            absl::Status* status) const {
   auto status_or_iter =
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context);
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context);
   if (!status_or_iter.ok()) {
     *status = status_or_iter.status();
     return false;
@@ -930,7 +1026,7 @@ bool ExistsExpr::Eval(absl::Span<const TupleData* const> params,
                       EvaluationContext* context, VirtualTupleSlot* result,
                       absl::Status* status) const {
   auto status_or_iter =
-      input()->CreateIterator(params, /*num_extra_slots=*/0, context);
+      input()->CreateIteratorWithStats(params, /*num_extra_slots=*/0, context);
   if (!status_or_iter.ok()) {
     *status = status_or_iter.status();
     return false;
@@ -969,6 +1065,87 @@ RelationalOp* ExistsExpr::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// CachedSubqueryExpr
+// -------------------------------------------------------
+
+::zetasql_base::StatusOr<std::unique_ptr<CachedSubqueryExpr>>
+CachedSubqueryExpr::Create(std::vector<std::unique_ptr<ValueExpr>> keys,
+                           std::unique_ptr<ValueExpr> subquery) {
+  return absl::WrapUnique(
+      new CachedSubqueryExpr(std::move(keys), std::move(subquery)));
+}
+
+absl::Status CachedSubqueryExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  for (ExprArg* arg : mutable_keys()) {
+    ZETASQL_RETURN_IF_ERROR(
+        arg->mutable_value_expr()->SetSchemasForEvaluation(params_schemas));
+  }
+  return mutable_subquery()->SetSchemasForEvaluation(params_schemas);
+}
+
+bool CachedSubqueryExpr::Eval(absl::Span<const TupleData* const> params,
+                              EvaluationContext* context,
+                              VirtualTupleSlot* result,
+                              absl::Status* status) const {
+  std::vector<Value> key;
+  key.reserve(keys().size());
+  for (const ExprArg* arg : keys()) {
+    TupleSlot slot;
+    if (!arg->value_expr()->EvalSimple(params, context, &slot, status)) {
+      return false;
+    }
+    key.push_back(slot.value());
+  }
+
+  const Value* cached_result = context->FindSubqueryResult(this, key);
+  if (cached_result != nullptr) {
+    result->SetValue(*cached_result);
+    return true;
+  }
+
+  if (!subquery()->Eval(params, context, result, status)) return false;
+  context->AddSubqueryResult(this, std::move(key), *result->mutable_value());
+  return true;
+}
+
+std::string CachedSubqueryExpr::DebugInternal(const std::string& indent,
+                                              bool verbose) const {
+  return absl::StrCat(
+      "CachedSubqueryExpr(",
+      ArgDebugString({"keys", "subquery"}, {kN, k1}, indent, verbose), ")");
+}
+
+CachedSubqueryExpr::CachedSubqueryExpr(
+    std::vector<std::unique_ptr<ValueExpr>> keys,
+    std::unique_ptr<ValueExpr> subquery)
+    : ValueExpr(subquery->output_type()) {
+  std::vector<std::unique_ptr<ExprArg>> key_args;
+  key_args.reserve(keys.size());
+  for (auto& key : keys) {
+    key_args.push_back(absl::make_unique<ExprArg>(std::move(key)));
+  }
+  SetArgs<ExprArg>(kKeys, std::move(key_args));
+  SetArg(kSubquery, absl::make_unique<ExprArg>(std::move(subquery)));
+}
+
+absl::Span<const ExprArg* const> CachedSubqueryExpr::keys() const {
+  return GetArgs<ExprArg>(kKeys);
+}
+
+absl::Span<ExprArg* const> CachedSubqueryExpr::mutable_keys() {
+  return GetMutableArgs<ExprArg>(kKeys);
+}
+
+const ValueExpr* CachedSubqueryExpr::subquery() const {
+  return GetArg(kSubquery)->node()->AsValueExpr();
+}
+
+ValueExpr* CachedSubqueryExpr::mutable_subquery() {
+  return GetMutableArg(kSubquery)->mutable_node()->AsMutableValueExpr();
+}
+
 // -------------------------------------------------------
 // ScalarFunctionCallExpr
 // -------------------------------------------------------
@@ -1603,8 +1780,9 @@ static absl::Status EvalRelationalOp(
     const RelationalOp& op, absl::Span<const TupleData* const> params,
     EvaluationContext* context, std::unique_ptr<TupleSchema>* schema,
     std::vector<std::unique_ptr<TupleData>>* datas) {
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
-                   op.CreateIterator(params, /*num_extra_slots=*/0, context));
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<TupleIterator> iter,
+      op.CreateIteratorWithStats(params, /*num_extra_slots=*/0, context));
   *schema = absl::make_unique<TupleSchema>(iter->Schema().variables());
   // We disable reordering when iterating over relations when processing DML
   // statements for backwardws compatibility with the text-based reference
@@ -2760,7 +2938,14 @@ absl::Status DMLInsertValueExpr::SetSchemasForEvaluation(
                                        &rows_to_insert));
 
   std::vector<std::vector<Value>> original_rows;
-  ZETASQL_RETURN_IF_ERROR(PopulateRowsInOriginalTable(params, context, &original_rows));
+  if (context->options().use_primary_key_lookups_for_dml &&
+      !context->options().return_all_rows_for_dml) {
+    ZETASQL_RETURN_IF_ERROR(PopulateRowsInOriginalTableWithPrimaryKeys(
+        rows_to_insert, context, &original_rows));
+  } else {
+    ZETASQL_RETURN_IF_ERROR(
+        PopulateRowsInOriginalTable(params, context, &original_rows));
+  }
 
   absl::string_view duplicate_primary_key_error_prefix =
       "Found two rows with primary key";
@@ -2960,6 +3145,79 @@ absl::Status DMLInsertValueExpr::PopulateRowsInOriginalTable(
   return absl::OkStatus();
 }
 
+absl::Status DMLInsertValueExpr::PopulateRowsInOriginalTableWithPrimaryKeys(
+    const std::vector<std::vector<Value>>& rows_to_insert,
+    EvaluationContext* context,
+    std::vector<std::vector<Value>>* original_rows) const {
+  ZETASQL_ASSIGN_OR_RETURN(const absl::optional<std::vector<int>> primary_key_indexes,
+                   GetPrimaryKeyColumnIndexes(context));
+  // Without a primary key, the new rows cannot collide with existing rows.
+  if (!primary_key_indexes.has_value()) return absl::OkStatus();
+
+  // Collect the primary keys to look up, and the values of each key column.
+  absl::flat_hash_set<Value> primary_keys;
+  std::vector<std::vector<Value>> key_column_values(
+      primary_key_indexes->size());
+  // A column can only be filtered if none of its values is NULL or NaN, which
+  // ColumnFilters cannot represent but which collide with themselves.
+  std::vector<bool> can_filter_key_column(primary_key_indexes->size(), true);
+  for (const std::vector<Value>& row_to_insert : rows_to_insert) {
+    RowNumberAndValues row_number_and_values;
+    row_number_and_values.values = row_to_insert;
+    ZETASQL_ASSIGN_OR_RETURN(const Value primary_key,
+                     GetPrimaryKeyOrRowNumber(row_number_and_values, context));
+    if (!primary_keys.insert(primary_key).second) continue;
+    for (int i = 0; i < primary_key_indexes->size(); ++i) {
+      const Value& value = row_to_insert[(*primary_key_indexes)[i]];
+      if (value.is_null() || value.type()->IsFloatingPoint()) {
+        can_filter_key_column[i] = false;
+      }
+      key_column_values[i].push_back(value);
+    }
+  }
+  if (primary_keys.empty()) return absl::OkStatus();
+
+  // The primary key indexes refer to 'column_list_', which is also the order of
+  // the columns in the scan.
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+                   table_->CreateEvaluatorTableIterator(
+                       stmt()->table_scan()->column_index_list()));
+  absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map;
+  for (int i = 0; i < primary_key_indexes->size(); ++i) {
+    if (!can_filter_key_column[i]) continue;
+    ZETASQL_RET_CHECK(filter_map
+                  .emplace((*primary_key_indexes)[i],
+                           absl::make_unique<ColumnFilter>(
+                               key_column_values[i]))
+                  .second);
+  }
+  ZETASQL_RETURN_IF_ERROR(iter->SetColumnFilterMap(std::move(filter_map)));
+  iter->SetDeadline(context->GetStatementEvaluationDeadline());
+
+  ZETASQL_RET_CHECK_EQ(iter->NumColumns(), column_list_->size());
+  int64_t num_rows_read = 0;
+  while (iter->NextRow()) {
+    if (num_rows_read++ %
+            absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period) ==
+        0) {
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    }
+
+    RowNumberAndValues row_number_and_values;
+    row_number_and_values.values.reserve(iter->NumColumns());
+    for (int i = 0; i < iter->NumColumns(); ++i) {
+      row_number_and_values.values.push_back(iter->GetValue(i));
+    }
+    // The iterator is not required to honor the filters.
+    ZETASQL_ASSIGN_OR_RETURN(const Value primary_key,
+                     GetPrimaryKeyOrRowNumber(row_number_and_values, context));
+    if (primary_keys.contains(primary_key)) {
+      original_rows->push_back(std::move(row_number_and_values.values));
+    }
+  }
+  return iter->Status();
+}
+
 ::zetasql_base::StatusOr<int64_t> DMLInsertValueExpr::InsertRows(
     const InsertColumnMap& insert_column_map,
     const std::vector<std::vector<Value>>& rows_to_insert,
@@ -29,6 +29,7 @@
 #include "google/protobuf/message.h"
 #include "google/protobuf/wire_format_lite.h"
 #include "zetasql/common/internal_value.h"
+#include "zetasql/common/simple_evaluator_table_iterator.h"
 #include "zetasql/common/status_payload_utils.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/common/testing/testing_proto_util.h"
@@ -70,6 +71,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "zetasql/base/clock.h"
 #include "zetasql/base/canonical_errors.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -859,6 +861,88 @@ TEST_F(EvalTest, ExistsExpr) {
   EXPECT_THAT(EvalExpr(*exists2, EmptyParams()), IsOkAndHolds(Bool(true)));
 }
 
+TEST_F(EvalTest, CachedSubqueryExpr) {
+  VariableId a("a"), p("p");
+  auto input = absl::WrapUnique(new TestRelationalOp(
+      {a}, CreateTestTupleDatas({{Int64(10)}}), /*preserves_order=*/true));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p, DerefExpr::Create(p, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> add_args;
+  add_args.push_back(std::move(deref_a));
+  add_args.push_back(std::move(deref_p));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto a_plus_p,
+                       ScalarFunctionCallExpr::Create(
+                           CreateFunction(FunctionKind::kAdd, Int64Type()),
+                           std::move(add_args), DEFAULT_ERROR_MODE));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto subquery,
+      SingleValueExpr::Create(std::move(a_plus_p), std::move(input)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto key, DerefExpr::Create(p, Int64Type()));
+  std::vector<std::unique_ptr<ValueExpr>> keys;
+  keys.push_back(std::move(key));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto cached,
+      CachedSubqueryExpr::Create(std::move(keys), std::move(subquery)));
+  EXPECT_EQ(
+      "CachedSubqueryExpr(\n"
+      "+-keys: {\n"
+      "| +-$p},\n"
+      "+-subquery: SingleValueExpr(\n"
+      "  +-value: Add($a, $p),\n"
+      "  +-input: TestRelationalOp))",
+      cached->DebugString());
+
+  const TupleSchema params_schema({p});
+  ZETASQL_ASSERT_OK(cached->SetSchemasForEvaluation({&params_schema}));
+
+  // Repeated keys are served from the cache.
+  EvaluationContext context((EvaluationOptions()));
+  for (int64_t key_value : {1, 2, 1, 2, 1}) {
+    const TupleData params_data = CreateTestTupleData({Int64(key_value)});
+    EXPECT_THAT(EvalExpr(*cached, {&params_data}, &context),
+                IsOkAndHolds(Int64(10 + key_value)));
+  }
+  EXPECT_EQ(context.num_cached_subquery_results(), 2);
+  EXPECT_GT(context.subquery_cache_byte_size(), 0);
+  // The cache does not take memory away from the operators.
+  EXPECT_EQ(context.memory_accountant()->num_bytes_in_use(), 0);
+
+  // Results are still correct if the cache does not fit in memory.
+  EvaluationOptions options;
+  options.max_subquery_cache_byte_size = 1;
+  EvaluationContext memory_context(options);
+  for (int64_t key_value : {1, 1}) {
+    const TupleData params_data = CreateTestTupleData({Int64(key_value)});
+    EXPECT_THAT(EvalExpr(*cached, {&params_data}, &memory_context),
+                IsOkAndHolds(Int64(11)));
+  }
+  EXPECT_EQ(memory_context.num_cached_subquery_results(), 0);
+}
+
+TEST_F(EvalTest, CachedSubqueryExprDoesNotCacheErrors) {
+  VariableId a("a");
+  auto input = absl::WrapUnique(
+      new TestRelationalOp({a}, CreateTestTupleDatas({{Int64(1)}, {Int64(2)}}),
+                           /*preserves_order=*/true));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_a, DerefExpr::Create(a, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto subquery,
+      SingleValueExpr::Create(std::move(deref_a), std::move(input)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto cached,
+                       CachedSubqueryExpr::Create(/*keys=*/{},
+                                                  std::move(subquery)));
+  ZETASQL_ASSERT_OK(cached->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationContext context((EvaluationOptions()));
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_THAT(EvalExpr(*cached, EmptyParams(), &context),
+                StatusIs(absl::StatusCode::kOutOfRange, "More than one element"));
+  }
+  EXPECT_EQ(context.num_cached_subquery_results(), 0);
+}
+
 TEST_F(EvalTest, DerefExprDuplicateIds) {
   const VariableId v("v");
   const VariableId w("w");
@@ -1146,6 +1230,121 @@ TEST_F(DMLValueExprEvalTest,
                HasSubstr("INSERT a NULL value into a primary key column")));
 }
 
+TEST_F(DMLValueExprEvalTest, DMLInsertValueExprWithPrimaryKeyLookups) {
+  // The table has two rows with primary key 1, which is only an error if the
+  // INSERT reads them.
+  SimpleTable table("test_table",
+                    {{"int_val", Int64Type()}, {"str_val", StringType()}});
+  ZETASQL_ASSERT_OK(table.SetPrimaryKey({0}));
+  const std::vector<std::vector<Value>> contents = {
+      {Int64(1), String("one")},
+      {Int64(1), String("uno")},
+      {Int64(4), NullString()}};
+  // Returns an iterator that honors the ColumnFilters on the primary key.
+  table.SetEvaluatorTableIteratorFactory(
+      [&table, &contents](absl::Span<const int> column_idxs)
+          -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
+        std::vector<const Column*> columns;
+        std::vector<std::shared_ptr<const std::vector<Value>>> column_values;
+        for (const int column_idx : column_idxs) {
+          columns.push_back(table.GetColumn(column_idx));
+          auto values = std::make_shared<std::vector<Value>>();
+          for (const std::vector<Value>& row : contents) {
+            values->push_back(row[column_idx]);
+          }
+          column_values.push_back(std::move(values));
+        }
+        std::unique_ptr<EvaluatorTableIterator> iter(
+            new SimpleEvaluatorTableIterator(
+                columns, column_values, contents.size(),
+                /*end_status=*/absl::OkStatus(), /*filter_column_idxs=*/{0},
+                /*cancel_cb=*/[]() {},
+                /*set_deadline_cb=*/[](absl::Time t) {},
+                zetasql_base::Clock::RealClock()));
+        return iter;
+      });
+
+  for (const int64_t key : {3, 4}) {
+    // Build a resolved AST for inserting a new row (<key>, "new") into the
+    // table.
+    std::unique_ptr<ResolvedTableScan> table_scan = MakeResolvedTableScan(
+        {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
+         ResolvedColumn{2, "test_table", "str_val", StringType()}},
+        &table, /*for_system_time_expr=*/nullptr);
+    table_scan->set_column_index_list({0, 1});
+    std::vector<std::unique_ptr<const ResolvedDMLValue>> row_values;
+    row_values.push_back(MakeResolvedDMLValue(
+        MakeResolvedLiteral(Int64Type(), Int64(key), /*has_explicit_type=*/
+                            true, /*float_literal_id=*/0)));
+    row_values.push_back(MakeResolvedDMLValue(
+        MakeResolvedLiteral(StringType(), String("new"), /*has_explicit_type=*/
+                            true, /*float_literal_id=*/0)));
+    std::vector<std::unique_ptr<const ResolvedInsertRow>> row_list;
+    row_list.push_back(MakeResolvedInsertRow(std::move(row_values)));
+    std::unique_ptr<ResolvedInsertStmt> stmt = MakeResolvedInsertStmt(
+        std::move(table_scan), ResolvedInsertStmt::OR_ERROR,
+        /*assert_rows_modified=*/nullptr,
+        {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
+         ResolvedColumn{2, "test_table", "str_val", StringType()}},
+        /*query_parameter_list=*/{}, /*query=*/nullptr,
+        /*query_output_column_list=*/{}, std::move(row_list));
+
+    // Create output types.
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        const ArrayType* table_array_type,
+        CreateTableArrayType(stmt->table_scan()->column_list(),
+                             /*is_value_table=*/false, type_factory()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const StructType* primary_key_type,
+                         CreatePrimaryKeyType(stmt->table_scan()->column_list(),
+                                              /*key_column_indexes=*/{0},
+                                              type_factory()));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        const StructType* dml_output_type,
+        CreateDMLOutputType(table_array_type, type_factory()));
+
+    // The rows to insert are constants, and the table is not read through the
+    // ResolvedScanMap.
+    auto column_to_variable_mapping =
+        absl::make_unique<ColumnToVariableMapping>(
+            absl::make_unique<VariableGenerator>());
+    auto resolved_scan_map = absl::make_unique<ResolvedScanMap>();
+    auto resolved_expr_map = absl::make_unique<ResolvedExprMap>();
+    for (const auto& value : stmt->row_list(0)->value_list()) {
+      ZETASQL_ASSERT_OK_AND_ASSIGN(
+          std::unique_ptr<ValueExpr> const_expr,
+          ConstExpr::Create(value->value()->GetAs<ResolvedLiteral>()->value()));
+      (*resolved_expr_map)[value->value()] = std::move(const_expr);
+    }
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<DMLInsertValueExpr> expr,
+        DMLInsertValueExpr::Create(
+            &table, table_array_type, primary_key_type, dml_output_type,
+            stmt.get(), &stmt->table_scan()->column_list(),
+            std::move(column_to_variable_mapping), std::move(resolved_scan_map),
+            std::move(resolved_expr_map)));
+
+    // Evaluate and check.
+    EvaluationOptions options;
+    options.return_all_rows_for_dml = false;
+    options.use_primary_key_lookups_for_dml = true;
+    EvaluationContext context(options);
+    ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
+    TupleSlot result;
+    absl::Status status;
+    if (key == 3) {
+      ASSERT_TRUE(expr->EvalSimple({}, &context, &result, &status)) << status;
+      EXPECT_EQ(result.value().field(0).int64_value(), 1);
+      EXPECT_THAT(result.value().field(1).elements(),
+                  UnorderedElementsAre(Property(
+                      &Value::fields, ElementsAre(Int64(3), String("new")))));
+    } else {
+      EXPECT_FALSE(expr->EvalSimple({}, &context, &result, &status));
+      EXPECT_THAT(status, StatusIs(absl::StatusCode::kOutOfRange,
+                                   HasSubstr("previously existing row")));
+    }
+  }
+}
+
 TEST_F(DMLValueExprEvalTest, DMLDeleteValueExpr) {
   // Build a resolved AST for deleting rows where str_val is null from the
   // table.
@@ -0,0 +1,281 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/resolved_ast/flat_serialization.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "zetasql/base/logging.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/endian.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_builder.h"
+
+namespace zetasql {
+
+namespace {
+
+constexpr char kMagic[4] = {'Z', 'R', 'A', 'F'};
+constexpr uint32_t kVersion = 1;
+constexpr int kHeaderSize = 12;
+constexpr int kNodeTableEntrySize = 12;
+
+void AppendUint32To(uint32_t value, std::string* out) {
+  char buf[4];
+  zetasql_base::LittleEndian::Store32(buf, value);
+  out->append(buf, sizeof(buf));
+}
+
+}  // namespace
+
+int ResolvedASTFlatWriter::BeginNode(ResolvedNodeKind kind) {
+  const int node_index = static_cast<int>(nodes_.size());
+  nodes_.emplace_back();
+  nodes_.back().kind = kind;
+  node_stack_.push_back(node_index);
+  return node_index;
+}
+
+void ResolvedASTFlatWriter::EndNode() {
+  DCHECK(!node_stack_.empty());
+  node_stack_.pop_back();
+}
+
+void ResolvedASTFlatWriter::StartField() {
+  PendingNode* node = current();
+  node->field_offsets.push_back(static_cast<uint32_t>(node->data.size()));
+}
+
+void ResolvedASTFlatWriter::AppendBool(bool value) {
+  current()->data.push_back(value ? 1 : 0);
+}
+
+void ResolvedASTFlatWriter::AppendInt64(int64_t value) {
+  char buf[8];
+  zetasql_base::LittleEndian::Store64(buf, static_cast<uint64_t>(value));
+  current()->data.append(buf, sizeof(buf));
+}
+
+void ResolvedASTFlatWriter::AppendUint32(uint32_t value) {
+  AppendUint32To(value, &current()->data);
+}
+
+void ResolvedASTFlatWriter::AppendString(absl::string_view value) {
+  AppendUint32(static_cast<uint32_t>(value.size()));
+  current()->data.append(value.data(), value.size());
+}
+
+void ResolvedASTFlatWriter::AppendNodeIndex(int node_index) {
+  AppendUint32(node_index < 0 ? ResolvedASTFlatReader::kNullNodeIndex
+                              : static_cast<uint32_t>(node_index));
+}
+
+absl::Status ResolvedASTFlatWriter::AppendProto(
+    const google::protobuf::Message& proto) {
+  std::string bytes;
+  ZETASQL_RET_CHECK(proto.SerializeToString(&bytes))
+      << "Failed to serialize " << proto.GetTypeName();
+  AppendString(bytes);
+  return absl::OkStatus();
+}
+
+std::string ResolvedASTFlatWriter::Finish() {
+  DCHECK(node_stack_.empty());
+  std::string out;
+  out.append(kMagic, sizeof(kMagic));
+  AppendUint32To(kVersion, &out);
+  AppendUint32To(static_cast<uint32_t>(nodes_.size()), &out);
+
+  // Payloads are laid out in node order right after the node table.
+  uint32_t payload_offset =
+      kHeaderSize + kNodeTableEntrySize * static_cast<uint32_t>(nodes_.size());
+  for (const PendingNode& node : nodes_) {
+    const uint32_t payload_size =
+        4 * (1 + static_cast<uint32_t>(node.field_offsets.size())) +
+        static_cast<uint32_t>(node.data.size());
+    AppendUint32To(static_cast<uint32_t>(node.kind), &out);
+    AppendUint32To(payload_offset, &out);
+    AppendUint32To(payload_size, &out);
+    payload_offset += payload_size;
+  }
+  out.reserve(payload_offset);
+
+  for (PendingNode& node : nodes_) {
+    const uint32_t fields_start =
+        4 * (1 + static_cast<uint32_t>(node.field_offsets.size()));
+    AppendUint32To(static_cast<uint32_t>(node.field_offsets.size()), &out);
+    for (const uint32_t field_offset : node.field_offsets) {
+      AppendUint32To(fields_start + field_offset, &out);
+    }
+    out.append(node.data);
+    // Release the per-node buffer as soon as it has been copied.
+    std::string().swap(node.data);
+  }
+  DCHECK_EQ(out.size(), payload_offset);
+  nodes_.clear();
+  return out;
+}
+
+absl::Status ResolvedASTFlatReader::FieldReader::Truncated() const {
+  return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+         << "Truncated field in flat resolved AST";
+}
+
+zetasql_base::StatusOr<bool> ResolvedASTFlatReader::FieldReader::ReadBool() {
+  if (data_.empty()) return Truncated();
+  const bool value = data_[0] != 0;
+  data_.remove_prefix(1);
+  return value;
+}
+
+zetasql_base::StatusOr<int64_t> ResolvedASTFlatReader::FieldReader::ReadInt64() {
+  if (data_.size() < 8) return Truncated();
+  const int64_t value =
+      static_cast<int64_t>(zetasql_base::LittleEndian::Load64(data_.data()));
+  data_.remove_prefix(8);
+  return value;
+}
+
+zetasql_base::StatusOr<uint32_t> ResolvedASTFlatReader::FieldReader::ReadUint32() {
+  if (data_.size() < 4) return Truncated();
+  const uint32_t value = zetasql_base::LittleEndian::Load32(data_.data());
+  data_.remove_prefix(4);
+  return value;
+}
+
+zetasql_base::StatusOr<absl::string_view>
+ResolvedASTFlatReader::FieldReader::ReadString() {
+  ZETASQL_ASSIGN_OR_RETURN(const uint32_t size, ReadUint32());
+  if (data_.size() < size) return Truncated();
+  const absl::string_view value = data_.substr(0, size);
+  data_.remove_prefix(size);
+  return value;
+}
+
+zetasql_base::StatusOr<int> ResolvedASTFlatReader::FieldReader::ReadNodeIndex() {
+  ZETASQL_ASSIGN_OR_RETURN(const uint32_t node_index, ReadUint32());
+  if (node_index == kNullNodeIndex) return -1;
+  return static_cast<int>(node_index);
+}
+
+absl::Status ResolvedASTFlatReader::FieldReader::ReadProto(
+    google::protobuf::Message* proto) {
+  ZETASQL_ASSIGN_OR_RETURN(const absl::string_view bytes, ReadString());
+  if (!proto->ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Failed to parse " << proto->GetTypeName()
+           << " in flat resolved AST";
+  }
+  return absl::OkStatus();
+}
+
+zetasql_base::StatusOr<ResolvedASTFlatReader> ResolvedASTFlatReader::Create(
+    absl::string_view data) {
+  if (data.size() < kHeaderSize ||
+      memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Not a flat resolved AST";
+  }
+  const uint32_t version = zetasql_base::LittleEndian::Load32(data.data() + 4);
+  if (version != kVersion) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Unsupported flat resolved AST version " << version;
+  }
+  const uint32_t num_nodes = zetasql_base::LittleEndian::Load32(data.data() + 8);
+  if (num_nodes == 0 ||
+      (data.size() - kHeaderSize) / kNodeTableEntrySize < num_nodes) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Corrupt node table in flat resolved AST";
+  }
+  ResolvedASTFlatReader reader(data, static_cast<int>(num_nodes));
+  for (int i = 0; i < reader.num_nodes_; ++i) {
+    const uint64_t offset = reader.NodeTableEntry(i, 1);
+    const uint64_t size = reader.NodeTableEntry(i, 2);
+    if (offset + size > data.size()) {
+      return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+             << "Node " << i << " is out of bounds in flat resolved AST";
+    }
+  }
+  return reader;
+}
+
+uint32_t ResolvedASTFlatReader::NodeTableEntry(int node_index, int word) const {
+  return zetasql_base::LittleEndian::Load32(
+      data_.data() + kHeaderSize + kNodeTableEntrySize * node_index + 4 * word);
+}
+
+zetasql_base::StatusOr<ResolvedNodeKind> ResolvedASTFlatReader::node_kind(
+    int node_index) const {
+  ZETASQL_RET_CHECK_GE(node_index, 0);
+  ZETASQL_RET_CHECK_LT(node_index, num_nodes_);
+  return static_cast<ResolvedNodeKind>(NodeTableEntry(node_index, 0));
+}
+
+absl::string_view ResolvedASTFlatReader::Payload(int node_index) const {
+  return data_.substr(NodeTableEntry(node_index, 1),
+                      NodeTableEntry(node_index, 2));
+}
+
+zetasql_base::StatusOr<int> ResolvedASTFlatReader::num_fields(int node_index) const {
+  ZETASQL_RET_CHECK_GE(node_index, 0);
+  ZETASQL_RET_CHECK_LT(node_index, num_nodes_);
+  const absl::string_view payload = Payload(node_index);
+  FieldReader header(payload);
+  ZETASQL_ASSIGN_OR_RETURN(const uint32_t num_fields, header.ReadUint32());
+  if (num_fields > (payload.size() - 4) / 4) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Corrupt field table for node " << node_index
+           << " in flat resolved AST";
+  }
+  return static_cast<int>(num_fields);
+}
+
+zetasql_base::StatusOr<ResolvedASTFlatReader::FieldReader>
+ResolvedASTFlatReader::GetField(int node_index, int field_index) const {
+  ZETASQL_ASSIGN_OR_RETURN(const int num_fields, this->num_fields(node_index));
+  if (field_index < 0 || field_index >= num_fields) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Node " << node_index << " has no field " << field_index
+           << " in flat resolved AST";
+  }
+  const absl::string_view payload = Payload(node_index);
+  const uint32_t start =
+      zetasql_base::LittleEndian::Load32(payload.data() + 4 * (1 + field_index));
+  const uint32_t end =
+      field_index + 1 < num_fields
+          ? zetasql_base::LittleEndian::Load32(payload.data() +
+                                          4 * (2 + field_index))
+          : static_cast<uint32_t>(payload.size());
+  if (start > end || end > payload.size()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder(ZETASQL_LOC)
+           << "Corrupt field " << field_index << " for node " << node_index
+           << " in flat resolved AST";
+  }
+  return FieldReader(payload.substr(start, end - start));
+}
+
+int ResolvedASTFlatReader::FindField(ResolvedNodeKind kind,
+                                     absl::string_view field_name) {
+  const absl::Span<const char* const> names = ResolvedNodeFlatFieldNames(kind);
+  for (int i = 0; i < names.size(); ++i) {
+    if (field_name == names[i]) return i;
+  }
+  return -1;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,181 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_RESOLVED_AST_FLAT_SERIALIZATION_H_
+#define ZETASQL_RESOLVED_AST_FLAT_SERIALIZATION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "zetasql/resolved_ast/resolved_node_kind.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// Flat, offset-based binary encoding of a resolved AST.
+//
+// This is an alternative to the AnyResolvedNodeProto encoding produced by
+// ResolvedNode::SaveTo(). The proto encoding must be parsed in full before
+// anything can be read from it; the flat encoding can be read in place (e.g.
+// from an mmap'ed file) and individual node fields can be located in O(1)
+// without decoding the rest of the tree. A full ResolvedNode tree can still be
+// rebuilt with ResolvedNode::RestoreFromFlat().
+//
+// Layout (all integers are little-endian, unaligned):
+//
+//   Header:     "ZRAF" magic, uint32 version, uint32 num_nodes
+//   Node table: num_nodes entries of
+//                 {uint32 node_kind, uint32 payload_offset,
+//                  uint32 payload_size}
+//   Payloads:   for each node,
+//                 uint32 num_fields, uint32 field_offsets[num_fields],
+//                 followed by the encoded fields.
+//
+// Nodes are numbered in pre-order, so node 0 is always the root. Field
+// offsets are relative to the start of the node payload. Fields are numbered
+// in declaration order, starting with the fields inherited from the topmost
+// superclass; ResolvedNodeFlatFieldNames() returns the names in that order.
+// A node with a parse location range (see
+// ResolvedNode::GetParseLocationRangeOrNULL()) has one more field after those,
+// holding the filename as a string followed by the start and end byte offsets
+// as integers.
+//
+// Field encodings:
+//   bool:               1 byte
+//   integers and enums: int64
+//   string:             uint32 length, bytes
+//   child node:         uint32 node index, or kNullNodeIndex
+//   other scalars:      uint32 length, serialized proto (the same proto used
+//                       for that field in resolved_ast.proto)
+//   vectors:            uint32 count, followed by the encoded elements
+//
+// Like the proto encoding, Types that reference proto or enum descriptors are
+// written using a FileDescriptorSetMap that the caller must ship alongside the
+// buffer, and catalog objects are referenced by name.
+class ResolvedASTFlatWriter {
+ public:
+  ResolvedASTFlatWriter() {}
+  ResolvedASTFlatWriter(const ResolvedASTFlatWriter&) = delete;
+  ResolvedASTFlatWriter& operator=(const ResolvedASTFlatWriter&) = delete;
+
+  // Reserves the next node index for a node of <kind> and directs subsequent
+  // field writes to it until the matching EndNode(). Nodes may be nested, so
+  // a parent can write its children before writing the fields that refer to
+  // them.
+  int BeginNode(ResolvedNodeKind kind);
+  void EndNode();
+
+  // Starts the next field of the current node. Every field must be started
+  // before any of the Append methods below are called for it.
+  void StartField();
+
+  void AppendBool(bool value);
+  void AppendInt64(int64_t value);
+  void AppendUint32(uint32_t value);
+  void AppendString(absl::string_view value);
+  // Appends a child node reference; -1 encodes a null child.
+  void AppendNodeIndex(int node_index);
+  absl::Status AppendProto(const google::protobuf::Message& proto);
+
+  // Returns the encoded buffer. Must be called after all nodes are ended.
+  // The writer must not be used after this.
+  std::string Finish();
+
+ private:
+  struct PendingNode {
+    ResolvedNodeKind kind;
+    std::vector<uint32_t> field_offsets;
+    std::string data;
+  };
+
+  PendingNode* current() { return &nodes_[node_stack_.back()]; }
+
+  std::vector<PendingNode> nodes_;
+  std::vector<int> node_stack_;
+};
+
+// Read-only view over a buffer produced by ResolvedASTFlatWriter. Does not
+// copy or take ownership of the buffer, which must outlive the reader.
+// All accessors validate offsets against the buffer size, so corrupt input
+// results in an error rather than an out-of-bounds read.
+class ResolvedASTFlatReader {
+ public:
+  static constexpr uint32_t kNullNodeIndex = 0xFFFFFFFF;
+
+  // Sequential decoder over the bytes of a single field.
+  class FieldReader {
+   public:
+    explicit FieldReader(absl::string_view data) : data_(data) {}
+
+    zetasql_base::StatusOr<bool> ReadBool();
+    zetasql_base::StatusOr<int64_t> ReadInt64();
+    zetasql_base::StatusOr<uint32_t> ReadUint32();
+    // The returned string_view points into the underlying buffer.
+    zetasql_base::StatusOr<absl::string_view> ReadString();
+    // Returns -1 for a null child.
+    zetasql_base::StatusOr<int> ReadNodeIndex();
+    absl::Status ReadProto(google::protobuf::Message* proto);
+
+    bool at_end() const { return data_.empty(); }
+
+   private:
+    absl::Status Truncated() const;
+
+    absl::string_view data_;
+  };
+
+  // Validates the header and node table of <data>.
+  static zetasql_base::StatusOr<ResolvedASTFlatReader> Create(
+      absl::string_view data);
+
+  int num_nodes() const { return num_nodes_; }
+  zetasql_base::StatusOr<ResolvedNodeKind> node_kind(int node_index) const;
+
+  zetasql_base::StatusOr<int> num_fields(int node_index) const;
+
+  // Returns a decoder positioned at field <field_index> of node <node_index>.
+  zetasql_base::StatusOr<FieldReader> GetField(int node_index,
+                                       int field_index) const;
+
+  // Returns the index of the field called <field_name> for nodes of <kind>,
+  // or -1 if there is no such field.
+  static int FindField(ResolvedNodeKind kind, absl::string_view field_name);
+
+ private:
+  ResolvedASTFlatReader(absl::string_view data, int num_nodes)
+      : data_(data), num_nodes_(num_nodes) {}
+
+  // Returns the payload of node <node_index>.
+  absl::string_view Payload(int node_index) const;
+  uint32_t NodeTableEntry(int node_index, int word) const;
+
+  absl::string_view data_;
+  int num_nodes_;
+};
+
+// Returns the names of the fields of <kind> in flat encoding order.
+// Generated in resolved_ast.cc.
+absl::Span<const char* const> ResolvedNodeFlatFieldNames(
+    ResolvedNodeKind kind);
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_RESOLVED_AST_FLAT_SERIALIZATION_H_
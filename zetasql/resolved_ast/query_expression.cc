@@ -24,25 +24,23 @@
 
 namespace zetasql {
 
-// Joins entries present in <list> (with pairs as elements) separated by
-// <delimiter>. While appending each pair we add the second element (if present)
-// as an alias to the first element.
-static std::string JoinListWithAliases(
+// Appends entries present in <list> (with pairs as elements) separated by
+// <delimiter> to <sql>. While appending each pair we add the second element (if
+// present) as an alias to the first element.
+static void AppendListWithAliases(
     const std::vector<std::pair<std::string, std::string>>& list,
-    const std::string& delimiter) {
-  std::string list_str;
+    const std::string& delimiter, std::string* sql) {
   bool first = true;
   for (const auto& entry : list) {
-    if (!first) absl::StrAppend(&list_str, delimiter);
+    if (!first) absl::StrAppend(sql, delimiter);
 
     if (entry.second.empty()) {
-      absl::StrAppend(&list_str, entry.first);
+      absl::StrAppend(sql, entry.first);
     } else {
-      absl::StrAppend(&list_str, entry.first, " AS ", entry.second);
+      absl::StrAppend(sql, entry.first, " AS ", entry.second);
     }
     first = false;
   }
-  return list_str;
 }
 
 void QueryExpression::ClearAllClauses() {
@@ -51,6 +49,8 @@ void QueryExpression::ClearAllClauses() {
   select_as_modifier_.clear();
   query_hints_.clear();
   from_.clear();
+  from_subquery_.reset();
+  from_subquery_alias_.clear();
   where_.clear();
   set_op_type_.clear();
   set_op_modifier_.clear();
@@ -66,58 +66,69 @@ void QueryExpression::ClearAllClauses() {
 
 std::string QueryExpression::GetSQLQuery() const {
   std::string sql;
+  AppendSQLQuery(&sql);
+  return sql;
+}
+
+void QueryExpression::AppendSQLQuery(std::string* sql) const {
   if (!with_list_.empty()) {
-    absl::StrAppend(&sql, "WITH ");
+    absl::StrAppend(sql, "WITH ");
     if (with_recursive_) {
-      absl::StrAppend(&sql, "RECURSIVE ");
+      absl::StrAppend(sql, "RECURSIVE ");
     }
-    absl::StrAppend(&sql, JoinListWithAliases(with_list_, ", "), " ");
+    AppendListWithAliases(with_list_, ", ", sql);
+    absl::StrAppend(sql, " ");
   }
   if (!select_list_.empty()) {
     DCHECK(set_op_type_.empty() && set_op_modifier_.empty() &&
            set_op_scan_list_.empty());
-    absl::StrAppend(&sql, "SELECT ",
-                    query_hints_.empty() ? "" : absl::StrCat(query_hints_, " "),
-                    select_as_modifier_.empty()
-                        ? ""
-                        : absl::StrCat(select_as_modifier_, " "),
-                    JoinListWithAliases(select_list_, ", "));
+    absl::StrAppend(sql, "SELECT ");
+    if (!query_hints_.empty()) {
+      absl::StrAppend(sql, query_hints_, " ");
+    }
+    if (!select_as_modifier_.empty()) {
+      absl::StrAppend(sql, select_as_modifier_, " ");
+    }
+    AppendListWithAliases(select_list_, ", ", sql);
   }
 
   if (!set_op_scan_list_.empty()) {
     DCHECK(!set_op_type_.empty());
     DCHECK(!set_op_modifier_.empty());
     DCHECK(select_list_.empty());
-    DCHECK(from_.empty() && where_.empty() && group_by_list_.empty());
+    DCHECK(!HasFromClause() && where_.empty() && group_by_list_.empty());
     for (int i = 0; i < set_op_scan_list_.size(); ++i) {
       const auto& qe = set_op_scan_list_[i];
       if (i > 0) {
-        absl::StrAppend(&sql, " ", set_op_type_);
+        absl::StrAppend(sql, " ", set_op_type_);
         if (i == 1) {
-          absl::StrAppend(&sql, " ", query_hints_);
+          absl::StrAppend(sql, " ", query_hints_);
         }
-        absl::StrAppend(&sql, " ", set_op_modifier_);
+        absl::StrAppend(sql, " ", set_op_modifier_);
       }
-      absl::StrAppend(&sql, "(", qe->GetSQLQuery(), ")");
+      absl::StrAppend(sql, "(");
+      qe->AppendSQLQuery(sql);
+      absl::StrAppend(sql, ")");
     }
   }
 
-  if (!from_.empty()) {
-    absl::StrAppend(&sql, " FROM ", from_);
+  if (HasFromClause()) {
+    absl::StrAppend(sql, " FROM ");
+    AppendFromClause(sql);
   }
 
   if (!where_.empty()) {
-    absl::StrAppend(&sql, " WHERE ", where_);
+    absl::StrAppend(sql, " WHERE ", where_);
   }
 
   if (!group_by_list_.empty()) {
     absl::StrAppend(
-        &sql, " GROUP ",
+        sql, " GROUP ",
         group_by_hints_.empty() ? "" : absl::StrCat(group_by_hints_, " "),
         "BY ");
     if (!rollup_column_id_list_.empty()) {
       absl::StrAppend(
-          &sql, "ROLLUP(",
+          sql, "ROLLUP(",
           absl::StrJoin(rollup_column_id_list_, ", ",
                         [this](std::string* out, int column_id) {
                           absl::StrAppend(
@@ -128,7 +139,7 @@ std::string QueryExpression::GetSQLQuery() const {
       // We assume while iterating the group_by_list_, the entries will be
       // sorted by the column id.
       absl::StrAppend(
-          &sql,
+          sql,
           absl::StrJoin(
               group_by_list_, ", ",
               [](std::string* out,
@@ -140,20 +151,45 @@ std::string QueryExpression::GetSQLQuery() const {
 
   if (!order_by_list_.empty()) {
     absl::StrAppend(
-        &sql, " ORDER ",
+        sql, " ORDER ",
         order_by_hints_.empty() ? "" : absl::StrCat(order_by_hints_, " "),
         "BY ", absl::StrJoin(order_by_list_, ", "));
   }
 
   if (!limit_.empty()) {
-    absl::StrAppend(&sql, " LIMIT ", limit_);
+    absl::StrAppend(sql, " LIMIT ", limit_);
   }
 
   if (!offset_.empty()) {
-    absl::StrAppend(&sql, " OFFSET ", offset_);
+    absl::StrAppend(sql, " OFFSET ", offset_);
   }
+}
 
-  return sql;
+void QueryExpression::AppendFromClause(std::string* sql) const {
+  if (from_subquery_ == nullptr) {
+    absl::StrAppend(sql, from_);
+    return;
+  }
+  absl::StrAppend(sql, "(");
+  from_subquery_->AppendSQLQuery(sql);
+  absl::StrAppend(sql, ") AS ", from_subquery_alias_);
+}
+
+const std::string QueryExpression::FromClause() const {
+  std::string from;
+  AppendFromClause(&from);
+  return from;
+}
+
+std::string* QueryExpression::MutableFromClause() {
+  if (from_subquery_ != nullptr) {
+    // The caller edits the text, so the subquery has to be rendered now.
+    DCHECK(from_.empty());
+    AppendFromClause(&from_);
+    from_subquery_.reset();
+    from_subquery_alias_.clear();
+  }
+  return &from_;
 }
 
 bool QueryExpression::CanFormSQLQuery() const {
@@ -163,9 +199,11 @@ bool QueryExpression::CanFormSQLQuery() const {
 void QueryExpression::Wrap(const std::string& alias) {
   DCHECK(CanFormSQLQuery());
   DCHECK(!alias.empty());
-  const std::string sql = GetSQLQuery();
+  std::unique_ptr<const QueryExpression> subquery(
+      new QueryExpression(std::move(*this)));
   ClearAllClauses();
-  from_ = absl::StrCat("(", sql, ") AS ", alias);
+  from_subquery_ = std::move(subquery);
+  from_subquery_alias_ = alias;
 }
 
 bool QueryExpression::TrySetWithClause(
@@ -40,8 +40,14 @@ class QueryExpression {
 
   std::string GetSQLQuery() const;
 
+  // Appends the SQL query to <sql>. Subqueries, including the ones created by
+  // Wrap(), are written directly into <sql>, so the text of each clause is
+  // copied only once however deeply the query is nested.
+  void AppendSQLQuery(std::string* sql) const;
+
   // Mutates the QueryExpression, wrapping its previous form as a subquery in
-  // the from_ clause, with the given <alias>.
+  // the from_ clause, with the given <alias>. The previous form is kept as a
+  // QueryExpression and only turned into text when the FROM clause is needed.
   void Wrap(const std::string& alias);
 
   // The below TrySet... methods return true if we are able to set the concerned
@@ -84,7 +90,9 @@ class QueryExpression {
   // inside the QueryExpression. Otherwise false.
   bool HasWithClause() const { return !with_list_.empty(); }
   bool HasSelectClause() const { return !select_list_.empty(); }
-  bool HasFromClause() const { return !from_.empty(); }
+  bool HasFromClause() const {
+    return !from_.empty() || from_subquery_ != nullptr;
+  }
   bool HasWhereClause() const { return !where_.empty(); }
   bool HasSetOpScanList() const { return !set_op_scan_list_.empty(); }
   bool HasGroupByClause() const { return !group_by_list_.empty(); }
@@ -94,7 +102,7 @@ class QueryExpression {
 
   void ResetSelectClause();
 
-  const std::string FromClause() const { return from_; }
+  const std::string FromClause() const;
 
   // Returns an immutable reference to select_list_. For QueryExpression built
   // from a SetOp scan, it returns the select_list_ of its first subquery.
@@ -116,7 +124,7 @@ class QueryExpression {
   // Returns a mutable pointer to the from_ clause of QueryExpression. Used
   // while building sql for a sample scan so as to rewrite the from_ clause to
   // include the TABLESAMPLE clause.
-  std::string* MutableFromClause() { return &from_; }
+  std::string* MutableFromClause();
 
   // Returns a mutable pointer to the select_list_ of QueryExpression. Used
   // while building sql for a sample scan that has a WITH WEIGHT clause.
@@ -125,8 +133,14 @@ class QueryExpression {
   }
 
  private:
+  // Moves all clauses of <other> into the new QueryExpression. Used by Wrap().
+  QueryExpression(QueryExpression&& other) = default;
+
   void ClearAllClauses();
 
+  // Appends the text of the FROM clause, without the FROM keyword, to <sql>.
+  void AppendFromClause(std::string* sql) const;
+
   // Fields below define the text associated with different clauses of a SQL
   // query. Some principles:
   // * The text does not include the keyword corresponding to the clause.
@@ -144,6 +158,10 @@ class QueryExpression {
   std::string query_hints_;
 
   std::string from_;
+  // Set instead of from_ by Wrap(). The FROM clause is this subquery, in
+  // parentheses, with alias <from_subquery_alias_>.
+  std::unique_ptr<const QueryExpression> from_subquery_;
+  std::string from_subquery_alias_;
   std::string where_;
 
   // Contains the keyword corresponding to the set operation (UNION | INTERSECT
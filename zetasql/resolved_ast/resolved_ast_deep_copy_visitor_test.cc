@@ -26,6 +26,7 @@
 #include "zetasql/public/function.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
+#include "zetasql/public/parse_location.h"
 #include "zetasql/public/simple_catalog.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
@@ -305,6 +306,11 @@ std::unique_ptr<ResolvedNode> ResolvedASTDeepCopyVisitorTest::TestDeepCopyAST(
   // Verify that the debug string matches.
   EXPECT_EQ(original_debug_string, deep_copy_ast->DebugString());
 
+  // CopyResolvedAST must produce the same tree as the visitor.
+  std::unique_ptr<ResolvedStatement> direct_copy =
+      CopyResolvedAST(analyzer_outputs_.back()->resolved_statement());
+  EXPECT_EQ(original_debug_string, direct_copy->DebugString());
+
   return deep_copy_ast;
 }
 
@@ -476,4 +482,33 @@ TEST_F(ResolvedASTDeepCopyVisitorTest, TestCastFilterScan) {
   ASSERT_EQ(ast->DebugString(), desired_ast->DebugString());
 }
 
+TEST(CopyResolvedASTTest, CopiesAllFields) {
+  EXPECT_EQ(nullptr, CopyResolvedAST<ResolvedScan>(nullptr));
+
+  std::unique_ptr<ResolvedLiteral> filter_expr =
+      MakeResolvedLiteral(types::BoolType(), Value::Bool(true));
+  ParseLocationRange location;
+  location.set_start(ParseLocationPoint::FromByteOffset(3));
+  location.set_end(ParseLocationPoint::FromByteOffset(7));
+  filter_expr->SetParseLocationRange(location);
+
+  std::unique_ptr<ResolvedFilterScan> scan = MakeResolvedFilterScan(
+      /*column_list=*/{}, MakeResolvedSingleRowScan(), std::move(filter_expr));
+  scan->add_hint_list(MakeResolvedOption(
+      "", "key", MakeResolvedLiteral(types::Int64Type(), Value::Int64(5))));
+  scan->set_is_ordered(true);
+
+  std::unique_ptr<ResolvedFilterScan> copy = CopyResolvedAST(scan.get());
+  ASSERT_NE(nullptr, copy);
+  EXPECT_NE(scan.get(), copy.get());
+  EXPECT_EQ(scan->DebugString(), copy->DebugString());
+  EXPECT_TRUE(copy->is_ordered());
+  ASSERT_EQ(1, copy->hint_list_size());
+  EXPECT_NE(scan->hint_list(0), copy->hint_list(0));
+  EXPECT_NE(scan->input_scan(), copy->input_scan());
+  ASSERT_NE(nullptr, copy->filter_expr()->GetParseLocationRangeOrNULL());
+  EXPECT_EQ(location.GetString(),
+            copy->filter_expr()->GetParseLocationRangeOrNULL()->GetString());
+}
+
 }  // namespace zetasql
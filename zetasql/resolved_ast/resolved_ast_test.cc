@@ -31,6 +31,7 @@
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
 #include "zetasql/public/value.pb.h"
+#include "zetasql/resolved_ast/flat_serialization.h"
 #include "zetasql/resolved_ast/make_node_vector.h"
 #include "zetasql/resolved_ast/resolved_node_kind.h"
 #include "zetasql/resolved_ast/serialization.pb.h"
@@ -42,11 +43,14 @@
 namespace zetasql {
 
 using testing::ContainerEq;
+using testing::Contains;
 using testing::ElementsAre;
 using testing::HasSubstr;
+using testing::Ne;
 using testing::NotNull;
 using testing::UnorderedElementsAre;
 using testing::UnorderedElementsAreArray;
+using zetasql_base::testing::IsOkAndHolds;
 using zetasql_base::testing::StatusIs;
 
 static const SimpleTable* t1 = new SimpleTable("T1");
@@ -495,6 +499,172 @@ TEST(ResolvedAST, Validator) {
           HasSubstr("ResolvedExpr does not have a Type:\nLiteral(value=4)")));
 }
 
+TEST(ResolvedAST, IncrementalValidator) {
+  TypeFactory type_factory;
+  SimpleColumn column1("table", "col1", types::Int64Type());
+  SimpleTable table("table", {&column1}, false, 123);
+  const ResolvedColumn resolved_column1(1, "Table", "col1",
+                                        type_factory.get_int64());
+  const ResolvedColumn resolved_column2(2, "Table", "col2",
+                                        type_factory.get_int64());
+
+  auto table_scan_uptr =
+      MakeResolvedTableScan({resolved_column1}, &table, nullptr);
+  ResolvedTableScan* table_scan = table_scan_uptr.get();
+  auto filter_scan_uptr = MakeResolvedFilterScan(
+      {resolved_column1}, std::move(table_scan_uptr),
+      MakeResolvedLiteral(type_factory.get_bool(), Value::Bool(true)));
+  ResolvedFilterScan* filter_scan = filter_scan_uptr.get();
+  auto stmt = MakeResolvedQueryStmt(
+      MakeNodeVector(MakeResolvedOutputColumn("col1", resolved_column1)),
+      false /* is_value_table */, std::move(filter_scan_uptr));
+
+  ValidatorOptions options;
+  options.incremental = true;
+  Validator validator(LanguageOptions(), options);
+  EXPECT_FALSE(table_scan->IsMarkedValidated());
+  ZETASQL_EXPECT_OK(validator.ValidateResolvedStatement(stmt.get()));
+  EXPECT_TRUE(stmt->IsMarkedValidated());
+  EXPECT_TRUE(filter_scan->IsMarkedValidated());
+  EXPECT_TRUE(table_scan->IsMarkedValidated());
+  EXPECT_TRUE(filter_scan->filter_expr()->IsMarkedValidated());
+
+  // Setters clear the marker, so the modified node is validated again.
+  filter_scan->set_column_list({resolved_column2});
+  EXPECT_FALSE(filter_scan->IsMarkedValidated());
+  EXPECT_TRUE(table_scan->IsMarkedValidated());
+  EXPECT_THAT(validator.ValidateResolvedStatement(stmt.get()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Column list contains column Table.col2#2 not "
+                                 "visible in scan node\n"
+                                 "FilterScan")));
+
+  // A replaced child is a new node without the marker.
+  filter_scan->set_column_list({resolved_column1});
+  filter_scan->set_filter_expr(MakeResolvedLiteral(nullptr, Value::Bool(true)));
+  EXPECT_THAT(
+      validator.ValidateResolvedStatement(stmt.get()),
+      StatusIs(absl::StatusCode::kInternal,
+               HasSubstr("ResolvedExpr does not have a Type:\nLiteral")));
+  filter_scan->set_filter_expr(
+      MakeResolvedLiteral(type_factory.get_bool(), Value::Bool(true)));
+  ZETASQL_EXPECT_OK(validator.ValidateResolvedStatement(stmt.get()));
+
+  // Subtrees with markers are skipped in incremental mode only.
+  table_scan->set_column_list({resolved_column2});
+  table_scan->SetValidatedMarker(true);
+  ZETASQL_EXPECT_OK(validator.ValidateResolvedStatement(stmt.get()));
+  EXPECT_THAT(Validator().ValidateResolvedStatement(stmt.get()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Column list contains column Table.col1#1 not "
+                                 "visible in scan node\n"
+                                 "FilterScan")));
+}
+
+TEST(ResolvedAST, IncrementalValidatorReplacedInputScan) {
+  SimpleColumn column1("table", "col1", types::BoolType());
+  SimpleColumn column2("table", "col2", types::BoolType());
+  SimpleTable table("table", {&column1, &column2}, false, 123);
+  const ResolvedColumn resolved_column1(1, "Table", "col1", types::BoolType());
+  const ResolvedColumn resolved_column2(2, "Table", "col2", types::BoolType());
+
+  auto filter_scan_uptr = MakeResolvedFilterScan(
+      {resolved_column1},
+      MakeResolvedTableScan({resolved_column1}, &table, nullptr),
+      MakeResolvedColumnRef(types::BoolType(), resolved_column1,
+                            false /* is_correlated */));
+  ResolvedFilterScan* filter_scan = filter_scan_uptr.get();
+  auto stmt = MakeResolvedQueryStmt(
+      MakeNodeVector(MakeResolvedOutputColumn("col1", resolved_column1)),
+      false /* is_value_table */, std::move(filter_scan_uptr));
+
+  ValidatorOptions options;
+  options.incremental = true;
+  Validator validator(LanguageOptions(), options);
+  ZETASQL_EXPECT_OK(validator.ValidateResolvedStatement(stmt.get()));
+  EXPECT_TRUE(filter_scan->filter_expr()->IsMarkedValidated());
+
+  // The filter expression keeps its marker, but the column it references is
+  // no longer produced by the new input scan.
+  filter_scan->set_input_scan(
+      MakeResolvedTableScan({resolved_column2}, &table, nullptr));
+  filter_scan->set_column_list({resolved_column2});
+  std::vector<std::unique_ptr<const ResolvedOutputColumn>> output_column_list;
+  output_column_list.push_back(
+      MakeResolvedOutputColumn("col2", resolved_column2));
+  stmt->set_output_column_list(std::move(output_column_list));
+  EXPECT_TRUE(filter_scan->filter_expr()->IsMarkedValidated());
+  EXPECT_THAT(validator.ValidateResolvedStatement(stmt.get()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Incorrect reference to column "
+                                 "Table.col1#1")));
+}
+
+// Returns a balanced tree of inner joins over <num_leaves> table scans that
+// each produce one new column. If <bad_leaf> is a valid index, that leaf is
+// wrapped in a FilterScan with an invalid column list.
+static std::unique_ptr<ResolvedScan> MakeJoinTree(const Table* table,
+                                                  int first_leaf,
+                                                  int num_leaves,
+                                                  int bad_leaf) {
+  if (num_leaves == 1) {
+    const ResolvedColumn column(first_leaf + 1, "T", "c", types::Int64Type());
+    std::unique_ptr<ResolvedScan> scan =
+        MakeResolvedTableScan({column}, table, nullptr);
+    if (first_leaf == bad_leaf) {
+      const ResolvedColumn other_column(1000, "T", "other",
+                                        types::Int64Type());
+      scan = MakeResolvedFilterScan(
+          {column, other_column}, std::move(scan),
+          MakeResolvedLiteral(types::BoolType(), Value::Bool(true)));
+    }
+    return scan;
+  }
+  const int num_left = num_leaves / 2;
+  std::unique_ptr<ResolvedScan> left =
+      MakeJoinTree(table, first_leaf, num_left, bad_leaf);
+  std::unique_ptr<ResolvedScan> right = MakeJoinTree(
+      table, first_leaf + num_left, num_leaves - num_left, bad_leaf);
+  ResolvedColumnList column_list = left->column_list();
+  column_list.insert(column_list.end(), right->column_list().begin(),
+                     right->column_list().end());
+  return MakeResolvedJoinScan(column_list, ResolvedJoinScan::INNER,
+                              std::move(left), std::move(right),
+                              nullptr /* join_expr */);
+}
+
+TEST(ResolvedAST, ParallelValidator) {
+  SimpleColumn column("table", "col", types::Int64Type());
+  SimpleTable table("table", {&column}, false, 123);
+  ValidatorOptions options;
+  options.num_threads = 4;
+  options.parallel_min_subtree_size = 1;
+
+  for (int bad_leaf = -1; bad_leaf < 16; ++bad_leaf) {
+    std::unique_ptr<ResolvedScan> join_tree =
+        MakeJoinTree(&table, 0, 16, bad_leaf);
+    const ResolvedScan* join_tree_ptr = join_tree.get();
+    const ResolvedColumn output_column = join_tree->column_list(0);
+    auto stmt = MakeResolvedQueryStmt(
+        MakeNodeVector(MakeResolvedOutputColumn("c", output_column)),
+        false /* is_value_table */, std::move(join_tree));
+    Validator validator(LanguageOptions(), options);
+    if (bad_leaf < 0) {
+      ZETASQL_EXPECT_OK(validator.ValidateResolvedStatement(stmt.get()));
+      // Nodes are only marked as validated in incremental mode.
+      EXPECT_FALSE(join_tree_ptr->IsMarkedValidated());
+    } else {
+      EXPECT_THAT(validator.ValidateResolvedStatement(stmt.get()),
+                  StatusIs(absl::StatusCode::kInternal,
+                           HasSubstr("Column list contains column T.other#1000 "
+                                     "not visible in scan node\n"
+                                     "FilterScan")))
+          << bad_leaf;
+      EXPECT_FALSE(join_tree_ptr->IsMarkedValidated());
+    }
+  }
+}
+
 TEST(ResolvedAST, GetChildNodes) {
   // One child.
   {
@@ -995,4 +1165,137 @@ TEST(ResolvedAST, ConstantDeserialization) {
   EXPECT_EQ(deserialized_constant->FullName(), constant_fullname);
 }
 
+// Appends the parse location range of <node> and its descendants to
+// <locations> in pre-order, with empty strings for nodes without one.
+static void CollectParseLocations(const ResolvedNode* node,
+                                  std::vector<std::string>* locations) {
+  const ParseLocationRange* location = node->GetParseLocationRangeOrNULL();
+  locations->push_back(location == nullptr ? "" : location->GetString());
+  std::vector<const ResolvedNode*> children;
+  node->GetChildNodes(&children);
+  for (const ResolvedNode* child : children) {
+    CollectParseLocations(child, locations);
+  }
+}
+
+TEST(ResolvedAST, FlatSerializationRoundTrip) {
+  SimpleColumn column("bar" /* table_name */, "baz" /* name */,
+                      types::Int64Type());
+  SimpleTable table("bar", {&column}, false /* takes_ownership */,
+                    123 /* id */);
+  SimpleCatalog catalog("foo");
+  catalog.AddTable(&table);
+  TypeFactory factory;
+  const Type* type;
+  ZETASQL_ASSERT_OK(factory.MakeProtoType(ValueProto::descriptor(), &type));
+  catalog.AddType("ZetaSQLValueProto", type);
+  AnalyzerOptions analyzer_options;
+  analyzer_options.set_record_parse_locations(true);
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(zetasql::AnalyzeStatement(
+      "select as struct baz + 1 AS x, 'abc' AS y, "
+      "new ZetaSQLValueProto(1 AS int32_value) AS z "
+      "from bar t where baz > 2 order by x",
+      analyzer_options, &catalog, &factory, &output));
+
+  FileDescriptorSetMap map;
+  std::string flat;
+  ZETASQL_ASSERT_OK(output->resolved_statement()->SaveToFlat(&map, &flat));
+
+  std::vector<const google::protobuf::DescriptorPool*> pools;
+  for (const auto& entry : map) pools.push_back(entry.first);
+
+  IdStringPool string_pool;
+  ResolvedNode::RestoreParams restore_params(pools, &catalog, &factory,
+                                             &string_pool);
+
+  auto ast =
+      std::move(ResolvedNode::RestoreFromFlat(flat, restore_params).value());
+  EXPECT_EQ(output->resolved_statement()->DebugString(), ast->DebugString());
+
+  std::vector<std::string> locations;
+  CollectParseLocations(output->resolved_statement(), &locations);
+  std::vector<std::string> restored_locations;
+  CollectParseLocations(ast.get(), &restored_locations);
+  EXPECT_THAT(locations, Contains(Ne("")));
+  EXPECT_EQ(locations, restored_locations);
+
+  // The filename is copied out of the buffer.
+  auto literal = MakeResolvedLiteral(Value::Int64(1));
+  ParseLocationRange literal_location;
+  literal_location.set_start(ParseLocationPoint::FromByteOffset("f.sql", 3));
+  literal_location.set_end(ParseLocationPoint::FromByteOffset("f.sql", 5));
+  literal->SetParseLocationRange(literal_location);
+  std::string literal_flat;
+  ZETASQL_ASSERT_OK(literal->SaveToFlat(&map, &literal_flat));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ResolvedNode> restored_literal,
+      ResolvedNode::RestoreFromFlat(literal_flat, restore_params));
+  literal_flat.assign(literal_flat.size(), '\0');
+  ASSERT_THAT(restored_literal->GetParseLocationRangeOrNULL(), NotNull());
+  EXPECT_EQ("f.sql:3-5",
+            restored_literal->GetParseLocationRangeOrNULL()->GetString());
+
+  EXPECT_THAT(ResolvedNode::RestoreFromFlat(flat.substr(0, flat.size() / 2),
+                                            restore_params),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ResolvedNode::RestoreFromFlat("garbage", restore_params),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ResolvedAST, FlatSerializationFieldAccess) {
+  SimpleColumn column("bar" /* table_name */, "baz" /* name */,
+                      types::Int64Type());
+  SimpleTable table("bar", {&column}, false /* takes_ownership */,
+                    123 /* id */);
+  SimpleCatalog catalog("foo");
+  catalog.AddTable(&table);
+  TypeFactory factory;
+  std::unique_ptr<const AnalyzerOutput> output;
+  ZETASQL_ASSERT_OK(zetasql::AnalyzeStatement("select baz from bar t;",
+                                        AnalyzerOptions(), &catalog, &factory,
+                                        &output));
+  FileDescriptorSetMap map;
+  std::string flat;
+  ZETASQL_ASSERT_OK(output->resolved_statement()->SaveToFlat(&map, &flat));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const ResolvedASTFlatReader reader,
+                       ResolvedASTFlatReader::Create(flat));
+  EXPECT_THAT(reader.node_kind(0), IsOkAndHolds(RESOLVED_QUERY_STMT));
+  EXPECT_FALSE(reader.node_kind(-1).ok());
+  EXPECT_FALSE(reader.node_kind(reader.num_nodes()).ok());
+
+  // Find the table scan without deserializing the tree.
+  int table_scan_index = -1;
+  for (int i = 0; i < reader.num_nodes(); ++i) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const ResolvedNodeKind kind,
+                         reader.node_kind(i));
+    if (kind == RESOLVED_TABLE_SCAN) table_scan_index = i;
+  }
+  ASSERT_GT(table_scan_index, 0);
+
+  const int table_field =
+      ResolvedASTFlatReader::FindField(RESOLVED_TABLE_SCAN, "table");
+  ASSERT_GE(table_field, 0);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedASTFlatReader::FieldReader table_reader,
+                       reader.GetField(table_scan_index, table_field));
+  TableRefProto table_ref;
+  ZETASQL_ASSERT_OK(table_reader.ReadProto(&table_ref));
+  EXPECT_EQ("bar", table_ref.name());
+  EXPECT_EQ(123, table_ref.serialization_id());
+
+  const int alias_field =
+      ResolvedASTFlatReader::FindField(RESOLVED_TABLE_SCAN, "alias");
+  ASSERT_GE(alias_field, 0);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(ResolvedASTFlatReader::FieldReader alias_reader,
+                       reader.GetField(table_scan_index, alias_field));
+  EXPECT_THAT(alias_reader.ReadString(), IsOkAndHolds("t"));
+  EXPECT_TRUE(alias_reader.at_end());
+
+  EXPECT_EQ(-1, ResolvedASTFlatReader::FindField(RESOLVED_TABLE_SCAN,
+                                                 "no_such_field"));
+  EXPECT_THAT(reader.GetField(table_scan_index, 1000),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 }  // namespace zetasql
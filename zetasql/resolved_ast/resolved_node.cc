@@ -28,6 +28,7 @@
 #include "zetasql/public/strings.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/flat_serialization.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/public/parse_location_range.pb.h"
@@ -270,6 +271,68 @@ absl::Status ResolvedNode::SaveTo(FileDescriptorSetMap* file_descriptor_set_map,
   return absl::OkStatus();
 }
 
+absl::Status ResolvedNode::SaveToFlat(
+    FileDescriptorSetMap* file_descriptor_set_map, std::string* output) const {
+  ResolvedASTFlatWriter writer;
+  ZETASQL_RETURN_IF_ERROR(SaveToFlat(file_descriptor_set_map, &writer).status());
+  *output = writer.Finish();
+  return absl::OkStatus();
+}
+
+zetasql_base::StatusOr<int> ResolvedNode::SaveToFlat(
+    FileDescriptorSetMap* file_descriptor_set_map,
+    ResolvedASTFlatWriter* writer) const {
+  const int node_index = writer->BeginNode(node_kind());
+  ZETASQL_RETURN_IF_ERROR(SaveFieldsToFlat(file_descriptor_set_map, writer));
+  const ParseLocationRange* parse_location_range =
+      GetParseLocationRangeOrNULL();
+  if (parse_location_range != nullptr) {
+    ZETASQL_RET_CHECK_EQ(parse_location_range->start().filename(),
+                 parse_location_range->end().filename());
+    writer->StartField();
+    writer->AppendString(parse_location_range->start().filename());
+    writer->AppendInt64(parse_location_range->start().GetByteOffset());
+    writer->AppendInt64(parse_location_range->end().GetByteOffset());
+  }
+  writer->EndNode();
+  return node_index;
+}
+
+absl::Status ResolvedNode::RestoreParseLocationRangeFromFlat(
+    const ResolvedASTFlatReader& reader, int node_index,
+    const RestoreParams& params) {
+  const int location_field =
+      static_cast<int>(ResolvedNodeFlatFieldNames(node_kind()).size());
+  ZETASQL_ASSIGN_OR_RETURN(const int num_fields, reader.num_fields(node_index));
+  if (num_fields == location_field) {
+    return absl::OkStatus();
+  }
+  ZETASQL_RET_CHECK_EQ(num_fields, location_field + 1);
+  ZETASQL_ASSIGN_OR_RETURN(ResolvedASTFlatReader::FieldReader in,
+                   reader.GetField(node_index, location_field));
+  ZETASQL_ASSIGN_OR_RETURN(const absl::string_view filename, in.ReadString());
+  ZETASQL_ASSIGN_OR_RETURN(const int64_t start, in.ReadInt64());
+  ZETASQL_ASSIGN_OR_RETURN(const int64_t end, in.ReadInt64());
+  // The restored location must not point into the flat buffer.
+  const absl::string_view stored_filename =
+      filename.empty() ? absl::string_view()
+                       : params.string_pool->Make(filename).ToStringView();
+  ParseLocationRange parse_location_range;
+  parse_location_range.set_start(ParseLocationPoint::FromByteOffset(
+      stored_filename, static_cast<int>(start)));
+  parse_location_range.set_end(ParseLocationPoint::FromByteOffset(
+      stored_filename, static_cast<int>(end)));
+  SetParseLocationRange(parse_location_range);
+  return absl::OkStatus();
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> ResolvedNode::RestoreFromFlat(
+    absl::string_view data, const RestoreParams& params) {
+  ZETASQL_ASSIGN_OR_RETURN(const ResolvedASTFlatReader reader,
+                   ResolvedASTFlatReader::Create(data));
+  return RestoreFromFlat(reader, /*node_index=*/0, params);
+}
+
 // Methods for classes in the generated code with customized DebugStrings.
 
 // ResolvedComputedColumn gets formatted as
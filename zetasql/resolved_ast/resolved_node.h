@@ -17,6 +17,7 @@
 #ifndef ZETASQL_RESOLVED_AST_RESOLVED_NODE_H_
 #define ZETASQL_RESOLVED_AST_RESOLVED_NODE_H_
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -31,11 +32,14 @@
 #include "zetasql/resolved_ast/resolved_ast.pb.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "zetasql/resolved_ast/serialization.pb.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
 namespace zetasql {
 
+class ResolvedASTFlatReader;
+class ResolvedASTFlatWriter;
 class ResolvedASTVisitor;
 
 // This is the base class for the resolved AST.
@@ -153,6 +157,27 @@ class ResolvedNode {
   static zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> RestoreFrom(
       const AnyResolvedNodeProto& proto, const RestoreParams& params);
 
+  // Serializes this node and its subtree into the flat encoding described in
+  // flat_serialization.h, which can be read in place without deserializing.
+  // <file_descriptor_set_map> is used as in SaveTo().
+  absl::Status SaveToFlat(FileDescriptorSetMap* file_descriptor_set_map,
+                          std::string* output) const;
+
+  // Appends this node and its subtree to <writer>, returning the index of
+  // this node.
+  zetasql_base::StatusOr<int> SaveToFlat(
+      FileDescriptorSetMap* file_descriptor_set_map,
+      ResolvedASTFlatWriter* writer) const;
+
+  // Deserializes the root node of a buffer produced by SaveToFlat().
+  static zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> RestoreFromFlat(
+      absl::string_view data, const RestoreParams& params);
+
+  // Deserializes node <node_index> of <reader>, of any node type.
+  static zetasql_base::StatusOr<std::unique_ptr<ResolvedNode>> RestoreFromFlat(
+      const ResolvedASTFlatReader& reader, int node_index,
+      const RestoreParams& params);
+
   std::string DebugString() const;
 
   // Check if any semantically meaningful fields have not been accessed in
@@ -254,7 +279,32 @@ class ResolvedNode {
   // depth. Returns 1 if the current node is a leaf.
   const int GetTreeDepth() const;
 
+  // Returns true if this node has been marked as validated by the Validator
+  // and has not been modified through its setters since. The marker only
+  // covers this node's own fields; replacing a child installs a new, unmarked
+  // node. See ValidatorOptions::incremental.
+  bool IsMarkedValidated() const {
+    return validated_marker_.load(std::memory_order_relaxed);
+  }
+  void SetValidatedMarker(bool validated) const {
+    validated_marker_.store(validated, std::memory_order_relaxed);
+  }
+
  protected:
+  // Appends the fields of this node, starting with those of its topmost
+  // superclass, to the current node of <writer>.
+  virtual absl::Status SaveFieldsToFlat(
+      FileDescriptorSetMap* file_descriptor_set_map,
+      ResolvedASTFlatWriter* writer) const {
+    return absl::OkStatus();
+  }
+
+  // Restores the parse location range that SaveToFlat() wrote after the
+  // fields of node <node_index> of <reader>, if there is one.
+  absl::Status RestoreParseLocationRangeFromFlat(
+      const ResolvedASTFlatReader& reader, int node_index,
+      const RestoreParams& params);
+
   // Struct used to collect all fields that should be printed in DebugString.
   struct DebugStringField {
     DebugStringField(const std::string& name_in, const std::string& value_in)
@@ -332,6 +382,9 @@ class ResolvedNode {
   friend class ResolvedOutputColumn;
 
   std::unique_ptr<ParseLocationRange> parse_location_range_;  // May be NULL.
+
+  // Atomic so that the same tree can be validated from several threads.
+  mutable std::atomic<bool> validated_marker_ = {false};
 };
 
 }  // namespace zetasql
@@ -972,8 +972,9 @@ absl::Status SQLBuilder::VisitResolvedSubqueryExpr(
       result->query_expression.release());
   ZETASQL_RETURN_IF_ERROR(AddSelectListIfNeeded(node->subquery()->column_list(),
                                         subquery_result.get()));
-  absl::StrAppend(&text, "(", subquery_result->GetSQLQuery(), ")",
-                  node->in_expr() == nullptr ? "" : ")");
+  absl::StrAppend(&text, "(");
+  subquery_result->AppendSQLQuery(&text);
+  absl::StrAppend(&text, ")", node->in_expr() == nullptr ? "" : ")");
 
   // Dummy access on the parameter list so as to pass the final
   // CheckFieldsAccessed() on a statement level before building the sql.
@@ -2204,9 +2205,11 @@ absl::Status SQLBuilder::VisitResolvedWithScan(const ResolvedWithScan* node) {
     ZETASQL_RETURN_IF_ERROR(
         AddSelectListIfNeeded(scan->column_list(), query_expression.get()));
 
-    with_list.push_back(std::make_pair(
-        ToIdentifierLiteral(name),
-        absl::StrCat("(", query_expression->GetSQLQuery(), ")")));
+    std::string with_query = "(";
+    query_expression->AppendSQLQuery(&with_query);
+    absl::StrAppend(&with_query, ")");
+    with_list.push_back(
+        std::make_pair(ToIdentifierLiteral(name), std::move(with_query)));
     SetPathForColumnList(scan->column_list(), ToIdentifierLiteral(name));
 
     if (actually_recursive) {
@@ -2446,7 +2449,7 @@ absl::Status SQLBuilder::VisitResolvedQueryStmt(const ResolvedQueryStmt* node) {
     ZETASQL_RET_CHECK_EQ(query_expression->SelectList().size(), 1);
     query_expression->SetSelectAsModifier("AS VALUE");
   }
-  absl::StrAppend(&sql, query_expression->GetSQLQuery());
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
@@ -2573,7 +2576,8 @@ absl::Status SQLBuilder::GetCreateViewStatement(
     ZETASQL_RET_CHECK_EQ(query_expression->SelectList().size(), 1);
     query_expression->SetSelectAsModifier("AS VALUE");
   }
-  absl::StrAppend(&sql, "AS ", query_expression->GetSQLQuery());
+  absl::StrAppend(&sql, "AS ");
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
@@ -2915,7 +2919,8 @@ absl::Status SQLBuilder::VisitResolvedCreateTableAsSelectStmt(
     ZETASQL_RET_CHECK_EQ(query_expression->SelectList().size(), 1);
     query_expression->SetSelectAsModifier(" AS VALUE");
   }
-  absl::StrAppend(&sql, " AS ", query_expression->GetSQLQuery());
+  absl::StrAppend(&sql, " AS ");
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
@@ -3015,7 +3020,8 @@ absl::Status SQLBuilder::VisitResolvedCreateModelStmt(
   }
 
   // Append SELECT statement.
-  absl::StrAppend(&sql, " AS ", query_expression->GetSQLQuery());
+  absl::StrAppend(&sql, " AS ");
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
@@ -3179,7 +3185,8 @@ absl::Status SQLBuilder::VisitResolvedCreateMaterializedViewStmt(
     ZETASQL_RET_CHECK_EQ(query_expression->SelectList().size(), 1);
     query_expression->SetSelectAsModifier(" AS VALUE");
   }
-  absl::StrAppend(&sql, " AS ", query_expression->GetSQLQuery());
+  absl::StrAppend(&sql, " AS ");
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
@@ -3349,7 +3356,8 @@ absl::Status SQLBuilder::VisitResolvedCreateTableFunctionStmt(
                      ProcessQuery(node->query(),
                                   node->output_column_list()));
     std::unique_ptr<QueryExpression> query_expression(query_result);
-    absl::StrAppend(&sql, " AS ", query_expression->GetSQLQuery());
+    absl::StrAppend(&sql, " AS ");
+    query_expression->AppendSQLQuery(&sql);
   } else if (!node->code().empty()) {
     if (is_external_language) {
       absl::StrAppend(&sql, " AS ", ToStringLiteral(node->code()));
@@ -3445,7 +3453,8 @@ absl::Status SQLBuilder::VisitResolvedExportDataStmt(
     ZETASQL_RET_CHECK_EQ(query_expression->SelectList().size(), 1);
     query_expression->SetSelectAsModifier("AS VALUE");
   }
-  absl::StrAppend(&sql, "AS ", query_expression->GetSQLQuery());
+  absl::StrAppend(&sql, "AS ");
+  query_expression->AppendSQLQuery(&sql);
 
   PushQueryFragment(node, sql);
   return absl::OkStatus();
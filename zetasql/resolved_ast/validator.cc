@@ -18,7 +18,9 @@
 
 #include <algorithm>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <type_traits>
+#include <utility>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/base/varsetter.h"
@@ -38,6 +40,7 @@
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_cat.h"
 #include "zetasql/base/map_util.h"
@@ -54,6 +57,156 @@ namespace zetasql {
 Validator::Validator(const LanguageOptions& language_options)
     : language_options_(language_options) {}
 
+Validator::Validator(const LanguageOptions& language_options,
+                     const ValidatorOptions& options)
+    : language_options_(language_options), options_(options) {}
+
+// A scan subtree being validated on a separate thread.
+struct Validator::ParallelTask {
+  std::unique_ptr<Validator> validator;
+  const ResolvedScan* scan = nullptr;
+  std::set<ResolvedColumn> visible_parameters;
+  absl::Status status;
+  std::thread thread;
+};
+
+static absl::Status MakeValidationFailedError(const absl::Status& status,
+                                              const ResolvedNode* node) {
+  if (status.code() == absl::StatusCode::kResourceExhausted) {
+    // Don't wrap a resource exhausted status into internal error. This error
+    // may still occur for a valid properly resolved expression (stack
+    // exhaustion in case of deeply nested expression). There exist cases
+    // where the validator uses more stack than parsing/analysis (b/65294961).
+    return status;
+  }
+  return ::zetasql_base::InternalErrorBuilder()
+         << "Resolved AST validation failed: " << status.message() << "\n"
+         << node->DebugString();
+}
+
+void Validator::PrepareTreeInfo(const ResolvedNode* root) {
+  tree_info_ = nullptr;
+  owned_tree_info_.reset();
+  if (!options_.incremental && options_.num_threads <= 1) {
+    return;
+  }
+  owned_tree_info_ = absl::make_unique<TreeInfo>();
+  bool all_validated = false;
+  owned_tree_info_->num_nodes =
+      CollectTreeInfo(root, /*in_modified_node=*/false, owned_tree_info_.get(),
+                      &all_validated);
+  if (options_.incremental && all_validated) {
+    owned_tree_info_->validated_subtrees.insert(root);
+  }
+  tree_info_ = owned_tree_info_.get();
+}
+
+int64_t Validator::CollectTreeInfo(const ResolvedNode* node,
+                                   bool in_modified_node, TreeInfo* tree_info,
+                                   bool* all_validated) const {
+  // The columns visible to an expression are determined by the scan or
+  // statement it belongs to. Once that node is modified, for example by
+  // replacing its input scan, the expressions below it must be checked again
+  // even if they were not modified themselves.
+  const bool modified =
+      !node->IsMarkedValidated() || (!node->IsScan() && in_modified_node);
+  std::vector<const ResolvedNode*> children;
+  node->GetChildNodes(&children);
+  std::vector<const ResolvedNode*> validated_children;
+  int64_t num_nodes = 1;
+  for (const ResolvedNode* child : children) {
+    bool child_validated = false;
+    num_nodes += CollectTreeInfo(child, modified, tree_info, &child_validated);
+    if (child_validated) {
+      validated_children.push_back(child);
+    }
+  }
+  *all_validated = node->IsMarkedValidated() &&
+                   validated_children.size() == children.size();
+
+  if (options_.incremental) {
+    // Validation is only skipped at scans and expressions. Record the
+    // outermost ones, unless this node itself will be skipped.
+    if (!*all_validated || !(node->IsScan() || node->IsExpression())) {
+      for (const ResolvedNode* child : validated_children) {
+        if (child->IsScan() || (child->IsExpression() && !modified)) {
+          tree_info->validated_subtrees.insert(child);
+        }
+      }
+    }
+  }
+  if (options_.num_threads > 1 && node->IsScan()) {
+    tree_info->scan_subtree_sizes[node] = num_nodes;
+  }
+  return num_nodes;
+}
+
+bool Validator::IsValidatedSubtree(const ResolvedNode* node) const {
+  return options_.incremental && tree_info_ != nullptr &&
+         tree_info_->validated_subtrees.contains(node);
+}
+
+bool Validator::ShouldValidateInParallel(const ResolvedScan* scan) const {
+  if (options_.num_threads <= 1 || tree_info_ == nullptr ||
+      static_cast<int>(parallel_tasks_.size()) + 1 >= options_.num_threads) {
+    return false;
+  }
+  const int64_t* num_nodes =
+      zetasql_base::FindOrNull(tree_info_->scan_subtree_sizes, scan);
+  // A subtree holding most of the tree would leave this thread idle.
+  return num_nodes != nullptr &&
+         *num_nodes >= options_.parallel_min_subtree_size &&
+         2 * *num_nodes <= tree_info_->num_nodes;
+}
+
+void Validator::StartParallelValidation(
+    const ResolvedScan* scan,
+    const std::set<ResolvedColumn>& visible_parameters) {
+  ValidatorOptions task_options = options_;
+  task_options.num_threads = 1;
+  auto task = absl::make_unique<ParallelTask>();
+  task->validator =
+      absl::make_unique<Validator>(language_options_, task_options);
+  Validator* validator = task->validator.get();
+  validator->tree_info_ = tree_info_;
+  validator->allowed_argument_kinds_ = allowed_argument_kinds_;
+  validator->current_create_table_function_stmt_ =
+      current_create_table_function_stmt_;
+  validator->nested_recursive_context_count_ = nested_recursive_context_count_;
+  validator->nested_recursive_term_count_ = nested_recursive_term_count_;
+  task->scan = scan;
+  task->visible_parameters = visible_parameters;
+
+  ParallelTask* task_ptr = task.get();
+  task->thread = std::thread([task_ptr]() {
+    task_ptr->status = task_ptr->validator->ValidateResolvedScan(
+        task_ptr->scan, task_ptr->visible_parameters);
+  });
+  parallel_tasks_.push_back(std::move(task));
+}
+
+absl::Status Validator::FinishParallelValidation() {
+  absl::Status status;
+  for (const std::unique_ptr<ParallelTask>& task : parallel_tasks_) {
+    task->thread.join();
+    status.Update(task->status);
+  }
+  parallel_tasks_.clear();
+  return status;
+}
+
+void Validator::MarkSubtreeValidated(const ResolvedNode* node) const {
+  if (IsValidatedSubtree(node)) {
+    return;
+  }
+  node->SetValidatedMarker(true);
+  std::vector<const ResolvedNode*> children;
+  node->GetChildNodes(&children);
+  for (const ResolvedNode* child : children) {
+    MarkSubtreeValidated(child);
+  }
+}
+
 static bool IsEmptyWindowFrame(const ResolvedWindowFrame& window_frame) {
   const ResolvedWindowFrameExpr* frame_start_expr = window_frame.start_expr();
   const ResolvedWindowFrameExpr* frame_end_expr = window_frame.end_expr();
@@ -128,7 +281,10 @@ absl::Status Validator::CheckColumnList(
 
 Validator::Validator() {}
 
-Validator::~Validator() {}
+Validator::~Validator() {
+  // Only non-empty if validation was interrupted.
+  FinishParallelValidation().IgnoreError();
+}
 
 absl::Status Validator::ValidateResolvedExprList(
     const std::set<ResolvedColumn>& visible_columns,
@@ -220,21 +376,20 @@ absl::Status Validator::ValidateResolvedFunctionCallBase(
 
 absl::Status Validator::ValidateStandaloneResolvedExpr(
     const ResolvedExpr* expr) {
-  const absl::Status status =
+  ZETASQL_RET_CHECK(nullptr != expr);
+  PrepareTreeInfo(expr);
+  absl::Status status =
       ValidateResolvedExpr({} /* visible_columns */,
                            {} /* visible_parameters */,
                            expr);
+  status.Update(FinishParallelValidation());
+  if (status.ok() && options_.incremental) {
+    MarkSubtreeValidated(expr);
+  }
+  tree_info_ = nullptr;
+  owned_tree_info_.reset();
   if (!status.ok()) {
-    if (status.code() == absl::StatusCode::kResourceExhausted) {
-      // Don't wrap a resource exhausted status into internal error. This error
-      // may still occur for a valid properly resolved expression (stack
-      // exhaustion in case of deeply nested expression). There exist cases
-      // where the validator uses more stack than parsing/analysis (b/65294961).
-      return status;
-    }
-    return ::zetasql_base::InternalErrorBuilder()
-           << "Resolved AST validation failed: " << status.message() << "\n"
-           << expr->DebugString();
+    return MakeValidationFailedError(status, expr);
   }
   return absl::OkStatus();
 }
@@ -245,6 +400,9 @@ absl::Status Validator::ValidateResolvedExpr(
     const ResolvedExpr* expr) {
 
   ZETASQL_RET_CHECK(nullptr != expr);
+  if (IsValidatedSubtree(expr)) {
+    return absl::OkStatus();
+  }
   ZETASQL_RET_CHECK(expr->type() != nullptr)
       << "ResolvedExpr does not have a Type:\n" << expr->DebugString();
 
@@ -1547,6 +1705,26 @@ absl::Status Validator::ValidateResolvedWithScan(
 absl::Status Validator::ValidateResolvedStatement(
     const ResolvedStatement* statement) {
   ZETASQL_RET_CHECK(nullptr != statement);
+  PrepareTreeInfo(statement);
+  absl::Status status;
+  if (!IsValidatedSubtree(statement)) {
+    status = ValidateResolvedStatementInternal(statement);
+    const absl::Status parallel_status = FinishParallelValidation();
+    if (status.ok() && !parallel_status.ok()) {
+      status = MakeValidationFailedError(parallel_status, statement);
+    }
+  }
+  if (status.ok() && options_.incremental) {
+    MarkSubtreeValidated(statement);
+  }
+  tree_info_ = nullptr;
+  owned_tree_info_.reset();
+  return status;
+}
+
+absl::Status Validator::ValidateResolvedStatementInternal(
+    const ResolvedStatement* statement) {
+  ZETASQL_RET_CHECK(nullptr != statement);
 
   absl::Status status;
   switch (statement->node_kind()) {
@@ -1554,7 +1732,7 @@ absl::Status Validator::ValidateResolvedStatement(
       status = ValidateResolvedQueryStmt(statement->GetAs<ResolvedQueryStmt>());
       break;
     case RESOLVED_EXPLAIN_STMT:
-      status = ValidateResolvedStatement(
+      status = ValidateResolvedStatementInternal(
           statement->GetAs<ResolvedExplainStmt>()->statement());
       break;
     case RESOLVED_CREATE_DATABASE_STMT:
@@ -1763,16 +1941,7 @@ absl::Status Validator::ValidateResolvedStatement(
   status.Update(ValidateHintList(statement->hint_list()));
 
   if (!status.ok()) {
-    if (status.code() == absl::StatusCode::kResourceExhausted) {
-      // Don't wrap a resource exhausted status into internal error. This error
-      // may still occur for a valid properly resolved expression (stack
-      // exhaustion in case of deeply nested expression). There exist cases
-      // where the validator uses more stack than parsing/analysis (b/65294961).
-      return status;
-    }
-    return ::zetasql_base::InternalErrorBuilder()
-           << "Resolved AST validation failed: " << status.message() << "\n"
-           << statement->DebugString();
+    return MakeValidationFailedError(status, statement);
   }
   return absl::OkStatus();
 }
@@ -2467,6 +2636,14 @@ absl::Status Validator::ValidateResolvedScan(
     const ResolvedScan* scan,
     const std::set<ResolvedColumn>& visible_parameters) {
   ZETASQL_RET_CHECK(nullptr != scan);
+  if (IsValidatedSubtree(scan)) {
+    return absl::OkStatus();
+  }
+  if (ShouldValidateInParallel(scan)) {
+    // Errors are reported by FinishParallelValidation().
+    StartParallelValidation(scan, visible_parameters);
+    return absl::OkStatus();
+  }
 
   switch (scan->node_kind()) {
     case RESOLVED_SINGLE_ROW_SCAN:
@@ -17,6 +17,7 @@
 #ifndef ZETASQL_RESOLVED_AST_VALIDATOR_H_
 #define ZETASQL_RESOLVED_AST_VALIDATOR_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <set>
@@ -27,11 +28,35 @@
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include "zetasql/resolved_ast/resolved_ast_enums.pb.h"
 #include "zetasql/resolved_ast/resolved_column.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "zetasql/base/status.h"
 
 namespace zetasql {
 
+struct ValidatorOptions {
+  // If true, subtrees in which every node is marked as validated (see
+  // ResolvedNode::IsMarkedValidated()) are not validated again. Every
+  // successful incremental validation marks all nodes of the validated tree,
+  // and the generated setters of a node clear its marker, so after a rewriter
+  // pass only the nodes it created or modified, their ancestors, and the
+  // expressions of modified scans are checked.
+  //
+  // A skipped subtree is assumed to still be valid where it is now used. In
+  // particular, a rewriter that moves an unmodified subtree with correlated
+  // column references must make sure those columns are still visible there.
+  bool incremental = false;
+
+  // Maximum number of threads used to validate one tree, including the
+  // calling thread. With more than one thread, scan subtrees with at least
+  // <parallel_min_subtree_size> nodes are validated on separate threads while
+  // the calling thread continues with the rest of the tree. When several
+  // subtrees are invalid, the error reported may differ from the one found by
+  // single-threaded validation.
+  int num_threads = 1;
+  int64_t parallel_min_subtree_size = 1000;
+};
+
 // Used to validate generated Resolved AST structures.
 //  * verifies that any column reference  within the resolved tree should be
 //    either from the column_list of one of the child nodes of the parent scan
@@ -40,6 +65,8 @@ class Validator {
  public:
   Validator();
   explicit Validator(const LanguageOptions& language_options);
+  Validator(const LanguageOptions& language_options,
+            const ValidatorOptions& options);
   Validator(const Validator&) = delete;
   Validator& operator=(const Validator&) = delete;
   ~Validator();
@@ -49,6 +76,54 @@ class Validator {
   absl::Status ValidateStandaloneResolvedExpr(const ResolvedExpr* expr);
 
  private:
+  struct ParallelTask;
+
+  // Information about the tree being validated, collected before validation
+  // when incremental or parallel validation is enabled.
+  struct TreeInfo {
+    // Roots of subtrees in which every node is marked as validated. Only
+    // filled in incremental mode.
+    absl::flat_hash_set<const ResolvedNode*> validated_subtrees;
+    // Number of nodes below each scan, inclusive. Only filled when
+    // validating in parallel.
+    absl::flat_hash_map<const ResolvedNode*, int64_t> scan_subtree_sizes;
+    int64_t num_nodes = 0;
+  };
+
+  // Collects <owned_tree_info_> for the tree rooted at <root>, if needed.
+  void PrepareTreeInfo(const ResolvedNode* root);
+
+  // Fills <tree_info> for the subtree rooted at <node>. Returns the number of
+  // nodes in the subtree and sets <*all_validated> if they are all marked as
+  // validated. <in_modified_node> is true if <node> belongs to a scan or
+  // statement that is not marked as validated, in which case expressions
+  // below <node> are not skipped.
+  int64_t CollectTreeInfo(const ResolvedNode* node, bool in_modified_node,
+                          TreeInfo* tree_info, bool* all_validated) const;
+
+  // Returns true if <node> is the root of a subtree that does not need to be
+  // validated again in incremental mode.
+  bool IsValidatedSubtree(const ResolvedNode* node) const;
+
+  // Returns true if <scan> should be validated on a separate thread.
+  bool ShouldValidateInParallel(const ResolvedScan* scan) const;
+
+  // Starts validating <scan> on a separate thread, with a Validator in the
+  // same state as this one.
+  void StartParallelValidation(
+      const ResolvedScan* scan,
+      const std::set<ResolvedColumn>& visible_parameters);
+
+  // Waits for all parallel validations and returns the first error in the
+  // order they were started.
+  absl::Status FinishParallelValidation();
+
+  // Marks all nodes in the tree rooted at <node> as validated.
+  void MarkSubtreeValidated(const ResolvedNode* node) const;
+
+  absl::Status ValidateResolvedStatementInternal(
+      const ResolvedStatement* statement);
+
   // Statements.
   absl::Status ValidateResolvedQueryStmt(const ResolvedQueryStmt* query);
   absl::Status ValidateResolvedCreateDatabaseStmt(
@@ -430,6 +505,16 @@ class Validator {
 
   const LanguageOptions language_options_;
 
+  const ValidatorOptions options_;
+
+  // Set during ValidateResolvedStatement() and
+  // ValidateStandaloneResolvedExpr(). Points to <owned_tree_info_>, or to the
+  // TreeInfo of the Validator that started this one on a separate thread.
+  const TreeInfo* tree_info_ = nullptr;
+  std::unique_ptr<TreeInfo> owned_tree_info_;
+
+  std::vector<std::unique_ptr<ParallelTask>> parallel_tasks_;
+
   // The number of nested "recursive contexts" we are in. A "recursive context"
   // is either a WITH entry of a recursive WITH or the body of a recursive view.
   // A ResolvedRecursiveScan node is legal only if this value is > 0.
@@ -329,6 +329,11 @@ class IgnoreReadTimeIterator : public EvaluatorTableIterator {
       override {
     return iterator_->SetColumnFilterMap(std::move(filter_map));
   }
+  absl::Status SetColumnProtoFieldPathMap(
+      absl::flat_hash_map<int, std::vector<ProtoFieldPath>> field_path_map)
+      override {
+    return iterator_->SetColumnProtoFieldPathMap(std::move(field_path_map));
+  }
   absl::Status SetReadTime(absl::Time read_time) override {
     return absl::OkStatus();
   }